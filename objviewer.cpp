@@ -4,9 +4,13 @@
 #include <d3dcompiler.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <malloc.h>
 #include <string.h>
 #include <stdint.h>
+#include <float.h>
 #include <math.h>
+#include <intrin.h>
+#include <type_traits>
 #define STB_TRUETYPE_IMPLEMENTATION
 #include <stb_truetype.h>
 
@@ -17,6 +21,8 @@
 #endif
 
 #define ARRAY_LEN(x) sizeof(x) / sizeof((x)[0])
+// a StringView of a string literal without scanning it for the terminator
+#define STRING_VIEW(x) StringView{ .start = (x), .len = sizeof(x) - 1 }
 
 #define CHECK_CBUFFER_ALIGNMENT(x) static_assert(sizeof(x) % 16 == 0, "constant buffer data must be 16-byte aligned")
 
@@ -102,15 +108,6 @@ static Vec3 lineVertices[] = {
     {  0.5f, 0.0f, 0.0f }
 };
 
-static Vec3 quadVertices[] = {
-    { 0.0f, 1.0f, 0.0f },
-    { 0.0f, 0.0f, 0.0f },
-    { 1.0f, 0.0f, 0.0f },
-    { 1.0f, 0.0f, 0.0f },
-    { 1.0f, 1.0f, 0.0f },
-    { 0.0f, 1.0f, 0.0f }
-};
-
 LRESULT CALLBACK WindowProc(HWND hwnd, UINT uMsg, WPARAM wParam, LPARAM lParam)
 {
     if(uMsg == WM_CLOSE)
@@ -176,6 +173,8 @@ enum class Vkey
     A = 'A',
     Space = VK_SPACE,
     F1 = VK_F1,
+    F2 = VK_F2,
+    F3 = VK_F3,
     LeftMouse = VK_LBUTTON
 };
 
@@ -196,6 +195,8 @@ struct Input
     Keybind moveDown;
     Keybind moveUp;
     Keybind devToggle;
+    Keybind toggleInstances;
+    Keybind exportFrameTimes;
     Keybind dragModel;
     int mousePosX;
     int mousePosY;
@@ -251,6 +252,8 @@ void ResetInputKeyTransitions(Input* input)
     ResetKeyTransitions(&input->moveDown);
     ResetKeyTransitions(&input->moveUp);
     ResetKeyTransitions(&input->devToggle);
+    ResetKeyTransitions(&input->toggleInstances);
+    ResetKeyTransitions(&input->exportFrameTimes);
     ResetKeyTransitions(&input->dragModel);
 }
 
@@ -325,6 +328,8 @@ bool ProcessWindowEvents(Input* input)
             HandleKeyUpForBind(&input->moveDown, &event);
             HandleKeyUpForBind(&input->moveUp, &event);
             HandleKeyUpForBind(&input->devToggle, &event);
+            HandleKeyUpForBind(&input->toggleInstances, &event);
+            HandleKeyUpForBind(&input->exportFrameTimes, &event);
         }
         else if(event.message == WM_KEYDOWN)
         {
@@ -335,6 +340,8 @@ bool ProcessWindowEvents(Input* input)
             HandleKeyDownForBind(&input->moveDown, &event);
             HandleKeyDownForBind(&input->moveUp, &event);
             HandleKeyDownForBind(&input->devToggle, &event);
+            HandleKeyDownForBind(&input->toggleInstances, &event);
+            HandleKeyDownForBind(&input->exportFrameTimes, &event);
         }
         else if(event.message == WM_QUIT)
         {
@@ -530,10 +537,12 @@ void FreeDx11VertexBuffer(Dx11VertexBuffer* vertexBuffer)
 enum class BufferUsageType
 {
     Static,
-    Dynamic
+    Dynamic,
+    // default usage, for partial updates with UploadDataToBufferRange
+    Updatable
 };
 
-Dx11VertexBuffer CreateDx11VertexBuffer(Dx11& dx, BufferUsageType usageType, void* data, size_t byteSize, UINT stride, UINT byteOffset)
+Dx11VertexBuffer CreateDx11VertexBuffer(Dx11& dx, BufferUsageType usageType, const void* data, size_t byteSize, UINT stride, UINT byteOffset)
 {
     D3D11_USAGE usage = D3D11_USAGE_IMMUTABLE;
     UINT cpuAccess = 0;
@@ -542,6 +551,9 @@ Dx11VertexBuffer CreateDx11VertexBuffer(Dx11& dx, BufferUsageType usageType, voi
         usage = D3D11_USAGE_DYNAMIC;
         cpuAccess |= D3D11_CPU_ACCESS_WRITE;
     }
+    else if(usageType == BufferUsageType::Updatable) {
+        usage = D3D11_USAGE_DEFAULT;
+    }
 
     D3D11_BUFFER_DESC vertexBufferDesc = {
         .ByteWidth = (UINT)byteSize,
@@ -551,7 +563,7 @@ Dx11VertexBuffer CreateDx11VertexBuffer(Dx11& dx, BufferUsageType usageType, voi
     };
 
     D3D11_SUBRESOURCE_DATA vertexBufData;
-    D3D11_SUBRESOURCE_DATA* vertexBufDataPtr;
+    D3D11_SUBRESOURCE_DATA* vertexBufDataPtr = nullptr;
     if(data != nullptr) {
         vertexBufData = { .pSysMem = data };
         vertexBufDataPtr = &vertexBufData;
@@ -593,7 +605,11 @@ enum class InputElType
     Position,
     TexCoord,
     Normal,
-    Matrix
+    Tangent,
+    Matrix,
+    NormalMatrix,
+    GlyphRect,
+    GlyphUvRect
 };
 
 D3D11_INPUT_ELEMENT_DESC CreateDx11InputElDesc(InputElType type, UINT typeIndex, UINT slot, UINT byteOffset, 
@@ -640,6 +656,18 @@ D3D11_INPUT_ELEMENT_DESC CreateDx11InputElDesc(InputElType type, UINT typeIndex,
                 .InstanceDataStepRate = instanceStepRate
             };
         }
+        case InputElType::Tangent:
+        {
+            return {
+                .SemanticName = "TANGENT",
+                .SemanticIndex = typeIndex,
+                .Format = DXGI_FORMAT_R32G32B32A32_FLOAT,
+                .InputSlot = slot,
+                .AlignedByteOffset = byteOffset,
+                .InputSlotClass = inputSlotClass,
+                .InstanceDataStepRate = instanceStepRate
+            };
+        }
         case InputElType::Matrix:
         {
             return {
@@ -652,6 +680,42 @@ D3D11_INPUT_ELEMENT_DESC CreateDx11InputElDesc(InputElType type, UINT typeIndex,
                 .InstanceDataStepRate = instanceStepRate
             };
         }
+        case InputElType::NormalMatrix:
+        {
+            return {
+                .SemanticName = "NORMALMATRIX",
+                .SemanticIndex = typeIndex,
+                .Format = DXGI_FORMAT_R32G32B32A32_FLOAT,
+                .InputSlot = slot,
+                .AlignedByteOffset = byteOffset,
+                .InputSlotClass = inputSlotClass,
+                .InstanceDataStepRate = instanceStepRate
+            };
+        }
+        case InputElType::GlyphRect:
+        {
+            return {
+                .SemanticName = "RECT",
+                .SemanticIndex = typeIndex,
+                .Format = DXGI_FORMAT_R32G32B32A32_FLOAT,
+                .InputSlot = slot,
+                .AlignedByteOffset = byteOffset,
+                .InputSlotClass = inputSlotClass,
+                .InstanceDataStepRate = instanceStepRate
+            };
+        }
+        case InputElType::GlyphUvRect:
+        {
+            return {
+                .SemanticName = "UVRECT",
+                .SemanticIndex = typeIndex,
+                .Format = DXGI_FORMAT_R16G16B16A16_UNORM,
+                .InputSlot = slot,
+                .AlignedByteOffset = byteOffset,
+                .InputSlotClass = inputSlotClass,
+                .InstanceDataStepRate = instanceStepRate
+            };
+        }
         default:
             ASSERT(false);
             return {};
@@ -679,8 +743,10 @@ ID3D11InputLayout* CreateBasicColorDx11InputLayout(Dx11* dx, ID3DBlob* vsByteCod
 ID3D11InputLayout* CreatePhongDx11InputLayout(Dx11* dx, ID3DBlob* vsByteCode)
 {
     D3D11_INPUT_ELEMENT_DESC inputElements[] = {
+        // interleaved ModelVertex
         CreateDx11InputElDesc(InputElType::Position, 0, 0, 0, false, 0),
-        CreateDx11InputElDesc(InputElType::Normal, 0, 1, 0, false, 0)
+        CreateDx11InputElDesc(InputElType::Normal, 0, 0, sizeof(Vec3), false, 0),
+        CreateDx11InputElDesc(InputElType::Tangent, 0, 0, 2 * sizeof(Vec3), false, 0)
     };
 
     ID3D11InputLayout* inputLayout = nullptr;
@@ -695,24 +761,47 @@ ID3D11InputLayout* CreatePhongDx11InputLayout(Dx11* dx, ID3DBlob* vsByteCode)
     return inputLayout;
 }
 
-ID3D11InputLayout* CreateTextDx11InputLayout(Dx11* dx, ID3DBlob* vsByteCode)
+ID3D11InputLayout* CreatePhongInstancedDx11InputLayout(Dx11* dx, ID3DBlob* vsByteCode)
 {
     UINT instanceStepRate = 1;
 
     D3D11_INPUT_ELEMENT_DESC inputElements[] = {
+        // interleaved ModelVertex
         CreateDx11InputElDesc(InputElType::Position, 0, 0, 0, false, 0),
-        
+        CreateDx11InputElDesc(InputElType::Normal, 0, 0, sizeof(Vec3), false, 0),
+        CreateDx11InputElDesc(InputElType::Tangent, 0, 0, 2 * sizeof(Vec3), false, 0),
+
         CreateDx11InputElDesc(InputElType::Matrix, 0, 1, 0, true, instanceStepRate),
         CreateDx11InputElDesc(InputElType::Matrix, 1, 1, 1 * sizeof(Vec4), true, instanceStepRate),
         CreateDx11InputElDesc(InputElType::Matrix, 2, 1, 2 * sizeof(Vec4), true, instanceStepRate),
         CreateDx11InputElDesc(InputElType::Matrix, 3, 1, 3 * sizeof(Vec4), true, instanceStepRate),
 
-        CreateDx11InputElDesc(InputElType::TexCoord, 0, 1, 4 * sizeof(Vec4), true, 1),
-        CreateDx11InputElDesc(InputElType::TexCoord, 1, 1, (4 * sizeof(Vec4)) + (1 * sizeof(Vec2)), true, instanceStepRate),
-        CreateDx11InputElDesc(InputElType::TexCoord, 2, 1, (4 * sizeof(Vec4)) + (2 * sizeof(Vec2)), true, instanceStepRate),
-        CreateDx11InputElDesc(InputElType::TexCoord, 3, 1, (4 * sizeof(Vec4)) + (3 * sizeof(Vec2)), true, instanceStepRate),
-        CreateDx11InputElDesc(InputElType::TexCoord, 4, 1, (4 * sizeof(Vec4)) + (4 * sizeof(Vec2)), true, instanceStepRate),
-        CreateDx11InputElDesc(InputElType::TexCoord, 5, 1, (4 * sizeof(Vec4)) + (5 * sizeof(Vec2)), true, instanceStepRate),
+        CreateDx11InputElDesc(InputElType::NormalMatrix, 0, 1, 4 * sizeof(Vec4), true, instanceStepRate),
+        CreateDx11InputElDesc(InputElType::NormalMatrix, 1, 1, 5 * sizeof(Vec4), true, instanceStepRate),
+        CreateDx11InputElDesc(InputElType::NormalMatrix, 2, 1, 6 * sizeof(Vec4), true, instanceStepRate),
+        CreateDx11InputElDesc(InputElType::NormalMatrix, 3, 1, 7 * sizeof(Vec4), true, instanceStepRate),
+    };
+
+    ID3D11InputLayout* inputLayout = nullptr;
+    HRESULT res = dx->device->CreateInputLayout(
+        inputElements,
+        ARRAY_LEN(inputElements),
+        vsByteCode->GetBufferPointer(),
+        vsByteCode->GetBufferSize(),
+        &inputLayout
+    );
+    ASSERT(res == S_OK);
+    return inputLayout;
+}
+
+ID3D11InputLayout* CreateTextDx11InputLayout(Dx11* dx, ID3DBlob* vsByteCode)
+{
+    UINT instanceStepRate = 1;
+
+    // no per-vertex stream, the vertex shader builds the quad corners from SV_VertexID
+    D3D11_INPUT_ELEMENT_DESC inputElements[] = {
+        CreateDx11InputElDesc(InputElType::GlyphRect, 0, 0, 0, true, instanceStepRate),
+        CreateDx11InputElDesc(InputElType::GlyphUvRect, 0, 0, sizeof(Vec4), true, instanceStepRate),
     };
 
     ID3D11InputLayout* inputLayout = nullptr;
@@ -833,6 +922,119 @@ String ReadAllTextFromFile(const char* filename)
     };
 }
 
+bool WriteAllBytesToFile(const char* filename, const void* data, size_t byteSize)
+{
+    ASSERT(byteSize < 0xFFFFFFFF);
+
+    HANDLE file = CreateFileA(
+        filename,
+        GENERIC_WRITE,
+        0,
+        nullptr,
+        CREATE_ALWAYS,
+        FILE_ATTRIBUTE_NORMAL,
+        nullptr
+    );
+    if(file == INVALID_HANDLE_VALUE)
+        return false;
+
+    DWORD bytesWritten = 0;
+    BOOL res = WriteFile(file, data, (DWORD)byteSize, &bytesWritten, nullptr);
+    CloseHandle(file);
+
+    return res && bytesWritten == byteSize;
+}
+
+struct FileInfo
+{
+    uint64_t byteSize;
+    uint64_t lastWriteTime;
+};
+
+// does not assert, a missing file is a normal outcome for callers checking caches
+bool GetFileInfo(const char* filename, FileInfo* info)
+{
+    HANDLE file = CreateFileA(
+        filename,
+        GENERIC_READ,
+        FILE_SHARE_READ,
+        nullptr,
+        OPEN_EXISTING,
+        FILE_ATTRIBUTE_NORMAL,
+        nullptr
+    );
+    if(file == INVALID_HANDLE_VALUE)
+        return false;
+
+    LARGE_INTEGER fileSize = {};
+    FILETIME writeTime = {};
+    bool res = GetFileSizeEx(file, &fileSize) && GetFileTime(file, nullptr, nullptr, &writeTime);
+    CloseHandle(file);
+
+    *info = {
+        .byteSize = (uint64_t)fileSize.QuadPart,
+        .lastWriteTime = ((uint64_t)writeTime.dwHighDateTime << 32) | writeTime.dwLowDateTime
+    };
+    return res;
+}
+
+struct MappedFile
+{
+    HANDLE file;
+    HANDLE mapping;
+    const unsigned char* data;
+    size_t len;
+};
+
+void FreeMappedFile(MappedFile* mappedFile)
+{
+    if(mappedFile->data != nullptr)
+        UnmapViewOfFile(mappedFile->data);
+    if(mappedFile->mapping != nullptr)
+        CloseHandle(mappedFile->mapping);
+    if(mappedFile->file != nullptr && mappedFile->file != INVALID_HANDLE_VALUE)
+        CloseHandle(mappedFile->file);
+    *mappedFile = {};
+}
+
+// returns an empty MappedFile when the file doesn't exist or is empty
+MappedFile MapFileForReading(const char* filename)
+{
+    MappedFile mappedFile = {};
+    mappedFile.file = CreateFileA(
+        filename,
+        GENERIC_READ,
+        FILE_SHARE_READ,
+        nullptr,
+        OPEN_EXISTING,
+        FILE_ATTRIBUTE_NORMAL,
+        nullptr
+    );
+    if(mappedFile.file == INVALID_HANDLE_VALUE)
+        return {};
+
+    LARGE_INTEGER fileSize = {};
+    if(!GetFileSizeEx(mappedFile.file, &fileSize) || fileSize.QuadPart == 0) {
+        FreeMappedFile(&mappedFile);
+        return {};
+    }
+    mappedFile.len = (size_t)fileSize.QuadPart;
+
+    mappedFile.mapping = CreateFileMappingA(mappedFile.file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if(mappedFile.mapping == nullptr) {
+        FreeMappedFile(&mappedFile);
+        return {};
+    }
+
+    mappedFile.data = (const unsigned char*)MapViewOfFile(mappedFile.mapping, FILE_MAP_READ, 0, 0, 0);
+    if(mappedFile.data == nullptr) {
+        FreeMappedFile(&mappedFile);
+        return {};
+    }
+
+    return mappedFile;
+}
+
 enum class ShaderType
 {
     Vertex,
@@ -892,11 +1094,46 @@ float toDegrees(float radians)
     return radians * (float)radiansToDegreesFactor;
 }
 
-float toRadians(float degrees)
+constexpr float toRadians(float degrees)
 {
     return degrees * (float)degreesToRadiansFactor;
 }
 
+// compile time sine for constexpr tables, runtime code keeps using sinf
+constexpr double ConstexprSin(double x)
+{
+    // reduce to [-pi, pi] and then to [-pi/2, pi/2] where the taylor series converges quickly
+    double turns = x / (2.0 * pi);
+    double wholeTurns = (double)(int64_t)(turns + (turns >= 0.0 ? 0.5 : -0.5));
+    x -= wholeTurns * 2.0 * pi;
+    if(x > pi / 2.0)
+        x = pi - x;
+    else if(x < -pi / 2.0)
+        x = -pi - x;
+
+    double xSq = x * x;
+    double term = x;
+    double sum = x;
+    for(int i = 1; i <= 9; i++) {
+        term *= -xSq / ((2.0 * i) * ((2.0 * i) + 1.0));
+        sum += term;
+    }
+    return sum;
+}
+
+constexpr double ConstexprCos(double x)
+{
+    return ConstexprSin(x + (pi / 2.0));
+}
+
+constexpr bool IsNearlyEqual(double one, double other, double epsilon)
+{
+    return (one - other) <= epsilon && (other - one) <= epsilon;
+}
+
+static_assert(IsNearlyEqual(ConstexprSin(pi / 6.0), 0.5, 1e-12), "constexpr sine is off");
+static_assert(IsNearlyEqual(ConstexprCos(-4.0 * pi / 3.0), -0.5, 1e-12), "constexpr cosine is off");
+
 float Clamp(float min, float max, float value)
 {
     if(value < min)
@@ -907,6 +1144,53 @@ float Clamp(float min, float max, float value)
         return value;
 }
 
+// alignment must be a power of 2
+size_t AlignUp(size_t value, size_t alignment)
+{
+    return (value + alignment - 1) & ~(alignment - 1);
+}
+
+struct CpuFeatures
+{
+    bool hasSse2;
+    bool hasSse41;
+    bool hasAvx;
+    bool hasAvx2;
+    bool hasFma;
+};
+
+CpuFeatures QueryCpuFeatures()
+{
+    int info[4] = {};
+    __cpuid(info, 0);
+    int maxLeaf = info[0];
+
+    CpuFeatures features = {};
+    __cpuid(info, 1);
+    features.hasSse2 = (info[3] & (1 << 26)) != 0;
+    features.hasSse41 = (info[2] & (1 << 19)) != 0;
+    features.hasFma = (info[2] & (1 << 12)) != 0;
+    bool hasOsxsave = (info[2] & (1 << 27)) != 0;
+    bool cpuHasAvx = (info[2] & (1 << 28)) != 0;
+
+    // the OS also has to save the ymm registers on context switches
+    bool osSavesYmm = hasOsxsave && (_xgetbv(0) & 0x6) == 0x6;
+    features.hasAvx = cpuHasAvx && osSavesYmm;
+    features.hasFma = features.hasFma && features.hasAvx;
+
+    if(maxLeaf >= 7) {
+        __cpuidex(info, 7, 0);
+        features.hasAvx2 = features.hasAvx && (info[1] & (1 << 5)) != 0;
+    }
+    return features;
+}
+
+const CpuFeatures& GetCpuFeatures()
+{
+    static CpuFeatures features = QueryCpuFeatures();
+    return features;
+}
+
 Vec3 operator + (const Vec3& one, const Vec3& other)
 {
     return {
@@ -967,6 +1251,141 @@ Vec3 Cross(const Vec3& one, const Vec3& other)
     };
 }
 
+Vec3 Min(const Vec3& one, const Vec3& other)
+{
+    return {
+        .x = one.x < other.x ? one.x : other.x,
+        .y = one.y < other.y ? one.y : other.y,
+        .z = one.z < other.z ? one.z : other.z
+    };
+}
+
+Vec3 Max(const Vec3& one, const Vec3& other)
+{
+    return {
+        .x = one.x > other.x ? one.x : other.x,
+        .y = one.y > other.y ? one.y : other.y,
+        .z = one.z > other.z ? one.z : other.z
+    };
+}
+
+float GetVec3Component(const Vec3& vec, int axis)
+{
+    return axis == 0 ? vec.x : (axis == 1 ? vec.y : vec.z);
+}
+
+struct Aabb
+{
+    Vec3 min;
+    Vec3 max;
+};
+
+Aabb EmptyAabb()
+{
+    return {
+        .min = {  FLT_MAX,  FLT_MAX,  FLT_MAX },
+        .max = { -FLT_MAX, -FLT_MAX, -FLT_MAX }
+    };
+}
+
+Aabb Union(const Aabb& one, const Aabb& other)
+{
+    return { .min = Min(one.min, other.min), .max = Max(one.max, other.max) };
+}
+
+Aabb Grow(const Aabb& box, const Vec3& point)
+{
+    return { .min = Min(box.min, point), .max = Max(box.max, point) };
+}
+
+float SurfaceArea(const Aabb& box)
+{
+    Vec3 extent = box.max - box.min;
+    if(extent.x < 0.0f || extent.y < 0.0f || extent.z < 0.0f)
+        return 0.0f;
+    return 2.0f * ((extent.x * extent.y) + (extent.y * extent.z) + (extent.z * extent.x));
+}
+
+struct BoundingSphere
+{
+    Vec3 center;
+    float radius;
+};
+
+struct ModelBounds
+{
+    Aabb box;
+    BoundingSphere sphere;
+};
+
+// running bounds so they can be gathered while the positions are parsed instead of in a separate pass
+struct BoundsAccumulator
+{
+    __m128 min;
+    __m128 max;
+    BoundingSphere sphere;
+    bool hasPoints;
+};
+
+BoundsAccumulator CreateBoundsAccumulator()
+{
+    return {
+        .min = _mm_set1_ps(FLT_MAX),
+        .max = _mm_set1_ps(-FLT_MAX)
+    };
+}
+
+void AddPointToBounds(BoundsAccumulator* bounds, Vec3 point)
+{
+    __m128 p = _mm_setr_ps(point.x, point.y, point.z, point.z);
+    bounds->min = _mm_min_ps(bounds->min, p);
+    bounds->max = _mm_max_ps(bounds->max, p);
+
+    if(!bounds->hasPoints) {
+        bounds->sphere = { .center = point, .radius = 0.0f };
+        bounds->hasPoints = true;
+        return;
+    }
+
+    // Ritter style single pass growth: move the sphere just far enough to touch the new point
+    Vec3 toPoint = point - bounds->sphere.center;
+    float distSquared = Dot(toPoint, toPoint);
+    float radius = bounds->sphere.radius;
+    if(distSquared > radius * radius) {
+        float dist = sqrtf(distSquared);
+        float newRadius = (radius + dist) * 0.5f;
+        bounds->sphere.center = bounds->sphere.center + (toPoint * ((newRadius - radius) / dist));
+        bounds->sphere.radius = newRadius;
+    }
+}
+
+ModelBounds GetBoundsFromAccumulator(const BoundsAccumulator& bounds)
+{
+    if(!bounds.hasPoints)
+        return {};
+
+    alignas(16) float minValues[4];
+    alignas(16) float maxValues[4];
+    _mm_store_ps(minValues, bounds.min);
+    _mm_store_ps(maxValues, bounds.max);
+
+    ModelBounds res = {
+        .box = {
+            .min = { minValues[0], minValues[1], minValues[2] },
+            .max = { maxValues[0], maxValues[1], maxValues[2] }
+        },
+        .sphere = bounds.sphere
+    };
+
+    // the box's circumsphere also contains every point, keep whichever is tighter
+    Vec3 boxCenter = (res.box.min + res.box.max) * 0.5f;
+    float boxRadius = Len(res.box.max - boxCenter);
+    if(boxRadius < res.sphere.radius)
+        res.sphere = { .center = boxCenter, .radius = boxRadius };
+
+    return res;
+}
+
 Vec4 operator + (const Vec4& one, const Vec4& other)
 {
     return {
@@ -1012,7 +1431,9 @@ struct Mat4
     float data[4][4];
 };
 
-Mat4 operator * (const Mat4& one, const Mat4& other)
+// every column of a Mat4 is 4 contiguous floats, so a result column is the sum of the left columns
+// scaled by the entries of the right column, the sse path sums in the same order as the scalar one
+constexpr Mat4 MulMat4Scalar(const Mat4& one, const Mat4& other)
 {
     Mat4 res = {};
 
@@ -1029,48 +1450,774 @@ Mat4 operator * (const Mat4& one, const Mat4& other)
     return res;
 }
 
-Mat4 operator * (const Mat4& mat, float scalar)
+Mat4 MulMat4Sse(const Mat4& one, const Mat4& other)
 {
-    Mat4 res = {};
+    __m128 cols[4] = {
+        _mm_loadu_ps(one.data[0]), _mm_loadu_ps(one.data[1]), _mm_loadu_ps(one.data[2]), _mm_loadu_ps(one.data[3])
+    };
 
-    for(int x = 0; x < 4; x++) {
-        for(int y = 0; y < 4; y++) {
-            res.data[y][x] = mat.data[y][x] * scalar;
-        }
+    Mat4 res;
+    for(int y = 0; y < 4; y++) {
+        __m128 sum = _mm_mul_ps(cols[0], _mm_set1_ps(other.data[y][0]));
+        sum = _mm_add_ps(sum, _mm_mul_ps(cols[1], _mm_set1_ps(other.data[y][1])));
+        sum = _mm_add_ps(sum, _mm_mul_ps(cols[2], _mm_set1_ps(other.data[y][2])));
+        sum = _mm_add_ps(sum, _mm_mul_ps(cols[3], _mm_set1_ps(other.data[y][3])));
+        _mm_storeu_ps(res.data[y], sum);
     }
-
     return res;
 }
 
-Mat4 IdentityMat4()
+Mat4 MulMat4Avx2(const Mat4& one, const Mat4& other)
 {
-    Mat4 res = {};
-    for(int i = 0; i < 4; i++)
-        res.data[i][i] = 1.0f;
+    // two result columns per register, the left columns are repeated in both halves
+    __m256 cols[4] = {
+        _mm256_broadcast_ps((const __m128*)one.data[0]), _mm256_broadcast_ps((const __m128*)one.data[1]),
+        _mm256_broadcast_ps((const __m128*)one.data[2]), _mm256_broadcast_ps((const __m128*)one.data[3])
+    };
+
+    Mat4 res;
+    for(int y = 0; y < 4; y += 2) {
+        __m256 otherCols = _mm256_loadu_ps(other.data[y]);
+        __m256 sum = _mm256_mul_ps(cols[0], _mm256_shuffle_ps(otherCols, otherCols, _MM_SHUFFLE(0, 0, 0, 0)));
+        sum = _mm256_fmadd_ps(cols[1], _mm256_shuffle_ps(otherCols, otherCols, _MM_SHUFFLE(1, 1, 1, 1)), sum);
+        sum = _mm256_fmadd_ps(cols[2], _mm256_shuffle_ps(otherCols, otherCols, _MM_SHUFFLE(2, 2, 2, 2)), sum);
+        sum = _mm256_fmadd_ps(cols[3], _mm256_shuffle_ps(otherCols, otherCols, _MM_SHUFFLE(3, 3, 3, 3)), sum);
+        _mm256_storeu_ps(res.data[y], sum);
+    }
     return res;
 }
 
-Mat4 TranslateMat4(Vec3 position)
+constexpr Mat4 operator * (const Mat4& one, const Mat4& other)
 {
-    Mat4 res = IdentityMat4();
-    res.data[3][0] = position.x;
-    res.data[3][1] = position.y;
-    res.data[3][2] = position.z;
+    // constant evaluation can't run the simd or crt paths
+    if(std::is_constant_evaluated())
+        return MulMat4Scalar(one, other);
+
+    const CpuFeatures& cpu = GetCpuFeatures();
+    if(cpu.hasAvx2 && cpu.hasFma)
+        return MulMat4Avx2(one, other);
+    if(cpu.hasSse2)
+        return MulMat4Sse(one, other);
+    return MulMat4Scalar(one, other);
+}
+
+Vec4 MulMat4Vec4Scalar(const Mat4& mat, const Vec4& vec)
+{
+    return {
+        .x = (mat.data[0][0] * vec.x) + (mat.data[1][0] * vec.y) + (mat.data[2][0] * vec.z) + (mat.data[3][0] * vec.w),
+        .y = (mat.data[0][1] * vec.x) + (mat.data[1][1] * vec.y) + (mat.data[2][1] * vec.z) + (mat.data[3][1] * vec.w),
+        .z = (mat.data[0][2] * vec.x) + (mat.data[1][2] * vec.y) + (mat.data[2][2] * vec.z) + (mat.data[3][2] * vec.w),
+        .w = (mat.data[0][3] * vec.x) + (mat.data[1][3] * vec.y) + (mat.data[2][3] * vec.z) + (mat.data[3][3] * vec.w),
+    };
+}
+
+Vec4 MulMat4Vec4Sse(const Mat4& mat, const Vec4& vec)
+{
+    __m128 sum = _mm_mul_ps(_mm_loadu_ps(mat.data[0]), _mm_set1_ps(vec.x));
+    sum = _mm_add_ps(sum, _mm_mul_ps(_mm_loadu_ps(mat.data[1]), _mm_set1_ps(vec.y)));
+    sum = _mm_add_ps(sum, _mm_mul_ps(_mm_loadu_ps(mat.data[2]), _mm_set1_ps(vec.z)));
+    sum = _mm_add_ps(sum, _mm_mul_ps(_mm_loadu_ps(mat.data[3]), _mm_set1_ps(vec.w)));
+
+    Vec4 res;
+    _mm_storeu_ps(&res.x, sum);
     return res;
 }
 
-Mat4 ScaleMat4(Vec3 scale)
+Vec4 MulMat4Vec4Fma(const Mat4& mat, const Vec4& vec)
 {
-    Mat4 res = IdentityMat4();
-    res.data[0][0] = scale.x;
-    res.data[1][1] = scale.y;
-    res.data[2][2] = scale.z;
+    __m128 sum = _mm_mul_ps(_mm_loadu_ps(mat.data[0]), _mm_set1_ps(vec.x));
+    sum = _mm_fmadd_ps(_mm_loadu_ps(mat.data[1]), _mm_set1_ps(vec.y), sum);
+    sum = _mm_fmadd_ps(_mm_loadu_ps(mat.data[2]), _mm_set1_ps(vec.z), sum);
+    sum = _mm_fmadd_ps(_mm_loadu_ps(mat.data[3]), _mm_set1_ps(vec.w), sum);
+
+    Vec4 res;
+    _mm_storeu_ps(&res.x, sum);
     return res;
 }
 
-Mat4 OrthoProjMat4(float left, float right, float bot, float top, float nearClip, float farClip)
+Vec4 operator * (const Mat4& mat, const Vec4& vec)
 {
-    // based on D3DXMatrixOrthoOffCenterRH
+    const CpuFeatures& cpu = GetCpuFeatures();
+    if(cpu.hasFma)
+        return MulMat4Vec4Fma(mat, vec);
+    if(cpu.hasSse2)
+        return MulMat4Vec4Sse(mat, vec);
+    return MulMat4Vec4Scalar(mat, vec);
+}
+
+void TransformPointsScalar(const Mat4& mat, const Vec3* points, Vec4* dest, uint32_t count)
+{
+    for(uint32_t i = 0; i < count; i++)
+        dest[i] = MulMat4Vec4Scalar(mat, { points[i].x, points[i].y, points[i].z, 1.0f });
+}
+
+void TransformPointsSse(const Mat4& mat, const Vec3* points, Vec4* dest, uint32_t count)
+{
+    __m128 cols[4] = {
+        _mm_loadu_ps(mat.data[0]), _mm_loadu_ps(mat.data[1]), _mm_loadu_ps(mat.data[2]), _mm_loadu_ps(mat.data[3])
+    };
+    for(uint32_t i = 0; i < count; i++) {
+        __m128 sum = _mm_mul_ps(cols[0], _mm_set1_ps(points[i].x));
+        sum = _mm_add_ps(sum, _mm_mul_ps(cols[1], _mm_set1_ps(points[i].y)));
+        sum = _mm_add_ps(sum, _mm_mul_ps(cols[2], _mm_set1_ps(points[i].z)));
+        sum = _mm_add_ps(sum, cols[3]);
+        _mm_storeu_ps(&dest[i].x, sum);
+    }
+}
+
+void TransformPointsAvx2(const Mat4& mat, const Vec3* points, Vec4* dest, uint32_t count)
+{
+    // two points per register, one in each half
+    __m256 cols[4] = {
+        _mm256_broadcast_ps((const __m128*)mat.data[0]), _mm256_broadcast_ps((const __m128*)mat.data[1]),
+        _mm256_broadcast_ps((const __m128*)mat.data[2]), _mm256_broadcast_ps((const __m128*)mat.data[3])
+    };
+    uint32_t i = 0;
+    for(; i + 2 <= count; i += 2) {
+        __m256 x = _mm256_set_m128(_mm_set1_ps(points[i + 1].x), _mm_set1_ps(points[i].x));
+        __m256 y = _mm256_set_m128(_mm_set1_ps(points[i + 1].y), _mm_set1_ps(points[i].y));
+        __m256 z = _mm256_set_m128(_mm_set1_ps(points[i + 1].z), _mm_set1_ps(points[i].z));
+        __m256 sum = _mm256_fmadd_ps(cols[0], x, cols[3]);
+        sum = _mm256_fmadd_ps(cols[1], y, sum);
+        sum = _mm256_fmadd_ps(cols[2], z, sum);
+        _mm256_storeu_ps(&dest[i].x, sum);
+    }
+    if(i < count)
+        TransformPointsSse(mat, points + i, dest + i, count - i);
+}
+
+// homogeneous mat * (point, 1) for a whole array, no perspective divide
+void TransformPoints(const Mat4& mat, const Vec3* points, Vec4* dest, uint32_t count)
+{
+    const CpuFeatures& cpu = GetCpuFeatures();
+    if(cpu.hasAvx2 && cpu.hasFma)
+        TransformPointsAvx2(mat, points, dest, count);
+    else if(cpu.hasSse2)
+        TransformPointsSse(mat, points, dest, count);
+    else
+        TransformPointsScalar(mat, points, dest, count);
+}
+
+Vec3 TransformPoint(const Mat4& mat, const Vec3& point)
+{
+    Vec4 res = mat * Vec4{ point.x, point.y, point.z, 1.0f };
+    return { res.x / res.w, res.y / res.w, res.z / res.w };
+}
+
+// 8 Vec3s in SoA layout, the unit of the bulk geometry kernels below
+struct alignas(32) Vec3x8
+{
+    float x[8];
+    float y[8];
+    float z[8];
+};
+
+// 16 bit unorm positions relative to a bounding box, same layout as Vec3x8
+struct alignas(16) QuantizedVec3x8
+{
+    uint16_t x[8];
+    uint16_t y[8];
+    uint16_t z[8];
+};
+
+uint32_t GetVec3x8BlockCount(uint32_t count)
+{
+    return (count + 7) / 8;
+}
+
+// the simd kernels use aligned loads, so blocks come from here rather than calloc
+Vec3x8* CreateVec3x8Blocks(uint32_t count)
+{
+    size_t byteSize = (size_t)GetVec3x8BlockCount(count) * sizeof(Vec3x8);
+    Vec3x8* blocks = (Vec3x8*)_aligned_malloc(byteSize > 0 ? byteSize : sizeof(Vec3x8), alignof(Vec3x8));
+    ASSERT(blocks != nullptr);
+    return blocks;
+}
+
+void FreeVec3x8Blocks(Vec3x8* blocks)
+{
+    _aligned_free(blocks);
+}
+
+// the tail of the last block repeats the last point so bounds and the like don't need a count
+void PackVec3x8Scalar(const Vec3* points, uint32_t count, Vec3x8* blocks)
+{
+    for(uint32_t block = 0; block < GetVec3x8BlockCount(count); block++) {
+        for(uint32_t lane = 0; lane < 8; lane++) {
+            uint32_t i = (block * 8) + lane;
+            const Vec3& point = points[i < count ? i : count - 1];
+            blocks[block].x[lane] = point.x;
+            blocks[block].y[lane] = point.y;
+            blocks[block].z[lane] = point.z;
+        }
+    }
+}
+
+void UnpackVec3x8Scalar(const Vec3x8* blocks, uint32_t count, Vec3* points)
+{
+    for(uint32_t i = 0; i < count; i++)
+        points[i] = { blocks[i / 8].x[i % 8], blocks[i / 8].y[i % 8], blocks[i / 8].z[i % 8] };
+}
+
+// 4 AoS points are 3 registers, x0 y0 z0 x1 | y1 z1 x2 y2 | z2 x3 y3 z3
+void PackVec3x8Sse(const Vec3* points, uint32_t count, Vec3x8* blocks)
+{
+    uint32_t fullCount = count & ~3u;
+    for(uint32_t i = 0; i < fullCount; i += 4) {
+        const float* src = &points[i].x;
+        __m128 a = _mm_loadu_ps(src);
+        __m128 b = _mm_loadu_ps(src + 4);
+        __m128 c = _mm_loadu_ps(src + 8);
+
+        __m128 bc = _mm_shuffle_ps(b, c, _MM_SHUFFLE(1, 1, 2, 2));
+        __m128 x = _mm_shuffle_ps(a, bc, _MM_SHUFFLE(2, 0, 3, 0));
+        __m128 y = _mm_shuffle_ps(_mm_shuffle_ps(a, b, _MM_SHUFFLE(0, 0, 1, 1)), _mm_shuffle_ps(b, c, _MM_SHUFFLE(2, 2, 3, 3)), _MM_SHUFFLE(2, 0, 2, 0));
+        __m128 z = _mm_shuffle_ps(_mm_shuffle_ps(a, b, _MM_SHUFFLE(1, 1, 2, 2)), _mm_shuffle_ps(c, c, _MM_SHUFFLE(3, 3, 0, 0)), _MM_SHUFFLE(2, 0, 2, 0));
+
+        Vec3x8* block = &blocks[i / 8];
+        _mm_store_ps(&block->x[i % 8], x);
+        _mm_store_ps(&block->y[i % 8], y);
+        _mm_store_ps(&block->z[i % 8], z);
+    }
+    for(uint32_t i = fullCount; i < GetVec3x8BlockCount(count) * 8; i++) {
+        const Vec3& point = points[i < count ? i : count - 1];
+        blocks[i / 8].x[i % 8] = point.x;
+        blocks[i / 8].y[i % 8] = point.y;
+        blocks[i / 8].z[i % 8] = point.z;
+    }
+}
+
+void UnpackVec3x8Sse(const Vec3x8* blocks, uint32_t count, Vec3* points)
+{
+    uint32_t fullCount = count & ~3u;
+    for(uint32_t i = 0; i < fullCount; i += 4) {
+        const Vec3x8* block = &blocks[i / 8];
+        __m128 x = _mm_load_ps(&block->x[i % 8]);
+        __m128 y = _mm_load_ps(&block->y[i % 8]);
+        __m128 z = _mm_load_ps(&block->z[i % 8]);
+
+        __m128 a = _mm_shuffle_ps(_mm_shuffle_ps(x, y, _MM_SHUFFLE(0, 0, 0, 0)), _mm_shuffle_ps(z, x, _MM_SHUFFLE(1, 1, 0, 0)), _MM_SHUFFLE(2, 0, 2, 0));
+        __m128 b = _mm_shuffle_ps(_mm_shuffle_ps(y, z, _MM_SHUFFLE(1, 1, 1, 1)), _mm_shuffle_ps(x, y, _MM_SHUFFLE(2, 2, 2, 2)), _MM_SHUFFLE(2, 0, 2, 0));
+        __m128 c = _mm_shuffle_ps(_mm_shuffle_ps(z, x, _MM_SHUFFLE(3, 3, 2, 2)), _mm_shuffle_ps(y, z, _MM_SHUFFLE(3, 3, 3, 3)), _MM_SHUFFLE(2, 0, 2, 0));
+
+        float* dest = &points[i].x;
+        _mm_storeu_ps(dest, a);
+        _mm_storeu_ps(dest + 4, b);
+        _mm_storeu_ps(dest + 8, c);
+    }
+    for(uint32_t i = fullCount; i < count; i++)
+        points[i] = { blocks[i / 8].x[i % 8], blocks[i / 8].y[i % 8], blocks[i / 8].z[i % 8] };
+}
+
+// blocks needs GetVec3x8BlockCount(count) entries
+void PackVec3x8(const Vec3* points, uint32_t count, Vec3x8* blocks)
+{
+    if(count == 0)
+        return;
+    if(GetCpuFeatures().hasSse2)
+        PackVec3x8Sse(points, count, blocks);
+    else
+        PackVec3x8Scalar(points, count, blocks);
+}
+
+void UnpackVec3x8(const Vec3x8* blocks, uint32_t count, Vec3* points)
+{
+    if(GetCpuFeatures().hasSse2)
+        UnpackVec3x8Sse(blocks, count, points);
+    else
+        UnpackVec3x8Scalar(blocks, count, points);
+}
+
+// scalar reference kernels, the simd ones must match them
+
+Aabb GetVec3x8BoundsScalar(const Vec3x8* blocks, uint32_t blockCount)
+{
+    Aabb res = EmptyAabb();
+    for(uint32_t block = 0; block < blockCount; block++) {
+        for(int lane = 0; lane < 8; lane++)
+            res = Grow(res, { blocks[block].x[lane], blocks[block].y[lane], blocks[block].z[lane] });
+    }
+    return res;
+}
+
+// zero length vectors stay zero
+void NormalizeVec3x8Scalar(Vec3x8* blocks, uint32_t blockCount)
+{
+    for(uint32_t block = 0; block < blockCount; block++) {
+        Vec3x8* vecs = &blocks[block];
+        for(int lane = 0; lane < 8; lane++) {
+            float len = sqrtf((vecs->x[lane] * vecs->x[lane]) + (vecs->y[lane] * vecs->y[lane]) + (vecs->z[lane] * vecs->z[lane]));
+            float invLen = len > 0.0f ? 1.0f / len : 0.0f;
+            vecs->x[lane] *= invLen;
+            vecs->y[lane] *= invLen;
+            vecs->z[lane] *= invLen;
+        }
+    }
+}
+
+// affine transform of points, the last row of mat is ignored
+void TransformVec3x8Scalar(const Mat4& mat, const Vec3x8* blocks, Vec3x8* dest, uint32_t blockCount)
+{
+    for(uint32_t block = 0; block < blockCount; block++) {
+        for(int lane = 0; lane < 8; lane++) {
+            float x = blocks[block].x[lane];
+            float y = blocks[block].y[lane];
+            float z = blocks[block].z[lane];
+            dest[block].x[lane] = (mat.data[0][0] * x) + (mat.data[1][0] * y) + (mat.data[2][0] * z) + mat.data[3][0];
+            dest[block].y[lane] = (mat.data[0][1] * x) + (mat.data[1][1] * y) + (mat.data[2][1] * z) + mat.data[3][1];
+            dest[block].z[lane] = (mat.data[0][2] * x) + (mat.data[1][2] * y) + (mat.data[2][2] * z) + mat.data[3][2];
+        }
+    }
+}
+
+uint16_t QuantizeUnorm16(float value, float offset, float scale)
+{
+    float unorm = ((value - offset) * scale) + 0.5f;
+    unorm = unorm < 0.0f ? 0.0f : (unorm > 65535.0f ? 65535.0f : unorm);
+    return (uint16_t)unorm;
+}
+
+void QuantizeVec3x8Scalar(const Vec3x8* blocks, const Aabb& bounds, QuantizedVec3x8* dest, uint32_t blockCount)
+{
+    Vec3 extent = bounds.max - bounds.min;
+    Vec3 scale = {
+        extent.x > 0.0f ? 65535.0f / extent.x : 0.0f,
+        extent.y > 0.0f ? 65535.0f / extent.y : 0.0f,
+        extent.z > 0.0f ? 65535.0f / extent.z : 0.0f
+    };
+    for(uint32_t block = 0; block < blockCount; block++) {
+        for(int lane = 0; lane < 8; lane++) {
+            dest[block].x[lane] = QuantizeUnorm16(blocks[block].x[lane], bounds.min.x, scale.x);
+            dest[block].y[lane] = QuantizeUnorm16(blocks[block].y[lane], bounds.min.y, scale.y);
+            dest[block].z[lane] = QuantizeUnorm16(blocks[block].z[lane], bounds.min.z, scale.z);
+        }
+    }
+}
+
+void AddVec3x8Scalar(const Vec3x8* one, const Vec3x8* other, Vec3x8* dest, uint32_t blockCount)
+{
+    for(uint32_t block = 0; block < blockCount; block++) {
+        for(int lane = 0; lane < 8; lane++) {
+            dest[block].x[lane] = one[block].x[lane] + other[block].x[lane];
+            dest[block].y[lane] = one[block].y[lane] + other[block].y[lane];
+            dest[block].z[lane] = one[block].z[lane] + other[block].z[lane];
+        }
+    }
+}
+
+// dest has 8 floats per block and the same alignment as the blocks
+void DotVec3x8Scalar(const Vec3x8* one, const Vec3x8* other, float* dest, uint32_t blockCount)
+{
+    for(uint32_t block = 0; block < blockCount; block++) {
+        for(int lane = 0; lane < 8; lane++) {
+            dest[(block * 8) + lane] = (one[block].x[lane] * other[block].x[lane]) +
+                (one[block].y[lane] * other[block].y[lane]) + (one[block].z[lane] * other[block].z[lane]);
+        }
+    }
+}
+
+void CrossVec3x8Scalar(const Vec3x8* one, const Vec3x8* other, Vec3x8* dest, uint32_t blockCount)
+{
+    for(uint32_t block = 0; block < blockCount; block++) {
+        for(int lane = 0; lane < 8; lane++) {
+            float x = (one[block].y[lane] * other[block].z[lane]) - (one[block].z[lane] * other[block].y[lane]);
+            float y = (one[block].z[lane] * other[block].x[lane]) - (one[block].x[lane] * other[block].z[lane]);
+            float z = (one[block].x[lane] * other[block].y[lane]) - (one[block].y[lane] * other[block].x[lane]);
+            dest[block].x[lane] = x;
+            dest[block].y[lane] = y;
+            dest[block].z[lane] = z;
+        }
+    }
+}
+
+// sse4.1 kernels, a block is two halves of 4 lanes
+
+float GetHorizontalMinSse(__m128 vec)
+{
+    vec = _mm_min_ps(vec, _mm_shuffle_ps(vec, vec, _MM_SHUFFLE(1, 0, 3, 2)));
+    vec = _mm_min_ps(vec, _mm_shuffle_ps(vec, vec, _MM_SHUFFLE(2, 3, 0, 1)));
+    return _mm_cvtss_f32(vec);
+}
+
+float GetHorizontalMaxSse(__m128 vec)
+{
+    vec = _mm_max_ps(vec, _mm_shuffle_ps(vec, vec, _MM_SHUFFLE(1, 0, 3, 2)));
+    vec = _mm_max_ps(vec, _mm_shuffle_ps(vec, vec, _MM_SHUFFLE(2, 3, 0, 1)));
+    return _mm_cvtss_f32(vec);
+}
+
+Aabb GetVec3x8BoundsSse41(const Vec3x8* blocks, uint32_t blockCount)
+{
+    __m128 minX = _mm_set1_ps(FLT_MAX), minY = minX, minZ = minX;
+    __m128 maxX = _mm_set1_ps(-FLT_MAX), maxY = maxX, maxZ = maxX;
+    for(uint32_t block = 0; block < blockCount; block++) {
+        for(int half = 0; half < 8; half += 4) {
+            __m128 x = _mm_load_ps(&blocks[block].x[half]);
+            __m128 y = _mm_load_ps(&blocks[block].y[half]);
+            __m128 z = _mm_load_ps(&blocks[block].z[half]);
+            minX = _mm_min_ps(minX, x);
+            minY = _mm_min_ps(minY, y);
+            minZ = _mm_min_ps(minZ, z);
+            maxX = _mm_max_ps(maxX, x);
+            maxY = _mm_max_ps(maxY, y);
+            maxZ = _mm_max_ps(maxZ, z);
+        }
+    }
+    return {
+        .min = { GetHorizontalMinSse(minX), GetHorizontalMinSse(minY), GetHorizontalMinSse(minZ) },
+        .max = { GetHorizontalMaxSse(maxX), GetHorizontalMaxSse(maxY), GetHorizontalMaxSse(maxZ) }
+    };
+}
+
+void NormalizeVec3x8Sse41(Vec3x8* blocks, uint32_t blockCount)
+{
+    __m128 zero = _mm_setzero_ps();
+    __m128 one = _mm_set1_ps(1.0f);
+    for(uint32_t block = 0; block < blockCount; block++) {
+        for(int half = 0; half < 8; half += 4) {
+            __m128 x = _mm_load_ps(&blocks[block].x[half]);
+            __m128 y = _mm_load_ps(&blocks[block].y[half]);
+            __m128 z = _mm_load_ps(&blocks[block].z[half]);
+            __m128 len = _mm_sqrt_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(x, x), _mm_mul_ps(y, y)), _mm_mul_ps(z, z)));
+            __m128 invLen = _mm_blendv_ps(zero, _mm_div_ps(one, len), _mm_cmpgt_ps(len, zero));
+            _mm_store_ps(&blocks[block].x[half], _mm_mul_ps(x, invLen));
+            _mm_store_ps(&blocks[block].y[half], _mm_mul_ps(y, invLen));
+            _mm_store_ps(&blocks[block].z[half], _mm_mul_ps(z, invLen));
+        }
+    }
+}
+
+void TransformVec3x8Sse41(const Mat4& mat, const Vec3x8* blocks, Vec3x8* dest, uint32_t blockCount)
+{
+    __m128 m[4][3];
+    for(int col = 0; col < 4; col++) {
+        for(int row = 0; row < 3; row++)
+            m[col][row] = _mm_set1_ps(mat.data[col][row]);
+    }
+    for(uint32_t block = 0; block < blockCount; block++) {
+        for(int half = 0; half < 8; half += 4) {
+            __m128 x = _mm_load_ps(&blocks[block].x[half]);
+            __m128 y = _mm_load_ps(&blocks[block].y[half]);
+            __m128 z = _mm_load_ps(&blocks[block].z[half]);
+            float* destRows[3] = { &dest[block].x[half], &dest[block].y[half], &dest[block].z[half] };
+            for(int row = 0; row < 3; row++) {
+                __m128 sum = _mm_add_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(m[0][row], x), _mm_mul_ps(m[1][row], y)), _mm_mul_ps(m[2][row], z)), m[3][row]);
+                _mm_store_ps(destRows[row], sum);
+            }
+        }
+    }
+}
+
+// _mm_packus_epi32 is what needs sse4.1
+void QuantizeVec3x8Sse41(const Vec3x8* blocks, const Aabb& bounds, QuantizedVec3x8* dest, uint32_t blockCount)
+{
+    Vec3 extent = bounds.max - bounds.min;
+    __m128 offsets[3] = { _mm_set1_ps(bounds.min.x), _mm_set1_ps(bounds.min.y), _mm_set1_ps(bounds.min.z) };
+    __m128 scales[3] = {
+        _mm_set1_ps(extent.x > 0.0f ? 65535.0f / extent.x : 0.0f),
+        _mm_set1_ps(extent.y > 0.0f ? 65535.0f / extent.y : 0.0f),
+        _mm_set1_ps(extent.z > 0.0f ? 65535.0f / extent.z : 0.0f)
+    };
+    __m128 half = _mm_set1_ps(0.5f);
+    __m128 zero = _mm_setzero_ps();
+    __m128 maxUnorm = _mm_set1_ps(65535.0f);
+    for(uint32_t block = 0; block < blockCount; block++) {
+        const float* srcRows[3] = { blocks[block].x, blocks[block].y, blocks[block].z };
+        uint16_t* destRows[3] = { dest[block].x, dest[block].y, dest[block].z };
+        for(int axis = 0; axis < 3; axis++) {
+            __m128 low = _mm_add_ps(_mm_mul_ps(_mm_sub_ps(_mm_load_ps(srcRows[axis]), offsets[axis]), scales[axis]), half);
+            __m128 high = _mm_add_ps(_mm_mul_ps(_mm_sub_ps(_mm_load_ps(srcRows[axis] + 4), offsets[axis]), scales[axis]), half);
+            // clamped then truncated like the scalar cast
+            __m128i packed = _mm_packus_epi32(_mm_cvttps_epi32(_mm_min_ps(_mm_max_ps(low, zero), maxUnorm)),
+                _mm_cvttps_epi32(_mm_min_ps(_mm_max_ps(high, zero), maxUnorm)));
+            _mm_store_si128((__m128i*)destRows[axis], packed);
+        }
+    }
+}
+
+void AddVec3x8Sse41(const Vec3x8* one, const Vec3x8* other, Vec3x8* dest, uint32_t blockCount)
+{
+    for(uint32_t block = 0; block < blockCount; block++) {
+        for(int half = 0; half < 8; half += 4) {
+            _mm_store_ps(&dest[block].x[half], _mm_add_ps(_mm_load_ps(&one[block].x[half]), _mm_load_ps(&other[block].x[half])));
+            _mm_store_ps(&dest[block].y[half], _mm_add_ps(_mm_load_ps(&one[block].y[half]), _mm_load_ps(&other[block].y[half])));
+            _mm_store_ps(&dest[block].z[half], _mm_add_ps(_mm_load_ps(&one[block].z[half]), _mm_load_ps(&other[block].z[half])));
+        }
+    }
+}
+
+void DotVec3x8Sse41(const Vec3x8* one, const Vec3x8* other, float* dest, uint32_t blockCount)
+{
+    for(uint32_t block = 0; block < blockCount; block++) {
+        for(int half = 0; half < 8; half += 4) {
+            __m128 dot = _mm_mul_ps(_mm_load_ps(&one[block].x[half]), _mm_load_ps(&other[block].x[half]));
+            dot = _mm_add_ps(dot, _mm_mul_ps(_mm_load_ps(&one[block].y[half]), _mm_load_ps(&other[block].y[half])));
+            dot = _mm_add_ps(dot, _mm_mul_ps(_mm_load_ps(&one[block].z[half]), _mm_load_ps(&other[block].z[half])));
+            _mm_store_ps(dest + (block * 8) + half, dot);
+        }
+    }
+}
+
+void CrossVec3x8Sse41(const Vec3x8* one, const Vec3x8* other, Vec3x8* dest, uint32_t blockCount)
+{
+    for(uint32_t block = 0; block < blockCount; block++) {
+        for(int half = 0; half < 8; half += 4) {
+            __m128 ax = _mm_load_ps(&one[block].x[half]);
+            __m128 ay = _mm_load_ps(&one[block].y[half]);
+            __m128 az = _mm_load_ps(&one[block].z[half]);
+            __m128 bx = _mm_load_ps(&other[block].x[half]);
+            __m128 by = _mm_load_ps(&other[block].y[half]);
+            __m128 bz = _mm_load_ps(&other[block].z[half]);
+            _mm_store_ps(&dest[block].x[half], _mm_sub_ps(_mm_mul_ps(ay, bz), _mm_mul_ps(az, by)));
+            _mm_store_ps(&dest[block].y[half], _mm_sub_ps(_mm_mul_ps(az, bx), _mm_mul_ps(ax, bz)));
+            _mm_store_ps(&dest[block].z[half], _mm_sub_ps(_mm_mul_ps(ax, by), _mm_mul_ps(ay, bx)));
+        }
+    }
+}
+
+// avx2 kernels, a block is one register per axis
+
+Aabb GetVec3x8BoundsAvx2(const Vec3x8* blocks, uint32_t blockCount)
+{
+    __m256 minX = _mm256_set1_ps(FLT_MAX), minY = minX, minZ = minX;
+    __m256 maxX = _mm256_set1_ps(-FLT_MAX), maxY = maxX, maxZ = maxX;
+    for(uint32_t block = 0; block < blockCount; block++) {
+        __m256 x = _mm256_load_ps(blocks[block].x);
+        __m256 y = _mm256_load_ps(blocks[block].y);
+        __m256 z = _mm256_load_ps(blocks[block].z);
+        minX = _mm256_min_ps(minX, x);
+        minY = _mm256_min_ps(minY, y);
+        minZ = _mm256_min_ps(minZ, z);
+        maxX = _mm256_max_ps(maxX, x);
+        maxY = _mm256_max_ps(maxY, y);
+        maxZ = _mm256_max_ps(maxZ, z);
+    }
+    return {
+        .min = {
+            GetHorizontalMinSse(_mm_min_ps(_mm256_castps256_ps128(minX), _mm256_extractf128_ps(minX, 1))),
+            GetHorizontalMinSse(_mm_min_ps(_mm256_castps256_ps128(minY), _mm256_extractf128_ps(minY, 1))),
+            GetHorizontalMinSse(_mm_min_ps(_mm256_castps256_ps128(minZ), _mm256_extractf128_ps(minZ, 1)))
+        },
+        .max = {
+            GetHorizontalMaxSse(_mm_max_ps(_mm256_castps256_ps128(maxX), _mm256_extractf128_ps(maxX, 1))),
+            GetHorizontalMaxSse(_mm_max_ps(_mm256_castps256_ps128(maxY), _mm256_extractf128_ps(maxY, 1))),
+            GetHorizontalMaxSse(_mm_max_ps(_mm256_castps256_ps128(maxZ), _mm256_extractf128_ps(maxZ, 1)))
+        }
+    };
+}
+
+void NormalizeVec3x8Avx2(Vec3x8* blocks, uint32_t blockCount)
+{
+    __m256 zero = _mm256_setzero_ps();
+    __m256 one = _mm256_set1_ps(1.0f);
+    for(uint32_t block = 0; block < blockCount; block++) {
+        __m256 x = _mm256_load_ps(blocks[block].x);
+        __m256 y = _mm256_load_ps(blocks[block].y);
+        __m256 z = _mm256_load_ps(blocks[block].z);
+        __m256 len = _mm256_sqrt_ps(_mm256_fmadd_ps(z, z, _mm256_fmadd_ps(y, y, _mm256_mul_ps(x, x))));
+        __m256 invLen = _mm256_blendv_ps(zero, _mm256_div_ps(one, len), _mm256_cmp_ps(len, zero, _CMP_GT_OQ));
+        _mm256_store_ps(blocks[block].x, _mm256_mul_ps(x, invLen));
+        _mm256_store_ps(blocks[block].y, _mm256_mul_ps(y, invLen));
+        _mm256_store_ps(blocks[block].z, _mm256_mul_ps(z, invLen));
+    }
+}
+
+void TransformVec3x8Avx2(const Mat4& mat, const Vec3x8* blocks, Vec3x8* dest, uint32_t blockCount)
+{
+    __m256 m[4][3];
+    for(int col = 0; col < 4; col++) {
+        for(int row = 0; row < 3; row++)
+            m[col][row] = _mm256_set1_ps(mat.data[col][row]);
+    }
+    for(uint32_t block = 0; block < blockCount; block++) {
+        __m256 x = _mm256_load_ps(blocks[block].x);
+        __m256 y = _mm256_load_ps(blocks[block].y);
+        __m256 z = _mm256_load_ps(blocks[block].z);
+        float* destRows[3] = { dest[block].x, dest[block].y, dest[block].z };
+        for(int row = 0; row < 3; row++) {
+            __m256 sum = _mm256_fmadd_ps(m[2][row], z, _mm256_fmadd_ps(m[1][row], y, _mm256_fmadd_ps(m[0][row], x, m[3][row])));
+            _mm256_store_ps(destRows[row], sum);
+        }
+    }
+}
+
+void QuantizeVec3x8Avx2(const Vec3x8* blocks, const Aabb& bounds, QuantizedVec3x8* dest, uint32_t blockCount)
+{
+    Vec3 extent = bounds.max - bounds.min;
+    __m256 offsets[3] = { _mm256_set1_ps(bounds.min.x), _mm256_set1_ps(bounds.min.y), _mm256_set1_ps(bounds.min.z) };
+    __m256 scales[3] = {
+        _mm256_set1_ps(extent.x > 0.0f ? 65535.0f / extent.x : 0.0f),
+        _mm256_set1_ps(extent.y > 0.0f ? 65535.0f / extent.y : 0.0f),
+        _mm256_set1_ps(extent.z > 0.0f ? 65535.0f / extent.z : 0.0f)
+    };
+    __m256 half = _mm256_set1_ps(0.5f);
+    __m256 zero = _mm256_setzero_ps();
+    __m256 maxUnorm = _mm256_set1_ps(65535.0f);
+    for(uint32_t block = 0; block < blockCount; block++) {
+        const float* srcRows[3] = { blocks[block].x, blocks[block].y, blocks[block].z };
+        uint16_t* destRows[3] = { dest[block].x, dest[block].y, dest[block].z };
+        for(int axis = 0; axis < 3; axis++) {
+            // no fma here so the rounding matches the scalar reference exactly
+            __m256 unorm = _mm256_add_ps(_mm256_mul_ps(_mm256_sub_ps(_mm256_load_ps(srcRows[axis]), offsets[axis]), scales[axis]), half);
+            __m256i ints = _mm256_cvttps_epi32(_mm256_min_ps(_mm256_max_ps(unorm, zero), maxUnorm));
+            __m128i packed = _mm_packus_epi32(_mm256_castsi256_si128(ints), _mm256_extracti128_si256(ints, 1));
+            _mm_store_si128((__m128i*)destRows[axis], packed);
+        }
+    }
+}
+
+void AddVec3x8Avx2(const Vec3x8* one, const Vec3x8* other, Vec3x8* dest, uint32_t blockCount)
+{
+    for(uint32_t block = 0; block < blockCount; block++) {
+        _mm256_store_ps(dest[block].x, _mm256_add_ps(_mm256_load_ps(one[block].x), _mm256_load_ps(other[block].x)));
+        _mm256_store_ps(dest[block].y, _mm256_add_ps(_mm256_load_ps(one[block].y), _mm256_load_ps(other[block].y)));
+        _mm256_store_ps(dest[block].z, _mm256_add_ps(_mm256_load_ps(one[block].z), _mm256_load_ps(other[block].z)));
+    }
+}
+
+void DotVec3x8Avx2(const Vec3x8* one, const Vec3x8* other, float* dest, uint32_t blockCount)
+{
+    for(uint32_t block = 0; block < blockCount; block++) {
+        __m256 dot = _mm256_mul_ps(_mm256_load_ps(one[block].x), _mm256_load_ps(other[block].x));
+        dot = _mm256_fmadd_ps(_mm256_load_ps(one[block].y), _mm256_load_ps(other[block].y), dot);
+        dot = _mm256_fmadd_ps(_mm256_load_ps(one[block].z), _mm256_load_ps(other[block].z), dot);
+        _mm256_store_ps(dest + (block * 8), dot);
+    }
+}
+
+void CrossVec3x8Avx2(const Vec3x8* one, const Vec3x8* other, Vec3x8* dest, uint32_t blockCount)
+{
+    for(uint32_t block = 0; block < blockCount; block++) {
+        __m256 ax = _mm256_load_ps(one[block].x);
+        __m256 ay = _mm256_load_ps(one[block].y);
+        __m256 az = _mm256_load_ps(one[block].z);
+        __m256 bx = _mm256_load_ps(other[block].x);
+        __m256 by = _mm256_load_ps(other[block].y);
+        __m256 bz = _mm256_load_ps(other[block].z);
+        _mm256_store_ps(dest[block].x, _mm256_fmsub_ps(ay, bz, _mm256_mul_ps(az, by)));
+        _mm256_store_ps(dest[block].y, _mm256_fmsub_ps(az, bx, _mm256_mul_ps(ax, bz)));
+        _mm256_store_ps(dest[block].z, _mm256_fmsub_ps(ax, by, _mm256_mul_ps(ay, bx)));
+    }
+}
+
+Aabb GetVec3x8Bounds(const Vec3x8* blocks, uint32_t blockCount)
+{
+    const CpuFeatures& cpu = GetCpuFeatures();
+    if(cpu.hasAvx2)
+        return GetVec3x8BoundsAvx2(blocks, blockCount);
+    else if(cpu.hasSse41)
+        return GetVec3x8BoundsSse41(blocks, blockCount);
+    return GetVec3x8BoundsScalar(blocks, blockCount);
+}
+
+void NormalizeVec3x8(Vec3x8* blocks, uint32_t blockCount)
+{
+    const CpuFeatures& cpu = GetCpuFeatures();
+    if(cpu.hasAvx2 && cpu.hasFma)
+        NormalizeVec3x8Avx2(blocks, blockCount);
+    else if(cpu.hasSse41)
+        NormalizeVec3x8Sse41(blocks, blockCount);
+    else
+        NormalizeVec3x8Scalar(blocks, blockCount);
+}
+
+void TransformVec3x8(const Mat4& mat, const Vec3x8* blocks, Vec3x8* dest, uint32_t blockCount)
+{
+    const CpuFeatures& cpu = GetCpuFeatures();
+    if(cpu.hasAvx2 && cpu.hasFma)
+        TransformVec3x8Avx2(mat, blocks, dest, blockCount);
+    else if(cpu.hasSse41)
+        TransformVec3x8Sse41(mat, blocks, dest, blockCount);
+    else
+        TransformVec3x8Scalar(mat, blocks, dest, blockCount);
+}
+
+void QuantizeVec3x8(const Vec3x8* blocks, const Aabb& bounds, QuantizedVec3x8* dest, uint32_t blockCount)
+{
+    const CpuFeatures& cpu = GetCpuFeatures();
+    if(cpu.hasAvx2)
+        QuantizeVec3x8Avx2(blocks, bounds, dest, blockCount);
+    else if(cpu.hasSse41)
+        QuantizeVec3x8Sse41(blocks, bounds, dest, blockCount);
+    else
+        QuantizeVec3x8Scalar(blocks, bounds, dest, blockCount);
+}
+
+void AddVec3x8(const Vec3x8* one, const Vec3x8* other, Vec3x8* dest, uint32_t blockCount)
+{
+    const CpuFeatures& cpu = GetCpuFeatures();
+    if(cpu.hasAvx2)
+        AddVec3x8Avx2(one, other, dest, blockCount);
+    else if(cpu.hasSse41)
+        AddVec3x8Sse41(one, other, dest, blockCount);
+    else
+        AddVec3x8Scalar(one, other, dest, blockCount);
+}
+
+void DotVec3x8(const Vec3x8* one, const Vec3x8* other, float* dest, uint32_t blockCount)
+{
+    const CpuFeatures& cpu = GetCpuFeatures();
+    if(cpu.hasAvx2 && cpu.hasFma)
+        DotVec3x8Avx2(one, other, dest, blockCount);
+    else if(cpu.hasSse41)
+        DotVec3x8Sse41(one, other, dest, blockCount);
+    else
+        DotVec3x8Scalar(one, other, dest, blockCount);
+}
+
+void CrossVec3x8(const Vec3x8* one, const Vec3x8* other, Vec3x8* dest, uint32_t blockCount)
+{
+    const CpuFeatures& cpu = GetCpuFeatures();
+    if(cpu.hasAvx2 && cpu.hasFma)
+        CrossVec3x8Avx2(one, other, dest, blockCount);
+    else if(cpu.hasSse41)
+        CrossVec3x8Sse41(one, other, dest, blockCount);
+    else
+        CrossVec3x8Scalar(one, other, dest, blockCount);
+}
+
+Mat4 operator * (const Mat4& mat, float scalar)
+{
+    Mat4 res = {};
+
+    for(int x = 0; x < 4; x++) {
+        for(int y = 0; y < 4; y++) {
+            res.data[y][x] = mat.data[y][x] * scalar;
+        }
+    }
+
+    return res;
+}
+
+constexpr Mat4 IdentityMat4()
+{
+    Mat4 res = {};
+    for(int i = 0; i < 4; i++)
+        res.data[i][i] = 1.0f;
+    return res;
+}
+
+constexpr Mat4 TranslateMat4(Vec3 position)
+{
+    Mat4 res = IdentityMat4();
+    res.data[3][0] = position.x;
+    res.data[3][1] = position.y;
+    res.data[3][2] = position.z;
+    return res;
+}
+
+constexpr Mat4 ScaleMat4(Vec3 scale)
+{
+    Mat4 res = IdentityMat4();
+    res.data[0][0] = scale.x;
+    res.data[1][1] = scale.y;
+    res.data[2][2] = scale.z;
+    return res;
+}
+
+Mat4 OrthoProjMat4(float left, float right, float bot, float top, float nearClip, float farClip)
+{
+    // based on D3DXMatrixOrthoOffCenterRH
     Mat4 res = IdentityMat4();
     res.data[0][0] = 2.0f / (right - left);
     res.data[1][1] = 2.0f / (top - bot);
@@ -1125,10 +2272,10 @@ Mat4 LookatMat4(Vec3 eye, Vec3 at, Vec3 up)
     return res;
 }
 
-Mat4 RotateEulerYMat4(float angleRads)
+constexpr Mat4 RotateEulerYMat4(float angleRads)
 {
-    float cosine = cosf(angleRads);
-    float sine = sinf(angleRads);
+    float cosine = std::is_constant_evaluated() ? (float)ConstexprCos(angleRads) : cosf(angleRads);
+    float sine = std::is_constant_evaluated() ? (float)ConstexprSin(angleRads) : sinf(angleRads);
     
     Mat4 res = IdentityMat4();
     res.data[0][0] =  cosine;
@@ -1138,10 +2285,10 @@ Mat4 RotateEulerYMat4(float angleRads)
     return res;
 }
 
-Mat4 RotateEulerXMat4(float angleRads)
+constexpr Mat4 RotateEulerXMat4(float angleRads)
 {
-    float cosine = cosf(angleRads);
-    float sine = sinf(angleRads);
+    float cosine = std::is_constant_evaluated() ? (float)ConstexprCos(angleRads) : cosf(angleRads);
+    float sine = std::is_constant_evaluated() ? (float)ConstexprSin(angleRads) : sinf(angleRads);
     
     Mat4 res = IdentityMat4();
     res.data[1][1] =  cosine;
@@ -1151,10 +2298,10 @@ Mat4 RotateEulerXMat4(float angleRads)
     return res;
 }
 
-Mat4 RotateEulerZMat4(float angleRads)
+constexpr Mat4 RotateEulerZMat4(float angleRads)
 {
-    float cosine = cosf(angleRads);
-    float sine = sinf(angleRads);
+    float cosine = std::is_constant_evaluated() ? (float)ConstexprCos(angleRads) : cosf(angleRads);
+    float sine = std::is_constant_evaluated() ? (float)ConstexprSin(angleRads) : sinf(angleRads);
     
     Mat4 res = IdentityMat4();
     res.data[0][0] =  cosine;
@@ -1164,6 +2311,11 @@ Mat4 RotateEulerZMat4(float angleRads)
     return res;
 }
 
+static_assert(IdentityMat4().data[2][2] == 1.0f && IdentityMat4().data[3][2] == 0.0f, "bad identity matrix");
+static_assert((TranslateMat4({ 1.0f, 2.0f, 3.0f }) * ScaleMat4({ 2.0f, 2.0f, 2.0f })).data[3][1] == 2.0f, "scale must not touch the translation");
+// a quarter turn around y takes +x to -z
+static_assert(IsNearlyEqual(RotateEulerYMat4((float)(pi / 2.0)).data[0][2], -1.0, 1e-6), "bad y rotation");
+
 struct Mat2
 {
     float data[2][2];
@@ -1174,12 +2326,91 @@ struct Mat3
     float data[3][3];
 };
 
-float Determ(const Mat2& mat)
+// rotation quaternion, x y z is the axis times sin(angle / 2) and w is cos(angle / 2)
+struct Quat
 {
-    return 
-        (mat.data[0][0] * mat.data[1][1]) - 
-        (mat.data[1][0] * mat.data[0][1]);
-}
+    float x;
+    float y;
+    float z;
+    float w;
+};
+
+constexpr Quat IdentityQuat()
+{
+    return { 0.0f, 0.0f, 0.0f, 1.0f };
+}
+
+// axis must be normalized
+constexpr Quat QuatFromAxisAngle(Vec3 axis, float angleRads)
+{
+    float halfAngle = angleRads * 0.5f;
+    float sine = std::is_constant_evaluated() ? (float)ConstexprSin(halfAngle) : sinf(halfAngle);
+    float cosine = std::is_constant_evaluated() ? (float)ConstexprCos(halfAngle) : cosf(halfAngle);
+    return { axis.x * sine, axis.y * sine, axis.z * sine, cosine };
+}
+
+// the rotation of other happens first, like Mat4 products
+constexpr Quat operator * (const Quat& one, const Quat& other)
+{
+    return {
+        .x = (one.w * other.x) + (one.x * other.w) + (one.y * other.z) - (one.z * other.y),
+        .y = (one.w * other.y) - (one.x * other.z) + (one.y * other.w) + (one.z * other.x),
+        .z = (one.w * other.z) + (one.x * other.y) - (one.y * other.x) + (one.z * other.w),
+        .w = (one.w * other.w) - (one.x * other.x) - (one.y * other.y) - (one.z * other.z)
+    };
+}
+
+// same order as RotateEulerXMat4 * RotateEulerYMat4 * RotateEulerZMat4
+constexpr Quat QuatFromEuler(Vec3 eulerRads)
+{
+    return QuatFromAxisAngle({ 1.0f, 0.0f, 0.0f }, eulerRads.x) *
+        QuatFromAxisAngle({ 0.0f, 1.0f, 0.0f }, eulerRads.y) *
+        QuatFromAxisAngle({ 0.0f, 0.0f, 1.0f }, eulerRads.z);
+}
+
+// repeated products drift off unit length, renormalize after incremental updates
+Quat Normalize(const Quat& quat)
+{
+    float len = sqrtf((quat.x * quat.x) + (quat.y * quat.y) + (quat.z * quat.z) + (quat.w * quat.w));
+    if(len == 0.0f)
+        return IdentityQuat();
+    float invLen = 1.0f / len;
+    return { quat.x * invLen, quat.y * invLen, quat.z * invLen, quat.w * invLen };
+}
+
+// assumes a unit quaternion, a zero one also gives the identity
+constexpr Mat3 Mat3FromQuat(const Quat& quat)
+{
+    float xx = quat.x * quat.x;
+    float yy = quat.y * quat.y;
+    float zz = quat.z * quat.z;
+    float xy = quat.x * quat.y;
+    float xz = quat.x * quat.z;
+    float yz = quat.y * quat.z;
+    float wx = quat.w * quat.x;
+    float wy = quat.w * quat.y;
+    float wz = quat.w * quat.z;
+
+    return {
+        .data = {
+            { 1.0f - (2.0f * (yy + zz)), 2.0f * (xy + wz), 2.0f * (xz - wy) },
+            { 2.0f * (xy - wz), 1.0f - (2.0f * (xx + zz)), 2.0f * (yz + wx) },
+            { 2.0f * (xz + wy), 2.0f * (yz - wx), 1.0f - (2.0f * (xx + yy)) }
+        }
+    };
+}
+
+static_assert(IsNearlyEqual(Mat3FromQuat(QuatFromAxisAngle({ 1.0f, 0.0f, 0.0f }, 0.7f)).data[1][2], RotateEulerXMat4(0.7f).data[1][2], 1e-6),
+    "quaternion and euler x rotation disagree");
+static_assert(IsNearlyEqual(Mat3FromQuat(QuatFromEuler({ 0.3f, 1.1f, 0.0f })).data[2][0], (RotateEulerXMat4(0.3f) * RotateEulerYMat4(1.1f)).data[2][0], 1e-6),
+    "quaternion euler order should match the matrix builders");
+
+float Determ(const Mat2& mat)
+{
+    return 
+        (mat.data[0][0] * mat.data[1][1]) - 
+        (mat.data[1][0] * mat.data[0][1]);
+}
 
 float Determ(const Mat3& mat)
 {
@@ -1307,16 +2538,200 @@ Mat4 Adjugate(const Mat4& mat)
     return Transpose(cofactorMat);
 }
 
-Mat4 Inverse(const Mat4& mat) 
+// reference path, a cofactor expansion with 17 determinants, only kept to check the faster inverses against
+Mat4 InverseCofactor(const Mat4& mat)
 {
     float determ = Determ(mat);
     Mat4 adjugateMat = Adjugate(mat);
     return adjugateMat * (1.0f / determ);
 }
 
+// Laplace expansion over the 2x2 sub-determinants of the first two and last two columns
+Mat4 InverseScalar(const Mat4& mat)
+{
+    const float (*a)[4] = mat.data;
+    float s0 = (a[0][0] * a[1][1]) - (a[1][0] * a[0][1]);
+    float s1 = (a[0][0] * a[1][2]) - (a[1][0] * a[0][2]);
+    float s2 = (a[0][0] * a[1][3]) - (a[1][0] * a[0][3]);
+    float s3 = (a[0][1] * a[1][2]) - (a[1][1] * a[0][2]);
+    float s4 = (a[0][1] * a[1][3]) - (a[1][1] * a[0][3]);
+    float s5 = (a[0][2] * a[1][3]) - (a[1][2] * a[0][3]);
+    float c5 = (a[2][2] * a[3][3]) - (a[3][2] * a[2][3]);
+    float c4 = (a[2][1] * a[3][3]) - (a[3][1] * a[2][3]);
+    float c3 = (a[2][1] * a[3][2]) - (a[3][1] * a[2][2]);
+    float c2 = (a[2][0] * a[3][3]) - (a[3][0] * a[2][3]);
+    float c1 = (a[2][0] * a[3][2]) - (a[3][0] * a[2][2]);
+    float c0 = (a[2][0] * a[3][1]) - (a[3][0] * a[2][1]);
+    float invDeterm = 1.0f / ((s0 * c5) - (s1 * c4) + (s2 * c3) + (s3 * c2) - (s4 * c1) + (s5 * c0));
+
+    Mat4 res = {
+        .data = {
+            { (a[1][1] * c5) - (a[1][2] * c4) + (a[1][3] * c3), -(a[0][1] * c5) + (a[0][2] * c4) - (a[0][3] * c3),
+              (a[3][1] * s5) - (a[3][2] * s4) + (a[3][3] * s3), -(a[2][1] * s5) + (a[2][2] * s4) - (a[2][3] * s3) },
+            { -(a[1][0] * c5) + (a[1][2] * c2) - (a[1][3] * c1), (a[0][0] * c5) - (a[0][2] * c2) + (a[0][3] * c1),
+              -(a[3][0] * s5) + (a[3][2] * s2) - (a[3][3] * s1), (a[2][0] * s5) - (a[2][2] * s2) + (a[2][3] * s1) },
+            { (a[1][0] * c4) - (a[1][1] * c2) + (a[1][3] * c0), -(a[0][0] * c4) + (a[0][1] * c2) - (a[0][3] * c0),
+              (a[3][0] * s4) - (a[3][1] * s2) + (a[3][3] * s0), -(a[2][0] * s4) + (a[2][1] * s2) - (a[2][3] * s0) },
+            { -(a[1][0] * c3) + (a[1][1] * c1) - (a[1][2] * c0), (a[0][0] * c3) - (a[0][1] * c1) + (a[0][2] * c0),
+              -(a[3][0] * s3) + (a[3][1] * s1) - (a[3][2] * s0), (a[2][0] * s3) - (a[2][1] * s1) + (a[2][2] * s0) }
+        }
+    };
+    for(int col = 0; col < 4; col++) {
+        for(int row = 0; row < 4; row++)
+            res.data[col][row] *= invDeterm;
+    }
+
+    return res;
+}
+
+// 2x2 matrices packed in one register as (m00, m01, m10, m11)
+__m128 Mul2x2Sse(__m128 one, __m128 other)
+{
+    return _mm_add_ps(_mm_mul_ps(one, _mm_shuffle_ps(other, other, _MM_SHUFFLE(3, 0, 3, 0))),
+        _mm_mul_ps(_mm_shuffle_ps(one, one, _MM_SHUFFLE(2, 3, 0, 1)), _mm_shuffle_ps(other, other, _MM_SHUFFLE(1, 2, 1, 2))));
+}
+
+// adjugate(one) * other
+__m128 AdjMul2x2Sse(__m128 one, __m128 other)
+{
+    return _mm_sub_ps(_mm_mul_ps(_mm_shuffle_ps(one, one, _MM_SHUFFLE(0, 0, 3, 3)), other),
+        _mm_mul_ps(_mm_shuffle_ps(one, one, _MM_SHUFFLE(2, 2, 1, 1)), _mm_shuffle_ps(other, other, _MM_SHUFFLE(1, 0, 3, 2))));
+}
+
+// one * adjugate(other)
+__m128 MulAdj2x2Sse(__m128 one, __m128 other)
+{
+    return _mm_sub_ps(_mm_mul_ps(one, _mm_shuffle_ps(other, other, _MM_SHUFFLE(0, 3, 0, 3))),
+        _mm_mul_ps(_mm_shuffle_ps(one, one, _MM_SHUFFLE(2, 3, 0, 1)), _mm_shuffle_ps(other, other, _MM_SHUFFLE(1, 2, 1, 2))));
+}
+
+// Cramer's rule on the four 2x2 blocks, every block is one register
+Mat4 InverseSse(const Mat4& mat)
+{
+    __m128 col0 = _mm_loadu_ps(mat.data[0]);
+    __m128 col1 = _mm_loadu_ps(mat.data[1]);
+    __m128 col2 = _mm_loadu_ps(mat.data[2]);
+    __m128 col3 = _mm_loadu_ps(mat.data[3]);
+
+    __m128 blockA = _mm_movelh_ps(col0, col1);
+    __m128 blockB = _mm_movehl_ps(col1, col0);
+    __m128 blockC = _mm_movelh_ps(col2, col3);
+    __m128 blockD = _mm_movehl_ps(col3, col2);
+
+    // determinants of the blocks as (|A|, |B|, |C|, |D|)
+    __m128 blockDeterms = _mm_sub_ps(
+        _mm_mul_ps(_mm_shuffle_ps(col0, col2, _MM_SHUFFLE(2, 0, 2, 0)), _mm_shuffle_ps(col1, col3, _MM_SHUFFLE(3, 1, 3, 1))),
+        _mm_mul_ps(_mm_shuffle_ps(col0, col2, _MM_SHUFFLE(3, 1, 3, 1)), _mm_shuffle_ps(col1, col3, _MM_SHUFFLE(2, 0, 2, 0))));
+    __m128 determA = _mm_shuffle_ps(blockDeterms, blockDeterms, _MM_SHUFFLE(0, 0, 0, 0));
+    __m128 determB = _mm_shuffle_ps(blockDeterms, blockDeterms, _MM_SHUFFLE(1, 1, 1, 1));
+    __m128 determC = _mm_shuffle_ps(blockDeterms, blockDeterms, _MM_SHUFFLE(2, 2, 2, 2));
+    __m128 determD = _mm_shuffle_ps(blockDeterms, blockDeterms, _MM_SHUFFLE(3, 3, 3, 3));
+
+    __m128 adjDMulC = AdjMul2x2Sse(blockD, blockC);
+    __m128 adjAMulB = AdjMul2x2Sse(blockA, blockB);
+    __m128 adjX = _mm_sub_ps(_mm_mul_ps(determD, blockA), Mul2x2Sse(blockB, adjDMulC));
+    __m128 adjW = _mm_sub_ps(_mm_mul_ps(determA, blockD), Mul2x2Sse(blockC, adjAMulB));
+    __m128 adjY = _mm_sub_ps(_mm_mul_ps(determB, blockC), MulAdj2x2Sse(blockD, adjAMulB));
+    __m128 adjZ = _mm_sub_ps(_mm_mul_ps(determC, blockB), MulAdj2x2Sse(blockA, adjDMulC));
+
+    // |M| = |A| |D| + |B| |C| - trace(adj(A) B adj(D) C)
+    __m128 trace = _mm_mul_ps(adjAMulB, _mm_shuffle_ps(adjDMulC, adjDMulC, _MM_SHUFFLE(3, 1, 2, 0)));
+    trace = _mm_add_ps(trace, _mm_shuffle_ps(trace, trace, _MM_SHUFFLE(1, 0, 3, 2)));
+    trace = _mm_add_ps(trace, _mm_shuffle_ps(trace, trace, _MM_SHUFFLE(2, 3, 0, 1)));
+    __m128 determ = _mm_sub_ps(_mm_add_ps(_mm_mul_ps(determA, determD), _mm_mul_ps(determB, determC)), trace);
+
+    // the block adjugates still need their off-diagonals negated, fold that into the reciprocal
+    __m128 invDeterm = _mm_div_ps(_mm_setr_ps(1.0f, -1.0f, -1.0f, 1.0f), determ);
+    adjX = _mm_mul_ps(adjX, invDeterm);
+    adjY = _mm_mul_ps(adjY, invDeterm);
+    adjZ = _mm_mul_ps(adjZ, invDeterm);
+    adjW = _mm_mul_ps(adjW, invDeterm);
+
+    Mat4 res;
+    _mm_storeu_ps(res.data[0], _mm_shuffle_ps(adjX, adjY, _MM_SHUFFLE(1, 3, 1, 3)));
+    _mm_storeu_ps(res.data[1], _mm_shuffle_ps(adjX, adjY, _MM_SHUFFLE(0, 2, 0, 2)));
+    _mm_storeu_ps(res.data[2], _mm_shuffle_ps(adjZ, adjW, _MM_SHUFFLE(1, 3, 1, 3)));
+    _mm_storeu_ps(res.data[3], _mm_shuffle_ps(adjZ, adjW, _MM_SHUFFLE(0, 2, 0, 2)));
+
+    return res;
+}
+
+// general inverse for matrices with a projection row, like the inverse view projection
+Mat4 Inverse(const Mat4& mat)
+{
+    if(GetCpuFeatures().hasSse2)
+        return InverseSse(mat);
+    return InverseScalar(mat);
+}
+
+// upper 3x3 inverted through the cross products of its columns, the translation is then rotated back,
+// only valid when the last row is (0, 0, 0, 1)
+Mat4 InverseAffine(const Mat4& mat)
+{
+    Vec3 col0 = { mat.data[0][0], mat.data[0][1], mat.data[0][2] };
+    Vec3 col1 = { mat.data[1][0], mat.data[1][1], mat.data[1][2] };
+    Vec3 col2 = { mat.data[2][0], mat.data[2][1], mat.data[2][2] };
+    Vec3 translation = { mat.data[3][0], mat.data[3][1], mat.data[3][2] };
+
+    // the rows of the inverse
+    Vec3 row0 = Cross(col1, col2);
+    Vec3 row1 = Cross(col2, col0);
+    Vec3 row2 = Cross(col0, col1);
+    float invDeterm = 1.0f / Dot(col0, row0);
+    row0 = row0 * invDeterm;
+    row1 = row1 * invDeterm;
+    row2 = row2 * invDeterm;
+
+    return {
+        .data = {
+            { row0.x, row1.x, row2.x, 0.0f },
+            { row0.y, row1.y, row2.y, 0.0f },
+            { row0.z, row1.z, row2.z, 0.0f },
+            { -Dot(row0, translation), -Dot(row1, translation), -Dot(row2, translation), 1.0f }
+        }
+    };
+}
+
+// rotation and translation only, the inverse rotation is the transpose
+Mat4 InverseRigid(const Mat4& mat)
+{
+    Vec3 col0 = { mat.data[0][0], mat.data[0][1], mat.data[0][2] };
+    Vec3 col1 = { mat.data[1][0], mat.data[1][1], mat.data[1][2] };
+    Vec3 col2 = { mat.data[2][0], mat.data[2][1], mat.data[2][2] };
+    Vec3 translation = { mat.data[3][0], mat.data[3][1], mat.data[3][2] };
+
+    return {
+        .data = {
+            { col0.x, col1.x, col2.x, 0.0f },
+            { col0.y, col1.y, col2.y, 0.0f },
+            { col0.z, col1.z, col2.z, 0.0f },
+            { -Dot(col0, translation), -Dot(col1, translation), -Dot(col2, translation), 1.0f }
+        }
+    };
+}
+
+// inverse transpose of the upper 3x3 only, the columns are the cross products scaled by 1 / determinant,
+// the translation never reaches a normal so it's dropped
 Mat4 NormalMat4FromModelMat(const Mat4& modelMat)
 {
-    return Transpose(Inverse(modelMat));
+    Vec3 col0 = { modelMat.data[0][0], modelMat.data[0][1], modelMat.data[0][2] };
+    Vec3 col1 = { modelMat.data[1][0], modelMat.data[1][1], modelMat.data[1][2] };
+    Vec3 col2 = { modelMat.data[2][0], modelMat.data[2][1], modelMat.data[2][2] };
+
+    Vec3 normalCol0 = Cross(col1, col2);
+    float invDeterm = 1.0f / Dot(col0, normalCol0);
+    normalCol0 = normalCol0 * invDeterm;
+    Vec3 normalCol1 = Cross(col2, col0) * invDeterm;
+    Vec3 normalCol2 = Cross(col0, col1) * invDeterm;
+
+    return {
+        .data = {
+            { normalCol0.x, normalCol0.y, normalCol0.z, 0.0f },
+            { normalCol1.x, normalCol1.y, normalCol1.z, 0.0f },
+            { normalCol2.x, normalCol2.y, normalCol2.z, 0.0f },
+            { 0.0f, 0.0f, 0.0f, 1.0f }
+        }
+    };
 }
 
 struct BasicColorShaderData
@@ -1337,8 +2752,18 @@ struct PhongShaderData
 };
 CHECK_CBUFFER_ALIGNMENT(PhongShaderData);
 
+struct PhongInstancedShaderData
+{
+    Mat4 projViewMat;
+    Vec4 color;
+    alignas(16) Vec3 lightPosition;
+    alignas(16) Vec3 camPosition;
+};
+CHECK_CBUFFER_ALIGNMENT(PhongInstancedShaderData);
+
 struct TextShaderData
 {
+    Mat4 orthoProjMat;
     Vec4 color;
 };
 CHECK_CBUFFER_ALIGNMENT(TextShaderData);
@@ -1379,6 +2804,20 @@ void UploadDataToBuffer(Dx11& dx, ID3D11Buffer* buffer, void* data, UINT dataByt
     dx.context->Unmap(buffer, 0);
 }
 
+// only for BufferUsageType::Updatable buffers, the rest of the buffer keeps its contents
+void UploadDataToBufferRange(Dx11& dx, ID3D11Buffer* buffer, const void* data, UINT byteOffset, UINT dataByteSize)
+{
+    D3D11_BOX destBox = {
+        .left = byteOffset,
+        .top = 0,
+        .front = 0,
+        .right = byteOffset + dataByteSize,
+        .bottom = 1,
+        .back = 1
+    };
+    dx.context->UpdateSubresource(buffer, 0, &destBox, data, 0, 0);
+}
+
 void ResizeDx11Backbuffer(Dx11Backbuffer* backbuffer, UINT newWidth, UINT newHeight, Dx11* dx)
 {
     dx->context->OMSetRenderTargets(0, 0, 0);
@@ -1442,6 +2881,208 @@ void UpdateTimer(Timer* timer)
     timer->lastTicks = currentTicks;
 }
 
+typedef void TaskFunc(void* data, int threadIndex);
+
+struct Task
+{
+    TaskFunc* func;
+    void* data;
+    volatile LONG* counter;
+};
+
+constexpr int MaxTaskPoolThreads = 64;
+constexpr LONG MaxQueuedTasks = 4096;
+
+struct TaskPool
+{
+    HANDLE threads[MaxTaskPoolThreads];
+    // worker threads only, the thread that created the pool also runs tasks while waiting
+    int threadCount;
+    Task tasks[MaxQueuedTasks];
+    LONG readIndex;
+    LONG writeIndex;
+    volatile LONG queueLock;
+    volatile LONG isShuttingDown;
+    HANDLE taskSemaphore;
+};
+
+// 0 = the thread that created the pool, workers are 1..threadCount
+static thread_local int taskThreadIndex = 0;
+
+struct TaskPoolThreadContext
+{
+    TaskPool* pool;
+    int threadIndex;
+};
+
+void LockTaskQueue(TaskPool* pool)
+{
+    while(InterlockedCompareExchange(&pool->queueLock, 1, 0) != 0)
+        YieldProcessor();
+}
+
+void UnlockTaskQueue(TaskPool* pool)
+{
+    InterlockedExchange(&pool->queueLock, 0);
+}
+
+bool TryRunQueuedTask(TaskPool* pool)
+{
+    LockTaskQueue(pool);
+    if(pool->readIndex == pool->writeIndex) {
+        UnlockTaskQueue(pool);
+        return false;
+    }
+    Task task = pool->tasks[pool->readIndex % MaxQueuedTasks];
+    pool->readIndex++;
+    UnlockTaskQueue(pool);
+
+    task.func(task.data, taskThreadIndex);
+    if(task.counter != nullptr)
+        InterlockedDecrement(task.counter);
+    return true;
+}
+
+DWORD WINAPI TaskPoolThreadProc(LPVOID param)
+{
+    TaskPoolThreadContext context = *(TaskPoolThreadContext*)param;
+    free(param);
+    taskThreadIndex = context.threadIndex;
+
+    TaskPool* pool = context.pool;
+    while(true) {
+        WaitForSingleObject(pool->taskSemaphore, INFINITE);
+        if(pool->isShuttingDown)
+            break;
+        TryRunQueuedTask(pool);
+    }
+    return 0;
+}
+
+TaskPool* CreateTaskPool(int threadCount)
+{
+    if(threadCount <= 0) {
+        SYSTEM_INFO sysInfo = {};
+        GetSystemInfo(&sysInfo);
+        threadCount = (int)sysInfo.dwNumberOfProcessors - 1;
+    }
+    if(threadCount > MaxTaskPoolThreads)
+        threadCount = MaxTaskPoolThreads;
+    if(threadCount < 0)
+        threadCount = 0;
+
+    TaskPool* pool = (TaskPool*)calloc(1, sizeof(TaskPool));
+    ASSERT(pool != nullptr);
+    pool->taskSemaphore = CreateSemaphoreA(nullptr, 0, MaxQueuedTasks, nullptr);
+    ASSERT(pool->taskSemaphore != nullptr);
+
+    for(int i = 0; i < threadCount; i++) {
+        TaskPoolThreadContext* context = (TaskPoolThreadContext*)calloc(1, sizeof(TaskPoolThreadContext));
+        ASSERT(context != nullptr);
+        *context = { .pool = pool, .threadIndex = i + 1 };
+        pool->threads[i] = CreateThread(nullptr, 0, TaskPoolThreadProc, context, 0, nullptr);
+        ASSERT(pool->threads[i] != nullptr);
+    }
+    pool->threadCount = threadCount;
+
+    return pool;
+}
+
+void FreeTaskPool(TaskPool* pool)
+{
+    InterlockedExchange(&pool->isShuttingDown, 1);
+    // a pool without workers runs everything inline, and waiting on zero handles is an error
+    if(pool->threadCount > 0) {
+        ReleaseSemaphore(pool->taskSemaphore, pool->threadCount, nullptr);
+        WaitForMultipleObjects(pool->threadCount, pool->threads, TRUE, INFINITE);
+    }
+    for(int i = 0; i < pool->threadCount; i++)
+        CloseHandle(pool->threads[i]);
+    CloseHandle(pool->taskSemaphore);
+    free(pool);
+}
+
+int GetTaskPoolTotalThreadCount(const TaskPool* pool)
+{
+    return pool == nullptr ? 1 : pool->threadCount + 1;
+}
+
+void PushTask(TaskPool* pool, TaskFunc* func, void* data, volatile LONG* counter)
+{
+    if(counter != nullptr)
+        InterlockedIncrement(counter);
+
+    if(pool != nullptr && pool->threadCount > 0) {
+        LockTaskQueue(pool);
+        if(pool->writeIndex - pool->readIndex < MaxQueuedTasks) {
+            pool->tasks[pool->writeIndex % MaxQueuedTasks] = { .func = func, .data = data, .counter = counter };
+            pool->writeIndex++;
+            UnlockTaskQueue(pool);
+            ReleaseSemaphore(pool->taskSemaphore, 1, nullptr);
+            return;
+        }
+        UnlockTaskQueue(pool);
+    }
+
+    // no workers or the queue is full: run it right here
+    func(data, taskThreadIndex);
+    if(counter != nullptr)
+        InterlockedDecrement(counter);
+}
+
+void WaitForTasks(TaskPool* pool, volatile LONG* counter)
+{
+    // help out instead of blocking so waiting from inside a task can't deadlock the pool
+    while(*counter > 0) {
+        if(pool == nullptr || !TryRunQueuedTask(pool))
+            YieldProcessor();
+    }
+}
+
+typedef void RangeTaskFunc(void* data, uint32_t start, uint32_t end, int threadIndex);
+
+struct RangeTask
+{
+    RangeTaskFunc* func;
+    void* data;
+    uint32_t start;
+    uint32_t end;
+};
+
+void RunRangeTask(void* data, int threadIndex)
+{
+    RangeTask* task = (RangeTask*)data;
+    task->func(task->data, task->start, task->end, threadIndex);
+}
+
+void ParallelFor(TaskPool* pool, uint32_t count, uint32_t batchSize, RangeTaskFunc* func, void* data)
+{
+    if(count == 0)
+        return;
+    if(batchSize == 0)
+        batchSize = 1;
+
+    uint32_t batchCount = (count + batchSize - 1) / batchSize;
+    if(pool == nullptr || pool->threadCount == 0 || batchCount == 1) {
+        func(data, 0, count, taskThreadIndex);
+        return;
+    }
+
+    RangeTask* tasks = (RangeTask*)calloc(1, batchCount * sizeof(RangeTask));
+    ASSERT(tasks != nullptr);
+
+    volatile LONG counter = 0;
+    for(uint32_t i = 0; i < batchCount; i++) {
+        uint32_t start = i * batchSize;
+        uint32_t end = (count - start) > batchSize ? start + batchSize : count;
+        tasks[i] = { .func = func, .data = data, .start = start, .end = end };
+        PushTask(pool, RunRangeTask, &tasks[i], &counter);
+    }
+    WaitForTasks(pool, &counter);
+
+    free(tasks);
+}
+
 struct FpsCam
 {
     Mat4 projMat;
@@ -1475,6 +3116,28 @@ Mat4 CreateViewMatForFpsCam(FpsCam* cam)
     return LookatMat4(cam->position, cam->position + cam->front, cam->up);
 }
 
+// world space sphere, puts the camera on +z looking down -z with the whole sphere in view
+FpsCam CreateFpsCamFramingSphere(const BoundingSphere& sphere, float fovY, float width, float height, 
+    float moveSpeed, float lookSpeed)
+{
+    float radius = sphere.radius > 0.0f ? sphere.radius : 1.0f;
+
+    // the sphere has to fit the narrower of the two fovs
+    float aspectRatio = width / height;
+    float fovX = 2.0f * atanf(tanf(fovY / 2.0f) * aspectRatio);
+    float narrowFov = fovX < fovY ? fovX : fovY;
+    float distance = radius / sinf(narrowFov / 2.0f);
+
+    // leave room to fly around the model without it getting clipped
+    float nearClip = (distance - radius) * 0.1f;
+    if(nearClip < radius * 0.001f)
+        nearClip = radius * 0.001f;
+    float farClip = (distance + radius) * 10.0f;
+
+    Vec3 position = sphere.center + Vec3{ 0.0f, 0.0f, distance };
+    return CreateFpsCam(position, moveSpeed, lookSpeed, PerspectiveProjMat4(fovY, width, height, nearClip, farClip));
+}
+
 void UpdateFpsCam(FpsCam* cam, Input* input, float deltaTime)
 {
     if(input->moveForward.isKeyDown)
@@ -1602,6 +3265,281 @@ StringView StringViewFromCString(const char* str)
     return view;
 }
 
+// number formatting straight into caller owned buffers, no allocations and no libc printf,
+// every function returns the number of chars written and the output is never null terminated
+
+constexpr int MinFormatPow10 = -53;
+constexpr int MaxFormatPow10 = 38;
+// the smallest float denormal still needs 9 digits below 1e-45
+constexpr double FormatPow10Table[MaxFormatPow10 - MinFormatPow10 + 1] = {
+    1e-53, 1e-52, 1e-51, 1e-50, 1e-49, 1e-48, 1e-47, 1e-46, 1e-45, 1e-44, 1e-43, 1e-42, 1e-41, 1e-40, 1e-39, 1e-38,
+    1e-37, 1e-36, 1e-35, 1e-34, 1e-33, 1e-32, 1e-31, 1e-30, 1e-29, 1e-28, 1e-27, 1e-26, 1e-25, 1e-24, 1e-23, 1e-22,
+    1e-21, 1e-20, 1e-19, 1e-18, 1e-17, 1e-16, 1e-15, 1e-14, 1e-13, 1e-12, 1e-11, 1e-10, 1e-9, 1e-8, 1e-7, 1e-6, 1e-5,
+    1e-4, 1e-3, 1e-2, 1e-1, 1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11, 1e12, 1e13, 1e14, 1e15, 1e16,
+    1e17, 1e18, 1e19, 1e20, 1e21, 1e22, 1e23, 1e24, 1e25, 1e26, 1e27, 1e28, 1e29, 1e30, 1e31, 1e32, 1e33, 1e34, 1e35,
+    1e36, 1e37, 1e38
+};
+
+constexpr char FormatDigitPairs[] =
+    "00010203040506070809101112131415161718192021222324252627282930313233343536373839"
+    "40414243444546474849505152535455565758596061626364656667686970717273747576777879"
+    "8081828384858687888990919293949596979899";
+
+double GetFormatPow10(int exponent)
+{
+    ASSERT(exponent >= MinFormatPow10 && exponent <= MaxFormatPow10);
+    return FormatPow10Table[exponent - MinFormatPow10];
+}
+
+size_t CopyFormattedChars(char* dest, size_t destLen, const char* src, size_t len)
+{
+    size_t copyLen = len < destLen ? len : destLen;
+    memcpy(dest, src, copyLen);
+    return copyLen;
+}
+
+// writes the digits backwards from end, two at a time
+char* WriteUintDigitsBackwards(char* end, uint64_t value)
+{
+    while(value >= 100) {
+        uint32_t pair = (uint32_t)(value % 100) * 2;
+        value /= 100;
+        *--end = FormatDigitPairs[pair + 1];
+        *--end = FormatDigitPairs[pair];
+    }
+    if(value >= 10) {
+        uint32_t pair = (uint32_t)value * 2;
+        *--end = FormatDigitPairs[pair + 1];
+        *--end = FormatDigitPairs[pair];
+    }
+    else {
+        *--end = (char)('0' + value);
+    }
+    return end;
+}
+
+size_t FormatUint(char* dest, size_t destLen, uint64_t value)
+{
+    char digits[20];
+    char* start = WriteUintDigitsBackwards(digits + sizeof(digits), value);
+    return CopyFormattedChars(dest, destLen, start, (size_t)((digits + sizeof(digits)) - start));
+}
+
+size_t FormatInt(char* dest, size_t destLen, int64_t value)
+{
+    char digits[21];
+    // negating in unsigned keeps INT64_MIN intact
+    uint64_t magnitude = value < 0 ? 0 - (uint64_t)value : (uint64_t)value;
+    char* start = WriteUintDigitsBackwards(digits + sizeof(digits), magnitude);
+    if(value < 0)
+        *--start = '-';
+    return CopyFormattedChars(dest, destLen, start, (size_t)((digits + sizeof(digits)) - start));
+}
+
+size_t FormatNonFiniteFloat(char* dest, size_t destLen, float value)
+{
+    if(isnan(value))
+        return CopyFormattedChars(dest, destLen, "nan", 3);
+    return value < 0.0f ? CopyFormattedChars(dest, destLen, "-inf", 4) : CopyFormattedChars(dest, destLen, "inf", 3);
+}
+
+// shortest decimal that parses back to the same float, plain notation from 1e-5 up to 1e9 and exponent notation outside
+size_t FormatFloat(char* dest, size_t destLen, float value)
+{
+    if(!isfinite(value))
+        return FormatNonFiniteFloat(dest, destLen, value);
+
+    char chars[32];
+    size_t len = 0;
+    if(signbit(value))
+        chars[len++] = '-';
+    float absValue = fabsf(value);
+    if(absValue == 0.0f) {
+        chars[len++] = '0';
+        return CopyFormattedChars(dest, destLen, chars, len);
+    }
+
+    // every float and both rounding boundaries to its neighbours are exact in a double,
+    // a boundary only rounds back when the mantissa is even
+    double exact = (double)absValue;
+    double lowBound = (exact + (double)nextafterf(absValue, 0.0f)) * 0.5;
+    // above FLT_MAX the next float would be infinity, the spacing stays the same as below it
+    double highBound = absValue == FLT_MAX ? exact + (exact - lowBound) : (exact + (double)nextafterf(absValue, INFINITY)) * 0.5;
+    uint32_t bits = 0;
+    memcpy(&bits, &absValue, sizeof(bits));
+    bool isEvenMantissa = (bits & 1) == 0;
+
+    // floor(log10(exact)) from the binary exponent, off by at most one
+    uint64_t exactBits = 0;
+    memcpy(&exactBits, &exact, sizeof(exactBits));
+    int binaryExponent = (int)((exactBits >> 52) & 0x7FF) - 1023;
+    int decimalExponent = (binaryExponent * 78913) >> 18;
+    if(decimalExponent < MaxFormatPow10 && exact >= GetFormatPow10(decimalExponent + 1))
+        decimalExponent++;
+
+    // 9 significant digits always round trip, so the loop always ends
+    uint64_t significand = 0;
+    int digitCount = 0;
+    int scaleExponent = 0;
+    for(digitCount = 1; digitCount <= 9; digitCount++) {
+        scaleExponent = decimalExponent - digitCount + 1;
+        significand = (uint64_t)((exact / GetFormatPow10(scaleExponent)) + 0.5);
+        // powers of ten up to 1e22 are exact, dividing by them avoids the rounding of the negative ones
+        double candidate = (scaleExponent < 0 && scaleExponent >= -22) ? (double)significand / GetFormatPow10(-scaleExponent) : 
+            (double)significand * GetFormatPow10(scaleExponent);
+        bool isInside = isEvenMantissa ? (candidate >= lowBound && candidate <= highBound) : 
+            (candidate > lowBound && candidate < highBound);
+        if(isInside)
+            break;
+    }
+    if(digitCount > 9)
+        digitCount = 9;
+
+    // 9.96 rounded to 2 digits is 10
+    if(significand == (uint64_t)GetFormatPow10(digitCount)) {
+        significand /= 10;
+        decimalExponent++;
+    }
+    while(digitCount > 1 && significand % 10 == 0) {
+        significand /= 10;
+        digitCount--;
+    }
+    char digits[20];
+    char* digitStart = WriteUintDigitsBackwards(digits + sizeof(digits), significand);
+    digitCount = (int)((digits + sizeof(digits)) - digitStart);
+
+    if(decimalExponent >= -5 && decimalExponent < 9) {
+        if(decimalExponent < 0) {
+            chars[len++] = '0';
+            chars[len++] = '.';
+            for(int i = -1; i > decimalExponent; i--)
+                chars[len++] = '0';
+            memcpy(chars + len, digitStart, digitCount);
+            len += digitCount;
+        }
+        else if(digitCount <= decimalExponent + 1) {
+            memcpy(chars + len, digitStart, digitCount);
+            len += digitCount;
+            for(int i = digitCount; i <= decimalExponent; i++)
+                chars[len++] = '0';
+        }
+        else {
+            memcpy(chars + len, digitStart, decimalExponent + 1);
+            len += decimalExponent + 1;
+            chars[len++] = '.';
+            memcpy(chars + len, digitStart + decimalExponent + 1, digitCount - (decimalExponent + 1));
+            len += digitCount - (decimalExponent + 1);
+        }
+    }
+    else {
+        chars[len++] = digitStart[0];
+        if(digitCount > 1) {
+            chars[len++] = '.';
+            memcpy(chars + len, digitStart + 1, digitCount - 1);
+            len += digitCount - 1;
+        }
+        chars[len++] = 'e';
+        if(decimalExponent < 0)
+            chars[len++] = '-';
+        char* exponentStart = WriteUintDigitsBackwards(digits + sizeof(digits), (uint64_t)abs(decimalExponent));
+        memcpy(chars + len, exponentStart, (digits + sizeof(digits)) - exponentStart);
+        len += (digits + sizeof(digits)) - exponentStart;
+    }
+    return CopyFormattedChars(dest, destLen, chars, len);
+}
+
+constexpr int MaxFormatFixedPrecision = 9;
+
+// same output as printf("%.*f") for values below 1e18 / 10^precision, larger ones fall back to FormatFloat
+size_t FormatFloatFixed(char* dest, size_t destLen, float value, int precision)
+{
+    if(!isfinite(value))
+        return FormatNonFiniteFloat(dest, destLen, value);
+    precision = precision < 0 ? 0 : (precision > MaxFormatFixedPrecision ? MaxFormatFixedPrecision : precision);
+
+    // a 24 bit mantissa times 5^9 fits in a double, so the scaled value and its fraction are exact
+    double scaled = fabs((double)value) * GetFormatPow10(precision);
+    if(scaled >= 1e18)
+        return FormatFloat(dest, destLen, value);
+    uint64_t rounded = (uint64_t)scaled;
+    double fraction = scaled - (double)rounded;
+    if(fraction > 0.5 || (fraction == 0.5 && (rounded & 1) != 0))
+        rounded++;
+
+    char chars[48];
+    char* end = chars + sizeof(chars);
+    char* start = end;
+    uint64_t precisionScale = (uint64_t)GetFormatPow10(precision);
+    if(precision > 0) {
+        start = WriteUintDigitsBackwards(end, rounded % precisionScale);
+        while(end - start < precision)
+            *--start = '0';
+        *--start = '.';
+    }
+    start = WriteUintDigitsBackwards(start, rounded / precisionScale);
+    if(signbit(value))
+        *--start = '-';
+    return CopyFormattedChars(dest, destLen, start, (size_t)(end - start));
+}
+
+// appends formatted text into a caller owned buffer, everything past the capacity is cut off
+struct TextBuilder
+{
+    char* data;
+    size_t len;
+    size_t capacity;
+};
+
+TextBuilder CreateTextBuilder(char* data, size_t capacity)
+{
+    return {
+        .data = data,
+        .capacity = capacity
+    };
+}
+
+StringView GetTextBuilderString(const TextBuilder& builder)
+{
+    return { .start = builder.data, .len = builder.len };
+}
+
+void AppendText(TextBuilder* builder, StringView text)
+{
+    builder->len += CopyFormattedChars(builder->data + builder->len, builder->capacity - builder->len, text.start, text.len);
+}
+
+void AppendUint(TextBuilder* builder, uint64_t value)
+{
+    builder->len += FormatUint(builder->data + builder->len, builder->capacity - builder->len, value);
+}
+
+void AppendInt(TextBuilder* builder, int64_t value)
+{
+    builder->len += FormatInt(builder->data + builder->len, builder->capacity - builder->len, value);
+}
+
+void AppendFloat(TextBuilder* builder, float value)
+{
+    builder->len += FormatFloat(builder->data + builder->len, builder->capacity - builder->len, value);
+}
+
+void AppendFloatFixed(TextBuilder* builder, float value, int precision)
+{
+    builder->len += FormatFloatFixed(builder->data + builder->len, builder->capacity - builder->len, value, precision);
+}
+
+// "(x y z)"
+void AppendVec3Fixed(TextBuilder* builder, Vec3 value, int precision)
+{
+    AppendText(builder, STRING_VIEW("("));
+    AppendFloatFixed(builder, value.x, precision);
+    AppendText(builder, STRING_VIEW(" "));
+    AppendFloatFixed(builder, value.y, precision);
+    AppendText(builder, STRING_VIEW(" "));
+    AppendFloatFixed(builder, value.z, precision);
+    AppendText(builder, STRING_VIEW(")"));
+}
+
 struct StringReader
 {
     StringView string;
@@ -1629,18 +3567,116 @@ StringView ReadLine(StringReader* reader)
     };
 }
 
-struct ObjModel
+struct BvhNode
 {
-    Vec3* positions;
-    Vec2* texCoords;
-    Vec3* normals;
-    unsigned int vertexCount;
+    Vec3 boundsMin;
+    // inner node: index of the first child, the second one is always right after it
+    // leaf: index of the first entry in Bvh::triIndices
+    uint32_t leftFirst;
+    Vec3 boundsMax;
+    // 0 for inner nodes
+    uint32_t triCount;
 };
+static_assert(sizeof(BvhNode) == 32, "sibling bvh nodes must share one 64 byte cache line");
 
-enum class ObjLineType
+constexpr size_t BvhNodeAlignment = 64;
+
+struct Bvh
 {
-    Comment,
-    Vertex,
+    // node 0 is the root, node 1 is padding so every sibling pair starts on a cache line
+    BvhNode* nodes;
+    uint32_t* triIndices;
+    uint32_t nodeCount;
+    uint32_t triCount;
+};
+
+void FreeBvh(Bvh* bvh)
+{
+    if(bvh->nodes != nullptr)
+        _aligned_free(bvh->nodes);
+    if(bvh->triIndices != nullptr)
+        free(bvh->triIndices);
+    *bvh = {};
+}
+
+constexpr uint32_t InvalidCorner = 0xFFFFFFFF;
+constexpr uint32_t InvalidCornerVertex = 0xFFFFFFFF;
+
+// corner table adjacency (Rossignac): corner c belongs to triangle c / 3, its neighbours in the triangle
+// are found with arithmetic and the corner across the edge opposite to c is stored in opposites
+struct CornerTable
+{
+    // vertex of each corner, InvalidCornerVertex for corners of triangles with broken indices
+    uint32_t* cornerVertices;
+    // InvalidCorner on boundary and non-manifold edges
+    uint32_t* opposites;
+    // lowest corner that uses each vertex
+    uint32_t* vertexCorners;
+    uint32_t cornerCount;
+    uint32_t vertexCount;
+};
+
+void FreeCornerTable(CornerTable* table)
+{
+    if(table->cornerVertices != nullptr)
+        free(table->cornerVertices);
+    if(table->opposites != nullptr)
+        free(table->opposites);
+    if(table->vertexCorners != nullptr)
+        free(table->vertexCorners);
+    *table = {};
+}
+
+uint32_t GetNextCorner(uint32_t corner)
+{
+    return corner % 3 == 2 ? corner - 2 : corner + 1;
+}
+
+uint32_t GetPrevCorner(uint32_t corner)
+{
+    return corner % 3 == 0 ? corner + 2 : corner - 1;
+}
+
+struct MeshValidationReport
+{
+    uint32_t triangleCount;
+    // two or more corners on the same position
+    uint32_t degenerateTriangles;
+    // distinct positions that are (nearly) collinear
+    uint32_t zeroAreaTriangles;
+    // relative indices, valid in .obj but worth knowing about when something looks off
+    uint32_t negativeIndices;
+    uint32_t outOfRangeIndices;
+    uint32_t edgeCount;
+    uint32_t boundaryEdges;
+    uint32_t boundaryLoops;
+    // shared by more than two triangles
+    uint32_t nonManifoldEdges;
+    uint32_t duplicateFaces;
+    float seconds;
+};
+
+struct ObjModel
+{
+    Vec3* positions;
+    Vec2* texCoords;
+    Vec3* normals;
+    // xyz = tangent, w = bitangent sign: bitangent = w * cross(normal, tangent)
+    Vec4* tangents;
+    unsigned int vertexCount;
+    // model space, over all positions in the file
+    ModelBounds bounds;
+    // over the triangles formed by every 3 consecutive positions
+    Bvh bvh;
+    MeshValidationReport validation;
+    // over the welded positions
+    CornerTable adjacency;
+};
+
+enum class ObjLineType
+{
+    Comment,
+    Vertex,
     TexCoord,
     Normal,
     Face,
@@ -1755,6 +3791,8 @@ void FreeObjData(ObjData* objData)
         free(objData->texCoords);
     if(objData->normals != nullptr)
         free(objData->normals);
+    if(objData->vertices != nullptr)
+        free(objData->vertices);
 
     *objData = {};
 }
@@ -1833,7 +3871,18 @@ int SplitStringOnChar(StringView line, char delimiter, bool collapseRepeatedDeli
     return writeIndex;
 }
 
-void GetVerticesFromObjLine(StringView line, ObjVertex* vertices, int* vertexWriteIndex)
+// negative indices count back from the attributes defined so far, turn them into regular 1-based ones
+int ResolveRelativeObjIndex(int objIndex, int attributeCountSoFar, uint32_t* negativeIndexCount)
+{
+    if(objIndex >= 0)
+        return objIndex;
+    (*negativeIndexCount)++;
+    int resolved = attributeCountSoFar + objIndex + 1;
+    return resolved > 0 ? resolved : objIndex;
+}
+
+void GetVerticesFromObjLine(StringView line, ObjVertex* vertices, int* vertexWriteIndex, ObjStats countsSoFar,
+    uint32_t* negativeIndexCount)
 {
     line = SkipObjLineStart(line);
 
@@ -1847,28 +3896,26 @@ void GetVerticesFromObjLine(StringView line, ObjVertex* vertices, int* vertexWri
         char* parseAt = nullptr;
         if(indexParts[0].len > 0) {
             parseAt = (char*)indexParts[0].start;
-            vertex.positionId = strtol(parseAt, &parseAt, 10);
+            vertex.positionId = ResolveRelativeObjIndex(strtol(parseAt, &parseAt, 10), countsSoFar.positionCount, negativeIndexCount);
         }
         if(indexParts[1].len > 0) {
             parseAt = (char*)indexParts[1].start;
-            vertex.texCoordId = strtol(parseAt, &parseAt, 10);
+            vertex.texCoordId = ResolveRelativeObjIndex(strtol(parseAt, &parseAt, 10), countsSoFar.texCoordCount, negativeIndexCount);
         }
         if(indexParts[2].len > 0) {
             parseAt = (char*)indexParts[2].start;
-            vertex.normalId = strtol(parseAt, &parseAt, 10);
+            vertex.normalId = ResolveRelativeObjIndex(strtol(parseAt, &parseAt, 10), countsSoFar.normalCount, negativeIndexCount);
         }
         vertices[(*vertexWriteIndex)++] = vertex;
     }
 }
 
+// arrayLen is the count of the attribute the index points into, returns arrayLen when it's out of range
 size_t GetArrayIndexFromObjIndex(int objIndex, size_t arrayLen)
 {
-    if(objIndex > 0) {
+    if(objIndex > 0 && (size_t)objIndex <= arrayLen)
         return objIndex - 1;
-    }
-    else {
-        return arrayLen - objIndex;
-    }
+    return arrayLen;
 }
 
 void FreeObjModel(ObjModel* model)
@@ -1879,553 +3926,7150 @@ void FreeObjModel(ObjModel* model)
         free(model->texCoords);
     if(model->normals != nullptr)
         free(model->normals);
+    if(model->tangents != nullptr)
+        free(model->tangents);
+    FreeBvh(&model->bvh);
+    FreeCornerTable(&model->adjacency);
 
     *model = {};
 }
 
-ObjModel LoadModelFromObjFile(const char* filename)
+// any unit vector perpendicular to the normal, used when the texcoords can't give us a direction
+Vec3 GetPerpendicularVec3(Vec3 normal)
 {
-    String objText = ReadAllTextFromFile(filename);
+    Vec3 axis = fabsf(normal.x) < 0.9f ? Vec3{ 1.0f, 0.0f, 0.0f } : Vec3{ 0.0f, 1.0f, 0.0f };
+    return Normalize(Cross(axis, normal));
+}
 
-    StringReader reader = { .string = { .start = objText.data, .len = objText.len } };
-    StringView line = {};
+float GetVec3AngleBetween(Vec3 one, Vec3 other)
+{
+    float lenProduct = Len(one) * Len(other);
+    if(lenProduct <= 0.0f)
+        return 0.0f;
+    return acosf(Clamp(-1.0f, 1.0f, Dot(one, other) / lenProduct));
+}
 
-    ObjStats stats = GetObjStats(objText);
-    ObjData data = AllocateObjData(stats);
+struct TangentGenContext
+{
+    const ObjModel* model;
+    const ObjVertex* vertices;
+    ObjStats stats;
+    // angle weighted tangent per corner, w = 1 for uv-orientation preserving faces, -1 otherwise
+    Vec4* cornerTangents;
+    uint32_t cornerCount;
+    int normalKeyBits;
+    // corners sorted by position and then by tangent group key, ties in corner order
+    uint64_t* sortKeys;
+    uint32_t* sortedCorners;
+    Vec4* tangents;
+};
 
-    int vertexWriteIndex = 0;
-    int texCoordWriteIndex = 0;
-    int normalWriteIndex = 0;
-    int verticesWriteIndex = 0;
+size_t GetCornerPositionIndex(const TangentGenContext& context, uint32_t corner)
+{
+    return GetArrayIndexFromObjIndex(context.vertices[corner].positionId, context.stats.positionCount);
+}
 
-    while((line = ReadLine(&reader)).len > 0) {
-        ObjLineType lineType = GetObjLineType(line);
-        switch(lineType) {
-            case ObjLineType::Vertex:
-                data.positions[vertexWriteIndex++] = GetVec3FromObjLine(line);
-                break;
-            case ObjLineType::TexCoord:
-                data.texCoords[texCoordWriteIndex++] = GetVec2FromObjLine(line);
-                break;
-            case ObjLineType::Normal:
-                data.normals[normalWriteIndex++] = GetVec3FromObjLine(line);
-                break;
-            case ObjLineType::Face:
-                GetVerticesFromObjLine(line, data.vertices, &verticesWriteIndex);
-                break;
+Vec3 GetCornerNormal(const ObjModel& model, uint32_t corner, Vec3 faceNormal)
+{
+    if(model.normals != nullptr)
+        return Normalize(model.normals[corner]);
+    return faceNormal;
+}
+
+void ComputeFaceTangentsTask(void* data, uint32_t start, uint32_t end, int threadIndex)
+{
+    // MikkTSpace style: per face tangent from the uv gradient, then projected onto each corner's
+    // normal plane and weighted by the corner angle so it doesn't depend on the triangulation
+    TangentGenContext* context = (TangentGenContext*)data;
+    const ObjModel& model = *context->model;
+
+    for(uint32_t face = start; face < end; face++) {
+        uint32_t base = face * 3;
+        Vec3 p[3] = { model.positions[base], model.positions[base + 1], model.positions[base + 2] };
+        Vec3 faceNormal = Cross(p[1] - p[0], p[2] - p[0]);
+        float faceNormalLen = Len(faceNormal);
+        faceNormal = faceNormalLen > 0.0f ? faceNormal / faceNormalLen : Vec3{ 0.0f, 1.0f, 0.0f };
+
+        Vec3 faceTangent = {};
+        float handedness = 1.0f;
+        if(model.texCoords != nullptr) {
+            Vec2 t0 = model.texCoords[base];
+            Vec2 t1 = model.texCoords[base + 1];
+            Vec2 t2 = model.texCoords[base + 2];
+            float du1 = t1.x - t0.x;
+            float dv1 = t1.y - t0.y;
+            float du2 = t2.x - t0.x;
+            float dv2 = t2.y - t0.y;
+            float signedUvArea = (du1 * dv2) - (dv1 * du2);
+            if(signedUvArea != 0.0f) {
+                handedness = signedUvArea > 0.0f ? 1.0f : -1.0f;
+                faceTangent = (((p[1] - p[0]) * dv2) - ((p[2] - p[0]) * dv1)) * handedness;
+            }
+        }
+
+        for(int i = 0; i < 3; i++) {
+            Vec3 normal = GetCornerNormal(model, base + i, faceNormal);
+            Vec3 projected = faceTangent - (normal * Dot(normal, faceTangent));
+            float projectedLen = Len(projected);
+            float angle = GetVec3AngleBetween(p[(i + 1) % 3] - p[i], p[(i + 2) % 3] - p[i]);
+
+            Vec3 weighted = {};
+            if(projectedLen > 1e-20f)
+                weighted = projected * (angle / projectedLen);
+            context->cornerTangents[base + i] = { weighted.x, weighted.y, weighted.z, handedness };
         }
     }
+}
 
-    bool hasTexCoords = data.vertices[0].texCoordId != InvalidObjIndex;
-    bool hasNormals = data.vertices[0].normalId != InvalidObjIndex;
+// texcoord, normal and handedness, corners with equal keys on the same position share a tangent
+uint64_t GetCornerTangentGroupKey(const TangentGenContext& context, uint32_t corner)
+{
+    ObjVertex vertex = context.vertices[corner];
+    uint64_t texCoordIndex = GetArrayIndexFromObjIndex(vertex.texCoordId, context.stats.texCoordCount);
+    uint64_t normalIndex = GetArrayIndexFromObjIndex(vertex.normalId, context.stats.normalCount);
+    uint64_t isMirrored = context.cornerTangents[corner].w < 0.0f ? 1 : 0;
+    return (((texCoordIndex << context.normalKeyBits) | normalIndex) << 1) | isMirrored;
+}
 
-    ObjModel model = { .vertexCount = stats.vertexCount };
-    model.positions = (Vec3*)calloc(1, stats.vertexCount * sizeof(Vec3));
-    ASSERT(model.positions != nullptr);
+bool IsSameTangentGroup(const TangentGenContext& context, uint32_t corner, uint32_t other)
+{
+    return GetCornerPositionIndex(context, corner) == GetCornerPositionIndex(context, other) &&
+        GetCornerTangentGroupKey(context, corner) == GetCornerTangentGroupKey(context, other);
+}
 
-    if(hasTexCoords) {
-        model.texCoords = (Vec2*)calloc(1, stats.vertexCount * sizeof(Vec2));
-        ASSERT(model.texCoords != nullptr);
+void WriteCornerTangentGroupKeysTask(void* data, uint32_t start, uint32_t end, int threadIndex)
+{
+    TangentGenContext* context = (TangentGenContext*)data;
+    for(uint32_t corner = start; corner < end; corner++) {
+        context->sortKeys[corner] = GetCornerTangentGroupKey(*context, corner);
+        context->sortedCorners[corner] = corner;
     }
+}
 
-    if(hasNormals) {
-        model.normals = (Vec3*)calloc(1, stats.vertexCount * sizeof(Vec3));
-        ASSERT(model.normals != nullptr);
-    }
+void WriteCornerPositionKeysTask(void* data, uint32_t start, uint32_t end, int threadIndex)
+{
+    TangentGenContext* context = (TangentGenContext*)data;
+    for(uint32_t i = start; i < end; i++)
+        context->sortKeys[i] = GetCornerPositionIndex(*context, context->sortedCorners[i]);
+}
 
-    for(int i = 0; i < stats.vertexCount; i++) {
-        ObjVertex vertex = data.vertices[i];
-        model.positions[i] = data.positions[GetArrayIndexFromObjIndex(vertex.positionId, stats.vertexCount)];
-        if(hasTexCoords)
-            model.texCoords[i] = data.texCoords[GetArrayIndexFromObjIndex(vertex.texCoordId, stats.vertexCount)];
-        if(hasNormals)
-            model.normals[i] = data.normals[GetArrayIndexFromObjIndex(vertex.normalId, stats.vertexCount)];
+void MergeCornerTangentsTask(void* data, uint32_t start, uint32_t end, int threadIndex)
+{
+    // corners that share position, texcoord, normal and handedness become one MikkTSpace vertex,
+    // anything else (uv seams, mirrored uvs) keeps its own tangent. every group is a run of the sorted corners,
+    // a task takes the groups that start in its range
+    TangentGenContext* context = (TangentGenContext*)data;
+    const ObjModel& model = *context->model;
+    const uint32_t* corners = context->sortedCorners;
+
+    uint32_t groupStart = start;
+    while(groupStart > 0 && groupStart < end && IsSameTangentGroup(*context, corners[groupStart - 1], corners[groupStart]))
+        groupStart++;
+
+    while(groupStart < end) {
+        uint32_t first = corners[groupStart];
+        uint32_t groupEnd = groupStart + 1;
+        while(groupEnd < context->cornerCount && IsSameTangentGroup(*context, first, corners[groupEnd]))
+            groupEnd++;
+
+        // corners without a valid position sort last and keep a zero tangent
+        if(GetCornerPositionIndex(*context, first) < (size_t)context->stats.positionCount) {
+            // the stable sorts keep each group in corner order, so the float sums don't depend on threading
+            Vec3 sum = {};
+            for(uint32_t i = groupStart; i < groupEnd; i++) {
+                Vec4 cornerTangent = context->cornerTangents[corners[i]];
+                sum = sum + Vec3{ cornerTangent.x, cornerTangent.y, cornerTangent.z };
+            }
+
+            float sumLen = Len(sum);
+            Vec3 tangent = sumLen > 1e-20f ? sum / sumLen :
+                GetPerpendicularVec3(GetCornerNormal(model, first, { 0.0f, 1.0f, 0.0f }));
+            float handedness = context->cornerTangents[first].w;
+            for(uint32_t i = groupStart; i < groupEnd; i++)
+                context->tangents[corners[i]] = { tangent.x, tangent.y, tangent.z, handedness };
+        }
+        groupStart = groupEnd;
     }
+}
 
-    FreeObjData(&data);
-    FreeString(&objText);
+int GetKeyBitCount(uint64_t maxKey)
+{
+    int bits = 1;
+    while(bits < 64 && (maxKey >> bits) != 0)
+        bits++;
+    return bits;
+}
 
-    return model;
+void RadixSortKeyValues(TaskPool* pool, uint64_t* keys, uint32_t* values, uint64_t* tempKeys, uint32_t* tempValues,
+    uint32_t count, int keyBits);
+
+Vec4* GenerateObjModelTangents(TaskPool* pool, const ObjModel& model, const ObjVertex* vertices, ObjStats stats)
+{
+    uint32_t cornerCount = model.vertexCount;
+    uint32_t faceCount = cornerCount / 3;
+    uint32_t positionCount = (uint32_t)stats.positionCount;
+
+    Vec4* tangents = (Vec4*)calloc(1, cornerCount * sizeof(Vec4));
+    ASSERT(tangents != nullptr);
+
+    // indices equal to the count stand for missing or broken ones
+    int texCoordKeyBits = GetKeyBitCount((uint64_t)stats.texCoordCount);
+    int normalKeyBits = GetKeyBitCount((uint64_t)stats.normalCount);
+    ASSERT(texCoordKeyBits + normalKeyBits + 1 <= 64);
+
+    TangentGenContext context = {
+        .model = &model,
+        .vertices = vertices,
+        .stats = stats,
+        .cornerTangents = (Vec4*)calloc(1, cornerCount * sizeof(Vec4)),
+        .cornerCount = cornerCount,
+        .normalKeyBits = normalKeyBits,
+        .sortKeys = (uint64_t*)calloc(1, cornerCount * sizeof(uint64_t) * 2),
+        .sortedCorners = (uint32_t*)calloc(1, cornerCount * sizeof(uint32_t) * 2),
+        .tangents = tangents
+    };
+    ASSERT(context.cornerTangents != nullptr);
+    ASSERT(context.sortKeys != nullptr);
+    ASSERT(context.sortedCorners != nullptr);
+
+    const uint32_t batchSize = 16 * 1024;
+    ParallelFor(pool, faceCount, batchSize, ComputeFaceTangentsTask, &context);
+
+    // two stable sorts, by tangent group and then by position, so every group of corners to merge is one run
+    // however many corners share a position
+    ParallelFor(pool, cornerCount, batchSize, WriteCornerTangentGroupKeysTask, &context);
+    RadixSortKeyValues(pool, context.sortKeys, context.sortedCorners, context.sortKeys + cornerCount,
+        context.sortedCorners + cornerCount, cornerCount, texCoordKeyBits + normalKeyBits + 1);
+    ParallelFor(pool, cornerCount, batchSize, WriteCornerPositionKeysTask, &context);
+    RadixSortKeyValues(pool, context.sortKeys, context.sortedCorners, context.sortKeys + cornerCount,
+        context.sortedCorners + cornerCount, cornerCount, GetKeyBitCount(positionCount));
+    ParallelFor(pool, cornerCount, batchSize, MergeCornerTangentsTask, &context);
+
+    free(context.sortedCorners);
+    free(context.sortKeys);
+    free(context.cornerTangents);
+
+    return tangents;
 }
 
-struct Transform
+struct WeldStats
 {
-    Vec3 position;
-    Vec3 scale;
-    Vec3 rotation;
+    uint32_t mergedCount;
+    size_t bytesSaved;
+};
+
+// positions are hashed into a uniform grid with cells twice the epsilon wide, so every position within
+// epsilon of a point lies in the point's own cell or in the neighbour on its nearer side of each axis
+struct WeldContext
+{
+    const Vec3* positions;
+    uint32_t positionCount;
+    float epsilon;
+    float invCellSize;
+    uint32_t bucketMask;
+    volatile LONG* bucketCounts;
+    uint32_t* bucketStarts;
+    uint32_t* bucketPositions;
+    // smallest index within epsilon of each position
+    uint32_t* representatives;
 };
 
-Mat4 GetModelMatFromTransform(const Transform& transform)
+void GetWeldCell(const WeldContext& context, Vec3 position, int64_t* cell, float* cellFraction)
 {
-    // TODO: support rotation on all axis
-    return TranslateMat4(transform.position) * 
-        ScaleMat4(transform.scale) * 
-        RotateEulerXMat4(transform.rotation.x) *
-        RotateEulerYMat4(transform.rotation.y);
+    float scaled[3] = { position.x * context.invCellSize, position.y * context.invCellSize, position.z * context.invCellSize };
+    for(int axis = 0; axis < 3; axis++) {
+        float cellStart = floorf(Clamp(-1e15f, 1e15f, scaled[axis]));
+        cell[axis] = (int64_t)cellStart;
+        cellFraction[axis] = scaled[axis] - cellStart;
+    }
 }
 
-struct Dx11ModelData
+uint32_t GetWeldBucket(const WeldContext& context, int64_t x, int64_t y, int64_t z)
 {
-    ID3D11Buffer** vertexBuffers;
-    UINT vertexBufferCount;
-    UINT* vertexBufferStrides;
-    UINT* vertexBufferOffsets;
-    UINT vertexCount;
-};
+    uint64_t hash = ((uint64_t)x * 73856093ull) ^ ((uint64_t)y * 19349663ull) ^ ((uint64_t)z * 83492791ull);
+    return (uint32_t)(hash ^ (hash >> 32)) & context.bucketMask;
+}
 
-Dx11ModelData CreateDx11ModelDataFromObjModel(const Dx11& dx, const ObjModel& objModel)
+uint32_t GetWeldBucketForPosition(const WeldContext& context, uint32_t positionIndex)
 {
-    Dx11ModelData modelData = {
-        .vertexBufferCount = 2,
-        .vertexCount = objModel.vertexCount
-    };
-
-    modelData.vertexBuffers = (ID3D11Buffer**)calloc(1, modelData.vertexBufferCount * sizeof(ID3D11Buffer*));
-    ASSERT(modelData.vertexBuffers != nullptr);
-    modelData.vertexBufferStrides = (UINT*)calloc(1, modelData.vertexBufferCount * sizeof(UINT*));
-    ASSERT(modelData.vertexBufferStrides != nullptr);
-    modelData.vertexBufferOffsets = (UINT*)calloc(1, modelData.vertexBufferCount * sizeof(UINT*));
-    ASSERT(modelData.vertexBufferOffsets != nullptr);
+    int64_t cell[3] = {};
+    float cellFraction[3] = {};
+    GetWeldCell(context, context.positions[positionIndex], cell, cellFraction);
+    return GetWeldBucket(context, cell[0], cell[1], cell[2]);
+}
 
-    modelData.vertexBuffers[0] = CreateStaticDx11VertexBuffer(dx, objModel.positions, sizeof(Vec3) * objModel.vertexCount);
-    modelData.vertexBuffers[1] = CreateStaticDx11VertexBuffer(dx, objModel.normals, sizeof(Vec3) * objModel.vertexCount);
+void CountWeldBucketsTask(void* data, uint32_t start, uint32_t end, int threadIndex)
+{
+    WeldContext* context = (WeldContext*)data;
+    for(uint32_t i = start; i < end; i++)
+        InterlockedIncrement(&context->bucketCounts[GetWeldBucketForPosition(*context, i)]);
+}
 
-    modelData.vertexBufferStrides[0] = sizeof(Vec3);
-    modelData.vertexBufferStrides[1] = sizeof(Vec3);
+void ScatterWeldBucketsTask(void* data, uint32_t start, uint32_t end, int threadIndex)
+{
+    WeldContext* context = (WeldContext*)data;
+    for(uint32_t i = start; i < end; i++) {
+        uint32_t bucket = GetWeldBucketForPosition(*context, i);
+        LONG slot = InterlockedIncrement(&context->bucketCounts[bucket]) - 1;
+        context->bucketPositions[context->bucketStarts[bucket] + slot] = i;
+    }
+}
 
-    modelData.vertexBufferOffsets[0] = 0;
-    modelData.vertexBufferOffsets[1] = 0;
+void FindWeldRepresentativesTask(void* data, uint32_t start, uint32_t end, int threadIndex)
+{
+    // taking the minimum index makes the result independent of the scatter order and the thread count
+    WeldContext* context = (WeldContext*)data;
+    float epsilonSq = context->epsilon * context->epsilon;
+    for(uint32_t bucket = start; bucket < end; bucket++) {
+        for(uint32_t slot = context->bucketStarts[bucket]; slot < context->bucketStarts[bucket + 1]; slot++) {
+            uint32_t positionIndex = context->bucketPositions[slot];
+            Vec3 position = context->positions[positionIndex];
+            int64_t cell[3] = {};
+            float cellFraction[3] = {};
+            GetWeldCell(*context, position, cell, cellFraction);
+            int64_t neighbourOffset[3] = {
+                cellFraction[0] < 0.5f ? -1 : 1,
+                cellFraction[1] < 0.5f ? -1 : 1,
+                cellFraction[2] < 0.5f ? -1 : 1
+            };
 
-    return modelData;
+            uint32_t representative = positionIndex;
+            for(int n = 0; n < 8; n++) {
+                uint32_t neighbourBucket = GetWeldBucket(*context,
+                    cell[0] + (n & 1 ? neighbourOffset[0] : 0),
+                    cell[1] + (n & 2 ? neighbourOffset[1] : 0),
+                    cell[2] + (n & 4 ? neighbourOffset[2] : 0));
+                for(uint32_t other = context->bucketStarts[neighbourBucket]; other < context->bucketStarts[neighbourBucket + 1]; other++) {
+                    uint32_t otherIndex = context->bucketPositions[other];
+                    Vec3 diff = context->positions[otherIndex] - position;
+                    if(otherIndex < representative && Dot(diff, diff) <= epsilonSq)
+                        representative = otherIndex;
+                }
+            }
+            context->representatives[positionIndex] = representative;
+        }
+    }
 }
 
-Dx11ModelData CreateDx11ModelDataForCube(const Dx11& dx, Vec3* vertexPositions, UINT vertexCount)
+// merges positions closer than epsilon, compacts the position array and points the face vertices at the survivors
+WeldStats WeldObjPositions(TaskPool* pool, ObjData* data, ObjStats* stats, float epsilon)
 {
-    Dx11ModelData modelData = {
-        .vertexBufferCount = 1,
-        .vertexCount = vertexCount
-    };
+    uint32_t positionCount = (uint32_t)stats->positionCount;
+    if(epsilon <= 0.0f || positionCount < 2)
+        return {};
 
-    modelData.vertexBuffers = (ID3D11Buffer**)calloc(1, modelData.vertexBufferCount * sizeof(ID3D11Buffer*));
-    ASSERT(modelData.vertexBuffers != nullptr);
-    modelData.vertexBufferStrides = (UINT*)calloc(1, modelData.vertexBufferCount * sizeof(UINT*));
-    ASSERT(modelData.vertexBufferStrides != nullptr);
-    modelData.vertexBufferOffsets = (UINT*)calloc(1, modelData.vertexBufferCount * sizeof(UINT*));
-    ASSERT(modelData.vertexBufferOffsets != nullptr);
+    uint32_t bucketCount = 1;
+    while(bucketCount < positionCount)
+        bucketCount *= 2;
+
+    WeldContext context = {
+        .positions = data->positions,
+        .positionCount = positionCount,
+        .epsilon = epsilon,
+        .invCellSize = 1.0f / (2.0f * epsilon),
+        .bucketMask = bucketCount - 1,
+        .bucketCounts = (volatile LONG*)calloc(1, bucketCount * sizeof(LONG)),
+        .bucketStarts = (uint32_t*)calloc(1, (bucketCount + 1) * sizeof(uint32_t)),
+        .bucketPositions = (uint32_t*)calloc(1, positionCount * sizeof(uint32_t)),
+        .representatives = (uint32_t*)calloc(1, positionCount * sizeof(uint32_t))
+    };
+    ASSERT(context.bucketCounts != nullptr);
+    ASSERT(context.bucketStarts != nullptr);
+    ASSERT(context.bucketPositions != nullptr);
+    ASSERT(context.representatives != nullptr);
+
+    const uint32_t batchSize = 16 * 1024;
+    ParallelFor(pool, positionCount, batchSize, CountWeldBucketsTask, &context);
+    for(uint32_t i = 0; i < bucketCount; i++) {
+        context.bucketStarts[i + 1] = context.bucketStarts[i] + (uint32_t)context.bucketCounts[i];
+        context.bucketCounts[i] = 0;
+    }
+    ParallelFor(pool, positionCount, batchSize, ScatterWeldBucketsTask, &context);
+    ParallelFor(pool, bucketCount, batchSize, FindWeldRepresentativesTask, &context);
+
+    // representatives always point backwards, so one forward pass resolves chains and compacts the survivors
+    uint32_t* remap = context.bucketPositions;
+    uint32_t keptCount = 0;
+    for(uint32_t i = 0; i < positionCount; i++) {
+        uint32_t representative = context.representatives[i];
+        if(representative == i) {
+            data->positions[keptCount] = data->positions[i];
+            remap[i] = keptCount++;
+        }
+        else {
+            remap[i] = remap[representative];
+        }
+    }
 
-    modelData.vertexBuffers[0] = CreateStaticDx11VertexBuffer(dx, vertexPositions, sizeof(Vec3) * vertexCount);
+    for(unsigned int i = 0; i < stats->vertexCount; i++) {
+        size_t positionIndex = GetArrayIndexFromObjIndex(data->vertices[i].positionId, positionCount);
+        if(positionIndex < positionCount)
+            data->vertices[i].positionId = (int)remap[positionIndex] + 1;
+    }
 
-    modelData.vertexBufferStrides[0] = sizeof(Vec3);
+    free(context.representatives);
+    free(context.bucketPositions);
+    free(context.bucketStarts);
+    free((void*)context.bucketCounts);
 
-    modelData.vertexBufferOffsets[0] = 0;
+    Vec3* shrunkPositions = (Vec3*)realloc(data->positions, keptCount * sizeof(Vec3));
+    if(shrunkPositions != nullptr)
+        data->positions = shrunkPositions;
+    stats->positionCount = (int)keptCount;
 
-    return modelData;
+    return {
+        .mergedCount = positionCount - keptCount,
+        .bytesSaved = (positionCount - keptCount) * sizeof(Vec3)
+    };
 }
 
-void FreeDx11ModelData(Dx11ModelData* modelData)
-{
-    for(int i = 0; i < modelData->vertexBufferCount; i++)
-        modelData->vertexBuffers[i]->Release();
+struct MeshValidationContext
+{
+    const ObjData* data;
+    ObjStats stats;
+    bool hasTexCoords;
+    bool hasNormals;
+    // open addressing tables filled from all threads at once, edges are keyed by their sorted position pair
+    volatile LONGLONG* edgeKeys;
+    volatile LONG* edgeCounts;
+    uint32_t edgeMask;
+    // 1 + index of the first triangle seen with a set of positions, 0 for empty slots
+    volatile LONG* faceSlots;
+    uint32_t faceMask;
+    volatile LONG degenerateTriangles;
+    volatile LONG zeroAreaTriangles;
+    volatile LONG outOfRangeIndices;
+    volatile LONG duplicateFaces;
+    volatile LONG edgeCount;
+    volatile LONG boundaryEdges;
+    volatile LONG nonManifoldEdges;
+};
 
-    free(modelData->vertexBuffers);
-    free(modelData->vertexBufferStrides);
-    free(modelData->vertexBufferOffsets);
+constexpr LONGLONG EmptyMeshEdgeKey = -1;
 
-    *modelData = {};
+uint64_t HashUint64(uint64_t value)
+{
+    // splitmix64 finalizer
+    value = (value ^ (value >> 30)) * 0xBF58476D1CE4E5B9ull;
+    value = (value ^ (value >> 27)) * 0x94D049BB133111EBull;
+    return value ^ (value >> 31);
 }
 
-struct BakedCharMap
+// 8 bytes at a time through the splitmix64 finalizer, for cache keys rather than hash tables
+uint64_t HashBytes(const void* data, size_t len)
 {
-    ByteBuffer ttf;
-    unsigned char* fontBitmap;
-    int fontBitmapWidth;
-    int fontBitmapHeight;
-    int startChar;
-    stbtt_bakedchar* bakedChars;
-};
+    const unsigned char* bytes = (const unsigned char*)data;
+    uint64_t hash = HashUint64(len);
+    size_t i = 0;
+    for(; i + 8 <= len; i += 8) {
+        uint64_t word = 0;
+        memcpy(&word, bytes + i, 8);
+        hash = HashUint64(hash ^ word);
+    }
+    uint64_t tail = 0;
+    memcpy(&tail, bytes + i, len - i);
+    return HashUint64(hash ^ tail);
+}
 
-void FreeBakedCharMap(BakedCharMap* bakedCharMap)
+uint32_t GetNextPowerOfTwo(uint32_t value)
 {
-    free(bakedCharMap->ttf.data);
-    free(bakedCharMap->fontBitmap);
-    free(bakedCharMap->bakedChars);
-    *bakedCharMap = {};
+    uint32_t res = 1;
+    while(res < value)
+        res *= 2;
+    return res;
 }
 
-BakedCharMap BakeCharMapForFont(const char* fontName, float fontHeight)
+void CountMeshEdge(MeshValidationContext* context, uint32_t a, uint32_t b)
+{
+    LONGLONG key = a < b ? (LONGLONG)(((uint64_t)a << 32) | b) : (LONGLONG)(((uint64_t)b << 32) | a);
+    uint32_t slot = (uint32_t)HashUint64((uint64_t)key) & context->edgeMask;
+    for(;;) {
+        LONGLONG existing = context->edgeKeys[slot];
+        if(existing == EmptyMeshEdgeKey)
+            existing = InterlockedCompareExchange64(&context->edgeKeys[slot], key, EmptyMeshEdgeKey);
+        if(existing == EmptyMeshEdgeKey || existing == key) {
+            InterlockedIncrement(&context->edgeCounts[slot]);
+            return;
+        }
+        slot = (slot + 1) & context->edgeMask;
+    }
+}
+
+void GetSortedTrianglePositions(const MeshValidationContext& context, uint32_t tri, uint32_t* sorted)
 {
-    ByteBuffer ttfBuffer = ReadAllBytesFromFile(fontName, 0);
-    
-    int fontBitmapWidth = 1024;
-    int fontBitmapHeight = 1024;
-    // one-channel bitmap
-    unsigned char* fontBitmapBuffer = (unsigned char*)calloc(1, fontBitmapWidth * fontBitmapHeight);
-    ASSERT(fontBitmapBuffer != nullptr);
-    
-    // from space to end of ASCII
-    int startChar = 32;
-    int nrOfChars = 96;
-    stbtt_bakedchar* bakedChars = (stbtt_bakedchar*)calloc(1, nrOfChars * sizeof(stbtt_bakedchar));
-    ASSERT(bakedChars != nullptr);
+    for(int i = 0; i < 3; i++)
+        sorted[i] = (uint32_t)GetArrayIndexFromObjIndex(context.data->vertices[(tri * 3) + i].positionId, context.stats.positionCount);
+    if(sorted[0] > sorted[1]) { uint32_t tmp = sorted[0]; sorted[0] = sorted[1]; sorted[1] = tmp; }
+    if(sorted[1] > sorted[2]) { uint32_t tmp = sorted[1]; sorted[1] = sorted[2]; sorted[2] = tmp; }
+    if(sorted[0] > sorted[1]) { uint32_t tmp = sorted[0]; sorted[0] = sorted[1]; sorted[1] = tmp; }
+}
 
-    int bakeRes = stbtt_BakeFontBitmap(
-        ttfBuffer.data,
-        0,
-        fontHeight,
-        fontBitmapBuffer,
-        fontBitmapWidth,
-        fontBitmapHeight,
-        startChar,
-        nrOfChars,
-        bakedChars
-    );
-    ASSERT(bakeRes > 0);
+// returns true when an earlier inserted triangle uses the same three positions
+bool InsertMeshFace(MeshValidationContext* context, uint32_t tri)
+{
+    uint32_t sorted[3] = {};
+    GetSortedTrianglePositions(*context, tri, sorted);
+    uint64_t hash = HashUint64(((uint64_t)sorted[0] << 32) | sorted[1]) ^ HashUint64(sorted[2]);
+    uint32_t slot = (uint32_t)hash & context->faceMask;
+    for(;;) {
+        LONG existing = context->faceSlots[slot];
+        if(existing == 0) {
+            existing = InterlockedCompareExchange(&context->faceSlots[slot], (LONG)tri + 1, 0);
+            if(existing == 0)
+                return false;
+        }
 
-    return {
-        .ttf = ttfBuffer,
-        .fontBitmap = fontBitmapBuffer,
-        .fontBitmapWidth = fontBitmapWidth,
-        .fontBitmapHeight = fontBitmapHeight,
-        .startChar = startChar,
-        .bakedChars = bakedChars
-    };
+        uint32_t other[3] = {};
+        GetSortedTrianglePositions(*context, (uint32_t)existing - 1, other);
+        if(other[0] == sorted[0] && other[1] == sorted[1] && other[2] == sorted[2])
+            return true;
+        slot = (slot + 1) & context->faceMask;
+    }
 }
 
-struct CharQuadInstanceData
-{
-    Mat4 xformMat;
-    Vec2 texCoords[6];
-};
+void ValidateMeshTrianglesTask(void* data, uint32_t start, uint32_t end, int threadIndex)
+{
+    MeshValidationContext* context = (MeshValidationContext*)data;
+    const ObjData& objData = *context->data;
+    LONG degenerateTriangles = 0;
+    LONG zeroAreaTriangles = 0;
+    LONG outOfRangeIndices = 0;
+    LONG duplicateFaces = 0;
+
+    for(uint32_t tri = start; tri < end; tri++) {
+        uint32_t positionIndices[3] = {};
+        bool hasValidPositions = true;
+        for(int i = 0; i < 3; i++) {
+            ObjVertex vertex = objData.vertices[(tri * 3) + i];
+            size_t positionIndex = GetArrayIndexFromObjIndex(vertex.positionId, context->stats.positionCount);
+            hasValidPositions = hasValidPositions && positionIndex < (size_t)context->stats.positionCount;
+            positionIndices[i] = (uint32_t)positionIndex;
+            outOfRangeIndices += positionIndex >= (size_t)context->stats.positionCount;
+            if(context->hasTexCoords)
+                outOfRangeIndices += GetArrayIndexFromObjIndex(vertex.texCoordId, context->stats.texCoordCount) >= (size_t)context->stats.texCoordCount;
+            if(context->hasNormals)
+                outOfRangeIndices += GetArrayIndexFromObjIndex(vertex.normalId, context->stats.normalCount) >= (size_t)context->stats.normalCount;
+        }
+        if(!hasValidPositions)
+            continue;
 
-size_t GenerateQuadInstanceDataForStringAt(BakedCharMap& bakedCharMap, StringView text, Vec2 position, 
-    Mat4& orthoProjMat, CharQuadInstanceData* instanceData, size_t maxInstances, size_t startIndex)
-{
-    size_t genCount = 0;
-    size_t readIndex = 0;
-    size_t writeIndex = startIndex;
-    while(writeIndex < maxInstances && readIndex < text.len) {
-        int c = (int)text.start[readIndex];
-        stbtt_aligned_quad quad = {};
-        stbtt_GetBakedQuad(
-            bakedCharMap.bakedChars,
-            bakedCharMap.fontBitmapWidth,
-            bakedCharMap.fontBitmapHeight,
-            c - bakedCharMap.startChar,
-            &position.x, 
-            &position.y,
-            &quad,
-            1
-        );
+        // triangles that reuse a position have no proper edges, keep them out of the topology checks
+        if(positionIndices[0] == positionIndices[1] || positionIndices[1] == positionIndices[2] || positionIndices[0] == positionIndices[2]) {
+            degenerateTriangles++;
+            continue;
+        }
 
-        // NOTE: 
-        // STB quad origin = top left and extends to bottom right
-        // OUR quad origin = bottom left and extends to top right, so do OUR the orthographic coords
-        // ^ y
-        // |
-        // -----> x
-        // instead of:
-        // -----> x
-        // |
-        // v y
-
-        float baseLine = position.y;
-        float baseLineDiff = quad.y0 - baseLine;
-        float height = quad.y1 - quad.y0;
-        float correctedYPos = (baseLine - (height + baseLineDiff));
+        Vec3 p0 = objData.positions[positionIndices[0]];
+        Vec3 e1 = objData.positions[positionIndices[1]] - p0;
+        Vec3 e2 = objData.positions[positionIndices[2]] - p0;
+        Vec3 e3 = e2 - e1;
+        float longestEdgeSq = fmaxf(Dot(e1, e1), fmaxf(Dot(e2, e2), Dot(e3, e3)));
+        float doubleArea = Len(Cross(e1, e2));
+        if(doubleArea <= FLT_EPSILON * longestEdgeSq)
+            zeroAreaTriangles++;
+
+        for(int i = 0; i < 3; i++)
+            CountMeshEdge(context, positionIndices[i], positionIndices[(i + 1) % 3]);
+        duplicateFaces += InsertMeshFace(context, tri);
+    }
 
-        Transform transform = {
-            .position = { quad.x0, correctedYPos, 0.0f },
-            .scale =    { quad.x1 - quad.x0, height, 1.0f }
-        };
+    InterlockedAdd(&context->degenerateTriangles, degenerateTriangles);
+    InterlockedAdd(&context->zeroAreaTriangles, zeroAreaTriangles);
+    InterlockedAdd(&context->outOfRangeIndices, outOfRangeIndices);
+    InterlockedAdd(&context->duplicateFaces, duplicateFaces);
+}
 
-        Vec2 topLeftTexCoord =      { quad.s0, quad.t0 };
-        Vec2 bottomLeftTexCoord =   { quad.s0, quad.t1 };
-        Vec2 bottomRightTexCoord =  { quad.s1, quad.t1 };
-        Vec2 topRightTexCoord =     { quad.s1, quad.t0 };
+void ClassifyMeshEdgesTask(void* data, uint32_t start, uint32_t end, int threadIndex)
+{
+    MeshValidationContext* context = (MeshValidationContext*)data;
+    LONG edgeCount = 0;
+    LONG boundaryEdges = 0;
+    LONG nonManifoldEdges = 0;
+    for(uint32_t slot = start; slot < end; slot++) {
+        LONG useCount = context->edgeCounts[slot];
+        edgeCount += useCount > 0;
+        boundaryEdges += useCount == 1;
+        nonManifoldEdges += useCount > 2;
+    }
+    InterlockedAdd(&context->edgeCount, edgeCount);
+    InterlockedAdd(&context->boundaryEdges, boundaryEdges);
+    InterlockedAdd(&context->nonManifoldEdges, nonManifoldEdges);
+}
 
-        instanceData[writeIndex] = {
-            .xformMat = orthoProjMat * GetModelMatFromTransform(transform),
-            .texCoords = {
-                topLeftTexCoord,
-                bottomLeftTexCoord,
-                bottomRightTexCoord,
-                bottomRightTexCoord,
-                topRightTexCoord,
-                topLeftTexCoord
-            }
-        };
+uint32_t FindBoundaryLoopRoot(uint32_t* parents, uint32_t position)
+{
+    while(parents[position] != position) {
+        parents[position] = parents[parents[position]];
+        position = parents[position];
+    }
+    return position;
+}
 
-        genCount++;
-        writeIndex++;
-        readIndex++;
+// every connected set of boundary edges is one loop (or hole) in the surface
+uint32_t CountBoundaryLoops(const MeshValidationContext& context)
+{
+    const uint32_t untouched = 0xFFFFFFFF;
+    uint32_t* parents = (uint32_t*)malloc(context.stats.positionCount * sizeof(uint32_t));
+    ASSERT(parents != nullptr);
+    memset(parents, 0xFF, context.stats.positionCount * sizeof(uint32_t));
+
+    uint32_t componentCount = 0;
+    for(uint32_t slot = 0; slot <= context.edgeMask; slot++) {
+        if(context.edgeCounts[slot] != 1)
+            continue;
+        uint32_t ends[2] = { (uint32_t)((uint64_t)context.edgeKeys[slot] >> 32), (uint32_t)context.edgeKeys[slot] };
+        for(int i = 0; i < 2; i++) {
+            if(parents[ends[i]] == untouched) {
+                parents[ends[i]] = ends[i];
+                componentCount++;
+            }
+        }
+        uint32_t rootA = FindBoundaryLoopRoot(parents, ends[0]);
+        uint32_t rootB = FindBoundaryLoopRoot(parents, ends[1]);
+        if(rootA != rootB) {
+            parents[rootB] = rootA;
+            componentCount--;
+        }
     }
 
-    return genCount;
+    free(parents);
+    return componentCount;
 }
 
-struct Dx11ShaderTexture2D
+// runs over the parsed indices before welding, so the report describes the file as it is
+MeshValidationReport ValidateObjMesh(TaskPool* pool, const ObjData& data, ObjStats stats, uint32_t negativeIndexCount)
+{
+    uint64_t startTicks = GetTicks();
+    uint32_t triangleCount = stats.vertexCount / 3;
+    MeshValidationReport report = { .triangleCount = triangleCount, .negativeIndices = negativeIndexCount };
+    if(triangleCount == 0)
+        return report;
+
+    uint32_t edgeCapacity = GetNextPowerOfTwo(triangleCount * 4);
+    uint32_t faceCapacity = GetNextPowerOfTwo(triangleCount * 2);
+    MeshValidationContext context = {
+        .data = &data,
+        .stats = stats,
+        .hasTexCoords = data.vertices[0].texCoordId != InvalidObjIndex,
+        .hasNormals = data.vertices[0].normalId != InvalidObjIndex,
+        .edgeKeys = (volatile LONGLONG*)malloc(edgeCapacity * sizeof(LONGLONG)),
+        .edgeCounts = (volatile LONG*)calloc(1, edgeCapacity * sizeof(LONG)),
+        .edgeMask = edgeCapacity - 1,
+        .faceSlots = (volatile LONG*)calloc(1, faceCapacity * sizeof(LONG)),
+        .faceMask = faceCapacity - 1
+    };
+    ASSERT(context.edgeKeys != nullptr);
+    ASSERT(context.edgeCounts != nullptr);
+    ASSERT(context.faceSlots != nullptr);
+    memset((void*)context.edgeKeys, 0xFF, edgeCapacity * sizeof(LONGLONG));
+
+    const uint32_t batchSize = 16 * 1024;
+    ParallelFor(pool, triangleCount, batchSize, ValidateMeshTrianglesTask, &context);
+    ParallelFor(pool, edgeCapacity, 256 * 1024, ClassifyMeshEdgesTask, &context);
+
+    report.degenerateTriangles = (uint32_t)context.degenerateTriangles;
+    report.zeroAreaTriangles = (uint32_t)context.zeroAreaTriangles;
+    report.outOfRangeIndices = (uint32_t)context.outOfRangeIndices;
+    report.duplicateFaces = (uint32_t)context.duplicateFaces;
+    report.edgeCount = (uint32_t)context.edgeCount;
+    report.boundaryEdges = (uint32_t)context.boundaryEdges;
+    report.nonManifoldEdges = (uint32_t)context.nonManifoldEdges;
+    if(report.boundaryEdges > 0)
+        report.boundaryLoops = CountBoundaryLoops(context);
+
+    free((void*)context.faceSlots);
+    free((void*)context.edgeCounts);
+    free((void*)context.edgeKeys);
+
+    report.seconds = (float)TicksToSeconds(GetTicks() - startTicks);
+    return report;
+}
+
+bool WriteMeshValidationJson(const char* filename, const MeshValidationReport& report)
+{
+    char json[1024] = {};
+    int len = snprintf(json, sizeof(json),
+        "{\n"
+        "    \"triangles\": %u,\n"
+        "    \"degenerateTriangles\": %u,\n"
+        "    \"zeroAreaTriangles\": %u,\n"
+        "    \"negativeIndices\": %u,\n"
+        "    \"outOfRangeIndices\": %u,\n"
+        "    \"edges\": %u,\n"
+        "    \"boundaryEdges\": %u,\n"
+        "    \"boundaryLoops\": %u,\n"
+        "    \"nonManifoldEdges\": %u,\n"
+        "    \"duplicateFaces\": %u,\n"
+        "    \"seconds\": %f\n"
+        "}\n",
+        report.triangleCount, report.degenerateTriangles, report.zeroAreaTriangles, report.negativeIndices,
+        report.outOfRangeIndices, report.edgeCount, report.boundaryEdges, report.boundaryLoops,
+        report.nonManifoldEdges, report.duplicateFaces, report.seconds);
+    return len > 0 && WriteAllBytesToFile(filename, json, (size_t)len);
+}
+
+constexpr int RadixSortDigitBits = 8;
+constexpr uint32_t RadixSortDigitCount = 1 << RadixSortDigitBits;
+constexpr uint32_t RadixSortBlockSize = 64 * 1024;
+
+// lsd radix sort of 64-bit keys with a 32-bit payload, each pass histograms fixed blocks in parallel and
+// then scatters them in parallel too, every block writing to its own precomputed offsets keeps it stable
+struct RadixSortContext
+{
+    uint32_t count;
+    const uint64_t* srcKeys;
+    const uint32_t* srcValues;
+    uint64_t* destKeys;
+    uint32_t* destValues;
+    // blockCount * RadixSortDigitCount, counts and then write offsets
+    uint32_t* blockOffsets;
+    int shift;
+};
+
+void CountRadixDigitsTask(void* data, uint32_t startBlock, uint32_t endBlock, int threadIndex)
+{
+    RadixSortContext* context = (RadixSortContext*)data;
+    for(uint32_t block = startBlock; block < endBlock; block++) {
+        uint32_t* counts = context->blockOffsets + (block * RadixSortDigitCount);
+        uint32_t start = block * RadixSortBlockSize;
+        uint32_t end = context->count - start > RadixSortBlockSize ? start + RadixSortBlockSize : context->count;
+        memset(counts, 0, RadixSortDigitCount * sizeof(uint32_t));
+        for(uint32_t i = start; i < end; i++)
+            counts[(context->srcKeys[i] >> context->shift) & (RadixSortDigitCount - 1)]++;
+    }
+}
+
+void ScatterRadixDigitsTask(void* data, uint32_t startBlock, uint32_t endBlock, int threadIndex)
+{
+    RadixSortContext* context = (RadixSortContext*)data;
+    for(uint32_t block = startBlock; block < endBlock; block++) {
+        uint32_t* offsets = context->blockOffsets + (block * RadixSortDigitCount);
+        uint32_t start = block * RadixSortBlockSize;
+        uint32_t end = context->count - start > RadixSortBlockSize ? start + RadixSortBlockSize : context->count;
+        for(uint32_t i = start; i < end; i++) {
+            uint64_t key = context->srcKeys[i];
+            uint32_t dest = offsets[(key >> context->shift) & (RadixSortDigitCount - 1)]++;
+            context->destKeys[dest] = key;
+            context->destValues[dest] = context->srcValues[i];
+        }
+    }
+}
+
+// sorts the low keyBits of the keys, the result ends up in keys/values, temp arrays must be as big as the input
+void RadixSortKeyValues(TaskPool* pool, uint64_t* keys, uint32_t* values, uint64_t* tempKeys, uint32_t* tempValues,
+    uint32_t count, int keyBits)
+{
+    uint32_t blockCount = (count + RadixSortBlockSize - 1) / RadixSortBlockSize;
+    uint32_t* blockOffsets = (uint32_t*)calloc(1, (size_t)blockCount * RadixSortDigitCount * sizeof(uint32_t));
+    ASSERT(blockOffsets != nullptr);
+
+    RadixSortContext context = {
+        .count = count,
+        .srcKeys = keys,
+        .srcValues = values,
+        .destKeys = tempKeys,
+        .destValues = tempValues,
+        .blockOffsets = blockOffsets
+    };
+    int passCount = (keyBits + RadixSortDigitBits - 1) / RadixSortDigitBits;
+    for(int pass = 0; pass < passCount; pass++) {
+        context.shift = pass * RadixSortDigitBits;
+        ParallelFor(pool, blockCount, 1, CountRadixDigitsTask, &context);
+
+        // digit major prefix sum so every block knows where its run of each digit goes
+        uint32_t offset = 0;
+        for(uint32_t digit = 0; digit < RadixSortDigitCount; digit++) {
+            for(uint32_t block = 0; block < blockCount; block++) {
+                uint32_t* slot = &blockOffsets[(block * RadixSortDigitCount) + digit];
+                uint32_t blockDigitCount = *slot;
+                *slot = offset;
+                offset += blockDigitCount;
+            }
+        }
+        ParallelFor(pool, blockCount, 1, ScatterRadixDigitsTask, &context);
+
+        const uint64_t* sortedKeys = context.destKeys;
+        const uint32_t* sortedValues = context.destValues;
+        context.destKeys = (uint64_t*)context.srcKeys;
+        context.destValues = (uint32_t*)context.srcValues;
+        context.srcKeys = sortedKeys;
+        context.srcValues = sortedValues;
+    }
+
+    if(context.srcKeys != keys) {
+        memcpy(keys, context.srcKeys, count * sizeof(uint64_t));
+        memcpy(values, context.srcValues, count * sizeof(uint32_t));
+    }
+    free(blockOffsets);
+}
+
+struct CornerTableBuildContext
+{
+    CornerTable* table;
+    uint64_t* edgeKeys;
+    uint32_t* edgeCorners;
+    uint32_t vertexBits;
+};
+
+constexpr uint64_t InvalidCornerEdgeKey = 0xFFFFFFFFFFFFFFFFull;
+
+void GetCornerEdgeKeysTask(void* data, uint32_t start, uint32_t end, int threadIndex)
+{
+    // every corner owns the edge across from it, keyed by its sorted vertex pair
+    CornerTableBuildContext* context = (CornerTableBuildContext*)data;
+    const uint32_t* cornerVertices = context->table->cornerVertices;
+    for(uint32_t corner = start; corner < end; corner++) {
+        uint32_t base = corner - (corner % 3);
+        uint32_t v0 = cornerVertices[base];
+        uint32_t v1 = cornerVertices[base + 1];
+        uint32_t v2 = cornerVertices[base + 2];
+        bool isValid = v0 != InvalidCornerVertex && v1 != InvalidCornerVertex && v2 != InvalidCornerVertex &&
+            v0 != v1 && v1 != v2 && v0 != v2;
+
+        uint32_t a = cornerVertices[GetNextCorner(corner)];
+        uint32_t b = cornerVertices[GetPrevCorner(corner)];
+        context->edgeKeys[corner] = isValid ? ((uint64_t)(a < b ? a : b) << context->vertexBits) | (a < b ? b : a) : InvalidCornerEdgeKey;
+        context->edgeCorners[corner] = corner;
+        context->table->opposites[corner] = InvalidCorner;
+    }
+}
+
+void LinkOppositeCornersTask(void* data, uint32_t start, uint32_t end, int threadIndex)
+{
+    // runs are handled by the task they start in, only edges shared by exactly two corners are manifold
+    CornerTableBuildContext* context = (CornerTableBuildContext*)data;
+    uint32_t cornerCount = context->table->cornerCount;
+    for(uint32_t i = start; i < end; i++) {
+        uint64_t key = context->edgeKeys[i];
+        if(key == InvalidCornerEdgeKey || (i > 0 && context->edgeKeys[i - 1] == key))
+            continue;
+        uint32_t runEnd = i + 1;
+        while(runEnd < cornerCount && context->edgeKeys[runEnd] == key)
+            runEnd++;
+        if(runEnd - i == 2) {
+            uint32_t c0 = context->edgeCorners[i];
+            uint32_t c1 = context->edgeCorners[i + 1];
+            context->table->opposites[c0] = c1;
+            context->table->opposites[c1] = c0;
+        }
+    }
+}
+
+// cornerVertices holds a malloc'd vertex index per corner, 3 per triangle, the table takes ownership of it
+CornerTable BuildCornerTable(TaskPool* pool, uint32_t* cornerVertices, uint32_t cornerCount, uint32_t vertexCount)
+{
+    CornerTable table = {
+        .cornerVertices = cornerVertices,
+        .opposites = (uint32_t*)malloc(cornerCount * sizeof(uint32_t)),
+        .vertexCorners = (uint32_t*)malloc((vertexCount > 0 ? vertexCount : 1) * sizeof(uint32_t)),
+        .cornerCount = cornerCount,
+        .vertexCount = vertexCount
+    };
+    ASSERT(table.cornerVertices != nullptr);
+    ASSERT(table.opposites != nullptr);
+    ASSERT(table.vertexCorners != nullptr);
+    if(cornerCount == 0)
+        return table;
+
+    int vertexBits = 1;
+    while(vertexBits < 32 && (1ull << vertexBits) < vertexCount)
+        vertexBits++;
+
+    CornerTableBuildContext context = {
+        .table = &table,
+        .edgeKeys = (uint64_t*)malloc(cornerCount * sizeof(uint64_t) * 2),
+        .edgeCorners = (uint32_t*)malloc(cornerCount * sizeof(uint32_t) * 2),
+        .vertexBits = (uint32_t)vertexBits
+    };
+    ASSERT(context.edgeKeys != nullptr);
+    ASSERT(context.edgeCorners != nullptr);
+
+    const uint32_t batchSize = 64 * 1024;
+    ParallelFor(pool, cornerCount, batchSize, GetCornerEdgeKeysTask, &context);
+    // the invalid key has all bits set so it still sorts last with only the used bits sorted
+    RadixSortKeyValues(pool, context.edgeKeys, context.edgeCorners, context.edgeKeys + cornerCount,
+        context.edgeCorners + cornerCount, cornerCount, vertexBits * 2);
+    ParallelFor(pool, cornerCount, batchSize, LinkOppositeCornersTask, &context);
+
+    memset(table.vertexCorners, 0xFF, vertexCount * sizeof(uint32_t));
+    for(uint32_t corner = cornerCount; corner-- > 0;) {
+        uint32_t vertex = table.cornerVertices[corner];
+        if(vertex != InvalidCornerVertex)
+            table.vertexCorners[vertex] = corner;
+    }
+
+    free(context.edgeCorners);
+    free(context.edgeKeys);
+    return table;
+}
+
+size_t GetCornerTableByteSize(const CornerTable& table)
+{
+    return ((size_t)table.cornerCount * 2 * sizeof(uint32_t)) + ((size_t)table.vertexCount * sizeof(uint32_t));
+}
+
+// headless benchmark on a generated grid, run with --bench-adjacency
+void RunCornerTableBenchmark(TaskPool* pool, uint32_t gridSize, int iterationCount)
+{
+    uint32_t vertexCount = (gridSize + 1) * (gridSize + 1);
+    uint32_t cornerCount = gridSize * gridSize * 6;
+    uint32_t* cornerVertices = (uint32_t*)malloc(cornerCount * sizeof(uint32_t));
+    ASSERT(cornerVertices != nullptr);
+    uint32_t writeIndex = 0;
+    for(uint32_t y = 0; y < gridSize; y++) {
+        for(uint32_t x = 0; x < gridSize; x++) {
+            uint32_t v00 = (y * (gridSize + 1)) + x;
+            uint32_t v10 = v00 + 1;
+            uint32_t v01 = v00 + gridSize + 1;
+            uint32_t v11 = v01 + 1;
+            uint32_t quad[6] = { v00, v10, v11, v00, v11, v01 };
+            for(int i = 0; i < 6; i++)
+                cornerVertices[writeIndex++] = quad[i];
+        }
+    }
+
+    TaskPool* pools[2] = { nullptr, pool };
+    for(int p = 0; p < 2; p++) {
+        uint64_t buildTicks = 0;
+        uint32_t boundaryCorners = 0;
+        size_t byteSize = 0;
+        for(int iteration = 0; iteration < iterationCount; iteration++) {
+            uint32_t* tableCornerVertices = (uint32_t*)malloc(cornerCount * sizeof(uint32_t));
+            ASSERT(tableCornerVertices != nullptr);
+            memcpy(tableCornerVertices, cornerVertices, cornerCount * sizeof(uint32_t));
+
+            uint64_t startTicks = GetTicks();
+            CornerTable table = BuildCornerTable(pools[p], tableCornerVertices, cornerCount, vertexCount);
+            buildTicks += GetTicks() - startTicks;
+
+            boundaryCorners = 0;
+            for(uint32_t corner = 0; corner < table.cornerCount; corner++)
+                boundaryCorners += table.opposites[corner] == InvalidCorner;
+            byteSize = GetCornerTableByteSize(table);
+            FreeCornerTable(&table);
+        }
+        uint32_t triangleCount = cornerCount / 3;
+        printf("corner table %s (%d threads): %u triangles in %.2f ms, %.1f bytes per triangle, %u boundary corners\n",
+            p == 0 ? "serial" : "parallel", GetTaskPoolTotalThreadCount(pools[p]), triangleCount,
+            (TicksToSeconds(buildTicks) * 1000.0) / iterationCount, (double)byteSize / triangleCount, boundaryCorners);
+    }
+
+    free(cornerVertices);
+}
+
+ObjModel LoadModelFromObjFile(const char* filename, TaskPool* pool, float weldEpsilon)
+{
+    String objText = ReadAllTextFromFile(filename);
+
+    StringReader reader = { .string = { .start = objText.data, .len = objText.len } };
+    StringView line = {};
+
+    ObjStats stats = GetObjStats(objText);
+    ObjData data = AllocateObjData(stats);
+
+    int vertexWriteIndex = 0;
+    int texCoordWriteIndex = 0;
+    int normalWriteIndex = 0;
+    int verticesWriteIndex = 0;
+    uint32_t negativeIndexCount = 0;
+    BoundsAccumulator bounds = CreateBoundsAccumulator();
+
+    while((line = ReadLine(&reader)).len > 0) {
+        ObjLineType lineType = GetObjLineType(line);
+        switch(lineType) {
+            case ObjLineType::Vertex:
+            {
+                Vec3 position = GetVec3FromObjLine(line);
+                data.positions[vertexWriteIndex++] = position;
+                AddPointToBounds(&bounds, position);
+                break;
+            }
+            case ObjLineType::TexCoord:
+                data.texCoords[texCoordWriteIndex++] = GetVec2FromObjLine(line);
+                break;
+            case ObjLineType::Normal:
+                data.normals[normalWriteIndex++] = GetVec3FromObjLine(line);
+                break;
+            case ObjLineType::Face:
+            {
+                ObjStats countsSoFar = {
+                    .positionCount = vertexWriteIndex,
+                    .texCoordCount = texCoordWriteIndex,
+                    .normalCount = normalWriteIndex
+                };
+                GetVerticesFromObjLine(line, data.vertices, &verticesWriteIndex, countsSoFar, &negativeIndexCount);
+                break;
+            }
+        }
+    }
+
+    MeshValidationReport validation = ValidateObjMesh(pool, data, stats, negativeIndexCount);
+
+    WeldStats weldStats = WeldObjPositions(pool, &data, &stats, weldEpsilon);
+    if(weldStats.mergedCount > 0) {
+        printf("welded %u positions closer than %g (%.1f KB saved)\n", weldStats.mergedCount, weldEpsilon,
+            weldStats.bytesSaved / 1024.0);
+    }
+
+    uint32_t* cornerVertices = (uint32_t*)malloc(stats.vertexCount * sizeof(uint32_t));
+    ASSERT(cornerVertices != nullptr);
+    for(unsigned int i = 0; i < stats.vertexCount; i++) {
+        size_t positionIndex = GetArrayIndexFromObjIndex(data.vertices[i].positionId, stats.positionCount);
+        cornerVertices[i] = positionIndex < (size_t)stats.positionCount ? (uint32_t)positionIndex : InvalidCornerVertex;
+    }
+
+    bool hasTexCoords = data.vertices[0].texCoordId != InvalidObjIndex;
+    bool hasNormals = data.vertices[0].normalId != InvalidObjIndex;
+
+    ObjModel model = {
+        .vertexCount = stats.vertexCount,
+        .bounds = GetBoundsFromAccumulator(bounds),
+        .validation = validation,
+        .adjacency = BuildCornerTable(pool, cornerVertices, stats.vertexCount, stats.positionCount)
+    };
+    model.positions = (Vec3*)calloc(1, stats.vertexCount * sizeof(Vec3));
+    ASSERT(model.positions != nullptr);
+
+    if(hasTexCoords) {
+        model.texCoords = (Vec2*)calloc(1, stats.vertexCount * sizeof(Vec2));
+        ASSERT(model.texCoords != nullptr);
+    }
+
+    if(hasNormals) {
+        model.normals = (Vec3*)calloc(1, stats.vertexCount * sizeof(Vec3));
+        ASSERT(model.normals != nullptr);
+    }
+
+    for(int i = 0; i < stats.vertexCount; i++) {
+        ObjVertex vertex = data.vertices[i];
+        // broken indices are reported by the validation pass and leave the attribute at zero
+        size_t positionIndex = GetArrayIndexFromObjIndex(vertex.positionId, stats.positionCount);
+        if(positionIndex < (size_t)stats.positionCount)
+            model.positions[i] = data.positions[positionIndex];
+        size_t texCoordIndex = GetArrayIndexFromObjIndex(vertex.texCoordId, stats.texCoordCount);
+        if(hasTexCoords && texCoordIndex < (size_t)stats.texCoordCount)
+            model.texCoords[i] = data.texCoords[texCoordIndex];
+        size_t normalIndex = GetArrayIndexFromObjIndex(vertex.normalId, stats.normalCount);
+        if(hasNormals && normalIndex < (size_t)stats.normalCount)
+            model.normals[i] = data.normals[normalIndex];
+    }
+
+    model.tangents = GenerateObjModelTangents(pool, model, data.vertices, stats);
+
+    FreeObjData(&data);
+    FreeString(&objText);
+
+    return model;
+}
+
+constexpr int BvhBinCount = 16;
+// nodes with more triangles than this get their children built as separate tasks
+constexpr uint32_t BvhParallelSubtreeMinTris = 8 * 1024;
+// nodes with more triangles than this also bin their triangles in parallel
+constexpr uint32_t BvhParallelBinningMinTris = 256 * 1024;
+constexpr uint32_t BvhBinningBatchSize = 64 * 1024;
+// nodes this deep stay leaves whatever their triangle count, so the traversal stack can't overflow
+constexpr uint32_t BvhMaxDepth = 64;
+
+struct BvhBin
+{
+    Aabb bounds;
+    Aabb centroidBounds;
+    uint32_t triCount;
+};
+
+struct BvhBinSet
+{
+    BvhBin bins[3][BvhBinCount];
+};
+
+struct BvhBuildContext
+{
+    TaskPool* pool;
+    const Vec3* positions;
+    Aabb* triBounds;
+    Vec3* triCentroids;
+    BvhNode* nodes;
+    uint32_t* triIndices;
+    volatile LONG nodeCount;
+    volatile LONG taskCounter;
+};
+
+struct BvhBuildTask
+{
+    BvhBuildContext* context;
+    uint32_t nodeIndex;
+    uint32_t depth;
+    Aabb centroidBounds;
+};
+
+struct BvhBinningJob
+{
+    BvhBuildContext* context;
+    uint32_t firstTri;
+    Aabb centroidBounds;
+    BvhBinSet* batchBinSets;
+};
+
+int GetBvhBinIndex(float centroid, float boundsMin, float binScale)
+{
+    int bin = (int)((centroid - boundsMin) * binScale);
+    return bin < 0 ? 0 : (bin >= BvhBinCount ? BvhBinCount - 1 : bin);
+}
+
+float GetBvhBinScale(const Aabb& centroidBounds, int axis)
+{
+    float extent = GetVec3Component(centroidBounds.max, axis) - GetVec3Component(centroidBounds.min, axis);
+    return extent > 0.0f ? (float)BvhBinCount / extent : 0.0f;
+}
+
+void ResetBvhBinSet(BvhBinSet* binSet)
+{
+    for(int axis = 0; axis < 3; axis++) {
+        for(int i = 0; i < BvhBinCount; i++)
+            binSet->bins[axis][i] = { .bounds = EmptyAabb(), .centroidBounds = EmptyAabb() };
+    }
+}
+
+void BinBvhTriangles(const BvhBuildContext& context, uint32_t start, uint32_t end, const Aabb& centroidBounds,
+    BvhBinSet* binSet)
+{
+    float binScales[3] = {
+        GetBvhBinScale(centroidBounds, 0),
+        GetBvhBinScale(centroidBounds, 1),
+        GetBvhBinScale(centroidBounds, 2)
+    };
+
+    for(uint32_t i = start; i < end; i++) {
+        uint32_t tri = context.triIndices[i];
+        Vec3 centroid = context.triCentroids[tri];
+        for(int axis = 0; axis < 3; axis++) {
+            int binIndex = GetBvhBinIndex(GetVec3Component(centroid, axis),
+                GetVec3Component(centroidBounds.min, axis), binScales[axis]);
+            BvhBin* bin = &binSet->bins[axis][binIndex];
+            bin->bounds = Union(bin->bounds, context.triBounds[tri]);
+            bin->centroidBounds = Grow(bin->centroidBounds, centroid);
+            bin->triCount++;
+        }
+    }
+}
+
+void BinBvhTrianglesTask(void* data, uint32_t start, uint32_t end, int threadIndex)
+{
+    BvhBinningJob* job = (BvhBinningJob*)data;
+    BvhBinSet* binSet = &job->batchBinSets[start / BvhBinningBatchSize];
+    ResetBvhBinSet(binSet);
+    BinBvhTriangles(*job->context, job->firstTri + start, job->firstTri + end, job->centroidBounds, binSet);
+}
+
+void BinBvhNode(BvhBuildContext* context, const BvhNode& node, const Aabb& centroidBounds, BvhBinSet* binSet)
+{
+    ResetBvhBinSet(binSet);
+    if(node.triCount < BvhParallelBinningMinTris) {
+        BinBvhTriangles(*context, node.leftFirst, node.leftFirst + node.triCount, centroidBounds, binSet);
+        return;
+    }
+
+    uint32_t batchCount = (node.triCount + BvhBinningBatchSize - 1) / BvhBinningBatchSize;
+    BvhBinningJob job = {
+        .context = context,
+        .firstTri = node.leftFirst,
+        .centroidBounds = centroidBounds,
+        .batchBinSets = (BvhBinSet*)calloc(1, batchCount * sizeof(BvhBinSet))
+    };
+    ASSERT(job.batchBinSets != nullptr);
+
+    ParallelFor(context->pool, node.triCount, BvhBinningBatchSize, BinBvhTrianglesTask, &job);
+
+    for(uint32_t batch = 0; batch < batchCount; batch++) {
+        for(int axis = 0; axis < 3; axis++) {
+            for(int i = 0; i < BvhBinCount; i++) {
+                BvhBin* bin = &binSet->bins[axis][i];
+                const BvhBin& batchBin = job.batchBinSets[batch].bins[axis][i];
+                bin->bounds = Union(bin->bounds, batchBin.bounds);
+                bin->centroidBounds = Union(bin->centroidBounds, batchBin.centroidBounds);
+                bin->triCount += batchBin.triCount;
+            }
+        }
+    }
+    free(job.batchBinSets);
+}
+
+void BuildBvhNode(BvhBuildContext* context, uint32_t nodeIndex, uint32_t depth, Aabb centroidBounds);
+
+void BuildBvhNodeTask(void* data, int threadIndex)
+{
+    BvhBuildTask* task = (BvhBuildTask*)data;
+    BuildBvhNode(task->context, task->nodeIndex, task->depth, task->centroidBounds);
+    free(task);
+}
+
+void BuildBvhNode(BvhBuildContext* context, uint32_t nodeIndex, uint32_t depth, Aabb centroidBounds)
+{
+    BvhNode* node = &context->nodes[nodeIndex];
+    if(node->triCount <= 2 || depth == BvhMaxDepth)
+        return;
+
+    BvhBinSet* binSet = (BvhBinSet*)malloc(sizeof(BvhBinSet));
+    ASSERT(binSet != nullptr);
+    BinBvhNode(context, *node, centroidBounds, binSet);
+
+    // sweep the bin boundaries of every axis and keep the cheapest SAH split,
+    // cost is relative to intersecting a triangle with traversal step = 1
+    const float traversalCost = 1.0f;
+    float nodeArea = SurfaceArea({ node->boundsMin, node->boundsMax });
+    float bestCost = (float)node->triCount;
+    int bestAxis = -1;
+    int bestSplit = 0;
+    for(int axis = 0; axis < 3; axis++) {
+        if(GetBvhBinScale(centroidBounds, axis) == 0.0f)
+            continue;
+
+        const BvhBin* bins = binSet->bins[axis];
+        float leftAreas[BvhBinCount - 1];
+        uint32_t leftCounts[BvhBinCount - 1];
+        Aabb leftBox = EmptyAabb();
+        uint32_t leftCount = 0;
+        for(int i = 0; i < BvhBinCount - 1; i++) {
+            leftBox = Union(leftBox, bins[i].bounds);
+            leftCount += bins[i].triCount;
+            leftAreas[i] = SurfaceArea(leftBox);
+            leftCounts[i] = leftCount;
+        }
+
+        Aabb rightBox = EmptyAabb();
+        uint32_t rightCount = 0;
+        for(int i = BvhBinCount - 1; i > 0; i--) {
+            rightBox = Union(rightBox, bins[i].bounds);
+            rightCount += bins[i].triCount;
+            if(leftCounts[i - 1] == 0 || rightCount == 0)
+                continue;
+
+            float cost = traversalCost +
+                ((leftAreas[i - 1] * leftCounts[i - 1]) + (SurfaceArea(rightBox) * rightCount)) / nodeArea;
+            if(cost < bestCost) {
+                bestCost = cost;
+                bestAxis = axis;
+                bestSplit = i;
+            }
+        }
+    }
+
+    if(bestAxis < 0) {
+        free(binSet);
+        return;
+    }
+
+    Aabb leftBounds = EmptyAabb();
+    Aabb leftCentroidBounds = EmptyAabb();
+    Aabb rightBounds = EmptyAabb();
+    Aabb rightCentroidBounds = EmptyAabb();
+    for(int i = 0; i < BvhBinCount; i++) {
+        const BvhBin& bin = binSet->bins[bestAxis][i];
+        if(i < bestSplit) {
+            leftBounds = Union(leftBounds, bin.bounds);
+            leftCentroidBounds = Union(leftCentroidBounds, bin.centroidBounds);
+        }
+        else {
+            rightBounds = Union(rightBounds, bin.bounds);
+            rightCentroidBounds = Union(rightCentroidBounds, bin.centroidBounds);
+        }
+    }
+    free(binSet);
+
+    float axisMin = GetVec3Component(centroidBounds.min, bestAxis);
+    float binScale = GetBvhBinScale(centroidBounds, bestAxis);
+    uint32_t i = node->leftFirst;
+    uint32_t j = node->leftFirst + node->triCount;
+    while(i < j) {
+        uint32_t tri = context->triIndices[i];
+        if(GetBvhBinIndex(GetVec3Component(context->triCentroids[tri], bestAxis), axisMin, binScale) < bestSplit) {
+            i++;
+        }
+        else {
+            j--;
+            context->triIndices[i] = context->triIndices[j];
+            context->triIndices[j] = tri;
+        }
+    }
+
+    uint32_t leftCount = i - node->leftFirst;
+    ASSERT(leftCount > 0 && leftCount < node->triCount);
+
+    uint32_t childIndex = (uint32_t)InterlockedAdd(&context->nodeCount, 2) - 2;
+    context->nodes[childIndex] = {
+        .boundsMin = leftBounds.min,
+        .leftFirst = node->leftFirst,
+        .boundsMax = leftBounds.max,
+        .triCount = leftCount
+    };
+    context->nodes[childIndex + 1] = {
+        .boundsMin = rightBounds.min,
+        .leftFirst = i,
+        .boundsMax = rightBounds.max,
+        .triCount = node->triCount - leftCount
+    };
+    node->leftFirst = childIndex;
+    node->triCount = 0;
+
+    Aabb childCentroidBounds[2] = { leftCentroidBounds, rightCentroidBounds };
+    for(int child = 0; child < 2; child++) {
+        uint32_t childNodeIndex = childIndex + child;
+        if(context->nodes[childNodeIndex].triCount >= BvhParallelSubtreeMinTris) {
+            BvhBuildTask* task = (BvhBuildTask*)malloc(sizeof(BvhBuildTask));
+            ASSERT(task != nullptr);
+            *task = {
+                .context = context,
+                .nodeIndex = childNodeIndex,
+                .depth = depth + 1,
+                .centroidBounds = childCentroidBounds[child]
+            };
+            PushTask(context->pool, BuildBvhNodeTask, task, &context->taskCounter);
+        }
+        else {
+            BuildBvhNode(context, childNodeIndex, depth + 1, childCentroidBounds[child]);
+        }
+    }
+}
+
+void ComputeBvhTriangleBoundsTask(void* data, uint32_t start, uint32_t end, int threadIndex)
+{
+    BvhBuildContext* context = (BvhBuildContext*)data;
+    const Vec3* positions = context->positions;
+    for(uint32_t tri = start; tri < end; tri++) {
+        Vec3 p0 = positions[(tri * 3) + 0];
+        Vec3 p1 = positions[(tri * 3) + 1];
+        Vec3 p2 = positions[(tri * 3) + 2];
+        Aabb bounds = { .min = Min(Min(p0, p1), p2), .max = Max(Max(p0, p1), p2) };
+        context->triBounds[tri] = bounds;
+        context->triCentroids[tri] = (bounds.min + bounds.max) * 0.5f;
+    }
+}
+
+Bvh BuildBvh(TaskPool* pool, const Vec3* positions, uint32_t vertexCount)
+{
+    uint32_t triCount = vertexCount / 3;
+    if(triCount == 0)
+        return {};
+
+    // a binary tree with one triangle per leaf at worst, plus the padding node
+    uint32_t maxNodeCount = (2 * triCount) + 1;
+    size_t nodesByteSize = AlignUp(maxNodeCount * sizeof(BvhNode), BvhNodeAlignment);
+
+    BvhBuildContext context = {
+        .pool = pool,
+        .positions = positions,
+        .triBounds = (Aabb*)malloc(triCount * sizeof(Aabb)),
+        .triCentroids = (Vec3*)malloc(triCount * sizeof(Vec3)),
+        .nodes = (BvhNode*)_aligned_malloc(nodesByteSize, BvhNodeAlignment),
+        .triIndices = (uint32_t*)malloc(triCount * sizeof(uint32_t)),
+        .nodeCount = 2
+    };
+    ASSERT(context.triBounds != nullptr);
+    ASSERT(context.triCentroids != nullptr);
+    ASSERT(context.nodes != nullptr);
+    ASSERT(context.triIndices != nullptr);
+    memset(context.nodes, 0, nodesByteSize);
+
+    ParallelFor(pool, triCount, BvhBinningBatchSize, ComputeBvhTriangleBoundsTask, &context);
+
+    Aabb rootBounds = EmptyAabb();
+    Aabb rootCentroidBounds = EmptyAabb();
+    for(uint32_t tri = 0; tri < triCount; tri++) {
+        context.triIndices[tri] = tri;
+        rootBounds = Union(rootBounds, context.triBounds[tri]);
+        rootCentroidBounds = Grow(rootCentroidBounds, context.triCentroids[tri]);
+    }
+    context.nodes[0] = {
+        .boundsMin = rootBounds.min,
+        .leftFirst = 0,
+        .boundsMax = rootBounds.max,
+        .triCount = triCount
+    };
+
+    BuildBvhNode(&context, 0, 0, rootCentroidBounds);
+    WaitForTasks(pool, &context.taskCounter);
+
+    free(context.triCentroids);
+    free(context.triBounds);
+
+    return {
+        .nodes = context.nodes,
+        .triIndices = context.triIndices,
+        .nodeCount = (uint32_t)context.nodeCount,
+        .triCount = triCount
+    };
+}
+
+struct Ray
+{
+    Vec3 origin;
+    Vec3 dir;
+};
+
+struct RayHit
+{
+    float t;
+    // barycentrics of the 2nd and 3rd vertex, the first one's weight is 1 - u - v
+    float u;
+    float v;
+    uint32_t triIndex;
+};
+
+constexpr uint32_t InvalidTriIndex = 0xFFFFFFFF;
+
+bool IntersectRayTriangle(const Ray& ray, Vec3 p0, Vec3 p1, Vec3 p2, float tMax, RayHit* hit)
+{
+    // Moller-Trumbore, double sided
+    Vec3 edge1 = p1 - p0;
+    Vec3 edge2 = p2 - p0;
+    Vec3 pVec = Cross(ray.dir, edge2);
+    float determ = Dot(edge1, pVec);
+    if(fabsf(determ) < 1e-12f)
+        return false;
+
+    float invDeterm = 1.0f / determ;
+    Vec3 tVec = ray.origin - p0;
+    float u = Dot(tVec, pVec) * invDeterm;
+    if(u < 0.0f || u > 1.0f)
+        return false;
+
+    Vec3 qVec = Cross(tVec, edge1);
+    float v = Dot(ray.dir, qVec) * invDeterm;
+    if(v < 0.0f || u + v > 1.0f)
+        return false;
+
+    float t = Dot(edge2, qVec) * invDeterm;
+    if(t <= 0.0f || t >= tMax)
+        return false;
+
+    hit->t = t;
+    hit->u = u;
+    hit->v = v;
+    return true;
+}
+
+// returns the entry distance or FLT_MAX on a miss
+float IntersectRayBvhNode(const Vec3& origin, const Vec3& invDir, const BvhNode& node, float tMax)
+{
+    float tx1 = (node.boundsMin.x - origin.x) * invDir.x;
+    float tx2 = (node.boundsMax.x - origin.x) * invDir.x;
+    float tMinHit = fminf(tx1, tx2);
+    float tMaxHit = fmaxf(tx1, tx2);
+    float ty1 = (node.boundsMin.y - origin.y) * invDir.y;
+    float ty2 = (node.boundsMax.y - origin.y) * invDir.y;
+    tMinHit = fmaxf(tMinHit, fminf(ty1, ty2));
+    tMaxHit = fminf(tMaxHit, fmaxf(ty1, ty2));
+    float tz1 = (node.boundsMin.z - origin.z) * invDir.z;
+    float tz2 = (node.boundsMax.z - origin.z) * invDir.z;
+    tMinHit = fmaxf(tMinHit, fminf(tz1, tz2));
+    tMaxHit = fminf(tMaxHit, fmaxf(tz1, tz2));
+
+    if(tMaxHit >= tMinHit && tMinHit < tMax && tMaxHit > 0.0f)
+        return tMinHit;
+    return FLT_MAX;
+}
+
+struct BvhStackEntry
+{
+    uint32_t nodeIndex;
+    float dist;
+};
+
+// pops the nearest pushed node that still starts before the closest hit so far
+bool PopBvhStackEntry(const BvhStackEntry* stack, int* stackSize, float tMax, uint32_t* nodeIndex)
+{
+    while(*stackSize > 0) {
+        BvhStackEntry entry = stack[--(*stackSize)];
+        if(entry.dist < tMax) {
+            *nodeIndex = entry.nodeIndex;
+            return true;
+        }
+    }
+    return false;
+}
+
+// closest hit along the ray, positions are the triangle soup the bvh was built from
+bool TraceRayBvh(const Bvh& bvh, const Vec3* positions, const Ray& ray, float tMax, RayHit* hit)
+{
+    *hit = { .t = tMax, .triIndex = InvalidTriIndex };
+    if(bvh.nodeCount == 0)
+        return false;
+
+    Vec3 invDir = { 1.0f / ray.dir.x, 1.0f / ray.dir.y, 1.0f / ray.dir.z };
+    if(IntersectRayBvhNode(ray.origin, invDir, bvh.nodes[0], tMax) == FLT_MAX)
+        return false;
+
+    // one far child per level at most, kept with its entry distance so it's dropped once a closer hit is found
+    BvhStackEntry stack[BvhMaxDepth];
+    int stackSize = 0;
+    uint32_t nodeIndex = 0;
+    while(true) {
+        const BvhNode& node = bvh.nodes[nodeIndex];
+        if(node.triCount > 0) {
+            for(uint32_t i = 0; i < node.triCount; i++) {
+                uint32_t tri = bvh.triIndices[node.leftFirst + i];
+                RayHit triHit = {};
+                if(IntersectRayTriangle(ray, positions[tri * 3], positions[(tri * 3) + 1], positions[(tri * 3) + 2],
+                    hit->t, &triHit))
+                {
+                    *hit = triHit;
+                    hit->triIndex = tri;
+                }
+            }
+            if(!PopBvhStackEntry(stack, &stackSize, hit->t, &nodeIndex))
+                break;
+            continue;
+        }
+
+        // visit the nearer child first, push the other one if it's hit at all
+        uint32_t near = node.leftFirst;
+        uint32_t far = node.leftFirst + 1;
+        float nearDist = IntersectRayBvhNode(ray.origin, invDir, bvh.nodes[near], hit->t);
+        float farDist = IntersectRayBvhNode(ray.origin, invDir, bvh.nodes[far], hit->t);
+        if(farDist < nearDist) {
+            uint32_t tmpIndex = near;
+            near = far;
+            far = tmpIndex;
+            float tmpDist = nearDist;
+            nearDist = farDist;
+            farDist = tmpDist;
+        }
+
+        if(nearDist == FLT_MAX) {
+            if(!PopBvhStackEntry(stack, &stackSize, hit->t, &nodeIndex))
+                break;
+        }
+        else {
+            nodeIndex = near;
+            if(farDist != FLT_MAX) {
+                ASSERT(stackSize < ARRAY_LEN(stack));
+                stack[stackSize++] = { .nodeIndex = far, .dist = farDist };
+            }
+        }
+    }
+
+    return hit->triIndex != InvalidTriIndex;
+}
+
+uint32_t XorShift32(uint32_t* state)
+{
+    uint32_t x = *state;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    *state = x;
+    return x;
+}
+
+float RandomFloat01(uint32_t* state)
+{
+    return (XorShift32(state) >> 8) * (1.0f / 16777216.0f);
+}
+
+// a ray from the bounds' outer sphere towards a point inside the bounds
+Ray GetRandomRayTowardsAabb(const Aabb& bounds, uint32_t* rngState)
+{
+    Vec3 center = (bounds.min + bounds.max) * 0.5f;
+    float radius = Len(bounds.max - center);
+    Vec3 onSphere = {
+        (RandomFloat01(rngState) * 2.0f) - 1.0f,
+        (RandomFloat01(rngState) * 2.0f) - 1.0f,
+        (RandomFloat01(rngState) * 2.0f) - 1.0f
+    };
+    Vec3 target = {
+        bounds.min.x + (RandomFloat01(rngState) * (bounds.max.x - bounds.min.x)),
+        bounds.min.y + (RandomFloat01(rngState) * (bounds.max.y - bounds.min.y)),
+        bounds.min.z + (RandomFloat01(rngState) * (bounds.max.z - bounds.min.z))
+    };
+    Vec3 origin = center + (Normalize(onSphere) * radius * 2.0f);
+    return { .origin = origin, .dir = Normalize(target - origin) };
+}
+
+// closest hit by testing every triangle, the reference for TraceRayBvh
+bool TraceRayBruteForce(const Vec3* positions, uint32_t triCount, const Ray& ray, float tMax, RayHit* hit)
+{
+    *hit = { .t = tMax, .triIndex = InvalidTriIndex };
+    for(uint32_t tri = 0; tri < triCount; tri++) {
+        RayHit triHit = {};
+        if(IntersectRayTriangle(ray, positions[tri * 3], positions[(tri * 3) + 1], positions[(tri * 3) + 2], hit->t, &triHit)) {
+            *hit = triHit;
+            hit->triIndex = tri;
+        }
+    }
+    return hit->triIndex != InvalidTriIndex;
+}
+
+uint32_t GetBvhDepth(const Bvh& bvh, uint32_t nodeIndex)
+{
+    const BvhNode& node = bvh.nodes[nodeIndex];
+    if(node.triCount > 0)
+        return 0;
+    uint32_t leftDepth = GetBvhDepth(bvh, node.leftFirst);
+    uint32_t rightDepth = GetBvhDepth(bvh, node.leftFirst + 1);
+    return 1 + (leftDepth > rightDepth ? leftDepth : rightDepth);
+}
+
+// binary cache next to the .obj so we only pay for parsing and tangent generation once,
+// a header followed by 16-byte aligned chunks so new data can be added without breaking old readers
+constexpr uint32_t ModelCacheMagic = 0x434A424F; // "OBJC"
+constexpr uint32_t ModelCacheVersion = 7;
+constexpr size_t ModelCacheAlignment = 16;
+
+enum class ModelCacheChunkId : uint32_t
+{
+    Positions = 1,
+    TexCoords,
+    Normals,
+    Tangents,
+    BvhNodes,
+    BvhTriIndices,
+    Bounds,
+    Validation,
+    CornerVertices,
+    CornerOpposites,
+    VertexCorners
+};
+
+struct ModelCacheHeader
+{
+    uint32_t magic;
+    uint32_t version;
+    uint64_t sourceByteSize;
+    uint64_t sourceWriteTime;
+    uint32_t vertexCount;
+    uint32_t chunkCount;
+    // welding changes the generated data, so a cache is only valid for the epsilon it was built with
+    float weldEpsilon;
+    uint32_t reserved;
+};
+
+struct ModelCacheChunk
+{
+    ModelCacheChunkId id;
+    uint32_t reserved;
+    uint64_t byteSize;
+};
+
+struct ModelCacheChunkSource
+{
+    ModelCacheChunkId id;
+    const void* data;
+    size_t byteSize;
+};
+
+void GetModelCacheFilename(const char* filename, char* dest, size_t destLen)
+{
+    snprintf(dest, destLen, "%s.cache", filename);
+}
+
+bool WriteModelCache(const char* cacheFilename, FileInfo sourceInfo, float weldEpsilon, uint32_t vertexCount,
+    const ModelCacheChunkSource* chunks, int chunkCount)
+{
+    size_t totalByteSize = AlignUp(sizeof(ModelCacheHeader), ModelCacheAlignment);
+    for(int i = 0; i < chunkCount; i++)
+        totalByteSize += AlignUp(sizeof(ModelCacheChunk), ModelCacheAlignment) + AlignUp(chunks[i].byteSize, ModelCacheAlignment);
+
+    unsigned char* buffer = (unsigned char*)calloc(1, totalByteSize);
+    ASSERT(buffer != nullptr);
+
+    *(ModelCacheHeader*)buffer = {
+        .magic = ModelCacheMagic,
+        .version = ModelCacheVersion,
+        .sourceByteSize = sourceInfo.byteSize,
+        .sourceWriteTime = sourceInfo.lastWriteTime,
+        .vertexCount = vertexCount,
+        .chunkCount = (uint32_t)chunkCount,
+        .weldEpsilon = weldEpsilon
+    };
+
+    size_t writeAt = AlignUp(sizeof(ModelCacheHeader), ModelCacheAlignment);
+    for(int i = 0; i < chunkCount; i++) {
+        *(ModelCacheChunk*)(buffer + writeAt) = { .id = chunks[i].id, .byteSize = chunks[i].byteSize };
+        writeAt += AlignUp(sizeof(ModelCacheChunk), ModelCacheAlignment);
+        memcpy(buffer + writeAt, chunks[i].data, chunks[i].byteSize);
+        writeAt += AlignUp(chunks[i].byteSize, ModelCacheAlignment);
+    }
+
+    bool res = WriteAllBytesToFile(cacheFilename, buffer, totalByteSize);
+    free(buffer);
+    return res;
+}
+
+const ModelCacheHeader* GetValidModelCacheHeader(const MappedFile& cacheFile, FileInfo sourceInfo, float weldEpsilon)
+{
+    if(cacheFile.len < sizeof(ModelCacheHeader))
+        return nullptr;
+
+    const ModelCacheHeader* header = (const ModelCacheHeader*)cacheFile.data;
+    if(header->magic != ModelCacheMagic || header->version != ModelCacheVersion ||
+        header->sourceByteSize != sourceInfo.byteSize || header->sourceWriteTime != sourceInfo.lastWriteTime ||
+        header->weldEpsilon != weldEpsilon)
+    {
+        return nullptr;
+    }
+    return header;
+}
+
+const void* FindModelCacheChunk(const MappedFile& cacheFile, ModelCacheChunkId id, size_t* byteSize)
+{
+    const ModelCacheHeader* header = (const ModelCacheHeader*)cacheFile.data;
+    size_t readAt = AlignUp(sizeof(ModelCacheHeader), ModelCacheAlignment);
+    for(uint32_t i = 0; i < header->chunkCount; i++) {
+        if(readAt + sizeof(ModelCacheChunk) > cacheFile.len)
+            return nullptr;
+
+        const ModelCacheChunk* chunk = (const ModelCacheChunk*)(cacheFile.data + readAt);
+        readAt += AlignUp(sizeof(ModelCacheChunk), ModelCacheAlignment);
+        if(chunk->byteSize > cacheFile.len - readAt)
+            return nullptr;
+
+        if(chunk->id == id) {
+            *byteSize = chunk->byteSize;
+            return cacheFile.data + readAt;
+        }
+        readAt += AlignUp(chunk->byteSize, ModelCacheAlignment);
+    }
+    return nullptr;
+}
+
+// returns a malloc'd copy of the chunk, or nullptr if it's missing or doesn't have the expected size
+void* CopyModelCacheChunk(const MappedFile& cacheFile, ModelCacheChunkId id, size_t expectedByteSize)
+{
+    size_t byteSize = 0;
+    const void* chunkData = FindModelCacheChunk(cacheFile, id, &byteSize);
+    if(chunkData == nullptr || byteSize != expectedByteSize)
+        return nullptr;
+
+    void* copy = malloc(byteSize);
+    ASSERT(copy != nullptr);
+    memcpy(copy, chunkData, byteSize);
+    return copy;
+}
+
+bool LoadBvhFromCache(const MappedFile& cacheFile, uint32_t triCount, Bvh* bvh)
+{
+    size_t nodesByteSize = 0;
+    const void* nodes = FindModelCacheChunk(cacheFile, ModelCacheChunkId::BvhNodes, &nodesByteSize);
+    if(nodes == nullptr || nodesByteSize == 0 || nodesByteSize % sizeof(BvhNode) != 0)
+        return false;
+
+    uint32_t* triIndices = (uint32_t*)CopyModelCacheChunk(cacheFile, ModelCacheChunkId::BvhTriIndices, triCount * sizeof(uint32_t));
+    if(triIndices == nullptr)
+        return false;
+
+    *bvh = {
+        .nodes = (BvhNode*)_aligned_malloc(AlignUp(nodesByteSize, BvhNodeAlignment), BvhNodeAlignment),
+        .triIndices = triIndices,
+        .nodeCount = (uint32_t)(nodesByteSize / sizeof(BvhNode)),
+        .triCount = triCount
+    };
+    ASSERT(bvh->nodes != nullptr);
+    memcpy(bvh->nodes, nodes, nodesByteSize);
+    return true;
+}
+
+bool LoadCornerTableFromCache(const MappedFile& cacheFile, uint32_t cornerCount, CornerTable* table)
+{
+    size_t vertexCornersByteSize = 0;
+    const void* vertexCorners = FindModelCacheChunk(cacheFile, ModelCacheChunkId::VertexCorners, &vertexCornersByteSize);
+    if(vertexCorners == nullptr || vertexCornersByteSize % sizeof(uint32_t) != 0)
+        return false;
+
+    *table = {
+        .cornerVertices = (uint32_t*)CopyModelCacheChunk(cacheFile, ModelCacheChunkId::CornerVertices, cornerCount * sizeof(uint32_t)),
+        .opposites = (uint32_t*)CopyModelCacheChunk(cacheFile, ModelCacheChunkId::CornerOpposites, cornerCount * sizeof(uint32_t)),
+        .vertexCorners = (uint32_t*)CopyModelCacheChunk(cacheFile, ModelCacheChunkId::VertexCorners, vertexCornersByteSize),
+        .cornerCount = cornerCount,
+        .vertexCount = (uint32_t)(vertexCornersByteSize / sizeof(uint32_t))
+    };
+    return table->cornerVertices != nullptr && table->opposites != nullptr && table->vertexCorners != nullptr;
+}
+
+bool LoadObjModelFromCache(const char* cacheFilename, FileInfo sourceInfo, float weldEpsilon, ObjModel* model)
+{
+    MappedFile cacheFile = MapFileForReading(cacheFilename);
+    const ModelCacheHeader* header = GetValidModelCacheHeader(cacheFile, sourceInfo, weldEpsilon);
+    if(header == nullptr) {
+        FreeMappedFile(&cacheFile);
+        return false;
+    }
+
+    unsigned int vertexCount = header->vertexCount;
+    *model = {
+        .positions = (Vec3*)CopyModelCacheChunk(cacheFile, ModelCacheChunkId::Positions, vertexCount * sizeof(Vec3)),
+        .texCoords = (Vec2*)CopyModelCacheChunk(cacheFile, ModelCacheChunkId::TexCoords, vertexCount * sizeof(Vec2)),
+        .normals = (Vec3*)CopyModelCacheChunk(cacheFile, ModelCacheChunkId::Normals, vertexCount * sizeof(Vec3)),
+        .tangents = (Vec4*)CopyModelCacheChunk(cacheFile, ModelCacheChunkId::Tangents, vertexCount * sizeof(Vec4)),
+        .vertexCount = vertexCount
+    };
+    bool hasBvh = LoadBvhFromCache(cacheFile, vertexCount / 3, &model->bvh);
+    bool hasAdjacency = LoadCornerTableFromCache(cacheFile, vertexCount, &model->adjacency);
+
+    size_t boundsByteSize = 0;
+    const void* bounds = FindModelCacheChunk(cacheFile, ModelCacheChunkId::Bounds, &boundsByteSize);
+    bool hasBounds = bounds != nullptr && boundsByteSize == sizeof(ModelBounds);
+    if(hasBounds)
+        memcpy(&model->bounds, bounds, sizeof(ModelBounds));
+
+    size_t validationByteSize = 0;
+    const void* validation = FindModelCacheChunk(cacheFile, ModelCacheChunkId::Validation, &validationByteSize);
+    bool hasValidation = validation != nullptr && validationByteSize == sizeof(MeshValidationReport);
+    if(hasValidation)
+        memcpy(&model->validation, validation, sizeof(MeshValidationReport));
+    FreeMappedFile(&cacheFile);
+
+    // texcoords and normals are optional in .obj files, everything else is always generated
+    if(model->positions == nullptr || model->tangents == nullptr || !hasBvh || !hasBounds || !hasValidation || !hasAdjacency) {
+        FreeObjModel(model);
+        return false;
+    }
+    return true;
+}
+
+bool WriteObjModelCache(const char* cacheFilename, FileInfo sourceInfo, float weldEpsilon, const ObjModel& model)
+{
+    ModelCacheChunkSource chunks[11] = {};
+    int chunkCount = 0;
+
+    chunks[chunkCount++] = { ModelCacheChunkId::Positions, model.positions, model.vertexCount * sizeof(Vec3) };
+    if(model.texCoords != nullptr)
+        chunks[chunkCount++] = { ModelCacheChunkId::TexCoords, model.texCoords, model.vertexCount * sizeof(Vec2) };
+    if(model.normals != nullptr)
+        chunks[chunkCount++] = { ModelCacheChunkId::Normals, model.normals, model.vertexCount * sizeof(Vec3) };
+    chunks[chunkCount++] = { ModelCacheChunkId::Tangents, model.tangents, model.vertexCount * sizeof(Vec4) };
+    chunks[chunkCount++] = { ModelCacheChunkId::BvhNodes, model.bvh.nodes, model.bvh.nodeCount * sizeof(BvhNode) };
+    chunks[chunkCount++] = { ModelCacheChunkId::BvhTriIndices, model.bvh.triIndices, model.bvh.triCount * sizeof(uint32_t) };
+    chunks[chunkCount++] = { ModelCacheChunkId::Bounds, &model.bounds, sizeof(ModelBounds) };
+    chunks[chunkCount++] = { ModelCacheChunkId::Validation, &model.validation, sizeof(MeshValidationReport) };
+    const CornerTable& adjacency = model.adjacency;
+    chunks[chunkCount++] = { ModelCacheChunkId::CornerVertices, adjacency.cornerVertices, adjacency.cornerCount * sizeof(uint32_t) };
+    chunks[chunkCount++] = { ModelCacheChunkId::CornerOpposites, adjacency.opposites, adjacency.cornerCount * sizeof(uint32_t) };
+    chunks[chunkCount++] = { ModelCacheChunkId::VertexCorners, adjacency.vertexCorners, adjacency.vertexCount * sizeof(uint32_t) };
+
+    return WriteModelCache(cacheFilename, sourceInfo, weldEpsilon, model.vertexCount, chunks, chunkCount);
+}
+
+// positions closer than weldEpsilon are merged, 0 keeps them as they are in the file
+ObjModel LoadObjModel(const char* filename, TaskPool* pool, float weldEpsilon)
+{
+    uint64_t startTicks = GetTicks();
+
+    char cacheFilename[MAX_PATH] = {};
+    GetModelCacheFilename(filename, cacheFilename, sizeof(cacheFilename));
+
+    FileInfo sourceInfo = {};
+    bool hasSourceInfo = GetFileInfo(filename, &sourceInfo);
+    ASSERT(hasSourceInfo);
+
+    ObjModel model = {};
+    if(LoadObjModelFromCache(cacheFilename, sourceInfo, weldEpsilon, &model)) {
+        printf("loaded %s from cache in %.2f ms\n", filename, TicksToSeconds(GetTicks() - startTicks) * 1000.0);
+        return model;
+    }
+
+    model = LoadModelFromObjFile(filename, pool, weldEpsilon);
+    printf("parsed %s in %.2f ms (%d threads)\n", filename, TicksToSeconds(GetTicks() - startTicks) * 1000.0,
+        GetTaskPoolTotalThreadCount(pool));
+
+    const MeshValidationReport& validation = model.validation;
+    printf("validated %u triangles in %.2f ms: %u degenerate, %u zero area, %u out of range indices, "
+        "%u non-manifold edges, %u boundary loops, %u duplicate faces\n",
+        validation.triangleCount, validation.seconds * 1000.0f, validation.degenerateTriangles, validation.zeroAreaTriangles,
+        validation.outOfRangeIndices, validation.nonManifoldEdges, validation.boundaryLoops, validation.duplicateFaces);
+
+    char reportFilename[MAX_PATH] = {};
+    snprintf(reportFilename, sizeof(reportFilename), "%s.validation.json", filename);
+    if(!WriteMeshValidationJson(reportFilename, validation))
+        printf("failed to write validation report %s\n", reportFilename);
+
+    uint64_t bvhStartTicks = GetTicks();
+    model.bvh = BuildBvh(pool, model.positions, model.vertexCount);
+    printf("built bvh in %.2f ms (%u nodes for %u triangles)\n", TicksToSeconds(GetTicks() - bvhStartTicks) * 1000.0,
+        model.bvh.nodeCount, model.bvh.triCount);
+
+    if(!WriteObjModelCache(cacheFilename, sourceInfo, weldEpsilon, model))
+        printf("failed to write model cache %s\n", cacheFilename);
+
+    return model;
+}
+
+// headless serial and pooled bvh build times plus the single threaded ray throughput of a model's bvh,
+// the first rays are checked against testing every triangle, run with --bench-bvh
+bool RunBvhBenchmark(TaskPool* pool, const char* filename, int buildIterationCount, uint32_t rayCount,
+    uint32_t checkedRayCount)
+{
+    ObjModel model = LoadObjModel(filename, pool, 1e-5f);
+
+    // the loaded tree usually comes from the model cache, so the builds run here
+    TaskPool* pools[2] = { nullptr, pool };
+    uint32_t buildNodeCounts[2] = {};
+    for(int p = 0; p < 2; p++) {
+        uint64_t startTicks = GetTicks();
+        for(int iteration = 0; iteration < buildIterationCount; iteration++) {
+            Bvh builtBvh = BuildBvh(pools[p], model.positions, model.vertexCount);
+            buildNodeCounts[p] = builtBvh.nodeCount;
+            FreeBvh(&builtBvh);
+        }
+        double seconds = TicksToSeconds(GetTicks() - startTicks);
+        printf("bvh build %s (%d threads): %.2f ms per build, %u nodes for %u triangles\n",
+            p == 0 ? "serial" : "parallel", GetTaskPoolTotalThreadCount(pools[p]), (seconds * 1000.0) / buildIterationCount,
+            buildNodeCounts[p], model.vertexCount / 3);
+    }
+
+    const Bvh& bvh = model.bvh;
+    Aabb bounds = { bvh.nodes[0].boundsMin, bvh.nodes[0].boundsMax };
+
+    uint32_t rngState = 0x12345678;
+    uint32_t hitCount = 0;
+    uint64_t startTicks = GetTicks();
+    for(uint32_t i = 0; i < rayCount; i++) {
+        Ray ray = GetRandomRayTowardsAabb(bounds, &rngState);
+        RayHit hit = {};
+        if(TraceRayBvh(bvh, model.positions, ray, FLT_MAX, &hit))
+            hitCount++;
+    }
+    double seconds = TicksToSeconds(GetTicks() - startTicks);
+
+    // the closest hit can only differ when two triangles are hit at the same distance
+    rngState = 0x12345678;
+    uint32_t mismatchCount = 0;
+    for(uint32_t i = 0; i < checkedRayCount; i++) {
+        Ray ray = GetRandomRayTowardsAabb(bounds, &rngState);
+        RayHit bvhHit = {};
+        RayHit referenceHit = {};
+        TraceRayBvh(bvh, model.positions, ray, FLT_MAX, &bvhHit);
+        TraceRayBruteForce(model.positions, bvh.triCount, ray, FLT_MAX, &referenceHit);
+        if(bvhHit.triIndex != referenceHit.triIndex && bvhHit.t != referenceHit.t)
+            mismatchCount++;
+    }
+
+    uint32_t depth = GetBvhDepth(bvh, 0);
+    printf("bvh of %s: %u nodes, depth %u (max %u), %.2f Mrays/s single threaded (%u/%u hits), "
+        "%u/%u rays differ from brute force\n", filename, bvh.nodeCount, depth, BvhMaxDepth,
+        seconds > 0.0 ? (rayCount / seconds) / 1000000.0 : 0.0, hitCount, rayCount, mismatchCount, checkedRayCount);
+
+    FreeObjModel(&model);
+    return mismatchCount == 0 && depth <= BvhMaxDepth && buildNodeCounts[0] == buildNodeCounts[1];
+}
+
+struct Transform
+{
+    Vec3 position;
+    Vec3 scale;
+    // left out it's a zero quaternion, which builds the same matrices as the identity
+    Quat rotation;
+};
+
+// T * R * S written straight into the 12 entries that aren't constant, each rotation column scaled by its axis
+constexpr Mat4 GetModelMatFromTransform(const Transform& transform)
+{
+    Mat3 rotation = Mat3FromQuat(transform.rotation);
+    float scale[3] = { transform.scale.x, transform.scale.y, transform.scale.z };
+
+    Mat4 res = {};
+    for(int col = 0; col < 3; col++) {
+        for(int row = 0; row < 3; row++)
+            res.data[col][row] = rotation.data[col][row] * scale[col];
+    }
+    res.data[3][0] = transform.position.x;
+    res.data[3][1] = transform.position.y;
+    res.data[3][2] = transform.position.z;
+    res.data[3][3] = 1.0f;
+    return res;
+}
+
+// the model matrix of a Transform is always affine, and rigid when it isn't scaled
+Mat4 GetInverseModelMatFromTransform(const Transform& transform, const Mat4& modelMat)
+{
+    if(transform.scale.x == 1.0f && transform.scale.y == 1.0f && transform.scale.z == 1.0f)
+        return InverseRigid(modelMat);
+    return InverseAffine(modelMat);
+}
+
+// the inverse transpose of R * S is R * S^-1, so it's built like the model matrix with the scales inverted
+Mat4 GetNormalMatFromTransform(const Transform& transform)
+{
+    Mat3 rotation = Mat3FromQuat(transform.rotation);
+    float scale[3] = { transform.scale.x, transform.scale.y, transform.scale.z };
+
+    Mat4 res = {};
+    for(int col = 0; col < 3; col++) {
+        float invScale = scale[col] != 0.0f ? 1.0f / scale[col] : 0.0f;
+        for(int row = 0; row < 3; row++)
+            res.data[col][row] = rotation.data[col][row] * invScale;
+    }
+    res.data[3][3] = 1.0f;
+    return res;
+}
+
+constexpr uint32_t InvalidSceneNode = UINT32_MAX;
+
+// hierarchy of transforms in SoA arrays, a parent is always added before its children so the nodes are
+// topologically sorted and one linear pass updates every world matrix after its parent's
+struct SceneGraph
+{
+    uint32_t* parents;
+    Vec3* localPositions;
+    Vec3* localScales;
+    Quat* localRotations;
+    Mat4* worldMats;
+    // inverse transpose of the world matrix
+    Mat4* normalMats;
+    // set when the local transform changes, the update pass spreads it to the subtrees and clears it
+    uint8_t* isDirty;
+    uint32_t count;
+    uint32_t capacity;
+};
+
+SceneGraph CreateSceneGraph(uint32_t capacity)
+{
+    SceneGraph graph = {
+        .parents = (uint32_t*)calloc(1, capacity * sizeof(uint32_t)),
+        .localPositions = (Vec3*)calloc(1, capacity * sizeof(Vec3)),
+        .localScales = (Vec3*)calloc(1, capacity * sizeof(Vec3)),
+        .localRotations = (Quat*)calloc(1, capacity * sizeof(Quat)),
+        .worldMats = (Mat4*)calloc(1, capacity * sizeof(Mat4)),
+        .normalMats = (Mat4*)calloc(1, capacity * sizeof(Mat4)),
+        .isDirty = (uint8_t*)calloc(1, capacity * sizeof(uint8_t)),
+        .capacity = capacity
+    };
+    ASSERT(graph.parents != nullptr && graph.localPositions != nullptr && graph.localScales != nullptr &&
+        graph.localRotations != nullptr && graph.worldMats != nullptr && graph.normalMats != nullptr && graph.isDirty != nullptr);
+    return graph;
+}
+
+void FreeSceneGraph(SceneGraph* graph)
+{
+    free(graph->parents);
+    free(graph->localPositions);
+    free(graph->localScales);
+    free(graph->localRotations);
+    free(graph->worldMats);
+    free(graph->normalMats);
+    free(graph->isDirty);
+    *graph = {};
+}
+
+// parent is InvalidSceneNode for a root
+uint32_t AddSceneNode(SceneGraph* graph, uint32_t parent, const Transform& localTransform)
+{
+    ASSERT(graph->count < graph->capacity);
+    ASSERT(parent == InvalidSceneNode || parent < graph->count);
+    uint32_t node = graph->count++;
+    graph->parents[node] = parent;
+    graph->localPositions[node] = localTransform.position;
+    graph->localScales[node] = localTransform.scale;
+    graph->localRotations[node] = localTransform.rotation;
+    graph->isDirty[node] = 1;
+    return node;
+}
+
+Transform GetSceneNodeLocalTransform(const SceneGraph& graph, uint32_t node)
+{
+    return {
+        .position = graph.localPositions[node],
+        .scale = graph.localScales[node],
+        .rotation = graph.localRotations[node]
+    };
+}
+
+void SetSceneNodeLocalTransform(SceneGraph* graph, uint32_t node, const Transform& localTransform)
+{
+    graph->localPositions[node] = localTransform.position;
+    graph->localScales[node] = localTransform.scale;
+    graph->localRotations[node] = localTransform.rotation;
+    graph->isDirty[node] = 1;
+}
+
+void SetSceneNodePosition(SceneGraph* graph, uint32_t node, const Vec3& position)
+{
+    graph->localPositions[node] = position;
+    graph->isDirty[node] = 1;
+}
+
+void SetSceneNodeRotation(SceneGraph* graph, uint32_t node, const Quat& rotation)
+{
+    graph->localRotations[node] = rotation;
+    graph->isDirty[node] = 1;
+}
+
+// returns how many nodes were recomputed
+uint32_t UpdateSceneGraph(SceneGraph* graph)
+{
+    uint32_t updatedCount = 0;
+    for(uint32_t node = 0; node < graph->count; node++) {
+        uint32_t parent = graph->parents[node];
+        // the parent came earlier in this pass, so its flag already says whether it changed
+        if(parent != InvalidSceneNode && graph->isDirty[parent])
+            graph->isDirty[node] = 1;
+        if(!graph->isDirty[node])
+            continue;
+
+        Transform localTransform = GetSceneNodeLocalTransform(*graph, node);
+        Mat4 localMat = GetModelMatFromTransform(localTransform);
+        Mat4 localNormalMat = GetNormalMatFromTransform(localTransform);
+        if(parent == InvalidSceneNode) {
+            graph->worldMats[node] = localMat;
+            graph->normalMats[node] = localNormalMat;
+        }
+        else {
+            // the inverse transpose of a product is the product of the inverse transposes
+            graph->worldMats[node] = graph->worldMats[parent] * localMat;
+            graph->normalMats[node] = graph->normalMats[parent] * localNormalMat;
+        }
+        updatedCount++;
+    }
+
+    // the flags had to survive the whole pass for the children to see them
+    memset(graph->isDirty, 0, graph->count * sizeof(uint8_t));
+    return updatedCount;
+}
+
+// headless benchmark of the lazy update against recomputing every node, returns false when the lazily updated world or
+// normal matrices differ from the full recompute, run with --bench-scene
+bool RunSceneGraphBenchmark(uint32_t nodeCount, float movingFraction, int iterationCount)
+{
+    SceneGraph graph = CreateSceneGraph(nodeCount);
+    uint32_t rngState = 0x5CE7E;
+    for(uint32_t i = 0; i < nodeCount; i++) {
+        // a random earlier node as the parent gives a random recursive tree, a few of them roots
+        uint32_t parent = (i == 0 || XorShift32(&rngState) % 64 == 0) ? InvalidSceneNode : XorShift32(&rngState) % i;
+        AddSceneNode(&graph, parent, {
+            .position = { RandomFloat01(&rngState) - 0.5f, RandomFloat01(&rngState) - 0.5f, RandomFloat01(&rngState) - 0.5f },
+            .scale = { 0.9f + (RandomFloat01(&rngState) * 0.2f), 0.9f + (RandomFloat01(&rngState) * 0.2f), 0.9f + (RandomFloat01(&rngState) * 0.2f) },
+            .rotation = QuatFromEuler({ RandomFloat01(&rngState), RandomFloat01(&rngState), RandomFloat01(&rngState) })
+        });
+    }
+    UpdateSceneGraph(&graph);
+
+    uint32_t movingCount = (uint32_t)(nodeCount * movingFraction);
+    uint64_t updatedTotal = 0;
+    double lazySeconds = 0.0;
+    for(int iteration = 0; iteration < iterationCount; iteration++) {
+        for(uint32_t i = 0; i < movingCount; i++) {
+            uint32_t node = XorShift32(&rngState) % nodeCount;
+            SetSceneNodePosition(&graph, node, graph.localPositions[node] + Vec3{ 0.01f, 0.0f, 0.0f });
+        }
+        uint64_t startTicks = GetTicks();
+        updatedTotal += UpdateSceneGraph(&graph);
+        lazySeconds += TicksToSeconds(GetTicks() - startTicks);
+    }
+
+    // the lazily updated matrices have to match a full recompute
+    Mat4* lazyWorldMats = (Mat4*)calloc(1, nodeCount * sizeof(Mat4));
+    Mat4* lazyNormalMats = (Mat4*)calloc(1, nodeCount * sizeof(Mat4));
+    ASSERT(lazyWorldMats != nullptr && lazyNormalMats != nullptr);
+    memcpy(lazyWorldMats, graph.worldMats, nodeCount * sizeof(Mat4));
+    memcpy(lazyNormalMats, graph.normalMats, nodeCount * sizeof(Mat4));
+
+    double fullSeconds = 0.0;
+    for(int iteration = 0; iteration < iterationCount; iteration++) {
+        memset(graph.isDirty, 1, nodeCount * sizeof(uint8_t));
+        uint64_t startTicks = GetTicks();
+        UpdateSceneGraph(&graph);
+        fullSeconds += TicksToSeconds(GetTicks() - startTicks);
+    }
+    uint32_t mismatchCount = 0;
+    uint32_t normalMismatchCount = 0;
+    for(uint32_t node = 0; node < nodeCount; node++) {
+        if(memcmp(&lazyWorldMats[node], &graph.worldMats[node], sizeof(Mat4)) != 0)
+            mismatchCount++;
+        if(memcmp(&lazyNormalMats[node], &graph.normalMats[node], sizeof(Mat4)) != 0)
+            normalMismatchCount++;
+    }
+
+    printf("scene graph %u nodes, %u moving: lazy update %.3f ms (%.0f nodes recomputed), full update %.3f ms, "
+        "%u world and %u normal matrix mismatches\n", nodeCount, movingCount, (lazySeconds * 1000.0) / iterationCount,
+        (double)updatedTotal / iterationCount, (fullSeconds * 1000.0) / iterationCount, mismatchCount, normalMismatchCount);
+
+    free(lazyNormalMats);
+    free(lazyWorldMats);
+    FreeSceneGraph(&graph);
+    return mismatchCount == 0 && normalMismatchCount == 0;
+}
+
+struct PickHit
+{
+    uint32_t triIndex;
+    // weights of the triangle's 3 vertices
+    Vec3 barycentrics;
+    Vec3 worldPosition;
+    float distance;
+};
+
+BoundingSphere TransformBoundingSphere(const BoundingSphere& sphere, const Mat4& mat)
+{
+    // the largest axis scale keeps it conservative for non-uniform scales
+    float scaleX = Len({ mat.data[0][0], mat.data[0][1], mat.data[0][2] });
+    float scaleY = Len({ mat.data[1][0], mat.data[1][1], mat.data[1][2] });
+    float scaleZ = Len({ mat.data[2][0], mat.data[2][1], mat.data[2][2] });
+    float maxScale = fmaxf(scaleX, fmaxf(scaleY, scaleZ));
+
+    return {
+        .center = TransformPoint(mat, sphere.center),
+        .radius = sphere.radius * maxScale
+    };
+}
+
+// screen position in pixels with the origin at the top left of the viewport
+Ray GetWorldRayFromScreenPosition(float screenX, float screenY, float viewportWidth, float viewportHeight,
+    const Mat4& projMat, const Mat4& viewMat)
+{
+    float ndcX = ((2.0f * screenX) / viewportWidth) - 1.0f;
+    float ndcY = 1.0f - ((2.0f * screenY) / viewportHeight);
+
+    // D3D clip space depth goes from 0 at the near plane to 1 at the far plane
+    Mat4 invProjViewMat = Inverse(projMat * viewMat);
+    Vec3 nearPoint = TransformPoint(invProjViewMat, { ndcX, ndcY, 0.0f });
+    Vec3 farPoint = TransformPoint(invProjViewMat, { ndcX, ndcY, 1.0f });
+
+    return {
+        .origin = nearPoint,
+        .dir = Normalize(farPoint - nearPoint)
+    };
+}
+
+// traces in model space so the bvh never has to be rebuilt for a moved or rotated model
+bool PickObjModelTriangle(const ObjModel& model, const Mat4& invModelMat, const Ray& worldRay, PickHit* pickHit)
+{
+    Vec3 modelOrigin = TransformPoint(invModelMat, worldRay.origin);
+    Vec3 modelTarget = TransformPoint(invModelMat, worldRay.origin + worldRay.dir);
+    Ray modelRay = { .origin = modelOrigin, .dir = modelTarget - modelOrigin };
+
+    RayHit hit = {};
+    if(!TraceRayBvh(model.bvh, model.positions, modelRay, FLT_MAX, &hit))
+        return false;
+
+    // the model ray direction wasn't normalized, so the hit distance is in world units already
+    *pickHit = {
+        .triIndex = hit.triIndex,
+        .barycentrics = { 1.0f - hit.u - hit.v, hit.u, hit.v },
+        .worldPosition = worldRay.origin + (worldRay.dir * hit.t),
+        .distance = hit.t
+    };
+    return true;
+}
+
+// headless check of mouse picking on a moved, rotated and scaled model, run with --bench-pick.
+// each case looks at a known point on a random triangle nothing else covers from in front of it, then picks it back
+// through the screen position the point projects to
+bool RunPickBenchmark(TaskPool* pool, const char* filename, uint32_t caseCount)
+{
+    ObjModel model = LoadObjModel(filename, pool, 1e-5f);
+    Transform transform = {
+        .position = { 1.5f, -0.5f, -3.0f },
+        .scale = { 1.2f, 0.8f, 1.0f },
+        .rotation = QuatFromEuler({ 0.4f, 0.9f, 0.0f })
+    };
+    Mat4 modelMat = GetModelMatFromTransform(transform);
+    Mat4 invModelMat = Inverse(modelMat);
+    const float viewportWidth = 1280.0f;
+    const float viewportHeight = 720.0f;
+    Mat4 projMat = PerspectiveProjMat4(toRadians(45.0f), viewportWidth, viewportHeight, 0.1f, 100.0f);
+    const Vec3 weights = { 0.2f, 0.3f, 0.5f };
+    const float tolerance = 1e-3f;
+
+    uint32_t triCount = model.vertexCount / 3;
+    uint32_t rngState = 0x91C4;
+    uint32_t checkedCount = 0;
+    uint32_t failedCount = 0;
+    uint64_t pickTicks = 0;
+    for(uint32_t attempt = 0; checkedCount < caseCount && attempt < caseCount * 16; attempt++) {
+        uint32_t tri = XorShift32(&rngState) % triCount;
+        Vec3 p0 = TransformPoint(modelMat, model.positions[tri * 3]);
+        Vec3 p1 = TransformPoint(modelMat, model.positions[(tri * 3) + 1]);
+        Vec3 p2 = TransformPoint(modelMat, model.positions[(tri * 3) + 2]);
+        Vec3 normal = Cross(p1 - p0, p2 - p0);
+        if(Len(normal) < 1e-4f)
+            continue;
+        normal = Normalize(normal);
+        Vec3 target = (p0 * weights.x) + (p1 * weights.y) + (p2 * weights.z);
+        Vec3 eye = target + (normal * 3.0f);
+
+        // skipped when another triangle is in the way, found by testing every triangle in model space
+        Vec3 modelEye = TransformPoint(invModelMat, eye);
+        Ray modelRay = { .origin = modelEye, .dir = TransformPoint(invModelMat, target) - modelEye };
+        RayHit referenceHit = {};
+        if(!TraceRayBruteForce(model.positions, triCount, modelRay, FLT_MAX, &referenceHit) || referenceHit.triIndex != tri)
+            continue;
+
+        // looking a bit to the side so the point isn't always in the middle of the viewport
+        Vec3 up = fabsf(normal.y) > 0.9f ? Vec3{ 1.0f, 0.0f, 0.0f } : Vec3{ 0.0f, 1.0f, 0.0f };
+        Vec3 lookOffset = { (RandomFloat01(&rngState) - 0.5f) * 1.5f, (RandomFloat01(&rngState) - 0.5f) * 1.0f, 0.0f };
+        Mat4 viewMat = LookatMat4(eye, target + lookOffset, up);
+        Vec4 clip = (projMat * viewMat) * Vec4{ target.x, target.y, target.z, 1.0f };
+        float screenX = ((clip.x / clip.w) + 1.0f) * 0.5f * viewportWidth;
+        float screenY = (1.0f - (clip.y / clip.w)) * 0.5f * viewportHeight;
+
+        uint64_t startTicks = GetTicks();
+        Ray pickRay = GetWorldRayFromScreenPosition(screenX, screenY, viewportWidth, viewportHeight, projMat, viewMat);
+        PickHit pickHit = {};
+        bool isPicked = PickObjModelTriangle(model, invModelMat, pickRay, &pickHit);
+        pickTicks += GetTicks() - startTicks;
+
+        Vec3 baryDiff = pickHit.barycentrics - weights;
+        Vec3 positionDiff = pickHit.worldPosition - target;
+        bool isMatching = isPicked && pickHit.triIndex == tri &&
+            fabsf(baryDiff.x) <= tolerance && fabsf(baryDiff.y) <= tolerance && fabsf(baryDiff.z) <= tolerance &&
+            Len(positionDiff) <= tolerance && fabsf(pickHit.distance - Len(target - pickRay.origin)) <= tolerance;
+        if(!isMatching) {
+            printf("pick case %u: triangle %u, expected %u, barycentrics %g %g %g, %g from the point\n", checkedCount,
+                isPicked ? pickHit.triIndex : InvalidTriIndex, tri, pickHit.barycentrics.x, pickHit.barycentrics.y,
+                pickHit.barycentrics.z, Len(positionDiff));
+            failedCount++;
+        }
+
+        // turned around the same ray can't hit anything
+        Mat4 awayViewMat = LookatMat4(eye, eye + normal, up);
+        Ray awayRay = GetWorldRayFromScreenPosition(viewportWidth * 0.5f, viewportHeight * 0.5f, viewportWidth, viewportHeight,
+            projMat, awayViewMat);
+        if(PickObjModelTriangle(model, invModelMat, awayRay, &pickHit)) {
+            printf("pick case %u: looking away hit triangle %u\n", checkedCount, pickHit.triIndex);
+            failedCount++;
+        }
+        checkedCount++;
+    }
+
+    printf("picked %u triangles of %s: %.2f us per pick, %u failed\n", checkedCount, filename,
+        checkedCount > 0 ? (TicksToSeconds(pickTicks) * 1e6) / checkedCount : 0.0, failedCount);
+    FreeObjModel(&model);
+    return checkedCount == caseCount && failedCount == 0;
+}
+
+Aabb TransformAabb(const Aabb& box, const Mat4& mat)
+{
+    // Arvo: every output axis is the translation plus the min/max contribution of each input axis
+    Aabb res = {
+        .min = { mat.data[3][0], mat.data[3][1], mat.data[3][2] },
+        .max = { mat.data[3][0], mat.data[3][1], mat.data[3][2] }
+    };
+    float boxMin[3] = { box.min.x, box.min.y, box.min.z };
+    float boxMax[3] = { box.max.x, box.max.y, box.max.z };
+    float* resMin[3] = { &res.min.x, &res.min.y, &res.min.z };
+    float* resMax[3] = { &res.max.x, &res.max.y, &res.max.z };
+    for(int row = 0; row < 3; row++) {
+        for(int col = 0; col < 3; col++) {
+            float a = mat.data[col][row] * boxMin[col];
+            float b = mat.data[col][row] * boxMax[col];
+            *resMin[row] += a < b ? a : b;
+            *resMax[row] += a < b ? b : a;
+        }
+    }
+    return res;
+}
+
+struct FrustumPlanes
+{
+    // xyz = normal pointing inwards, w = distance, a point is inside when dot(normal, point) + w >= 0
+    Vec4 planes[6];
+};
+
+FrustumPlanes ExtractFrustumPlanes(const Mat4& projViewMat)
+{
+    // Gribb/Hartmann on the rows of the matrix, D3D clip space so the near plane is just z >= 0
+    Vec4 rows[4] = {};
+    for(int row = 0; row < 4; row++) {
+        rows[row] = { projViewMat.data[0][row], projViewMat.data[1][row], projViewMat.data[2][row], projViewMat.data[3][row] };
+    }
+
+    FrustumPlanes frustum = {
+        .planes = {
+            rows[3] + rows[0], // left
+            rows[3] - rows[0], // right
+            rows[3] + rows[1], // bottom
+            rows[3] - rows[1], // top
+            rows[2],           // near
+            rows[3] - rows[2]  // far
+        }
+    };
+
+    for(int i = 0; i < 6; i++) {
+        Vec4 plane = frustum.planes[i];
+        float len = Len({ plane.x, plane.y, plane.z });
+        if(len > 0.0f)
+            frustum.planes[i] = plane / len;
+    }
+    return frustum;
+}
+
+constexpr uint32_t CullBoxBatchSize = 8;
+
+// SoA boxes so 8 of them can be tested against a plane at once
+struct CullBoxes
+{
+    float* minX;
+    float* minY;
+    float* minZ;
+    float* maxX;
+    float* maxY;
+    float* maxZ;
+    uint32_t count;
+    uint32_t capacity;
+};
+
+CullBoxes CreateCullBoxes(uint32_t capacity)
+{
+    capacity = (uint32_t)AlignUp(capacity > 0 ? capacity : 1, CullBoxBatchSize);
+    size_t arrayByteSize = capacity * sizeof(float);
+
+    CullBoxes boxes = { .capacity = capacity };
+    float** arrays[6] = { &boxes.minX, &boxes.minY, &boxes.minZ, &boxes.maxX, &boxes.maxY, &boxes.maxZ };
+    for(int i = 0; i < 6; i++) {
+        *arrays[i] = (float*)_aligned_malloc(arrayByteSize, 32);
+        ASSERT(*arrays[i] != nullptr);
+        memset(*arrays[i], 0, arrayByteSize);
+    }
+    return boxes;
+}
+
+void FreeCullBoxes(CullBoxes* boxes)
+{
+    _aligned_free(boxes->minX);
+    _aligned_free(boxes->minY);
+    _aligned_free(boxes->minZ);
+    _aligned_free(boxes->maxX);
+    _aligned_free(boxes->maxY);
+    _aligned_free(boxes->maxZ);
+    *boxes = {};
+}
+
+void ResetCullBoxes(CullBoxes* boxes)
+{
+    boxes->count = 0;
+}
+
+uint32_t AddCullBox(CullBoxes* boxes, const Aabb& box)
+{
+    ASSERT(boxes->count < boxes->capacity);
+    uint32_t index = boxes->count++;
+    boxes->minX[index] = box.min.x;
+    boxes->minY[index] = box.min.y;
+    boxes->minZ[index] = box.min.z;
+    boxes->maxX[index] = box.max.x;
+    boxes->maxY[index] = box.max.y;
+    boxes->maxZ[index] = box.max.z;
+    return index;
+}
+
+// the plane test only needs the box corner furthest along the plane normal (the p-vertex)
+uint32_t CullBoxesScalar(const CullBoxes& boxes, const FrustumPlanes& frustum, uint32_t* visibleIndices)
+{
+    uint32_t visibleCount = 0;
+    for(uint32_t i = 0; i < boxes.count; i++) {
+        bool isVisible = true;
+        for(int p = 0; p < 6 && isVisible; p++) {
+            Vec4 plane = frustum.planes[p];
+            float x = plane.x >= 0.0f ? boxes.maxX[i] : boxes.minX[i];
+            float y = plane.y >= 0.0f ? boxes.maxY[i] : boxes.minY[i];
+            float z = plane.z >= 0.0f ? boxes.maxZ[i] : boxes.minZ[i];
+            isVisible = (plane.x * x) + (plane.y * y) + (plane.z * z) + plane.w >= 0.0f;
+        }
+        if(isVisible)
+            visibleIndices[visibleCount++] = i;
+    }
+    return visibleCount;
+}
+
+uint32_t CullBoxesAvx(const CullBoxes& boxes, const FrustumPlanes& frustum, uint32_t* visibleIndices)
+{
+    // the p-vertex choice only depends on the plane, so it picks whole arrays instead of per box blends
+    const float* planeXs[6];
+    const float* planeYs[6];
+    const float* planeZs[6];
+    __m256 planeNx[6];
+    __m256 planeNy[6];
+    __m256 planeNz[6];
+    __m256 planeD[6];
+    for(int p = 0; p < 6; p++) {
+        Vec4 plane = frustum.planes[p];
+        planeXs[p] = plane.x >= 0.0f ? boxes.maxX : boxes.minX;
+        planeYs[p] = plane.y >= 0.0f ? boxes.maxY : boxes.minY;
+        planeZs[p] = plane.z >= 0.0f ? boxes.maxZ : boxes.minZ;
+        planeNx[p] = _mm256_set1_ps(plane.x);
+        planeNy[p] = _mm256_set1_ps(plane.y);
+        planeNz[p] = _mm256_set1_ps(plane.z);
+        planeD[p] = _mm256_set1_ps(plane.w);
+    }
+
+    uint32_t visibleCount = 0;
+    __m256 zero = _mm256_setzero_ps();
+    for(uint32_t base = 0; base < boxes.count; base += CullBoxBatchSize) {
+        __m256 inside = _mm256_castsi256_ps(_mm256_set1_epi32(-1));
+        for(int p = 0; p < 6; p++) {
+            __m256 dist = _mm256_add_ps(planeD[p], _mm256_mul_ps(planeNx[p], _mm256_load_ps(planeXs[p] + base)));
+            dist = _mm256_add_ps(dist, _mm256_mul_ps(planeNy[p], _mm256_load_ps(planeYs[p] + base)));
+            dist = _mm256_add_ps(dist, _mm256_mul_ps(planeNz[p], _mm256_load_ps(planeZs[p] + base)));
+            inside = _mm256_and_ps(inside, _mm256_cmp_ps(dist, zero, _CMP_GE_OQ));
+        }
+
+        uint32_t mask = (uint32_t)_mm256_movemask_ps(inside);
+        uint32_t remaining = boxes.count - base;
+        if(remaining < CullBoxBatchSize)
+            mask &= (1u << remaining) - 1;
+
+        // compact the survivors
+        while(mask != 0) {
+            unsigned long bit = 0;
+            _BitScanForward(&bit, mask);
+            visibleIndices[visibleCount++] = base + (uint32_t)bit;
+            mask &= mask - 1;
+        }
+    }
+    return visibleCount;
+}
+
+// writes the indices of the boxes that intersect the frustum, returns how many there are
+uint32_t CullBoxesAgainstFrustum(const CullBoxes& boxes, const FrustumPlanes& frustum, uint32_t* visibleIndices)
+{
+    if(GetCpuFeatures().hasAvx)
+        return CullBoxesAvx(boxes, frustum, visibleIndices);
+    return CullBoxesScalar(boxes, frustum, visibleIndices);
+}
+
+// headless timing of the scalar and AVX frustum culling on the same boxes, run with --bench-cull
+bool RunCullBenchmark(uint32_t boxCount, int iterationCount)
+{
+    // boxes all around the camera so every plane culls some of them and many straddle a plane
+    CullBoxes boxes = CreateCullBoxes(boxCount);
+    uint32_t rngState = 0x2545F491;
+    for(uint32_t i = 0; i < boxCount; i++) {
+        Vec3 center = {
+            (RandomFloat01(&rngState) * 80.0f) - 40.0f,
+            (RandomFloat01(&rngState) * 80.0f) - 40.0f,
+            (RandomFloat01(&rngState) * 240.0f) - 120.0f
+        };
+        Vec3 halfSize = Vec3 { 0.05f, 0.05f, 0.05f } + (Vec3 { RandomFloat01(&rngState), RandomFloat01(&rngState), RandomFloat01(&rngState) } * 2.0f);
+        AddCullBox(&boxes, { .min = center - halfSize, .max = center + halfSize });
+    }
+
+    Mat4 projMat = PerspectiveProjMat4(toRadians(60.0f), 1280.0f, 720.0f, 0.1f, 100.0f);
+    Mat4 viewMat = LookatMat4({ 0.0f, 0.0f, 0.0f }, { 0.3f, 0.2f, -1.0f }, { 0.0f, 1.0f, 0.0f });
+    FrustumPlanes frustum = ExtractFrustumPlanes(projMat * viewMat);
+    uint32_t* scalarIndices = (uint32_t*)calloc(1, boxCount * sizeof(uint32_t));
+    uint32_t* avxIndices = (uint32_t*)calloc(1, boxCount * sizeof(uint32_t));
+    ASSERT(scalarIndices != nullptr && avxIndices != nullptr);
+
+    uint32_t scalarVisibleCount = 0;
+    uint64_t startTicks = GetTicks();
+    for(int iteration = 0; iteration < iterationCount; iteration++)
+        scalarVisibleCount = CullBoxesScalar(boxes, frustum, scalarIndices);
+    double scalarSeconds = TicksToSeconds(GetTicks() - startTicks);
+    printf("cull scalar: %.2f ns/box, %u of %u boxes visible\n", (scalarSeconds * 1e9) / ((double)iterationCount * boxCount),
+        scalarVisibleCount, boxCount);
+
+    bool isMatching = true;
+    if(GetCpuFeatures().hasAvx) {
+        uint32_t avxVisibleCount = 0;
+        startTicks = GetTicks();
+        for(int iteration = 0; iteration < iterationCount; iteration++)
+            avxVisibleCount = CullBoxesAvx(boxes, frustum, avxIndices);
+        double avxSeconds = TicksToSeconds(GetTicks() - startTicks);
+
+        isMatching = avxVisibleCount == scalarVisibleCount &&
+            memcmp(avxIndices, scalarIndices, scalarVisibleCount * sizeof(uint32_t)) == 0;
+        printf("cull avx: %.2f ns/box, %.2fx scalar, %s\n", (avxSeconds * 1e9) / ((double)iterationCount * boxCount),
+            avxSeconds > 0.0 ? scalarSeconds / avxSeconds : 0.0, isMatching ? "same visible boxes" : "visible boxes differ");
+    }
+    else {
+        printf("cull avx: not supported by this cpu\n");
+    }
+
+    free(avxIndices);
+    free(scalarIndices);
+    FreeCullBoxes(&boxes);
+    return isMatching;
+}
+
+// software occlusion culling: occluder triangles are rasterized into a small depth buffer and a min/max
+// hierarchy is built on top of it, objects are culled when their nearest depth is behind every occluder
+// texel their screen rect touches
+constexpr int OcclusionBufferWidth = 256;
+constexpr int OcclusionBufferHeight = 128;
+constexpr int OcclusionBandHeight = 8;
+constexpr int OcclusionMaxLevelCount = 9;
+constexpr uint32_t OcclusionMaxRefineTexels = 64;
+constexpr uint32_t MaxOccluderMeshes = 16;
+
+struct OccluderMesh
+{
+    const Vec3* positions;
+    uint32_t vertexCount;
+    Mat4 modelMat;
+};
+
+// setup done once per triangle and shared by all the bands that touch it,
+// edge functions and depth are planes in screen space evaluated at pixel centers
+struct OccluderTriangle
+{
+    int minX;
+    int minY;
+    int maxX;
+    int maxY;
+    float edgeA[3];
+    float edgeB[3];
+    float edgeC[3];
+    float depthA;
+    float depthB;
+    float depthC;
+};
+
+struct OcclusionLevel
+{
+    float* minDepth;
+    float* maxDepth;
+    int width;
+    int height;
+};
+
+struct OcclusionBuffer
+{
+    // level 0 holds the nearest occluder depth per pixel, so its min and max are the same array
+    float* depth;
+    OcclusionLevel levels[OcclusionMaxLevelCount];
+    int levelCount;
+    Mat4 projViewMat;
+    OccluderMesh occluders[MaxOccluderMeshes];
+    uint32_t occluderCount;
+    OccluderTriangle* triangles;
+    uint32_t triangleCount;
+    uint32_t triangleCapacity;
+};
+
+OcclusionBuffer CreateOcclusionBuffer()
+{
+    OcclusionBuffer buffer = {};
+    size_t depthByteSize = OcclusionBufferWidth * OcclusionBufferHeight * sizeof(float);
+    buffer.depth = (float*)_aligned_malloc(depthByteSize, 32);
+    ASSERT(buffer.depth != nullptr);
+
+    buffer.levels[0] = { .minDepth = buffer.depth, .maxDepth = buffer.depth, .width = OcclusionBufferWidth, .height = OcclusionBufferHeight };
+    buffer.levelCount = 1;
+    while(buffer.levelCount < OcclusionMaxLevelCount) {
+        const OcclusionLevel& prev = buffer.levels[buffer.levelCount - 1];
+        if(prev.width == 1 && prev.height == 1)
+            break;
+        OcclusionLevel level = {
+            .width = prev.width > 1 ? prev.width / 2 : 1,
+            .height = prev.height > 1 ? prev.height / 2 : 1
+        };
+        level.minDepth = (float*)calloc(1, level.width * level.height * sizeof(float));
+        level.maxDepth = (float*)calloc(1, level.width * level.height * sizeof(float));
+        ASSERT(level.minDepth != nullptr && level.maxDepth != nullptr);
+        buffer.levels[buffer.levelCount++] = level;
+    }
+    return buffer;
+}
+
+void FreeOcclusionBuffer(OcclusionBuffer* buffer)
+{
+    _aligned_free(buffer->depth);
+    for(int i = 1; i < buffer->levelCount; i++) {
+        free(buffer->levels[i].minDepth);
+        free(buffer->levels[i].maxDepth);
+    }
+    free(buffer->triangles);
+    *buffer = {};
+}
+
+void BeginOcclusionFrame(OcclusionBuffer* buffer, const Mat4& projViewMat)
+{
+    buffer->projViewMat = projViewMat;
+    buffer->occluderCount = 0;
+}
+
+// the positions are a plain triangle list and have to stay alive until the occluders are rasterized
+void AddOccluder(OcclusionBuffer* buffer, const Vec3* positions, uint32_t vertexCount, const Mat4& modelMat)
+{
+    ASSERT(buffer->occluderCount < MaxOccluderMeshes);
+    buffer->occluders[buffer->occluderCount++] = { .positions = positions, .vertexCount = vertexCount, .modelMat = modelMat };
+}
+
+Vec3 GetOcclusionScreenPosition(Vec4 clip)
+{
+    float invW = 1.0f / clip.w;
+    return {
+        ((clip.x * invW * 0.5f) + 0.5f) * OcclusionBufferWidth,
+        (0.5f - (clip.y * invW * 0.5f)) * OcclusionBufferHeight,
+        clip.z * invW
+    };
+}
+
+struct OccluderSetupContext
+{
+    OcclusionBuffer* buffer;
+    const OccluderMesh* mesh;
+    Mat4 xformMat;
+    uint32_t firstTriangle;
+};
+
+void SetupOccluderTrianglesTask(void* data, uint32_t start, uint32_t end, int threadIndex)
+{
+    OccluderSetupContext* context = (OccluderSetupContext*)data;
+    for(uint32_t tri = start; tri < end; tri++) {
+        OccluderTriangle* out = &context->buffer->triangles[context->firstTriangle + tri];
+        *out = { .minX = 1, .maxX = 0 };
+
+        // triangles reaching past the near plane are dropped instead of clipped, which only loses occlusion
+        Vec3 screen[3];
+        bool isInFront = true;
+        for(int i = 0; i < 3; i++) {
+            Vec3 p = context->mesh->positions[(tri * 3) + i];
+            Vec4 clip = context->xformMat * Vec4 { p.x, p.y, p.z, 1.0f };
+            isInFront = isInFront && clip.w > 0.0f && clip.z >= 0.0f;
+            if(isInFront)
+                screen[i] = GetOcclusionScreenPosition(clip);
+        }
+        if(!isInFront)
+            continue;
+
+        float area = ((screen[1].x - screen[0].x) * (screen[2].y - screen[0].y)) - ((screen[2].x - screen[0].x) * (screen[1].y - screen[0].y));
+        if(fabsf(area) < 1e-6f)
+            continue;
+
+        float minX = fminf(screen[0].x, fminf(screen[1].x, screen[2].x));
+        float maxX = fmaxf(screen[0].x, fmaxf(screen[1].x, screen[2].x));
+        float minY = fminf(screen[0].y, fminf(screen[1].y, screen[2].y));
+        float maxY = fmaxf(screen[0].y, fmaxf(screen[1].y, screen[2].y));
+        out->minX = (int)Clamp(0.0f, OcclusionBufferWidth - 1.0f, floorf(minX));
+        out->maxX = (int)Clamp(-1.0f, OcclusionBufferWidth - 1.0f, ceilf(maxX) - 1.0f);
+        out->minY = (int)Clamp(0.0f, OcclusionBufferHeight - 1.0f, floorf(minY));
+        out->maxY = (int)Clamp(-1.0f, OcclusionBufferHeight - 1.0f, ceilf(maxY) - 1.0f);
+        if(maxX < 0.0f || maxY < 0.0f) {
+            out->minX = 1;
+            out->maxX = 0;
+            continue;
+        }
+
+        // no backface culling, flip the edges of clockwise triangles so inside is always positive
+        float sign = area > 0.0f ? 1.0f : -1.0f;
+        for(int e = 0; e < 3; e++) {
+            Vec3 a = screen[e];
+            Vec3 b = screen[(e + 1) % 3];
+            out->edgeA[e] = (a.y - b.y) * sign;
+            out->edgeB[e] = (b.x - a.x) * sign;
+            out->edgeC[e] = ((a.x * b.y) - (a.y * b.x)) * sign;
+        }
+
+        // depth is linear in screen space after the perspective divide
+        Vec3 d1 = screen[1] - screen[0];
+        Vec3 d2 = screen[2] - screen[0];
+        float invArea = 1.0f / area;
+        out->depthA = ((d1.z * d2.y) - (d2.z * d1.y)) * invArea;
+        out->depthB = ((d2.z * d1.x) - (d1.z * d2.x)) * invArea;
+        out->depthC = screen[0].z - (out->depthA * screen[0].x) - (out->depthB * screen[0].y);
+    }
+}
+
+void RasterizeOccluderRowScalar(float* row, const OccluderTriangle& tri, int minX, int maxX, float py)
+{
+    for(int x = minX; x <= maxX; x++) {
+        float px = x + 0.5f;
+        bool isInside = true;
+        for(int e = 0; e < 3; e++)
+            isInside = isInside && (tri.edgeA[e] * px) + (tri.edgeB[e] * py) + tri.edgeC[e] >= 0.0f;
+        if(isInside) {
+            float z = (tri.depthA * px) + (tri.depthB * py) + tri.depthC;
+            row[x] = z < row[x] ? z : row[x];
+        }
+    }
+}
+
+void RasterizeOccluderRowAvx(float* row, const OccluderTriangle& tri, int minX, int maxX, float py)
+{
+    // 8 pixels per step, the buffer width is a multiple of 8 so aligned spans never leave the row
+    __m256 laneOffsets = _mm256_setr_ps(0.5f, 1.5f, 2.5f, 3.5f, 4.5f, 5.5f, 6.5f, 7.5f);
+    __m256 zero = _mm256_setzero_ps();
+    __m256 edgeA[3];
+    __m256 edgeRow[3];
+    for(int e = 0; e < 3; e++) {
+        edgeA[e] = _mm256_set1_ps(tri.edgeA[e]);
+        edgeRow[e] = _mm256_set1_ps((tri.edgeB[e] * py) + tri.edgeC[e]);
+    }
+    __m256 depthA = _mm256_set1_ps(tri.depthA);
+    __m256 depthRow = _mm256_set1_ps((tri.depthB * py) + tri.depthC);
+
+    for(int x = minX & ~7; x <= maxX; x += 8) {
+        __m256 px = _mm256_add_ps(_mm256_set1_ps((float)x), laneOffsets);
+        __m256 inside = _mm256_cmp_ps(_mm256_add_ps(_mm256_mul_ps(edgeA[0], px), edgeRow[0]), zero, _CMP_GE_OQ);
+        inside = _mm256_and_ps(inside, _mm256_cmp_ps(_mm256_add_ps(_mm256_mul_ps(edgeA[1], px), edgeRow[1]), zero, _CMP_GE_OQ));
+        inside = _mm256_and_ps(inside, _mm256_cmp_ps(_mm256_add_ps(_mm256_mul_ps(edgeA[2], px), edgeRow[2]), zero, _CMP_GE_OQ));
+        if(_mm256_movemask_ps(inside) == 0)
+            continue;
+
+        // lanes outside [minX, maxX] can still pass the edge tests through rounding, keep them out
+        __m256 lane = _mm256_sub_ps(px, _mm256_set1_ps(0.5f));
+        inside = _mm256_and_ps(inside, _mm256_cmp_ps(lane, _mm256_set1_ps((float)minX), _CMP_GE_OQ));
+        inside = _mm256_and_ps(inside, _mm256_cmp_ps(lane, _mm256_set1_ps((float)maxX), _CMP_LE_OQ));
+
+        __m256 z = _mm256_add_ps(_mm256_mul_ps(depthA, px), depthRow);
+        __m256 old = _mm256_load_ps(row + x);
+        _mm256_store_ps(row + x, _mm256_blendv_ps(old, _mm256_min_ps(old, z), inside));
+    }
+}
+
+struct OccluderRasterContext
+{
+    OcclusionBuffer* buffer;
+    bool useAvx;
+};
+
+// every band owns its rows, so the bands can be rasterized in parallel without any locking
+void RasterizeOcclusionBandsTask(void* data, uint32_t start, uint32_t end, int threadIndex)
+{
+    OccluderRasterContext* context = (OccluderRasterContext*)data;
+    OcclusionBuffer* buffer = context->buffer;
+    for(uint32_t band = start; band < end; band++) {
+        int bandMinY = band * OcclusionBandHeight;
+        int bandMaxY = bandMinY + OcclusionBandHeight - 1;
+        for(int y = bandMinY; y <= bandMaxY; y++) {
+            float* row = buffer->depth + (y * OcclusionBufferWidth);
+            for(int x = 0; x < OcclusionBufferWidth; x++)
+                row[x] = 1.0f;
+        }
+
+        for(uint32_t i = 0; i < buffer->triangleCount; i++) {
+            const OccluderTriangle& tri = buffer->triangles[i];
+            if(tri.minX > tri.maxX || tri.maxY < bandMinY || tri.minY > bandMaxY)
+                continue;
+            int minY = tri.minY > bandMinY ? tri.minY : bandMinY;
+            int maxY = tri.maxY < bandMaxY ? tri.maxY : bandMaxY;
+            for(int y = minY; y <= maxY; y++) {
+                float* row = buffer->depth + (y * OcclusionBufferWidth);
+                if(context->useAvx)
+                    RasterizeOccluderRowAvx(row, tri, tri.minX, tri.maxX, y + 0.5f);
+                else
+                    RasterizeOccluderRowScalar(row, tri, tri.minX, tri.maxX, y + 0.5f);
+            }
+        }
+    }
+}
+
+struct OcclusionLevelContext
+{
+    const OcclusionLevel* src;
+    const OcclusionLevel* dest;
+};
+
+void DownsampleOcclusionLevelTask(void* data, uint32_t start, uint32_t end, int threadIndex)
+{
+    OcclusionLevelContext* context = (OcclusionLevelContext*)data;
+    const OcclusionLevel* src = context->src;
+    const OcclusionLevel* dest = context->dest;
+    for(uint32_t y = start; y < end; y++) {
+        // levels that are already 1 texel high or wide just repeat their last row or column
+        int srcY0 = (int)y * 2 < src->height ? (int)y * 2 : src->height - 1;
+        int srcY1 = srcY0 + 1 < src->height ? srcY0 + 1 : srcY0;
+        for(int x = 0; x < dest->width; x++) {
+            int srcX0 = x * 2 < src->width ? x * 2 : src->width - 1;
+            int srcX1 = srcX0 + 1 < src->width ? srcX0 + 1 : srcX0;
+            int srcIndices[4] = {
+                (srcY0 * src->width) + srcX0, (srcY0 * src->width) + srcX1,
+                (srcY1 * src->width) + srcX0, (srcY1 * src->width) + srcX1
+            };
+            float minDepth = src->minDepth[srcIndices[0]];
+            float maxDepth = src->maxDepth[srcIndices[0]];
+            for(int i = 1; i < 4; i++) {
+                minDepth = fminf(minDepth, src->minDepth[srcIndices[i]]);
+                maxDepth = fmaxf(maxDepth, src->maxDepth[srcIndices[i]]);
+            }
+            dest->minDepth[(y * dest->width) + x] = minDepth;
+            dest->maxDepth[(y * dest->width) + x] = maxDepth;
+        }
+    }
+}
+
+void RasterizeOccluders(TaskPool* pool, OcclusionBuffer* buffer)
+{
+    uint32_t triangleCount = 0;
+    for(uint32_t i = 0; i < buffer->occluderCount; i++)
+        triangleCount += buffer->occluders[i].vertexCount / 3;
+    if(triangleCount > buffer->triangleCapacity) {
+        free(buffer->triangles);
+        buffer->triangleCapacity = triangleCount;
+        buffer->triangles = (OccluderTriangle*)calloc(1, triangleCount * sizeof(OccluderTriangle));
+        ASSERT(buffer->triangles != nullptr);
+    }
+    buffer->triangleCount = triangleCount;
+
+    uint32_t firstTriangle = 0;
+    for(uint32_t i = 0; i < buffer->occluderCount; i++) {
+        const OccluderMesh* mesh = &buffer->occluders[i];
+        OccluderSetupContext context = {
+            .buffer = buffer,
+            .mesh = mesh,
+            .xformMat = buffer->projViewMat * mesh->modelMat,
+            .firstTriangle = firstTriangle
+        };
+        ParallelFor(pool, mesh->vertexCount / 3, 1024, SetupOccluderTrianglesTask, &context);
+        firstTriangle += mesh->vertexCount / 3;
+    }
+
+    OccluderRasterContext rasterContext = { .buffer = buffer, .useAvx = GetCpuFeatures().hasAvx };
+    ParallelFor(pool, OcclusionBufferHeight / OcclusionBandHeight, 1, RasterizeOcclusionBandsTask, &rasterContext);
+
+    for(int i = 1; i < buffer->levelCount; i++) {
+        OcclusionLevelContext levelContext = { .src = &buffer->levels[i - 1], .dest = &buffer->levels[i] };
+        ParallelFor(pool, buffer->levels[i].height, 16, DownsampleOcclusionLevelTask, &levelContext);
+    }
+}
+
+// returns false when the box reaches past the near plane, those can't be tested and count as visible
+bool GetOccludeeScreenRect(const Aabb& box, const Mat4& projViewMat, Aabb* rect)
+{
+    *rect = EmptyAabb();
+    for(int i = 0; i < 8; i++) {
+        Vec4 corner = {
+            i & 1 ? box.max.x : box.min.x,
+            i & 2 ? box.max.y : box.min.y,
+            i & 4 ? box.max.z : box.min.z,
+            1.0f
+        };
+        Vec4 clip = projViewMat * corner;
+        if(clip.w <= 0.0f || clip.z < 0.0f)
+            return false;
+        *rect = Grow(*rect, GetOcclusionScreenPosition(clip));
+    }
+    return true;
+}
+
+// -1 when the rect is occluded, 1 when it is in front of everything it covers, 0 when undecided
+int TestOcclusionLevel(const OcclusionLevel& level, int levelIndex, int minX, int minY, int maxX, int maxY, float nearDepth)
+{
+    float minDepth = 1.0f;
+    float maxDepth = 0.0f;
+    for(int y = minY >> levelIndex; y <= maxY >> levelIndex; y++) {
+        for(int x = minX >> levelIndex; x <= maxX >> levelIndex; x++) {
+            minDepth = fminf(minDepth, level.minDepth[(y * level.width) + x]);
+            maxDepth = fmaxf(maxDepth, level.maxDepth[(y * level.width) + x]);
+        }
+    }
+    if(nearDepth > maxDepth)
+        return -1;
+    if(nearDepth <= minDepth)
+        return 1;
+    return 0;
+}
+
+bool IsBoxOccluded(const OcclusionBuffer& buffer, const Aabb& box)
+{
+    Aabb rect = {};
+    if(!GetOccludeeScreenRect(box, buffer.projViewMat, &rect))
+        return false;
+    if(rect.max.x <= 0.0f || rect.max.y <= 0.0f || rect.min.x >= OcclusionBufferWidth || rect.min.y >= OcclusionBufferHeight)
+        return false;
+
+    int minX = (int)Clamp(0.0f, OcclusionBufferWidth - 1.0f, floorf(rect.min.x));
+    int maxX = (int)Clamp(0.0f, OcclusionBufferWidth - 1.0f, floorf(rect.max.x));
+    int minY = (int)Clamp(0.0f, OcclusionBufferHeight - 1.0f, floorf(rect.min.y));
+    int maxY = (int)Clamp(0.0f, OcclusionBufferHeight - 1.0f, floorf(rect.max.y));
+
+    // start on the level where the rect covers at most 2x2 texels, then refine while it stays cheap
+    int levelIndex = 0;
+    while(levelIndex < buffer.levelCount - 1 && ((maxX >> levelIndex) - (minX >> levelIndex) > 1 || (maxY >> levelIndex) - (minY >> levelIndex) > 1))
+        levelIndex++;
+
+    for(; levelIndex >= 0; levelIndex--) {
+        uint32_t texelCount = ((maxX >> levelIndex) - (minX >> levelIndex) + 1) * ((maxY >> levelIndex) - (minY >> levelIndex) + 1);
+        if(texelCount > OcclusionMaxRefineTexels)
+            break;
+        int result = TestOcclusionLevel(buffer.levels[levelIndex], levelIndex, minX, minY, maxX, maxY, rect.min.z);
+        if(result != 0)
+            return result < 0;
+    }
+    return false;
+}
+
+struct OcclusionTestContext
+{
+    const OcclusionBuffer* buffer;
+    const CullBoxes* boxes;
+    const uint32_t* indices;
+    uint8_t* isOccluded;
+};
+
+void TestOccludeesTask(void* data, uint32_t start, uint32_t end, int threadIndex)
+{
+    OcclusionTestContext* context = (OcclusionTestContext*)data;
+    for(uint32_t i = start; i < end; i++) {
+        uint32_t boxIndex = context->indices[i];
+        Aabb box = {
+            .min = { context->boxes->minX[boxIndex], context->boxes->minY[boxIndex], context->boxes->minZ[boxIndex] },
+            .max = { context->boxes->maxX[boxIndex], context->boxes->maxY[boxIndex], context->boxes->maxZ[boxIndex] }
+        };
+        context->isOccluded[i] = IsBoxOccluded(*context->buffer, box);
+    }
+}
+
+// filters the already frustum culled indices in place, returns how many are left
+uint32_t CullOccludedBoxes(TaskPool* pool, const OcclusionBuffer& buffer, const CullBoxes& boxes, uint32_t* visibleIndices, uint32_t visibleCount)
+{
+    uint8_t* isOccluded = (uint8_t*)malloc(visibleCount > 0 ? visibleCount : 1);
+    ASSERT(isOccluded != nullptr);
+
+    OcclusionTestContext context = { .buffer = &buffer, .boxes = &boxes, .indices = visibleIndices, .isOccluded = isOccluded };
+    ParallelFor(pool, visibleCount, 256, TestOccludeesTask, &context);
+
+    uint32_t remaining = 0;
+    for(uint32_t i = 0; i < visibleCount; i++) {
+        if(!isOccluded[i])
+            visibleIndices[remaining++] = visibleIndices[i];
+    }
+    free(isOccluded);
+    return remaining;
+}
+
+// headless benchmark: a wall of occluder quads in front of random boxes, run with --bench-occlusion
+void RunOcclusionBenchmark(TaskPool* pool, uint32_t boxCount, int iterationCount)
+{
+    const int wallQuads = 32;
+    uint32_t wallVertexCount = wallQuads * wallQuads * 6;
+    Vec3* wallPositions = (Vec3*)calloc(1, wallVertexCount * sizeof(Vec3));
+    ASSERT(wallPositions != nullptr);
+    uint32_t writeIndex = 0;
+    for(int y = 0; y < wallQuads; y++) {
+        for(int x = 0; x < wallQuads; x++) {
+            float x0 = -8.0f + (x * 0.5f);
+            float y0 = -8.0f + (y * 0.5f);
+            Vec3 quad[6] = {
+                { x0, y0, 0.0f }, { x0 + 0.5f, y0, 0.0f }, { x0 + 0.5f, y0 + 0.5f, 0.0f },
+                { x0, y0, 0.0f }, { x0 + 0.5f, y0 + 0.5f, 0.0f }, { x0, y0 + 0.5f, 0.0f }
+            };
+            for(int i = 0; i < 6; i++)
+                wallPositions[writeIndex++] = quad[i];
+        }
+    }
+
+    CullBoxes boxes = CreateCullBoxes(boxCount);
+    uint32_t rngState = 0x9E3779B9;
+    for(uint32_t i = 0; i < boxCount; i++) {
+        Vec3 center = {
+            (RandomFloat01(&rngState) * 20.0f) - 10.0f,
+            (RandomFloat01(&rngState) * 12.0f) - 6.0f,
+            (RandomFloat01(&rngState) * -40.0f) + 8.0f
+        };
+        Vec3 halfSize = Vec3 { 0.1f, 0.1f, 0.1f } + (Vec3 { RandomFloat01(&rngState), RandomFloat01(&rngState), RandomFloat01(&rngState) } * 0.4f);
+        AddCullBox(&boxes, { .min = center - halfSize, .max = center + halfSize });
+    }
+
+    Mat4 projMat = PerspectiveProjMat4(toRadians(45.0f), 1280.0f, 720.0f, 0.1f, 100.0f);
+    Mat4 viewMat = LookatMat4({ 0.0f, 0.0f, 12.0f }, { 0.0f, 0.0f, 0.0f }, { 0.0f, 1.0f, 0.0f });
+    Mat4 projViewMat = projMat * viewMat;
+    OcclusionBuffer occlusion = CreateOcclusionBuffer();
+    uint32_t* visibleIndices = (uint32_t*)calloc(1, boxCount * sizeof(uint32_t));
+    ASSERT(visibleIndices != nullptr);
+
+    TaskPool* pools[2] = { nullptr, pool };
+    for(int p = 0; p < 2; p++) {
+        uint64_t rasterTicks = 0;
+        uint64_t testTicks = 0;
+        uint32_t frustumVisibleCount = 0;
+        uint32_t visibleCount = 0;
+        for(int iteration = 0; iteration < iterationCount; iteration++) {
+            uint64_t startTicks = GetTicks();
+            BeginOcclusionFrame(&occlusion, projViewMat);
+            AddOccluder(&occlusion, wallPositions, wallVertexCount, IdentityMat4());
+            RasterizeOccluders(pools[p], &occlusion);
+            uint64_t rasterEndTicks = GetTicks();
+
+            frustumVisibleCount = CullBoxesAgainstFrustum(boxes, ExtractFrustumPlanes(projViewMat), visibleIndices);
+            visibleCount = CullOccludedBoxes(pools[p], occlusion, boxes, visibleIndices, frustumVisibleCount);
+            rasterTicks += rasterEndTicks - startTicks;
+            testTicks += GetTicks() - rasterEndTicks;
+        }
+        printf("occlusion %s (%d threads): raster %.3f ms, cull %.1f ns/box, %u of %u boxes in the frustum occluded\n",
+            p == 0 ? "serial" : "parallel", GetTaskPoolTotalThreadCount(pools[p]),
+            (TicksToSeconds(rasterTicks) * 1000.0) / iterationCount,
+            (TicksToSeconds(testTicks) * 1e9) / ((double)iterationCount * boxCount),
+            frustumVisibleCount - visibleCount, frustumVisibleCount);
+    }
+
+    free(visibleIndices);
+    FreeOcclusionBuffer(&occlusion);
+    FreeCullBoxes(&boxes);
+    free(wallPositions);
+}
+
+// interleaved POSITION, NORMAL and TANGENT, the position only layouts read the same buffer with the same stride
+struct ModelVertex
+{
+    Vec3 position;
+    Vec3 normal;
+    // xyz = tangent, w = bitangent sign
+    Vec4 tangent;
+};
+static_assert(sizeof(ModelVertex) == 40);
+
+struct ModelDrawRange
+{
+    UINT firstIndex;
+    UINT indexCount;
+};
+
+// the deduplicated vertices, the indices and the draw range of every submesh in one allocation, ready to upload,
+// indices are 16-bit whenever the vertex count allows it
+struct PackedModel
+{
+    void* memory;
+    size_t byteSize;
+    ModelVertex* vertices;
+    uint32_t vertexCount;
+    void* indices;
+    uint32_t indexCount;
+    uint32_t indexStride;
+    ModelDrawRange* drawRanges;
+    uint32_t drawRangeCount;
+};
+
+constexpr uint32_t InvalidPackedVertex = 0xFFFFFFFF;
+constexpr size_t PackedModelAlignment = 16;
+
+void FreePackedModel(PackedModel* packed)
+{
+    _aligned_free(packed->memory);
+    *packed = {};
+}
+
+ModelVertex GetModelVertexForCorner(const Vec3* positions, const Vec3* normals, const Vec4* tangents, uint32_t corner)
+{
+    return {
+        .position = positions[corner],
+        .normal = normals != nullptr ? normals[corner] : Vec3{},
+        .tangent = tangents != nullptr ? tangents[corner] : Vec4{}
+    };
+}
+
+// triangle list corners to indexed vertices, corners with bit-identical attributes share a vertex,
+// submeshEnds are the ascending corner counts where each submesh ends
+PackedModel PackModelVertices(const Vec3* positions, const Vec3* normals, const Vec4* tangents, uint32_t cornerCount,
+    const uint32_t* submeshEnds, uint32_t submeshCount)
+{
+    ASSERT(submeshCount > 0 && submeshEnds[submeshCount - 1] == cornerCount);
+
+    // at most half full keeps the probe sequences short
+    uint32_t hashBits = 1;
+    while((1u << hashBits) < cornerCount * 2)
+        hashBits++;
+    uint32_t hashMask = (1u << hashBits) - 1;
+    uint32_t* hashSlots = (uint32_t*)malloc((hashMask + 1) * sizeof(uint32_t));
+    uint32_t* cornerVertices = (uint32_t*)calloc(1, cornerCount * sizeof(uint32_t));
+    uint32_t* vertexCorners = (uint32_t*)calloc(1, cornerCount * sizeof(uint32_t));
+    ASSERT(hashSlots != nullptr && cornerVertices != nullptr && vertexCorners != nullptr);
+    memset(hashSlots, 0xFF, (hashMask + 1) * sizeof(uint32_t));
+
+    uint32_t vertexCount = 0;
+    for(uint32_t corner = 0; corner < cornerCount; corner++) {
+        ModelVertex vertex = GetModelVertexForCorner(positions, normals, tangents, corner);
+        uint32_t slot = (uint32_t)HashBytes(&vertex, sizeof(vertex)) & hashMask;
+        while(true) {
+            uint32_t existing = hashSlots[slot];
+            if(existing == InvalidPackedVertex) {
+                hashSlots[slot] = vertexCount;
+                vertexCorners[vertexCount] = corner;
+                cornerVertices[corner] = vertexCount++;
+                break;
+            }
+            ModelVertex existingVertex = GetModelVertexForCorner(positions, normals, tangents, vertexCorners[existing]);
+            if(memcmp(&existingVertex, &vertex, sizeof(vertex)) == 0) {
+                cornerVertices[corner] = existing;
+                break;
+            }
+            slot = (slot + 1) & hashMask;
+        }
+    }
+
+    uint32_t indexStride = vertexCount <= 0xFFFF ? sizeof(uint16_t) : sizeof(uint32_t);
+    size_t verticesByteSize = AlignUp(vertexCount * sizeof(ModelVertex), PackedModelAlignment);
+    size_t indicesByteSize = AlignUp((size_t)cornerCount * indexStride, PackedModelAlignment);
+    size_t drawRangesByteSize = submeshCount * sizeof(ModelDrawRange);
+    PackedModel packed = {
+        .byteSize = verticesByteSize + indicesByteSize + drawRangesByteSize,
+        .vertexCount = vertexCount,
+        .indexCount = cornerCount,
+        .indexStride = indexStride,
+        .drawRangeCount = submeshCount
+    };
+    packed.memory = _aligned_malloc(packed.byteSize, PackedModelAlignment);
+    ASSERT(packed.memory != nullptr);
+    packed.vertices = (ModelVertex*)packed.memory;
+    packed.indices = (unsigned char*)packed.memory + verticesByteSize;
+    packed.drawRanges = (ModelDrawRange*)((unsigned char*)packed.indices + indicesByteSize);
+
+    for(uint32_t i = 0; i < vertexCount; i++)
+        packed.vertices[i] = GetModelVertexForCorner(positions, normals, tangents, vertexCorners[i]);
+    for(uint32_t corner = 0; corner < cornerCount; corner++) {
+        if(indexStride == sizeof(uint16_t))
+            ((uint16_t*)packed.indices)[corner] = (uint16_t)cornerVertices[corner];
+        else
+            ((uint32_t*)packed.indices)[corner] = cornerVertices[corner];
+    }
+    uint32_t firstIndex = 0;
+    for(uint32_t i = 0; i < submeshCount; i++) {
+        packed.drawRanges[i] = { .firstIndex = firstIndex, .indexCount = submeshEnds[i] - firstIndex };
+        firstIndex = submeshEnds[i];
+    }
+
+    free(vertexCorners);
+    free(cornerVertices);
+    free(hashSlots);
+    return packed;
+}
+
+// the obj loader doesn't split groups or materials, so the whole model is a single submesh
+PackedModel PackObjModel(const ObjModel& objModel)
+{
+    uint32_t submeshEnd = objModel.vertexCount;
+    return PackModelVertices(objModel.positions, objModel.normals, objModel.tangents, objModel.vertexCount, &submeshEnd, 1);
+}
+
+struct Dx11ModelData
+{
+    ID3D11Buffer* vertexBuffer;
+    ID3D11Buffer* indexBuffer;
+    UINT vertexStride;
+    DXGI_FORMAT indexFormat;
+    // one per submesh, the only part of the packed model kept on the CPU after the upload,
+    // so it gets its own small allocation and the packed memory can be freed
+    ModelDrawRange* drawRanges;
+    UINT drawRangeCount;
+};
+
+Dx11ModelData CreateDx11ModelData(const Dx11& dx, const PackedModel& packed)
+{
+    Dx11ModelData modelData = {
+        .vertexStride = sizeof(ModelVertex),
+        .indexFormat = packed.indexStride == sizeof(uint16_t) ? DXGI_FORMAT_R16_UINT : DXGI_FORMAT_R32_UINT,
+        .drawRangeCount = packed.drawRangeCount
+    };
+
+    modelData.vertexBuffer = CreateStaticDx11VertexBuffer(dx, packed.vertices, packed.vertexCount * sizeof(ModelVertex));
+
+    D3D11_BUFFER_DESC indexBufferDesc = {
+        .ByteWidth = packed.indexCount * packed.indexStride,
+        .Usage = D3D11_USAGE_IMMUTABLE,
+        .BindFlags = D3D11_BIND_INDEX_BUFFER
+    };
+    D3D11_SUBRESOURCE_DATA indexBufData = {
+        .pSysMem = packed.indices
+    };
+    HRESULT res = dx.device->CreateBuffer(&indexBufferDesc, &indexBufData, &modelData.indexBuffer);
+    ASSERT(res == S_OK);
+
+    modelData.drawRanges = (ModelDrawRange*)calloc(1, packed.drawRangeCount * sizeof(ModelDrawRange));
+    ASSERT(modelData.drawRanges != nullptr);
+    memcpy(modelData.drawRanges, packed.drawRanges, packed.drawRangeCount * sizeof(ModelDrawRange));
+
+    return modelData;
+}
+
+Dx11ModelData CreateDx11ModelDataFromObjModel(const Dx11& dx, const ObjModel& objModel)
+{
+    PackedModel packed = PackObjModel(objModel);
+    Dx11ModelData modelData = CreateDx11ModelData(dx, packed);
+    FreePackedModel(&packed);
+    return modelData;
+}
+
+Dx11ModelData CreateDx11ModelDataForCube(const Dx11& dx, Vec3* vertexPositions, UINT vertexCount)
+{
+    PackedModel packed = PackModelVertices(vertexPositions, nullptr, nullptr, vertexCount, &vertexCount, 1);
+    Dx11ModelData modelData = CreateDx11ModelData(dx, packed);
+    FreePackedModel(&packed);
+    return modelData;
+}
+
+void FreeDx11ModelData(Dx11ModelData* modelData)
+{
+    modelData->vertexBuffer->Release();
+    modelData->indexBuffer->Release();
+    free(modelData->drawRanges);
+    *modelData = {};
+}
+
+// per instance vertex data, matches MATRIX and NORMALMATRIX in phonginstancedvs.hlsl
+struct ModelInstanceData
+{
+    Mat4 modelMat;
+    Mat4 normalMat;
+};
+
+// SoA transforms of many copies of one model, same conventions as Transform and GetModelMatFromTransform
+struct ModelInstances
+{
+    float* positionX;
+    float* positionY;
+    float* positionZ;
+    float* scaleX;
+    float* scaleY;
+    float* scaleZ;
+    // rotation quaternions
+    float* rotationX;
+    float* rotationY;
+    float* rotationZ;
+    float* rotationW;
+    uint32_t count;
+    uint32_t capacity;
+    // packed every frame and uploaded in one go
+    ModelInstanceData* instanceData;
+};
+
+ModelInstances CreateModelInstances(uint32_t capacity)
+{
+    ModelInstances instances = { .capacity = capacity };
+    float** arrays[10] = {
+        &instances.positionX, &instances.positionY, &instances.positionZ,
+        &instances.scaleX, &instances.scaleY, &instances.scaleZ,
+        &instances.rotationX, &instances.rotationY, &instances.rotationZ, &instances.rotationW
+    };
+    for(int i = 0; i < ARRAY_LEN(arrays); i++) {
+        *arrays[i] = (float*)calloc(1, capacity * sizeof(float));
+        ASSERT(*arrays[i] != nullptr);
+    }
+    instances.instanceData = (ModelInstanceData*)calloc(1, capacity * sizeof(ModelInstanceData));
+    ASSERT(instances.instanceData != nullptr);
+    return instances;
+}
+
+void FreeModelInstances(ModelInstances* instances)
+{
+    free(instances->positionX);
+    free(instances->positionY);
+    free(instances->positionZ);
+    free(instances->scaleX);
+    free(instances->scaleY);
+    free(instances->scaleZ);
+    free(instances->rotationX);
+    free(instances->rotationY);
+    free(instances->rotationZ);
+    free(instances->rotationW);
+    free(instances->instanceData);
+    *instances = {};
+}
+
+uint32_t AddModelInstance(ModelInstances* instances, const Transform& transform)
+{
+    ASSERT(instances->count < instances->capacity);
+    uint32_t index = instances->count++;
+    instances->positionX[index] = transform.position.x;
+    instances->positionY[index] = transform.position.y;
+    instances->positionZ[index] = transform.position.z;
+    instances->scaleX[index] = transform.scale.x;
+    instances->scaleY[index] = transform.scale.y;
+    instances->scaleZ[index] = transform.scale.z;
+    instances->rotationX[index] = transform.rotation.x;
+    instances->rotationY[index] = transform.rotation.y;
+    instances->rotationZ[index] = transform.rotation.z;
+    instances->rotationW[index] = transform.rotation.w;
+    return index;
+}
+
+// rotation applied in the instance's local space before its current one
+void RotateModelInstances(ModelInstances* instances, const Quat& rotation)
+{
+    for(uint32_t i = 0; i < instances->count; i++) {
+        Quat current = { instances->rotationX[i], instances->rotationY[i], instances->rotationZ[i], instances->rotationW[i] };
+        Quat rotated = Normalize(current * rotation);
+        instances->rotationX[i] = rotated.x;
+        instances->rotationY[i] = rotated.y;
+        instances->rotationZ[i] = rotated.z;
+        instances->rotationW[i] = rotated.w;
+    }
+}
+
+void PackModelInstancesTask(void* data, uint32_t start, uint32_t end, int threadIndex)
+{
+    // model = T * R * S and normal = inverse transpose of R * S = R * S^-1,
+    // so both come straight from the same quaternion without a general inverse
+    ModelInstances* instances = (ModelInstances*)data;
+    for(uint32_t i = start; i < end; i++) {
+        Mat3 rotation = Mat3FromQuat({ instances->rotationX[i], instances->rotationY[i], instances->rotationZ[i], instances->rotationW[i] });
+        float scale[3] = { instances->scaleX[i], instances->scaleY[i], instances->scaleZ[i] };
+
+        ModelInstanceData* out = &instances->instanceData[i];
+        for(int col = 0; col < 3; col++) {
+            float invScale = scale[col] != 0.0f ? 1.0f / scale[col] : 0.0f;
+            for(int row = 0; row < 3; row++) {
+                out->modelMat.data[col][row] = rotation.data[col][row] * scale[col];
+                out->normalMat.data[col][row] = rotation.data[col][row] * invScale;
+            }
+            out->modelMat.data[col][3] = 0.0f;
+            out->normalMat.data[col][3] = 0.0f;
+        }
+        out->modelMat.data[3][0] = instances->positionX[i];
+        out->modelMat.data[3][1] = instances->positionY[i];
+        out->modelMat.data[3][2] = instances->positionZ[i];
+        out->modelMat.data[3][3] = 1.0f;
+        out->normalMat.data[3][0] = 0.0f;
+        out->normalMat.data[3][1] = 0.0f;
+        out->normalMat.data[3][2] = 0.0f;
+        out->normalMat.data[3][3] = 1.0f;
+    }
+}
+
+void PackModelInstances(TaskPool* pool, ModelInstances* instances)
+{
+    ParallelFor(pool, instances->count, 4096, PackModelInstancesTask, instances);
+}
+
+// headless benchmark of the per frame cpu work for instanced drawing, run with --bench-instances
+void RunModelInstancesBenchmark(TaskPool* pool, uint32_t instanceCount, int iterationCount)
+{
+    ModelInstances instances = CreateModelInstances(instanceCount);
+    uint32_t rngState = 0x2545F491;
+    for(uint32_t i = 0; i < instanceCount; i++) {
+        Transform transform = {
+            .position = { RandomFloat01(&rngState) * 100.0f, 0.0f, RandomFloat01(&rngState) * 100.0f },
+            .scale = { 0.5f + RandomFloat01(&rngState), 0.5f + RandomFloat01(&rngState), 0.5f + RandomFloat01(&rngState) },
+            .rotation = QuatFromEuler({ RandomFloat01(&rngState) * 6.28f, RandomFloat01(&rngState) * 6.28f, 0.0f })
+        };
+        AddModelInstance(&instances, transform);
+    }
+
+    TaskPool* pools[2] = { nullptr, pool };
+    for(int p = 0; p < 2; p++) {
+        uint64_t startTicks = GetTicks();
+        for(int iteration = 0; iteration < iterationCount; iteration++)
+            PackModelInstances(pools[p], &instances);
+        double seconds = TicksToSeconds(GetTicks() - startTicks);
+        printf("instance packing %s (%d threads): %.2f ms for %u instances, %.1f ns per instance, %.1f MB per frame\n",
+            p == 0 ? "serial" : "parallel", GetTaskPoolTotalThreadCount(pools[p]), (seconds * 1000.0) / iterationCount,
+            instanceCount, (seconds * 1e9) / ((double)iterationCount * instanceCount),
+            (instanceCount * sizeof(ModelInstanceData)) / (1024.0 * 1024.0));
+    }
+
+    FreeModelInstances(&instances);
+}
+
+// the ascii bake the hud used before GlyphAtlas, now only --bench-text uses it
+// through GenerateGlyphInstancesForStringAt as the baseline for the instance formats
+struct BakedCharMap
+{
+    ByteBuffer ttf;
+    unsigned char* fontBitmap;
+    int fontBitmapWidth;
+    int fontBitmapHeight;
+    int startChar;
+    stbtt_bakedchar* bakedChars;
+};
+
+void FreeBakedCharMap(BakedCharMap* bakedCharMap)
+{
+    free(bakedCharMap->ttf.data);
+    free(bakedCharMap->fontBitmap);
+    free(bakedCharMap->bakedChars);
+    *bakedCharMap = {};
+}
+
+BakedCharMap BakeCharMapForFont(const char* fontName, float fontHeight)
+{
+    ByteBuffer ttfBuffer = ReadAllBytesFromFile(fontName, 0);
+    
+    int fontBitmapWidth = 1024;
+    int fontBitmapHeight = 1024;
+    // one-channel bitmap
+    unsigned char* fontBitmapBuffer = (unsigned char*)calloc(1, fontBitmapWidth * fontBitmapHeight);
+    ASSERT(fontBitmapBuffer != nullptr);
+    
+    // from space to end of ASCII
+    int startChar = 32;
+    int nrOfChars = 96;
+    stbtt_bakedchar* bakedChars = (stbtt_bakedchar*)calloc(1, nrOfChars * sizeof(stbtt_bakedchar));
+    ASSERT(bakedChars != nullptr);
+
+    int bakeRes = stbtt_BakeFontBitmap(
+        ttfBuffer.data,
+        0,
+        fontHeight,
+        fontBitmapBuffer,
+        fontBitmapWidth,
+        fontBitmapHeight,
+        startChar,
+        nrOfChars,
+        bakedChars
+    );
+    ASSERT(bakeRes > 0);
+
+    return {
+        .ttf = ttfBuffer,
+        .fontBitmap = fontBitmapBuffer,
+        .fontBitmapWidth = fontBitmapWidth,
+        .fontBitmapHeight = fontBitmapHeight,
+        .startChar = startChar,
+        .bakedChars = bakedChars
+    };
+}
+
+// 24 bytes per glyph instead of a full matrix and 6 texcoords,
+// textvs.hlsl expands the quad corners from SV_VertexID and applies the ortho projection
+struct GlyphInstance
+{
+    // x0, y0, x1, y1 in pixels, origin at the bottom left
+    Vec4 screenRect;
+    // s0, t0, s1, t1 as unorm16, t0 is the top of the glyph in the atlas
+    uint16_t uvRect[4];
+};
+static_assert(sizeof(GlyphInstance) == 24);
+
+uint16_t PackUnorm16(float value)
+{
+    float clamped = fminf(fmaxf(value, 0.0f), 1.0f);
+    return (uint16_t)((clamped * 65535.0f) + 0.5f);
+}
+
+GlyphInstance GetGlyphInstanceFromQuad(const stbtt_aligned_quad& quad, float baseLine)
+{
+    // NOTE: 
+    // STB quad origin = top left and extends to bottom right
+    // OUR quad origin = bottom left and extends to top right, so do OUR the orthographic coords
+    // ^ y
+    // |
+    // -----> x
+    // instead of:
+    // -----> x
+    // |
+    // v y
+
+    float baseLineDiff = quad.y0 - baseLine;
+    float height = quad.y1 - quad.y0;
+    float correctedYPos = (baseLine - (height + baseLineDiff));
+
+    return {
+        .screenRect = { quad.x0, correctedYPos, quad.x1, correctedYPos + height },
+        .uvRect = { PackUnorm16(quad.s0), PackUnorm16(quad.t0), PackUnorm16(quad.s1), PackUnorm16(quad.t1) }
+    };
+}
+
+size_t GenerateGlyphInstancesForStringAt(BakedCharMap& bakedCharMap, StringView text, Vec2 position, 
+    GlyphInstance* instanceData, size_t maxInstances, size_t startIndex)
+{
+    size_t genCount = 0;
+    size_t readIndex = 0;
+    size_t writeIndex = startIndex;
+    while(writeIndex < maxInstances && readIndex < text.len) {
+        int c = (int)text.start[readIndex];
+        stbtt_aligned_quad quad = {};
+        stbtt_GetBakedQuad(
+            bakedCharMap.bakedChars,
+            bakedCharMap.fontBitmapWidth,
+            bakedCharMap.fontBitmapHeight,
+            c - bakedCharMap.startChar,
+            &position.x, 
+            &position.y,
+            &quad,
+            1
+        );
+        instanceData[writeIndex] = GetGlyphInstanceFromQuad(quad, position.y);
+
+        genCount++;
+        writeIndex++;
+        readIndex++;
+    }
+
+    return genCount;
+}
+
+// decodes one UTF-8 sequence at *index and advances past it, malformed input becomes U+FFFD
+uint32_t DecodeUtf8(const char* text, size_t len, size_t* index)
+{
+    const unsigned char* bytes = (const unsigned char*)text;
+    size_t i = *index;
+    uint32_t lead = bytes[i];
+    if(lead < 0x80) {
+        *index = i + 1;
+        return lead;
+    }
+
+    uint32_t followCount = 0;
+    uint32_t codepoint = 0;
+    uint32_t minCodepoint = 0;
+    if((lead & 0xE0) == 0xC0) {
+        followCount = 1;
+        codepoint = lead & 0x1F;
+        minCodepoint = 0x80;
+    }
+    else if((lead & 0xF0) == 0xE0) {
+        followCount = 2;
+        codepoint = lead & 0x0F;
+        minCodepoint = 0x800;
+    }
+    else if((lead & 0xF8) == 0xF0) {
+        followCount = 3;
+        codepoint = lead & 0x07;
+        minCodepoint = 0x10000;
+    }
+    else {
+        *index = i + 1;
+        return 0xFFFD;
+    }
+
+    for(uint32_t j = 1; j <= followCount; j++) {
+        if(i + j >= len || (bytes[i + j] & 0xC0) != 0x80) {
+            *index = i + j;
+            return 0xFFFD;
+        }
+        codepoint = (codepoint << 6) | (bytes[i + j] & 0x3F);
+    }
+    *index = i + followCount + 1;
+
+    // overlong encodings, surrogates and anything past the unicode range
+    if(codepoint < minCodepoint || (codepoint >= 0xD800 && codepoint <= 0xDFFF) || codepoint > 0x10FFFF)
+        return 0xFFFD;
+    return codepoint;
+}
+
+// writes up to 4 bytes and returns the count
+uint32_t EncodeUtf8(uint32_t codepoint, char* dest)
+{
+    if(codepoint < 0x80) {
+        dest[0] = (char)codepoint;
+        return 1;
+    }
+    if(codepoint < 0x800) {
+        dest[0] = (char)(0xC0 | (codepoint >> 6));
+        dest[1] = (char)(0x80 | (codepoint & 0x3F));
+        return 2;
+    }
+    if(codepoint < 0x10000) {
+        dest[0] = (char)(0xE0 | (codepoint >> 12));
+        dest[1] = (char)(0x80 | ((codepoint >> 6) & 0x3F));
+        dest[2] = (char)(0x80 | (codepoint & 0x3F));
+        return 3;
+    }
+    dest[0] = (char)(0xF0 | (codepoint >> 18));
+    dest[1] = (char)(0x80 | ((codepoint >> 12) & 0x3F));
+    dest[2] = (char)(0x80 | ((codepoint >> 6) & 0x3F));
+    dest[3] = (char)(0x80 | (codepoint & 0x3F));
+    return 4;
+}
+
+uint32_t CountUtf8Codepoints(StringView text)
+{
+    uint32_t count = 0;
+    size_t index = 0;
+    while(index < text.len) {
+        DecodeUtf8(text.start, text.len, &index);
+        count++;
+    }
+    return count;
+}
+
+constexpr uint32_t InvalidGlyphSlot = 0xFFFFFFFF;
+constexpr uint32_t MaxGlyphAtlasBatch = 256;
+constexpr int GlyphAtlasPadding = 1;
+// a glyph can go into a shelf up to this many pixels taller than itself
+constexpr int GlyphAtlasShelfSlack = 8;
+
+struct AtlasGlyph
+{
+    uint32_t codepoint;
+    uint32_t shelfIndex;
+    // the columns taken in the shelf, left padding included
+    int x;
+    int width;
+    uint32_t lastUsedFrame;
+    // neighbours in the lru list, most recently used first
+    uint32_t prevSlot;
+    uint32_t nextSlot;
+    stbtt_packedchar packed;
+};
+
+// a row of glyphs filled left to right
+struct AtlasShelf
+{
+    int y;
+    int height;
+    int usedWidth;
+    uint32_t glyphCount;
+    // columns changed since the last upload, empty when dirtyX0 >= dirtyX1
+    int dirtyX0;
+    int dirtyX1;
+};
+
+// columns of an evicted glyph that new glyphs can reuse
+struct AtlasSpan
+{
+    uint32_t shelfIndex;
+    int x;
+    int width;
+};
+
+// glyphs are rasterized on first use with the stbtt packing api into shelves,
+// when it is full the least recently used glyphs that weren't used this frame are evicted
+struct GlyphAtlas
+{
+    ByteBuffer ttf;
+    stbtt_fontinfo fontInfo;
+    stbtt_pack_context packContext;
+    float fontHeight;
+    unsigned char* bitmap;
+    int width;
+    int height;
+
+    AtlasGlyph* glyphs;
+    uint32_t* freeGlyphSlots;
+    uint32_t freeGlyphSlotCount;
+    uint32_t maxGlyphs;
+    uint32_t lruHeadSlot;
+    uint32_t lruTailSlot;
+    // open addressing codepoint -> glyph slot with linear probing
+    uint32_t* glyphHashSlots;
+    uint32_t glyphHashShift;
+    uint32_t glyphHashMask;
+
+    AtlasShelf* shelves;
+    uint32_t shelfCount;
+    uint32_t maxShelves;
+    int nextShelfY;
+    AtlasSpan* freeSpans;
+    uint32_t freeSpanCount;
+
+    uint32_t frameIndex;
+    // bumped on every eviction so cached glyph instances know their uvs might be stale
+    uint32_t evictionCount;
+    uint32_t rasterizedGlyphCount;
+    uint32_t replacementCodepoint;
+
+    // scratch for one batch of new glyphs
+    int* batchCodepoints;
+    stbrp_rect* batchRects;
+    stbtt_packedchar* batchPacked;
+};
+
+GlyphAtlas CreateGlyphAtlas(const char* fontName, float fontHeight, int width, int height, uint32_t maxGlyphs)
+{
+    GlyphAtlas atlas = {
+        .ttf = ReadAllBytesFromFile(fontName, 0),
+        .fontHeight = fontHeight,
+        .width = width,
+        .height = height,
+        .maxGlyphs = maxGlyphs,
+        .lruHeadSlot = InvalidGlyphSlot,
+        .lruTailSlot = InvalidGlyphSlot
+    };
+    int initRes = stbtt_InitFont(&atlas.fontInfo, atlas.ttf.data, stbtt_GetFontOffsetForIndex(atlas.ttf.data, 0));
+    ASSERT(initRes != 0);
+
+    atlas.bitmap = (unsigned char*)calloc(1, width * height);
+    ASSERT(atlas.bitmap != nullptr);
+    int packRes = stbtt_PackBegin(&atlas.packContext, atlas.bitmap, width, height, width, GlyphAtlasPadding, nullptr);
+    ASSERT(packRes != 0);
+
+    atlas.glyphs = (AtlasGlyph*)calloc(1, maxGlyphs * sizeof(AtlasGlyph));
+    atlas.freeGlyphSlots = (uint32_t*)calloc(1, maxGlyphs * sizeof(uint32_t));
+    atlas.freeSpans = (AtlasSpan*)calloc(1, maxGlyphs * sizeof(AtlasSpan));
+    ASSERT(atlas.glyphs != nullptr && atlas.freeGlyphSlots != nullptr && atlas.freeSpans != nullptr);
+    for(uint32_t i = 0; i < maxGlyphs; i++)
+        atlas.freeGlyphSlots[i] = maxGlyphs - 1 - i;
+    atlas.freeGlyphSlotCount = maxGlyphs;
+
+    // at most half full keeps the probe sequences short
+    uint32_t hashBits = 1;
+    while((1u << hashBits) < maxGlyphs * 2)
+        hashBits++;
+    atlas.glyphHashShift = 32 - hashBits;
+    atlas.glyphHashMask = (1u << hashBits) - 1;
+    atlas.glyphHashSlots = (uint32_t*)malloc((atlas.glyphHashMask + 1) * sizeof(uint32_t));
+    ASSERT(atlas.glyphHashSlots != nullptr);
+    memset(atlas.glyphHashSlots, 0xFF, (atlas.glyphHashMask + 1) * sizeof(uint32_t));
+
+    // every shelf is at least one padded pixel row high
+    atlas.maxShelves = (uint32_t)(height / (GlyphAtlasPadding + 1));
+    atlas.shelves = (AtlasShelf*)calloc(1, atlas.maxShelves * sizeof(AtlasShelf));
+    ASSERT(atlas.shelves != nullptr);
+
+    atlas.batchCodepoints = (int*)calloc(1, MaxGlyphAtlasBatch * sizeof(int));
+    atlas.batchRects = (stbrp_rect*)calloc(1, MaxGlyphAtlasBatch * sizeof(stbrp_rect));
+    atlas.batchPacked = (stbtt_packedchar*)calloc(1, MaxGlyphAtlasBatch * sizeof(stbtt_packedchar));
+    ASSERT(atlas.batchCodepoints != nullptr && atlas.batchRects != nullptr && atlas.batchPacked != nullptr);
+
+    atlas.replacementCodepoint = stbtt_FindGlyphIndex(&atlas.fontInfo, 0xFFFD) != 0 ? 0xFFFD : '?';
+    return atlas;
+}
+
+void FreeGlyphAtlas(GlyphAtlas* atlas)
+{
+    stbtt_PackEnd(&atlas->packContext);
+    free(atlas->ttf.data);
+    free(atlas->bitmap);
+    free(atlas->glyphs);
+    free(atlas->freeGlyphSlots);
+    free(atlas->freeSpans);
+    free(atlas->glyphHashSlots);
+    free(atlas->shelves);
+    free(atlas->batchCodepoints);
+    free(atlas->batchRects);
+    free(atlas->batchPacked);
+    *atlas = {};
+}
+
+// glyphs used from here on are protected from eviction until the next call
+void BeginGlyphAtlasFrame(GlyphAtlas* atlas)
+{
+    atlas->frameIndex++;
+}
+
+uint32_t GetGlyphHashIndex(const GlyphAtlas* atlas, uint32_t codepoint)
+{
+    return (codepoint * 0x9E3779B1u) >> atlas->glyphHashShift;
+}
+
+uint32_t FindAtlasGlyph(const GlyphAtlas* atlas, uint32_t codepoint)
+{
+    uint32_t hashIndex = GetGlyphHashIndex(atlas, codepoint);
+    while(true) {
+        uint32_t slot = atlas->glyphHashSlots[hashIndex];
+        if(slot == InvalidGlyphSlot || atlas->glyphs[slot].codepoint == codepoint)
+            return slot;
+        hashIndex = (hashIndex + 1) & atlas->glyphHashMask;
+    }
+}
+
+void InsertAtlasGlyphHash(GlyphAtlas* atlas, uint32_t slot)
+{
+    uint32_t hashIndex = GetGlyphHashIndex(atlas, atlas->glyphs[slot].codepoint);
+    while(atlas->glyphHashSlots[hashIndex] != InvalidGlyphSlot)
+        hashIndex = (hashIndex + 1) & atlas->glyphHashMask;
+    atlas->glyphHashSlots[hashIndex] = slot;
+}
+
+void RemoveAtlasGlyphHash(GlyphAtlas* atlas, uint32_t slot)
+{
+    uint32_t hashIndex = GetGlyphHashIndex(atlas, atlas->glyphs[slot].codepoint);
+    while(atlas->glyphHashSlots[hashIndex] != slot)
+        hashIndex = (hashIndex + 1) & atlas->glyphHashMask;
+
+    // shift the following entries back into the hole instead of leaving a tombstone
+    uint32_t holeIndex = hashIndex;
+    uint32_t nextIndex = (holeIndex + 1) & atlas->glyphHashMask;
+    while(atlas->glyphHashSlots[nextIndex] != InvalidGlyphSlot) {
+        uint32_t nextSlot = atlas->glyphHashSlots[nextIndex];
+        uint32_t homeIndex = GetGlyphHashIndex(atlas, atlas->glyphs[nextSlot].codepoint);
+        // the entry can move if its home isn't cyclically between the hole and its position
+        if(((nextIndex - homeIndex) & atlas->glyphHashMask) >= ((nextIndex - holeIndex) & atlas->glyphHashMask)) {
+            atlas->glyphHashSlots[holeIndex] = nextSlot;
+            holeIndex = nextIndex;
+        }
+        nextIndex = (nextIndex + 1) & atlas->glyphHashMask;
+    }
+    atlas->glyphHashSlots[holeIndex] = InvalidGlyphSlot;
+}
+
+void UnlinkAtlasGlyphLru(GlyphAtlas* atlas, uint32_t slot)
+{
+    AtlasGlyph& glyph = atlas->glyphs[slot];
+    if(glyph.prevSlot != InvalidGlyphSlot)
+        atlas->glyphs[glyph.prevSlot].nextSlot = glyph.nextSlot;
+    else
+        atlas->lruHeadSlot = glyph.nextSlot;
+    if(glyph.nextSlot != InvalidGlyphSlot)
+        atlas->glyphs[glyph.nextSlot].prevSlot = glyph.prevSlot;
+    else
+        atlas->lruTailSlot = glyph.prevSlot;
+}
+
+void LinkAtlasGlyphLruHead(GlyphAtlas* atlas, uint32_t slot)
+{
+    AtlasGlyph& glyph = atlas->glyphs[slot];
+    glyph.prevSlot = InvalidGlyphSlot;
+    glyph.nextSlot = atlas->lruHeadSlot;
+    if(atlas->lruHeadSlot != InvalidGlyphSlot)
+        atlas->glyphs[atlas->lruHeadSlot].prevSlot = slot;
+    else
+        atlas->lruTailSlot = slot;
+    atlas->lruHeadSlot = slot;
+}
+
+void MarkAtlasShelfDirty(AtlasShelf* shelf, int x0, int x1)
+{
+    if(shelf->dirtyX0 >= shelf->dirtyX1) {
+        shelf->dirtyX0 = x0;
+        shelf->dirtyX1 = x1;
+    }
+    else {
+        shelf->dirtyX0 = x0 < shelf->dirtyX0 ? x0 : shelf->dirtyX0;
+        shelf->dirtyX1 = x1 > shelf->dirtyX1 ? x1 : shelf->dirtyX1;
+    }
+}
+
+// returns false when the least recently used glyph was used this frame
+bool EvictLeastRecentlyUsedAtlasGlyph(GlyphAtlas* atlas)
+{
+    uint32_t slot = atlas->lruTailSlot;
+    if(slot == InvalidGlyphSlot || atlas->glyphs[slot].lastUsedFrame == atlas->frameIndex)
+        return false;
+
+    AtlasGlyph& glyph = atlas->glyphs[slot];
+    RemoveAtlasGlyphHash(atlas, slot);
+    UnlinkAtlasGlyphLru(atlas, slot);
+    atlas->freeGlyphSlots[atlas->freeGlyphSlotCount++] = slot;
+
+    // the left and top padding of new glyphs is never written, so clear the old pixels
+    AtlasShelf& shelf = atlas->shelves[glyph.shelfIndex];
+    for(int y = shelf.y; y < shelf.y + shelf.height; y++)
+        memset(atlas->bitmap + (y * atlas->width) + glyph.x, 0, glyph.width);
+    MarkAtlasShelfDirty(&shelf, glyph.x, glyph.x + glyph.width);
+
+    shelf.glyphCount--;
+    if(shelf.glyphCount == 0) {
+        // an empty shelf takes glyphs of any height that fits again, drop its spans
+        shelf.usedWidth = 0;
+        for(uint32_t i = 0; i < atlas->freeSpanCount; i++) {
+            if(atlas->freeSpans[i].shelfIndex == glyph.shelfIndex)
+                atlas->freeSpans[i--] = atlas->freeSpans[--atlas->freeSpanCount];
+        }
+    }
+    else {
+        // merge with the free neighbours so wider glyphs fit in the hole
+        int spanX0 = glyph.x;
+        int spanX1 = glyph.x + glyph.width;
+        for(uint32_t i = 0; i < atlas->freeSpanCount; i++) {
+            const AtlasSpan& span = atlas->freeSpans[i];
+            if(span.shelfIndex != glyph.shelfIndex || (span.x + span.width != spanX0 && span.x != spanX1))
+                continue;
+            spanX0 = span.x < spanX0 ? span.x : spanX0;
+            spanX1 = span.x + span.width > spanX1 ? span.x + span.width : spanX1;
+            atlas->freeSpans[i--] = atlas->freeSpans[--atlas->freeSpanCount];
+        }
+
+        if(spanX1 == shelf.usedWidth) {
+            shelf.usedWidth = spanX0;
+        }
+        else if(atlas->freeSpanCount < atlas->maxGlyphs) {
+            // when out of span records the columns only come back once the shelf is empty
+            atlas->freeSpans[atlas->freeSpanCount++] = {
+                .shelfIndex = glyph.shelfIndex,
+                .x = spanX0,
+                .width = spanX1 - spanX0
+            };
+        }
+    }
+
+    glyph = {};
+    atlas->evictionCount++;
+    return true;
+}
+
+bool AllocateAtlasRectOnce(GlyphAtlas* atlas, int width, int height, AtlasGlyph* glyph)
+{
+    // the narrowest hole left by an evicted glyph in a shelf of the right height
+    uint32_t bestSpanIndex = InvalidGlyphSlot;
+    for(uint32_t i = 0; i < atlas->freeSpanCount; i++) {
+        const AtlasSpan& span = atlas->freeSpans[i];
+        int shelfHeight = atlas->shelves[span.shelfIndex].height;
+        if(span.width < width || shelfHeight < height || shelfHeight > height + GlyphAtlasShelfSlack)
+            continue;
+        if(bestSpanIndex == InvalidGlyphSlot || span.width < atlas->freeSpans[bestSpanIndex].width)
+            bestSpanIndex = i;
+    }
+    if(bestSpanIndex != InvalidGlyphSlot) {
+        AtlasSpan& span = atlas->freeSpans[bestSpanIndex];
+        glyph->shelfIndex = span.shelfIndex;
+        glyph->x = span.x;
+        span.x += width;
+        span.width -= width;
+        if(span.width == 0)
+            span = atlas->freeSpans[--atlas->freeSpanCount];
+        return true;
+    }
+
+    // the end of a shelf of the right height, or any empty shelf that is tall enough
+    for(uint32_t i = 0; i < atlas->shelfCount; i++) {
+        AtlasShelf& shelf = atlas->shelves[i];
+        bool isFitting = shelf.height >= height && (shelf.height <= height + GlyphAtlasShelfSlack || shelf.glyphCount == 0);
+        if(isFitting && shelf.usedWidth + width <= atlas->width) {
+            glyph->shelfIndex = i;
+            glyph->x = shelf.usedWidth;
+            shelf.usedWidth += width;
+            return true;
+        }
+    }
+
+    // empty shelves at the bottom go back to the free space so it can be split up differently
+    // merged away shelves have no height and sit inside the shelf above, so the free space starts below the last one kept
+    while(atlas->shelfCount > 0 && atlas->shelves[atlas->shelfCount - 1].glyphCount == 0)
+        atlas->shelfCount--;
+    if(atlas->shelfCount > 0)
+        atlas->nextShelfY = atlas->shelves[atlas->shelfCount - 1].y + atlas->shelves[atlas->shelfCount - 1].height;
+    else
+        atlas->nextShelfY = 0;
+
+    // rounded up so glyphs of similar height share shelves
+    int shelfHeight = (height + 3) & ~3;
+    if(atlas->nextShelfY + shelfHeight <= atlas->height && atlas->shelfCount < atlas->maxShelves) {
+        atlas->shelves[atlas->shelfCount] = {
+            .y = atlas->nextShelfY,
+            .height = shelfHeight,
+            .usedWidth = width
+        };
+        glyph->shelfIndex = atlas->shelfCount;
+        glyph->x = 0;
+        atlas->shelfCount++;
+        atlas->nextShelfY += shelfHeight;
+        return true;
+    }
+
+    // neighbouring empty shelves merge into a taller one, the ones merged away stay behind with no height
+    for(uint32_t i = 0; i < atlas->shelfCount; i++) {
+        int mergedHeight = 0;
+        uint32_t endIndex = i;
+        while(endIndex < atlas->shelfCount && atlas->shelves[endIndex].glyphCount == 0 && mergedHeight < height)
+            mergedHeight += atlas->shelves[endIndex++].height;
+        if(mergedHeight < height) {
+            i = endIndex;
+            continue;
+        }
+
+        atlas->shelves[i].height = mergedHeight;
+        for(uint32_t j = i + 1; j < endIndex; j++)
+            atlas->shelves[j].height = 0;
+        AtlasShelf& shelf = atlas->shelves[i];
+        glyph->shelfIndex = i;
+        glyph->x = 0;
+        shelf.usedWidth = width;
+        return true;
+    }
+
+    // last resort before evicting, a shelf that is too tall for the glyph
+    for(uint32_t i = 0; i < atlas->freeSpanCount; i++) {
+        AtlasSpan& span = atlas->freeSpans[i];
+        if(span.width >= width && atlas->shelves[span.shelfIndex].height >= height) {
+            glyph->shelfIndex = span.shelfIndex;
+            glyph->x = span.x;
+            span.x += width;
+            span.width -= width;
+            if(span.width == 0)
+                span = atlas->freeSpans[--atlas->freeSpanCount];
+            return true;
+        }
+    }
+    for(uint32_t i = 0; i < atlas->shelfCount; i++) {
+        AtlasShelf& shelf = atlas->shelves[i];
+        if(shelf.height >= height && shelf.usedWidth + width <= atlas->width) {
+            glyph->shelfIndex = i;
+            glyph->x = shelf.usedWidth;
+            shelf.usedWidth += width;
+            return true;
+        }
+    }
+    return false;
+}
+
+bool AllocateAtlasRect(GlyphAtlas* atlas, int width, int height, AtlasGlyph* glyph)
+{
+    if(width > atlas->width || height > atlas->height)
+        return false;
+
+    // evicted neighbours merge with the end of their shelf, so evicting keeps making room
+    while(!AllocateAtlasRectOnce(atlas, width, height, glyph)) {
+        if(!EvictLeastRecentlyUsedAtlasGlyph(atlas))
+            return false;
+    }
+    glyph->width = width;
+    atlas->shelves[glyph->shelfIndex].glyphCount++;
+    return true;
+}
+
+// rasterizes glyphs that aren't in the atlas yet, the codepoints have to be unique and present in the font
+void AddAtlasGlyphs(GlyphAtlas* atlas, const uint32_t* codepoints, uint32_t count)
+{
+    for(uint32_t batchStart = 0; batchStart < count; batchStart += MaxGlyphAtlasBatch) {
+        uint32_t batchCount = count - batchStart < MaxGlyphAtlasBatch ? count - batchStart : MaxGlyphAtlasBatch;
+        for(uint32_t i = 0; i < batchCount; i++)
+            atlas->batchCodepoints[i] = (int)codepoints[batchStart + i];
+
+        stbtt_pack_range range = {
+            .font_size = atlas->fontHeight,
+            .array_of_unicode_codepoints = atlas->batchCodepoints,
+            .num_chars = (int)batchCount,
+            .chardata_for_range = atlas->batchPacked
+        };
+        stbtt_PackFontRangesGatherRects(&atlas->packContext, &atlas->fontInfo, &range, 1, atlas->batchRects);
+
+        // shelf allocation instead of stbtt_PackFontRangesPackRects so glyphs can be added and evicted over time
+        uint32_t batchSlots[MaxGlyphAtlasBatch];
+        for(uint32_t i = 0; i < batchCount; i++) {
+            stbrp_rect& rect = atlas->batchRects[i];
+            rect.was_packed = 0;
+            if(atlas->freeGlyphSlotCount == 0 && !EvictLeastRecentlyUsedAtlasGlyph(atlas))
+                continue;
+
+            AtlasGlyph glyph = {
+                .codepoint = (uint32_t)atlas->batchCodepoints[i],
+                .lastUsedFrame = atlas->frameIndex
+            };
+            if(!AllocateAtlasRect(atlas, rect.w, rect.h, &glyph))
+                continue;
+
+            // linked right away, glyphs used this frame are never evicted for the rest of the batch
+            uint32_t slot = atlas->freeGlyphSlots[--atlas->freeGlyphSlotCount];
+            atlas->glyphs[slot] = glyph;
+            LinkAtlasGlyphLruHead(atlas, slot);
+            batchSlots[i] = slot;
+            rect.x = (stbrp_coord)glyph.x;
+            rect.y = (stbrp_coord)atlas->shelves[glyph.shelfIndex].y;
+            rect.was_packed = 1;
+        }
+        stbtt_PackFontRangesRenderIntoRects(&atlas->packContext, &atlas->fontInfo, &range, 1, atlas->batchRects);
+
+        for(uint32_t i = 0; i < batchCount; i++) {
+            if(!atlas->batchRects[i].was_packed)
+                continue;
+            AtlasGlyph& glyph = atlas->glyphs[batchSlots[i]];
+            glyph.packed = atlas->batchPacked[i];
+            InsertAtlasGlyphHash(atlas, batchSlots[i]);
+            MarkAtlasShelfDirty(&atlas->shelves[glyph.shelfIndex], glyph.x, glyph.x + glyph.width);
+            atlas->rasterizedGlyphCount++;
+        }
+    }
+}
+
+uint32_t ResolveAtlasCodepoint(GlyphAtlas* atlas, uint32_t codepoint)
+{
+    if(codepoint == 0 || stbtt_FindGlyphIndex(&atlas->fontInfo, (int)codepoint) == 0)
+        return atlas->replacementCodepoint;
+    return codepoint;
+}
+
+// looks the glyph up and protects it from eviction this frame
+uint32_t UseAtlasGlyph(GlyphAtlas* atlas, uint32_t codepoint)
+{
+    uint32_t slot = FindAtlasGlyph(atlas, codepoint);
+    if(slot == InvalidGlyphSlot) {
+        codepoint = ResolveAtlasCodepoint(atlas, codepoint);
+        slot = FindAtlasGlyph(atlas, codepoint);
+    }
+    if(slot != InvalidGlyphSlot && atlas->glyphs[slot].lastUsedFrame != atlas->frameIndex) {
+        atlas->glyphs[slot].lastUsedFrame = atlas->frameIndex;
+        UnlinkAtlasGlyphLru(atlas, slot);
+        LinkAtlasGlyphLruHead(atlas, slot);
+    }
+    return slot;
+}
+
+// UTF-8 version of GenerateGlyphInstancesForStringAt, missing glyphs are rasterized in one batch before the layout
+size_t GenerateGlyphInstancesForUtf8StringAt(GlyphAtlas* atlas, StringView text, Vec2 position, 
+    GlyphInstance* instanceData, size_t maxInstances, size_t startIndex)
+{
+    uint32_t missingCodepoints[MaxGlyphAtlasBatch];
+    uint32_t missingCount = 0;
+    size_t readIndex = 0;
+    while(readIndex < text.len) {
+        uint32_t codepoint = DecodeUtf8(text.start, text.len, &readIndex);
+        if(UseAtlasGlyph(atlas, codepoint) != InvalidGlyphSlot)
+            continue;
+
+        codepoint = ResolveAtlasCodepoint(atlas, codepoint);
+        bool isQueued = false;
+        for(uint32_t i = 0; i < missingCount && !isQueued; i++)
+            isQueued = missingCodepoints[i] == codepoint;
+        if(isQueued)
+            continue;
+        missingCodepoints[missingCount++] = codepoint;
+        if(missingCount == MaxGlyphAtlasBatch) {
+            AddAtlasGlyphs(atlas, missingCodepoints, missingCount);
+            missingCount = 0;
+        }
+    }
+    AddAtlasGlyphs(atlas, missingCodepoints, missingCount);
+
+    size_t genCount = 0;
+    size_t writeIndex = startIndex;
+    readIndex = 0;
+    while(writeIndex < maxInstances && readIndex < text.len) {
+        uint32_t slot = UseAtlasGlyph(atlas, DecodeUtf8(text.start, text.len, &readIndex));
+        // only when the atlas couldn't fit it, an empty glyph keeps the instance count equal to the codepoint count
+        if(slot == InvalidGlyphSlot) {
+            instanceData[writeIndex] = {};
+        }
+        else {
+            stbtt_aligned_quad quad = {};
+            float baseLine = position.y;
+            stbtt_GetPackedQuad(&atlas->glyphs[slot].packed, atlas->width, atlas->height, 0, 
+                &position.x, &position.y, &quad, 1);
+            instanceData[writeIndex] = GetGlyphInstanceFromQuad(quad, baseLine);
+        }
+
+        genCount++;
+        writeIndex++;
+    }
+
+    return genCount;
+}
+
+// a prewarmed atlas cached next to the font, so later launches map it instead of rasterizing the range again
+constexpr uint32_t GlyphAtlasCacheMagic = 0x43544C41; // "ALTC"
+constexpr uint32_t GlyphAtlasCacheVersion = 1;
+constexpr size_t GlyphAtlasCacheAlignment = 16;
+
+// followed by the shelves, the glyphs and the bitmap rows down to nextShelfY, each 16-byte aligned
+struct GlyphAtlasCacheHeader
+{
+    uint32_t magic;
+    uint32_t version;
+    // the font contents rather than its write time, the same font installed elsewhere can share a cache
+    uint64_t fontHash;
+    float fontHeight;
+    uint32_t firstCodepoint;
+    uint32_t codepointCount;
+    int32_t width;
+    int32_t height;
+    int32_t nextShelfY;
+    uint32_t shelfCount;
+    uint32_t glyphCount;
+};
+
+void GetGlyphAtlasCacheFilename(const char* fontName, float fontHeight, uint32_t firstCodepoint, uint32_t codepointCount,
+    char* dest, size_t destLen)
+{
+    snprintf(dest, destLen, "%s.%gpx.%x-%x.atlas", fontName, fontHeight, firstCodepoint, firstCodepoint + codepointCount - 1);
+}
+
+size_t GetGlyphAtlasCacheByteSize(uint32_t shelfCount, uint32_t glyphCount, int width, int rowCount)
+{
+    return AlignUp(sizeof(GlyphAtlasCacheHeader), GlyphAtlasCacheAlignment) +
+        AlignUp(shelfCount * sizeof(AtlasShelf), GlyphAtlasCacheAlignment) +
+        AlignUp(glyphCount * sizeof(AtlasGlyph), GlyphAtlasCacheAlignment) +
+        ((size_t)width * rowCount);
+}
+
+bool WriteGlyphAtlasCache(const char* cacheFilename, const GlyphAtlas& atlas, uint64_t fontHash, 
+    uint32_t firstCodepoint, uint32_t codepointCount)
+{
+    uint32_t glyphCount = atlas.maxGlyphs - atlas.freeGlyphSlotCount;
+    size_t totalByteSize = GetGlyphAtlasCacheByteSize(atlas.shelfCount, glyphCount, atlas.width, atlas.nextShelfY);
+    unsigned char* buffer = (unsigned char*)calloc(1, totalByteSize);
+    ASSERT(buffer != nullptr);
+
+    *(GlyphAtlasCacheHeader*)buffer = {
+        .magic = GlyphAtlasCacheMagic,
+        .version = GlyphAtlasCacheVersion,
+        .fontHash = fontHash,
+        .fontHeight = atlas.fontHeight,
+        .firstCodepoint = firstCodepoint,
+        .codepointCount = codepointCount,
+        .width = atlas.width,
+        .height = atlas.height,
+        .nextShelfY = atlas.nextShelfY,
+        .shelfCount = atlas.shelfCount,
+        .glyphCount = glyphCount
+    };
+
+    size_t writeAt = AlignUp(sizeof(GlyphAtlasCacheHeader), GlyphAtlasCacheAlignment);
+    memcpy(buffer + writeAt, atlas.shelves, atlas.shelfCount * sizeof(AtlasShelf));
+    writeAt += AlignUp(atlas.shelfCount * sizeof(AtlasShelf), GlyphAtlasCacheAlignment);
+    AtlasGlyph* glyphs = (AtlasGlyph*)(buffer + writeAt);
+    uint32_t glyphIndex = 0;
+    for(uint32_t slot = atlas.lruHeadSlot; slot != InvalidGlyphSlot; slot = atlas.glyphs[slot].nextSlot)
+        glyphs[glyphIndex++] = atlas.glyphs[slot];
+    writeAt += AlignUp(glyphCount * sizeof(AtlasGlyph), GlyphAtlasCacheAlignment);
+    memcpy(buffer + writeAt, atlas.bitmap, (size_t)atlas.width * atlas.nextShelfY);
+
+    bool res = WriteAllBytesToFile(cacheFilename, buffer, totalByteSize);
+    free(buffer);
+    return res;
+}
+
+// the records are copied in as they are, anything pointing outside the atlas would later be cleared or uploaded
+// out of bounds, so a stale or edited file has to be rejected
+bool AreGlyphAtlasCacheRecordsValid(const GlyphAtlasCacheHeader& header, const AtlasShelf* shelves,
+    const AtlasGlyph* glyphs)
+{
+    bool isValid = true;
+    for(uint32_t i = 0; i < header.shelfCount && isValid; i++) {
+        const AtlasShelf& shelf = shelves[i];
+        isValid = shelf.y >= 0 && shelf.height >= 0 && shelf.y <= header.nextShelfY &&
+            shelf.height <= header.nextShelfY - shelf.y &&
+            shelf.usedWidth >= 0 && shelf.usedWidth <= header.width;
+    }
+
+    uint32_t* shelfGlyphCounts = (uint32_t*)calloc(1, (header.shelfCount + 1) * sizeof(uint32_t));
+    ASSERT(shelfGlyphCounts != nullptr);
+    for(uint32_t i = 0; i < header.glyphCount && isValid; i++) {
+        const AtlasGlyph& glyph = glyphs[i];
+        isValid = glyph.shelfIndex < header.shelfCount && glyph.x >= 0 && glyph.width >= 0 &&
+            glyph.x <= shelves[glyph.shelfIndex].usedWidth && glyph.width <= shelves[glyph.shelfIndex].usedWidth - glyph.x;
+        if(isValid)
+            shelfGlyphCounts[glyph.shelfIndex]++;
+    }
+    // eviction frees a shelf when its count drops to zero, so the counts have to match the glyphs
+    for(uint32_t i = 0; i < header.shelfCount && isValid; i++)
+        isValid = shelfGlyphCounts[i] == shelves[i].glyphCount;
+    free(shelfGlyphCounts);
+    return isValid;
+}
+
+bool LoadGlyphAtlasFromCache(const char* cacheFilename, GlyphAtlas* atlas, uint64_t fontHash,
+    uint32_t firstCodepoint, uint32_t codepointCount)
+{
+    MappedFile cacheFile = MapFileForReading(cacheFilename);
+    if(cacheFile.len < sizeof(GlyphAtlasCacheHeader)) {
+        FreeMappedFile(&cacheFile);
+        return false;
+    }
+
+    const GlyphAtlasCacheHeader* header = (const GlyphAtlasCacheHeader*)cacheFile.data;
+    bool isValid = header->magic == GlyphAtlasCacheMagic && header->version == GlyphAtlasCacheVersion &&
+        header->fontHash == fontHash && header->fontHeight == atlas->fontHeight &&
+        header->firstCodepoint == firstCodepoint && header->codepointCount == codepointCount &&
+        header->width == atlas->width && header->height == atlas->height && header->nextShelfY >= 0 && header->nextShelfY <= atlas->height &&
+        header->shelfCount <= atlas->maxShelves && header->glyphCount <= atlas->maxGlyphs &&
+        cacheFile.len >= GetGlyphAtlasCacheByteSize(header->shelfCount, header->glyphCount, header->width, header->nextShelfY);
+    // only an atlas nothing was added to yet can take the cached state
+    if(!isValid || atlas->shelfCount != 0) {
+        FreeMappedFile(&cacheFile);
+        return false;
+    }
+
+    size_t shelvesAt = AlignUp(sizeof(GlyphAtlasCacheHeader), GlyphAtlasCacheAlignment);
+    size_t glyphsAt = shelvesAt + AlignUp(header->shelfCount * sizeof(AtlasShelf), GlyphAtlasCacheAlignment);
+    const AtlasShelf* shelves = (const AtlasShelf*)(cacheFile.data + shelvesAt);
+    const AtlasGlyph* glyphs = (const AtlasGlyph*)(cacheFile.data + glyphsAt);
+    if(!AreGlyphAtlasCacheRecordsValid(*header, shelves, glyphs)) {
+        FreeMappedFile(&cacheFile);
+        return false;
+    }
+
+    memcpy(atlas->shelves, shelves, header->shelfCount * sizeof(AtlasShelf));
+    atlas->shelfCount = header->shelfCount;
+    atlas->nextShelfY = header->nextShelfY;
+
+    // the slots, hash and lru links are rebuilt, only the placement and metrics come from the file
+    // written most recently used first, linked back in reverse to keep that order
+    for(uint32_t i = header->glyphCount; i-- > 0;) {
+        uint32_t slot = atlas->freeGlyphSlots[--atlas->freeGlyphSlotCount];
+        atlas->glyphs[slot] = glyphs[i];
+        atlas->glyphs[slot].lastUsedFrame = atlas->frameIndex;
+        LinkAtlasGlyphLruHead(atlas, slot);
+        InsertAtlasGlyphHash(atlas, slot);
+    }
+    size_t readAt = glyphsAt + AlignUp(header->glyphCount * sizeof(AtlasGlyph), GlyphAtlasCacheAlignment);
+
+    memcpy(atlas->bitmap, cacheFile.data + readAt, (size_t)header->width * header->nextShelfY);
+    for(uint32_t i = 0; i < atlas->shelfCount; i++)
+        MarkAtlasShelfDirty(&atlas->shelves[i], 0, atlas->width);
+
+    FreeMappedFile(&cacheFile);
+    return true;
+}
+
+// rasterizes [firstCodepoint, firstCodepoint + codepointCount) up front so the first frames don't have to,
+// returns true when it came from the cache
+bool PrewarmGlyphAtlas(GlyphAtlas* atlas, uint32_t firstCodepoint, uint32_t codepointCount, const char* cacheFilename)
+{
+    uint64_t fontHash = HashBytes(atlas->ttf.data, atlas->ttf.len);
+    if(LoadGlyphAtlasFromCache(cacheFilename, atlas, fontHash, firstCodepoint, codepointCount))
+        return true;
+
+    uint32_t* codepoints = (uint32_t*)calloc(1, (codepointCount + 1) * sizeof(uint32_t));
+    ASSERT(codepoints != nullptr);
+    uint32_t presentCount = 0;
+    bool hasReplacement = false;
+    for(uint32_t i = 0; i < codepointCount; i++) {
+        uint32_t codepoint = firstCodepoint + i;
+        if(stbtt_FindGlyphIndex(&atlas->fontInfo, (int)codepoint) == 0 || FindAtlasGlyph(atlas, codepoint) != InvalidGlyphSlot)
+            continue;
+        codepoints[presentCount++] = codepoint;
+        hasReplacement |= codepoint == atlas->replacementCodepoint;
+    }
+    if(!hasReplacement && FindAtlasGlyph(atlas, atlas->replacementCodepoint) == InvalidGlyphSlot)
+        codepoints[presentCount++] = atlas->replacementCodepoint;
+    AddAtlasGlyphs(atlas, codepoints, presentCount);
+    free(codepoints);
+
+    // a range that didn't fit would be cached with holes
+    if(atlas->evictionCount == 0 && atlas->freeSpanCount == 0) {
+        if(!WriteGlyphAtlasCache(cacheFilename, *atlas, fontHash, firstCodepoint, codepointCount))
+            printf("failed to write glyph atlas cache %s\n", cacheFilename);
+    }
+    return false;
+}
+
+// signed distance field glyphs stay sharp at any scale, so one atlas rasterized at a single height serves every text size
+constexpr int SdfGlyphPadding = 6;
+// the edge is at 128 and the value falls off by 128 / padding per pixel outside of it
+constexpr unsigned char SdfOnEdgeValue = 128;
+constexpr float SdfPixelDistScale = (float)SdfOnEdgeValue / (float)SdfGlyphPadding;
+constexpr uint32_t SdfRasterizeBatchSize = 8;
+
+struct SdfGlyph
+{
+    uint32_t codepoint;
+    // bitmap rect in atlas pixels, the distance padding included
+    int x;
+    int y;
+    int width;
+    int height;
+    // bitmap offset from the pen position at the atlas font height, y goes down
+    int xoff;
+    int yoff;
+    float xadvance;
+};
+
+struct SdfAtlas
+{
+    ByteBuffer ttf;
+    stbtt_fontinfo fontInfo;
+    // the height the distance fields were rasterized at
+    float fontHeight;
+    float scale;
+    unsigned char* bitmap;
+    int width;
+    int height;
+    // sorted by codepoint for the lookup
+    SdfGlyph* glyphs;
+    uint32_t glyphCount;
+    uint32_t replacementCodepoint;
+};
+
+struct SdfGlyphBitmap
+{
+    unsigned char* pixels;
+    int width;
+    int height;
+};
+
+struct SdfAtlasBuildContext
+{
+    SdfAtlas* atlas;
+    const uint32_t* codepoints;
+    SdfGlyphBitmap* bitmaps;
+};
+
+// stb_truetype only reads the font info and mallocs the output, so every glyph can go to a different thread
+void RasterizeSdfGlyphsTask(void* data, uint32_t start, uint32_t end, int threadIndex)
+{
+    SdfAtlasBuildContext* context = (SdfAtlasBuildContext*)data;
+    SdfAtlas* atlas = context->atlas;
+    for(uint32_t i = start; i < end; i++) {
+        SdfGlyph& glyph = atlas->glyphs[i];
+        SdfGlyphBitmap& bitmap = context->bitmaps[i];
+        glyph.codepoint = context->codepoints[i];
+        bitmap.pixels = stbtt_GetCodepointSDF(&atlas->fontInfo, atlas->scale, (int)glyph.codepoint, SdfGlyphPadding,
+            SdfOnEdgeValue, SdfPixelDistScale, &bitmap.width, &bitmap.height, &glyph.xoff, &glyph.yoff);
+        // empty glyphs like the space have no bitmap but still advance
+        if(bitmap.pixels == nullptr)
+            bitmap = {};
+        glyph.width = bitmap.width;
+        glyph.height = bitmap.height;
+
+        int advanceWidth = 0;
+        int leftSideBearing = 0;
+        stbtt_GetCodepointHMetrics(&atlas->fontInfo, (int)glyph.codepoint, &advanceWidth, &leftSideBearing);
+        glyph.xadvance = (float)advanceWidth * atlas->scale;
+    }
+}
+
+// every glyph has its own rect, so the copies don't overlap
+void CopySdfGlyphsToAtlasTask(void* data, uint32_t start, uint32_t end, int threadIndex)
+{
+    SdfAtlasBuildContext* context = (SdfAtlasBuildContext*)data;
+    SdfAtlas* atlas = context->atlas;
+    for(uint32_t i = start; i < end; i++) {
+        const SdfGlyph& glyph = atlas->glyphs[i];
+        SdfGlyphBitmap& bitmap = context->bitmaps[i];
+        for(int row = 0; row < glyph.height; row++) {
+            memcpy(atlas->bitmap + ((size_t)(glyph.y + row) * atlas->width) + glyph.x,
+                bitmap.pixels + ((size_t)row * bitmap.width), glyph.width);
+        }
+        stbtt_FreeSDF(bitmap.pixels, nullptr);
+        bitmap = {};
+    }
+}
+
+// rasterizes the distance fields on the pool and then packs them on the calling thread,
+// the placement only depends on the glyph sizes and the codepoint order so the atlas is the same for any thread count
+SdfAtlas CreateSdfAtlas(TaskPool* pool, const char* fontName, float fontHeight, const uint32_t* codepoints, 
+    uint32_t codepointCount, int width)
+{
+    SdfAtlas atlas = {
+        .ttf = ReadAllBytesFromFile(fontName, 0),
+        .fontHeight = fontHeight,
+        .width = width,
+        .glyphCount = codepointCount
+    };
+    int initRes = stbtt_InitFont(&atlas.fontInfo, atlas.ttf.data, stbtt_GetFontOffsetForIndex(atlas.ttf.data, 0));
+    ASSERT(initRes != 0);
+    atlas.scale = stbtt_ScaleForPixelHeight(&atlas.fontInfo, fontHeight);
+    atlas.replacementCodepoint = stbtt_FindGlyphIndex(&atlas.fontInfo, 0xFFFD) != 0 ? 0xFFFD : '?';
+
+    atlas.glyphs = (SdfGlyph*)calloc(1, codepointCount * sizeof(SdfGlyph));
+    SdfGlyphBitmap* bitmaps = (SdfGlyphBitmap*)calloc(1, codepointCount * sizeof(SdfGlyphBitmap));
+    uint64_t* keys = (uint64_t*)calloc(1, codepointCount * sizeof(uint64_t));
+    uint32_t* order = (uint32_t*)calloc(1, codepointCount * sizeof(uint32_t));
+    uint64_t* tempKeys = (uint64_t*)calloc(1, codepointCount * sizeof(uint64_t));
+    uint32_t* tempOrder = (uint32_t*)calloc(1, codepointCount * sizeof(uint32_t));
+    ASSERT(atlas.glyphs != nullptr && bitmaps != nullptr && keys != nullptr && order != nullptr && 
+        tempKeys != nullptr && tempOrder != nullptr);
+
+    SdfAtlasBuildContext context = {
+        .atlas = &atlas,
+        .codepoints = codepoints,
+        .bitmaps = bitmaps
+    };
+    ParallelFor(pool, codepointCount, SdfRasterizeBatchSize, RasterizeSdfGlyphsTask, &context);
+
+    // tallest first and stable, so equal heights keep the codepoint order and end up on the same shelves
+    for(uint32_t i = 0; i < codepointCount; i++) {
+        keys[i] = (uint64_t)(0xFFFF - atlas.glyphs[i].height);
+        order[i] = i;
+    }
+    RadixSortKeyValues(pool, keys, order, tempKeys, tempOrder, codepointCount, 16);
+
+    int shelfX = 0;
+    int shelfY = 0;
+    int shelfHeight = 0;
+    for(uint32_t i = 0; i < codepointCount; i++) {
+        SdfGlyph& glyph = atlas.glyphs[order[i]];
+        ASSERT(glyph.width + GlyphAtlasPadding <= width);
+        if(shelfX + glyph.width + GlyphAtlasPadding > width) {
+            shelfY += shelfHeight;
+            shelfX = 0;
+            shelfHeight = 0;
+        }
+        glyph.x = shelfX + GlyphAtlasPadding;
+        glyph.y = shelfY + GlyphAtlasPadding;
+        shelfX += glyph.width + GlyphAtlasPadding;
+        if(glyph.height + GlyphAtlasPadding > shelfHeight)
+            shelfHeight = glyph.height + GlyphAtlasPadding;
+    }
+    atlas.height = (int)AlignUp((size_t)(shelfY + shelfHeight + GlyphAtlasPadding), 4);
+    atlas.bitmap = (unsigned char*)calloc(1, (size_t)width * atlas.height);
+    ASSERT(atlas.bitmap != nullptr);
+    ParallelFor(pool, codepointCount, SdfRasterizeBatchSize, CopySdfGlyphsToAtlasTask, &context);
+
+    // sort the glyphs by codepoint for FindSdfGlyph, duplicates keep their input order
+    for(uint32_t i = 0; i < codepointCount; i++) {
+        keys[i] = atlas.glyphs[i].codepoint;
+        order[i] = i;
+    }
+    RadixSortKeyValues(pool, keys, order, tempKeys, tempOrder, codepointCount, 21);
+    SdfGlyph* sortedGlyphs = (SdfGlyph*)calloc(1, codepointCount * sizeof(SdfGlyph));
+    ASSERT(sortedGlyphs != nullptr);
+    for(uint32_t i = 0; i < codepointCount; i++)
+        sortedGlyphs[i] = atlas.glyphs[order[i]];
+    free(atlas.glyphs);
+    atlas.glyphs = sortedGlyphs;
+
+    free(tempOrder);
+    free(tempKeys);
+    free(order);
+    free(keys);
+    free(bitmaps);
+    return atlas;
+}
+
+void FreeSdfAtlas(SdfAtlas* atlas)
+{
+    free(atlas->ttf.data);
+    free(atlas->bitmap);
+    free(atlas->glyphs);
+    *atlas = {};
+}
+
+const SdfGlyph* FindSdfGlyph(const SdfAtlas& atlas, uint32_t codepoint)
+{
+    uint32_t low = 0;
+    uint32_t high = atlas.glyphCount;
+    while(low < high) {
+        uint32_t mid = low + ((high - low) / 2);
+        if(atlas.glyphs[mid].codepoint < codepoint)
+            low = mid + 1;
+        else
+            high = mid;
+    }
+    return (low < atlas.glyphCount && atlas.glyphs[low].codepoint == codepoint) ? &atlas.glyphs[low] : nullptr;
+}
+
+// same instances as the bitmap atlas, only the quads are scaled from the atlas font height to fontHeight
+size_t GenerateSdfGlyphInstancesForUtf8StringAt(const SdfAtlas& atlas, StringView text, Vec2 position, float fontHeight,
+    GlyphInstance* instanceData, size_t maxInstances, size_t startIndex)
+{
+    float textScale = fontHeight / atlas.fontHeight;
+    float invWidth = 1.0f / (float)atlas.width;
+    float invHeight = 1.0f / (float)atlas.height;
+
+    size_t genCount = 0;
+    size_t writeIndex = startIndex;
+    size_t readIndex = 0;
+    while(writeIndex < maxInstances && readIndex < text.len) {
+        const SdfGlyph* glyph = FindSdfGlyph(atlas, DecodeUtf8(text.start, text.len, &readIndex));
+        if(glyph == nullptr)
+            glyph = FindSdfGlyph(atlas, atlas.replacementCodepoint);
+
+        if(glyph == nullptr) {
+            instanceData[writeIndex] = {};
+        }
+        else {
+            float x0 = position.x + ((float)glyph->xoff * textScale);
+            float y1 = position.y - ((float)glyph->yoff * textScale);
+            instanceData[writeIndex] = {
+                .screenRect = { x0, y1 - ((float)glyph->height * textScale), x0 + ((float)glyph->width * textScale), y1 },
+                .uvRect = {
+                    PackUnorm16((float)glyph->x * invWidth), PackUnorm16((float)glyph->y * invHeight),
+                    PackUnorm16((float)(glyph->x + glyph->width) * invWidth), PackUnorm16((float)(glyph->y + glyph->height) * invHeight)
+                }
+            };
+            position.x += glyph->xadvance * textScale;
+        }
+
+        genCount++;
+        writeIndex++;
+    }
+
+    return genCount;
+}
+
+// the previous 112 byte instance, only kept as the baseline for --bench-text
+struct MatrixGlyphInstance
+{
+    Mat4 xformMat;
+    Vec2 texCoords[6];
+};
+
+size_t GenerateMatrixGlyphInstancesForStringAt(BakedCharMap& bakedCharMap, StringView text, Vec2 position, 
+    const Mat4& orthoProjMat, MatrixGlyphInstance* instanceData, size_t maxInstances, size_t startIndex)
+{
+    size_t genCount = 0;
+    for(size_t readIndex = 0; startIndex + genCount < maxInstances && readIndex < text.len; readIndex++) {
+        stbtt_aligned_quad quad = {};
+        stbtt_GetBakedQuad(bakedCharMap.bakedChars, bakedCharMap.fontBitmapWidth, bakedCharMap.fontBitmapHeight,
+            (int)text.start[readIndex] - bakedCharMap.startChar, &position.x, &position.y, &quad, 1);
+
+        float height = quad.y1 - quad.y0;
+        float correctedYPos = position.y - (height + (quad.y0 - position.y));
+        Transform transform = {
+            .position = { quad.x0, correctedYPos, 0.0f },
+            .scale =    { quad.x1 - quad.x0, height, 1.0f }
+        };
+        instanceData[startIndex + genCount] = {
+            .xformMat = orthoProjMat * GetModelMatFromTransform(transform),
+            .texCoords = {
+                { quad.s0, quad.t0 }, { quad.s0, quad.t1 }, { quad.s1, quad.t1 },
+                { quad.s1, quad.t1 }, { quad.s1, quad.t0 }, { quad.s0, quad.t0 }
+            }
+        };
+        genCount++;
+    }
+    return genCount;
+}
+
+constexpr uint32_t MaxTextRuns = 16;
+constexpr uint32_t MaxTextRunLen = 128;
+
+// one line of text, its glyphs are only regenerated when the contents or position change
+struct TextRun
+{
+    char text[MaxTextRunLen];
+    uint32_t len;
+    Vec2 position;
+    uint32_t firstGlyph;
+    uint32_t glyphCount;
+    // the atlas eviction count when the glyphs were generated
+    uint32_t atlasEvictionCount;
+    bool isDirty;
+};
+
+// retained glyph instances of all runs packed back to back in run order,
+// put the runs that change every frame last so their length changes shift as few glyphs as possible
+struct TextLayoutCache
+{
+    TextRun runs[MaxTextRuns];
+    uint32_t runCount;
+    GlyphInstance* glyphs;
+    uint32_t glyphCount;
+    uint32_t maxGlyphs;
+};
+
+struct GlyphRange
+{
+    uint32_t first;
+    uint32_t count;
+};
+
+TextLayoutCache CreateTextLayoutCache(uint32_t maxGlyphs)
+{
+    GlyphInstance* glyphs = (GlyphInstance*)calloc(1, maxGlyphs * sizeof(GlyphInstance));
+    ASSERT(glyphs != nullptr);
+    return {
+        .glyphs = glyphs,
+        .maxGlyphs = maxGlyphs
+    };
+}
+
+void FreeTextLayoutCache(TextLayoutCache* cache)
+{
+    free(cache->glyphs);
+    *cache = {};
+}
+
+// runIndex can be at most one past the last run, which appends a new run
+void GenerateTextRun(TextLayoutCache* cache, GlyphAtlas* atlas, uint32_t runIndex)
+{
+    TextRun& run = cache->runs[runIndex];
+    StringView text = { .start = run.text, .len = run.len };
+
+    // one glyph per codepoint, clamped to what is left in the cache
+    uint32_t otherGlyphCount = cache->glyphCount - run.glyphCount;
+    uint32_t newGlyphCount = CountUtf8Codepoints(text);
+    if(otherGlyphCount + newGlyphCount > cache->maxGlyphs)
+        newGlyphCount = cache->maxGlyphs - otherGlyphCount;
+
+    if(newGlyphCount != run.glyphCount) {
+        // shift the glyphs of the following runs, their data moved so they have to be uploaded again
+        uint32_t tailFirst = run.firstGlyph + run.glyphCount;
+        memmove(cache->glyphs + run.firstGlyph + newGlyphCount, cache->glyphs + tailFirst,
+            (cache->glyphCount - tailFirst) * sizeof(GlyphInstance));
+        for(uint32_t i = runIndex + 1; i < cache->runCount; i++) {
+            TextRun& nextRun = cache->runs[i];
+            nextRun.firstGlyph = (nextRun.firstGlyph - run.glyphCount) + newGlyphCount;
+            nextRun.isDirty = true;
+        }
+        cache->glyphCount = otherGlyphCount + newGlyphCount;
+        run.glyphCount = newGlyphCount;
+    }
+
+    GenerateGlyphInstancesForUtf8StringAt(atlas, text, run.position, cache->glyphs, 
+        run.firstGlyph + newGlyphCount, run.firstGlyph);
+    run.atlasEvictionCount = atlas->evictionCount;
+    run.isDirty = true;
+}
+
+// runIndex can be at most one past the last run, which appends a new run
+void SetTextRun(TextLayoutCache* cache, GlyphAtlas* atlas, uint32_t runIndex, StringView text, Vec2 position)
+{
+    ASSERT(runIndex <= cache->runCount && runIndex < MaxTextRuns);
+    if(runIndex == cache->runCount) {
+        cache->runs[runIndex] = { .firstGlyph = cache->glyphCount };
+        cache->runCount++;
+    }
+
+    TextRun& run = cache->runs[runIndex];
+    uint32_t len = text.len < MaxTextRunLen ? (uint32_t)text.len : MaxTextRunLen;
+    // a cut inside a multi-byte character backs up to its lead byte
+    if(len < text.len) {
+        while(len > 0 && ((uint8_t)text.start[len] & 0xC0) == 0x80)
+            len--;
+    }
+    bool isSameText = len == run.len && memcmp(run.text, text.start, len) == 0;
+    if(isSameText && position.x == run.position.x && position.y == run.position.y)
+        return;
+
+    memcpy(run.text, text.start, len);
+    run.len = len;
+    run.position = position;
+    GenerateTextRun(cache, atlas, runIndex);
+}
+
+// coalesces neighbouring dirty runs into glyph ranges to upload and clears their dirty flags,
+// call it after the last SetTextRun of the frame
+uint32_t TakeTextLayoutDirtyRanges(TextLayoutCache* cache, GlyphAtlas* atlas, GlyphRange* ranges)
+{
+    // unchanged runs don't touch their glyphs, so new glyphs of this frame can have evicted them.
+    // a regenerated run's glyphs are in use this frame and can't be evicted again, so this settles
+    bool isAnyRunStale = true;
+    while(isAnyRunStale) {
+        isAnyRunStale = false;
+        for(uint32_t i = 0; i < cache->runCount; i++) {
+            if(cache->runs[i].atlasEvictionCount != atlas->evictionCount) {
+                GenerateTextRun(cache, atlas, i);
+                isAnyRunStale = true;
+            }
+        }
+    }
+
+    uint32_t rangeCount = 0;
+    for(uint32_t i = 0; i < cache->runCount; i++) {
+        TextRun& run = cache->runs[i];
+        if(!run.isDirty)
+            continue;
+        run.isDirty = false;
+        if(run.glyphCount == 0)
+            continue;
+
+        if(rangeCount > 0 && ranges[rangeCount - 1].first + ranges[rangeCount - 1].count == run.firstGlyph)
+            ranges[rangeCount - 1].count += run.glyphCount;
+        else
+            ranges[rangeCount++] = { .first = run.firstGlyph, .count = run.glyphCount };
+    }
+    return rangeCount;
+}
+
+// headless benchmark of the per-frame glyph generation for both instance formats, run with --bench-text
+void RunTextBenchmark(size_t glyphsPerFrame, int frameCount)
+{
+    BakedCharMap bakedCharMap = BakeCharMapForFont("res/CourierPrime-Regular.ttf", 32.0f);
+    float viewportWidth = 1280.0f;
+    float viewportHeight = 720.0f;
+    Mat4 orthoProjMat = OrthoProjMat4(0.0f, viewportWidth, 0.0f, viewportHeight, 0.1f, 100.0f);
+
+    // lines of all printable ASCII characters
+    const size_t lineLen = 96;
+    char line[lineLen + 1] = {};
+    for(size_t i = 0; i < lineLen; i++)
+        line[i] = (char)(32 + (i % 95));
+    StringView lineView = { .start = line, .len = lineLen };
+
+    GlyphInstance* glyphInstances = (GlyphInstance*)calloc(1, glyphsPerFrame * sizeof(GlyphInstance));
+    MatrixGlyphInstance* matrixInstances = (MatrixGlyphInstance*)calloc(1, glyphsPerFrame * sizeof(MatrixGlyphInstance));
+    ASSERT(glyphInstances != nullptr && matrixInstances != nullptr);
+
+    double compactSeconds = 0.0;
+    double matrixSeconds = 0.0;
+    for(int frame = 0; frame < frameCount; frame++) {
+        uint64_t startTicks = GetTicks();
+        size_t glyphCount = 0;
+        for(float y = 10.0f; glyphCount < glyphsPerFrame; y += 1.0f) {
+            glyphCount += GenerateGlyphInstancesForStringAt(bakedCharMap, lineView, { 0.0f, y }, 
+                glyphInstances, glyphsPerFrame, glyphCount);
+        }
+        compactSeconds += TicksToSeconds(GetTicks() - startTicks);
+
+        startTicks = GetTicks();
+        glyphCount = 0;
+        for(float y = 10.0f; glyphCount < glyphsPerFrame; y += 1.0f) {
+            glyphCount += GenerateMatrixGlyphInstancesForStringAt(bakedCharMap, lineView, { 0.0f, y }, orthoProjMat, 
+                matrixInstances, glyphsPerFrame, glyphCount);
+        }
+        matrixSeconds += TicksToSeconds(GetTicks() - startTicks);
+    }
+
+    // expand the compact instances the way textvs.hlsl does and compare against the matrix path
+    const Vec2 quadCorners[6] = { { 0.0f, 1.0f }, { 0.0f, 0.0f }, { 1.0f, 0.0f }, { 1.0f, 0.0f }, { 1.0f, 1.0f }, { 0.0f, 1.0f } };
+    float maxPositionError = 0.0f;
+    float maxTexCoordError = 0.0f;
+    for(size_t i = 0; i < glyphsPerFrame; i++) {
+        const GlyphInstance& glyph = glyphInstances[i];
+        for(int vertexId = 0; vertexId < 6; vertexId++) {
+            Vec2 corner = quadCorners[vertexId];
+            Vec4 compactPosition = orthoProjMat * Vec4{
+                glyph.screenRect.x + ((glyph.screenRect.z - glyph.screenRect.x) * corner.x),
+                glyph.screenRect.y + ((glyph.screenRect.w - glyph.screenRect.y) * corner.y),
+                0.0f, 1.0f
+            };
+            Vec4 matrixPosition = matrixInstances[i].xformMat * Vec4{ corner.x, corner.y, 0.0f, 1.0f };
+            maxPositionError = fmaxf(maxPositionError, fabsf(compactPosition.x - matrixPosition.x));
+            maxPositionError = fmaxf(maxPositionError, fabsf(compactPosition.y - matrixPosition.y));
+
+            float u = (corner.x == 0.0f ? glyph.uvRect[0] : glyph.uvRect[2]) / 65535.0f;
+            float v = (corner.y == 0.0f ? glyph.uvRect[3] : glyph.uvRect[1]) / 65535.0f;
+            maxTexCoordError = fmaxf(maxTexCoordError, fabsf(u - matrixInstances[i].texCoords[vertexId].x));
+            maxTexCoordError = fmaxf(maxTexCoordError, fabsf(v - matrixInstances[i].texCoords[vertexId].y));
+        }
+    }
+
+    printf("text %zu glyphs/frame: compact %.3f ms (%zu KB), matrix %.3f ms (%zu KB)\n", glyphsPerFrame,
+        (compactSeconds * 1000.0) / frameCount, (glyphsPerFrame * sizeof(GlyphInstance)) / 1024,
+        (matrixSeconds * 1000.0) / frameCount, (glyphsPerFrame * sizeof(MatrixGlyphInstance)) / 1024);
+    printf("max clip space error %g, max texcoord error %g texels\n", maxPositionError,
+        maxTexCoordError * bakedCharMap.fontBitmapWidth);
+
+    free(matrixInstances);
+    free(glyphInstances);
+    FreeBakedCharMap(&bakedCharMap);
+}
+
+// headless benchmark of the cached HUD layout against regenerating and uploading every glyph each frame,
+// the staging copies stand in for the buffer uploads, run with --bench-text-cache
+bool RunTextLayoutCacheBenchmark(uint32_t maxGlyphs, int frameCount)
+{
+    GlyphAtlas atlas = CreateGlyphAtlas("res/CourierPrime-Regular.ttf", 32.0f, 1024, 1024, 4096);
+    TextLayoutCache cache = CreateTextLayoutCache(maxGlyphs);
+    GlyphInstance* fullGlyphs = (GlyphInstance*)calloc(1, maxGlyphs * sizeof(GlyphInstance));
+    GlyphInstance* fullStaging = (GlyphInstance*)calloc(1, maxGlyphs * sizeof(GlyphInstance));
+    GlyphInstance* cacheStaging = (GlyphInstance*)calloc(1, maxGlyphs * sizeof(GlyphInstance));
+    ASSERT(fullGlyphs != nullptr && fullStaging != nullptr && cacheStaging != nullptr);
+
+    // same lines and update rates as the HUD, only the frame time changes every frame
+    const int lineCount = 5;
+    const Vec2 linePositions[lineCount] = { { 30.0f, 110.0f }, { 30.0f, 35.0f }, { 30.0f, 10.0f }, { 30.0f, 60.0f }, { 30.0f, 85.0f } };
+    char lines[lineCount][MaxTextRunLen] = {};
+    GlyphRange ranges[MaxTextRuns] = {};
+    uint32_t rngState = 0x7E47;
+
+    double fullSeconds = 0.0;
+    double cacheSeconds = 0.0;
+    uint64_t cacheUploadedBytes = 0;
+    uint32_t fullGlyphCount = 0;
+    for(int frame = 0; frame < frameCount; frame++) {
+        BeginGlyphAtlasFrame(&atlas);
+        snprintf(lines[0], MaxTextRunLen, "mesh: 0 degenerate, 0 zero area, 0 bad indices, 0 non-manifold, 0 holes, 0 duplicates");
+        snprintf(lines[1], MaxTextRunLen, "bounds: (-1.37 -0.98 -0.85)-(1.37 0.98 0.85) r 1.71");
+        snprintf(lines[2], MaxTextRunLen, "pick: none");
+        snprintf(lines[3], MaxTextRunLen, "model vertices: 2904, visible objects: %d/8 (0 occluded), instances: 0", 4 + ((frame / 10) % 5));
+        float deltaTime = 0.0166f + (RandomFloat01(&rngState) * 0.002f);
+        snprintf(lines[4], MaxTextRunLen, "frame time: %f (%d FPS)", deltaTime, (int)(1.0f / deltaTime));
+
+        uint64_t startTicks = GetTicks();
+        fullGlyphCount = 0;
+        for(int i = 0; i < lineCount; i++) {
+            fullGlyphCount += (uint32_t)GenerateGlyphInstancesForUtf8StringAt(&atlas, StringViewFromCString(lines[i]), 
+                linePositions[i], fullGlyphs, maxGlyphs, fullGlyphCount);
+        }
+        memcpy(fullStaging, fullGlyphs, maxGlyphs * sizeof(GlyphInstance));
+        fullSeconds += TicksToSeconds(GetTicks() - startTicks);
+
+        startTicks = GetTicks();
+        for(int i = 0; i < lineCount; i++)
+            SetTextRun(&cache, &atlas, i, StringViewFromCString(lines[i]), linePositions[i]);
+        uint32_t rangeCount = TakeTextLayoutDirtyRanges(&cache, &atlas, ranges);
+        for(uint32_t i = 0; i < rangeCount; i++) {
+            memcpy(cacheStaging + ranges[i].first, cache.glyphs + ranges[i].first, ranges[i].count * sizeof(GlyphInstance));
+            cacheUploadedBytes += ranges[i].count * sizeof(GlyphInstance);
+        }
+        cacheSeconds += TicksToSeconds(GetTicks() - startTicks);
+    }
+
+    bool isMatching = cache.glyphCount == fullGlyphCount && 
+        memcmp(cacheStaging, fullStaging, fullGlyphCount * sizeof(GlyphInstance)) == 0;
+
+    // a line too long for a run with a 2 byte character across the cut
+    char longLine[MaxTextRunLen + 1] = {};
+    memset(longLine, 'a', MaxTextRunLen - 1);
+    EncodeUtf8(0xE9, longLine + MaxTextRunLen - 1);
+    SetTextRun(&cache, &atlas, lineCount, { .start = longLine, .len = sizeof(longLine) }, { 30.0f, 135.0f });
+    bool isCutAtCharacter = cache.runs[lineCount].len == MaxTextRunLen - 1;
+    printf("text layout %u glyphs: full %.2f us (%zu bytes), cached %.2f us (%.0f bytes), %.2f us saved per frame, %s\n",
+        fullGlyphCount, (fullSeconds * 1000000.0) / frameCount, maxGlyphs * sizeof(GlyphInstance),
+        (cacheSeconds * 1000000.0) / frameCount, (double)cacheUploadedBytes / frameCount,
+        ((fullSeconds - cacheSeconds) * 1000000.0) / frameCount, isMatching ? "uploads match" : "UPLOAD MISMATCH");
+    printf("long line cut at %u of %u bytes%s\n", cache.runs[lineCount].len, (uint32_t)sizeof(longLine),
+        isCutAtCharacter ? "" : ", INSIDE A CHARACTER");
+
+    free(cacheStaging);
+    free(fullStaging);
+    free(fullGlyphs);
+    FreeTextLayoutCache(&cache);
+    FreeGlyphAtlas(&atlas);
+    return isMatching && isCutAtCharacter;
+}
+
+// places a glyph rect without rasterizing anything, for checking the shelf allocator on its own
+uint32_t AddAtlasGlyphRect(GlyphAtlas* atlas, uint32_t codepoint, int width, int height)
+{
+    if(atlas->freeGlyphSlotCount == 0 && !EvictLeastRecentlyUsedAtlasGlyph(atlas))
+        return InvalidGlyphSlot;
+    AtlasGlyph glyph = {
+        .codepoint = codepoint,
+        .lastUsedFrame = atlas->frameIndex
+    };
+    if(!AllocateAtlasRect(atlas, width, height, &glyph))
+        return InvalidGlyphSlot;
+    uint32_t slot = atlas->freeGlyphSlots[--atlas->freeGlyphSlotCount];
+    atlas->glyphs[slot] = glyph;
+    LinkAtlasGlyphLruHead(atlas, slot);
+    InsertAtlasGlyphHash(atlas, slot);
+    return slot;
+}
+
+// merges two empty shelves for a taller glyph, then empties the shelves below it and adds a new shelf,
+// which has to start below the merged one instead of at the shelves merged away into it
+bool CheckGlyphAtlasShelfMerge()
+{
+    const int atlasWidth = 32;
+    const int shelfHeight = 8;
+    GlyphAtlas atlas = CreateGlyphAtlas("res/CourierPrime-Regular.ttf", 32.0f, atlasWidth, 5 * shelfHeight, 16);
+    BeginGlyphAtlasFrame(&atlas);
+
+    // one full width glyph per shelf fills the atlas
+    uint32_t rowSlots[5];
+    for(uint32_t i = 0; i < ARRAY_LEN(rowSlots); i++)
+        rowSlots[i] = AddAtlasGlyphRect(&atlas, 'a' + i, atlasWidth, shelfHeight);
+
+    // shelves 1 and 2 are evicted first and merge for a glyph of twice the height
+    BeginGlyphAtlasFrame(&atlas);
+    UseAtlasGlyph(&atlas, 'a');
+    UseAtlasGlyph(&atlas, 'd');
+    UseAtlasGlyph(&atlas, 'e');
+    EvictLeastRecentlyUsedAtlasGlyph(&atlas);
+    EvictLeastRecentlyUsedAtlasGlyph(&atlas);
+    uint32_t tallSlot = AddAtlasGlyphRect(&atlas, 'f', atlasWidth, 2 * shelfHeight);
+
+    // emptying the bottom shelves pops them together with the merged away one
+    BeginGlyphAtlasFrame(&atlas);
+    UseAtlasGlyph(&atlas, 'a');
+    UseAtlasGlyph(&atlas, 'f');
+    EvictLeastRecentlyUsedAtlasGlyph(&atlas);
+    EvictLeastRecentlyUsedAtlasGlyph(&atlas);
+    uint32_t refillSlot = AddAtlasGlyphRect(&atlas, 'g', atlasWidth, shelfHeight + 4);
+
+    bool isPlaced = rowSlots[0] != InvalidGlyphSlot && rowSlots[4] != InvalidGlyphSlot && 
+        tallSlot != InvalidGlyphSlot && refillSlot != InvalidGlyphSlot;
+    uint32_t overlapCount = 0;
+    for(uint32_t slotA = 0; slotA < atlas.maxGlyphs; slotA++) {
+        const AtlasGlyph& glyphA = atlas.glyphs[slotA];
+        if(glyphA.codepoint == 0 || FindAtlasGlyph(&atlas, glyphA.codepoint) != slotA)
+            continue;
+        const AtlasShelf& shelfA = atlas.shelves[glyphA.shelfIndex];
+        for(uint32_t slotB = slotA + 1; slotB < atlas.maxGlyphs; slotB++) {
+            const AtlasGlyph& glyphB = atlas.glyphs[slotB];
+            if(glyphB.codepoint == 0 || FindAtlasGlyph(&atlas, glyphB.codepoint) != slotB)
+                continue;
+            const AtlasShelf& shelfB = atlas.shelves[glyphB.shelfIndex];
+            if(glyphA.x < glyphB.x + glyphB.width && glyphB.x < glyphA.x + glyphA.width && 
+                shelfA.y < shelfB.y + shelfB.height && shelfB.y < shelfA.y + shelfA.height)
+                overlapCount++;
+        }
+    }
+
+    printf("shelf merge: %u shelves, next shelf at %d, %u overlapping glyphs%s\n", atlas.shelfCount, atlas.nextShelfY, 
+        overlapCount, isPlaced ? "" : ", failed to place a glyph");
+    FreeGlyphAtlas(&atlas);
+    return isPlaced && overlapCount == 0;
+}
+
+// headless benchmark of adding new glyphs every frame to an atlas too small for all of them,
+// so the shelves keep getting evicted, run with --bench-atlas
+bool RunGlyphAtlasBenchmark(int atlasSize, uint32_t newGlyphsPerFrame, int frameCount)
+{
+    GlyphAtlas atlas = CreateGlyphAtlas("res/CourierPrime-Regular.ttf", 32.0f, atlasSize, atlasSize, 4096);
+
+    // every codepoint of the basic multilingual plane the font has a glyph for
+    uint32_t* fontCodepoints = (uint32_t*)calloc(1, 0x10000 * sizeof(uint32_t));
+    ASSERT(fontCodepoints != nullptr);
+    uint32_t fontCodepointCount = 0;
+    for(uint32_t codepoint = 0x21; codepoint < 0x10000; codepoint++) {
+        if(stbtt_FindGlyphIndex(&atlas.fontInfo, (int)codepoint) != 0)
+            fontCodepoints[fontCodepointCount++] = codepoint;
+    }
+
+    size_t maxTextLen = newGlyphsPerFrame * 4;
+    char* text = (char*)calloc(1, maxTextLen);
+    GlyphInstance* instances = (GlyphInstance*)calloc(1, newGlyphsPerFrame * sizeof(GlyphInstance));
+    uint8_t* coverage = (uint8_t*)calloc(1, atlasSize * atlasSize);
+    ASSERT(text != nullptr && instances != nullptr && coverage != nullptr);
+
+    double totalSeconds = 0.0;
+    double maxFrameSeconds = 0.0;
+    uint32_t missingCount = 0;
+    uint32_t nextCodepoint = 0;
+    for(int frame = 0; frame < frameCount; frame++) {
+        BeginGlyphAtlasFrame(&atlas);
+        size_t textLen = 0;
+        uint32_t frameGlyphCount = newGlyphsPerFrame < fontCodepointCount ? newGlyphsPerFrame : fontCodepointCount;
+        for(uint32_t i = 0; i < frameGlyphCount; i++) {
+            textLen += EncodeUtf8(fontCodepoints[nextCodepoint], text + textLen);
+            nextCodepoint = (nextCodepoint + 1) % fontCodepointCount;
+        }
+
+        uint64_t startTicks = GetTicks();
+        GenerateGlyphInstancesForUtf8StringAt(&atlas, { .start = text, .len = textLen }, { 0.0f, 100.0f }, 
+            instances, newGlyphsPerFrame, 0);
+        double frameSeconds = TicksToSeconds(GetTicks() - startTicks);
+        totalSeconds += frameSeconds;
+        maxFrameSeconds = frameSeconds > maxFrameSeconds ? frameSeconds : maxFrameSeconds;
+
+        // everything used this frame has to be resident
+        size_t readIndex = 0;
+        while(readIndex < textLen) {
+            if(FindAtlasGlyph(&atlas, DecodeUtf8(text, textLen, &readIndex)) == InvalidGlyphSlot)
+                missingCount++;
+        }
+    }
+
+    // no two resident glyphs may overlap, padding included
+    uint32_t overlapCount = 0;
+    uint32_t residentCount = 0;
+    for(uint32_t slot = 0; slot < atlas.maxGlyphs; slot++) {
+        const AtlasGlyph& glyph = atlas.glyphs[slot];
+        if(glyph.codepoint == 0 || FindAtlasGlyph(&atlas, glyph.codepoint) != slot)
+            continue;
+        residentCount++;
+        for(int y = glyph.packed.y0 - GlyphAtlasPadding; y < glyph.packed.y1; y++) {
+            for(int x = glyph.packed.x0 - GlyphAtlasPadding; x < glyph.packed.x1; x++) {
+                if(coverage[(y * atlasSize) + x]++ != 0)
+                    overlapCount++;
+            }
+        }
+    }
+
+    printf("glyph atlas %dx%d, %u font glyphs, %u new per frame: %.3f ms avg, %.3f ms max frame, %.2f us per glyph\n",
+        atlasSize, atlasSize, fontCodepointCount, newGlyphsPerFrame, (totalSeconds * 1000.0) / frameCount, 
+        maxFrameSeconds * 1000.0, (totalSeconds * 1000000.0) / atlas.rasterizedGlyphCount);
+    printf("%u rasterized, %u evictions, %u resident, %u missing, %u overlapping pixels\n", atlas.rasterizedGlyphCount,
+        atlas.evictionCount, residentCount, missingCount, overlapCount);
+
+    free(coverage);
+    free(instances);
+    free(text);
+    free(fontCodepoints);
+    FreeGlyphAtlas(&atlas);
+    bool isShelfMergePassing = CheckGlyphAtlasShelfMerge();
+    return missingCount == 0 && overlapCount == 0 && isShelfMergePassing;
+}
+
+// headless startup benchmark of prewarming atlases with and without their cache, a corrupted cache has to be rebuilt,
+// run with --bench-font-cache
+bool RunGlyphAtlasCacheBenchmark(int iterationCount)
+{
+    struct AtlasCacheBenchConfig
+    {
+        float fontHeight;
+        int atlasSize;
+        uint32_t firstCodepoint;
+        uint32_t codepointCount;
+    };
+    const AtlasCacheBenchConfig configs[] = {
+        { 32.0f, 1024, 0x20, 0x5F },
+        { 32.0f, 1024, 0x20, 0x160 },
+        { 64.0f, 2048, 0x20, 0x160 }
+    };
+    const char* fontName = "res/CourierPrime-Regular.ttf";
+
+    bool isPassing = true;
+    for(const AtlasCacheBenchConfig& config : configs) {
+        char cacheFilename[MAX_PATH] = {};
+        GetGlyphAtlasCacheFilename(fontName, config.fontHeight, config.firstCodepoint, config.codepointCount,
+            cacheFilename, sizeof(cacheFilename));
+
+        double coldSeconds = 0.0;
+        double warmSeconds = 0.0;
+        uint32_t mismatchCount = 0;
+        uint32_t glyphCount = 0;
+        for(int iteration = 0; iteration < iterationCount; iteration++) {
+            DeleteFileA(cacheFilename);
+            uint64_t startTicks = GetTicks();
+            GlyphAtlas coldAtlas = CreateGlyphAtlas(fontName, config.fontHeight, config.atlasSize, config.atlasSize, 4096);
+            bool isColdCached = PrewarmGlyphAtlas(&coldAtlas, config.firstCodepoint, config.codepointCount, cacheFilename);
+            coldSeconds += TicksToSeconds(GetTicks() - startTicks);
+
+            startTicks = GetTicks();
+            GlyphAtlas warmAtlas = CreateGlyphAtlas(fontName, config.fontHeight, config.atlasSize, config.atlasSize, 4096);
+            bool isWarmCached = PrewarmGlyphAtlas(&warmAtlas, config.firstCodepoint, config.codepointCount, cacheFilename);
+            warmSeconds += TicksToSeconds(GetTicks() - startTicks);
+
+            // the cached atlas has to be the same glyphs at the same places
+            glyphCount = coldAtlas.maxGlyphs - coldAtlas.freeGlyphSlotCount;
+            if(isColdCached || !isWarmCached || glyphCount != warmAtlas.maxGlyphs - warmAtlas.freeGlyphSlotCount ||
+                memcmp(coldAtlas.bitmap, warmAtlas.bitmap, (size_t)config.atlasSize * config.atlasSize) != 0)
+            {
+                mismatchCount++;
+            }
+            for(uint32_t slot = coldAtlas.lruHeadSlot; slot != InvalidGlyphSlot; slot = coldAtlas.glyphs[slot].nextSlot) {
+                const AtlasGlyph& coldGlyph = coldAtlas.glyphs[slot];
+                uint32_t warmSlot = FindAtlasGlyph(&warmAtlas, coldGlyph.codepoint);
+                if(warmSlot == InvalidGlyphSlot || memcmp(&warmAtlas.glyphs[warmSlot].packed, &coldGlyph.packed, sizeof(stbtt_packedchar)) != 0)
+                    mismatchCount++;
+            }
+
+            FreeGlyphAtlas(&warmAtlas);
+            FreeGlyphAtlas(&coldAtlas);
+        }
+
+        // a cache whose glyph points past the shelves has to be rebuilt rather than loaded
+        ByteBuffer cacheBytes = ReadAllBytesFromFile(cacheFilename, 0);
+        const GlyphAtlasCacheHeader* header = (const GlyphAtlasCacheHeader*)cacheBytes.data;
+        size_t glyphsAt = AlignUp(sizeof(GlyphAtlasCacheHeader), GlyphAtlasCacheAlignment) +
+            AlignUp(header->shelfCount * sizeof(AtlasShelf), GlyphAtlasCacheAlignment);
+        ((AtlasGlyph*)(cacheBytes.data + glyphsAt))->shelfIndex = header->shelfCount;
+        WriteAllBytesToFile(cacheFilename, cacheBytes.data, cacheBytes.len);
+        free(cacheBytes.data);
+        GlyphAtlas corruptAtlas = CreateGlyphAtlas(fontName, config.fontHeight, config.atlasSize, config.atlasSize, 4096);
+        if(PrewarmGlyphAtlas(&corruptAtlas, config.firstCodepoint, config.codepointCount, cacheFilename))
+            mismatchCount++;
+        FreeGlyphAtlas(&corruptAtlas);
+        DeleteFileA(cacheFilename);
+
+        printf("glyph atlas %.0f px U+%04X-U+%04X (%u glyphs, %dx%d): cold %.2f ms, warm %.2f ms, %u mismatches\n",
+            config.fontHeight, config.firstCodepoint, config.firstCodepoint + config.codepointCount - 1, glyphCount,
+            config.atlasSize, config.atlasSize, (coldSeconds * 1000.0) / iterationCount, (warmSeconds * 1000.0) / iterationCount,
+            mismatchCount);
+        isPassing &= mismatchCount == 0;
+    }
+    return isPassing;
+}
+
+uint64_t HashSdfAtlas(const SdfAtlas& atlas)
+{
+    return HashBytes(atlas.bitmap, (size_t)atlas.width * atlas.height) ^ 
+        HashUint64(HashBytes(atlas.glyphs, atlas.glyphCount * sizeof(SdfGlyph)));
+}
+
+// headless benchmark of the sdf atlas build time for 1 to all threads, run with --bench-sdf
+// the font has fewer glyphs than glyphCount, so its codepoints repeat to make up the set
+bool RunSdfAtlasBenchmark(TaskPool* pool, uint32_t glyphCount, float fontHeight, int iterationCount)
+{
+    const char* fontName = "res/CourierPrime-Regular.ttf";
+    ByteBuffer ttf = ReadAllBytesFromFile(fontName, 0);
+    stbtt_fontinfo fontInfo = {};
+    int initRes = stbtt_InitFont(&fontInfo, ttf.data, stbtt_GetFontOffsetForIndex(ttf.data, 0));
+    ASSERT(initRes != 0);
+
+    uint32_t* fontCodepoints = (uint32_t*)calloc(1, 0x10000 * sizeof(uint32_t));
+    uint32_t* codepoints = (uint32_t*)calloc(1, glyphCount * sizeof(uint32_t));
+    ASSERT(fontCodepoints != nullptr && codepoints != nullptr);
+    uint32_t fontCodepointCount = 0;
+    for(uint32_t codepoint = 0x20; codepoint < 0x10000; codepoint++) {
+        if(stbtt_FindGlyphIndex(&fontInfo, (int)codepoint) != 0)
+            fontCodepoints[fontCodepointCount++] = codepoint;
+    }
+    for(uint32_t i = 0; i < glyphCount; i++)
+        codepoints[i] = fontCodepoints[i % fontCodepointCount];
+
+    int maxThreadCount = GetTaskPoolTotalThreadCount(pool);
+    // at least up to 4 threads, so the determinism check sees real workers even on small machines
+    int threadCounts[MaxTaskPoolThreads + 1] = {};
+    int configCount = 0;
+    for(int threadCount = 1; threadCount < maxThreadCount || threadCount <= 4; threadCount *= 2)
+        threadCounts[configCount++] = threadCount;
+    if(threadCounts[configCount - 1] < maxThreadCount)
+        threadCounts[configCount++] = maxThreadCount;
+
+    bool isPassing = true;
+    double singleThreadSeconds = 0.0;
+    uint64_t referenceHash = 0;
+    for(int config = 0; config < configCount; config++) {
+        int threadCount = threadCounts[config];
+        TaskPool* configPool = threadCount == maxThreadCount ? pool : (threadCount == 1 ? nullptr : CreateTaskPool(threadCount - 1));
+
+        double bestSeconds = 0.0;
+        uint32_t mismatchCount = 0;
+        int atlasHeight = 0;
+        for(int iteration = 0; iteration < iterationCount; iteration++) {
+            uint64_t startTicks = GetTicks();
+            SdfAtlas atlas = CreateSdfAtlas(configPool, fontName, fontHeight, codepoints, glyphCount, 2048);
+            double seconds = TicksToSeconds(GetTicks() - startTicks);
+            bestSeconds = (iteration == 0 || seconds < bestSeconds) ? seconds : bestSeconds;
+
+            // every thread count has to produce the exact same atlas
+            uint64_t hash = HashSdfAtlas(atlas);
+            if(config == 0 && iteration == 0)
+                referenceHash = hash;
+            else if(hash != referenceHash)
+                mismatchCount++;
+            atlasHeight = atlas.height;
+            FreeSdfAtlas(&atlas);
+        }
+        if(config == 0)
+            singleThreadSeconds = bestSeconds;
+
+        printf("sdf atlas %u glyphs at %.0f px, 2048x%d, %2d threads: %8.2f ms (%.2fx), %u mismatches\n", glyphCount, fontHeight,
+            atlasHeight, threadCount, bestSeconds * 1000.0, singleThreadSeconds / bestSeconds, mismatchCount);
+        isPassing &= mismatchCount == 0;
+
+        if(configPool != nullptr && configPool != pool)
+            FreeTaskPool(configPool);
+    }
+
+    free(codepoints);
+    free(fontCodepoints);
+    free(ttf.data);
+    return isPassing;
+}
+
+struct Dx11ShaderTexture2D
+{
+    ID3D11Texture2D* texture;
+    ID3D11ShaderResourceView* view;
+};
+
+void FreeDx11ShaderTexture2D(Dx11ShaderTexture2D* shaderTex)
+{
+    shaderTex->texture->Release();   
+    shaderTex->view->Release();   
+    *shaderTex = {};
+}
+
+ID3D11SamplerState* CreateDx11TextureSampler(Dx11& dx)
+{
+    D3D11_SAMPLER_DESC samplerDesc = {
+        .Filter = D3D11_FILTER_MIN_MAG_MIP_LINEAR,
+        .AddressU = D3D11_TEXTURE_ADDRESS_CLAMP,
+        .AddressV = D3D11_TEXTURE_ADDRESS_CLAMP,
+        .AddressW = D3D11_TEXTURE_ADDRESS_CLAMP,
+        .MaxAnisotropy = 1,
+        .ComparisonFunc = D3D11_COMPARISON_ALWAYS
+    };
+
+    ID3D11SamplerState* sampler = nullptr;
+    HRESULT res = dx.device->CreateSamplerState(&samplerDesc, &sampler);
+    ASSERT(res == S_OK);
+
+    return sampler;
+}
+
+Dx11ShaderTexture2D CreateDx11ShaderTextureForSdfAtlas(Dx11& dx, SdfAtlas& atlas)
+{
+    D3D11_TEXTURE2D_DESC texDesc = {
+        .Width = (UINT)atlas.width,
+        .Height = (UINT)atlas.height,
+        .MipLevels = 1,
+        .ArraySize = 1,
+        .Format = DXGI_FORMAT_R8_UNORM,
+        .SampleDesc = { .Count = 1 },
+        .Usage = D3D11_USAGE_IMMUTABLE,
+        .BindFlags = D3D11_BIND_SHADER_RESOURCE
+    };
+
+    D3D11_SUBRESOURCE_DATA texData = {
+        .pSysMem = atlas.bitmap,
+        .SysMemPitch = (UINT)atlas.width
+    };
+
+    ID3D11Texture2D* tex = nullptr;
+    HRESULT res = dx.device->CreateTexture2D(
+        &texDesc,
+        &texData,
+        &tex
+    );
+    ASSERT(res == S_OK);
+
+    ID3D11ShaderResourceView* view = nullptr;
+    res = dx.device->CreateShaderResourceView(
+        tex,
+        nullptr,
+        &view
+    );
+    ASSERT(res == S_OK);
+
+    return {
+        .texture = tex,
+        .view = view
+    };
+}
+
+// default usage so the dirty parts can be updated with UploadGlyphAtlasDirtyRects
+Dx11ShaderTexture2D CreateDx11ShaderTextureForGlyphAtlas(Dx11& dx, GlyphAtlas& atlas)
+{
+    D3D11_TEXTURE2D_DESC texDesc = {
+        .Width = (UINT)atlas.width,
+        .Height = (UINT)atlas.height,
+        .MipLevels = 1,
+        .ArraySize = 1,
+        .Format = DXGI_FORMAT_R8_UNORM,
+        .SampleDesc = { .Count = 1 },
+        .Usage = D3D11_USAGE_DEFAULT,
+        .BindFlags = D3D11_BIND_SHADER_RESOURCE
+    };
+
+    D3D11_SUBRESOURCE_DATA texData = {
+        .pSysMem = atlas.bitmap,
+        .SysMemPitch = (UINT)atlas.width
+    };
+
+    ID3D11Texture2D* tex = nullptr;
+    HRESULT res = dx.device->CreateTexture2D(
+        &texDesc,
+        &texData,
+        &tex
+    );
+    ASSERT(res == S_OK);
+
+    ID3D11ShaderResourceView* view = nullptr;
+    res = dx.device->CreateShaderResourceView(
+        tex,
+        nullptr,
+        &view
+    );
+    ASSERT(res == S_OK);
+
+    // the whole bitmap went up with the texture
+    for(uint32_t i = 0; i < atlas.shelfCount; i++) {
+        atlas.shelves[i].dirtyX0 = 0;
+        atlas.shelves[i].dirtyX1 = 0;
+    }
+
+    return {
+        .texture = tex,
+        .view = view
+    };
+}
+
+// one sub-rectangle per shelf with new glyphs, returns the number of uploads
+uint32_t UploadGlyphAtlasDirtyRects(Dx11& dx, GlyphAtlas* atlas, Dx11ShaderTexture2D& shaderTex)
+{
+    uint32_t uploadCount = 0;
+    for(uint32_t i = 0; i < atlas->shelfCount; i++) {
+        AtlasShelf& shelf = atlas->shelves[i];
+        if(shelf.dirtyX0 >= shelf.dirtyX1)
+            continue;
+
+        // the whole shelf height, bilinear filtering reads the rows below the glyphs too
+        D3D11_BOX destBox = {
+            .left = (UINT)shelf.dirtyX0,
+            .top = (UINT)shelf.y,
+            .front = 0,
+            .right = (UINT)shelf.dirtyX1,
+            .bottom = (UINT)(shelf.y + shelf.height),
+            .back = 1
+        };
+        const unsigned char* src = atlas->bitmap + (shelf.y * atlas->width) + shelf.dirtyX0;
+        dx.context->UpdateSubresource(shaderTex.texture, 0, &destBox, src, (UINT)atlas->width, 0);
+        shelf.dirtyX0 = 0;
+        shelf.dirtyX1 = 0;
+        uploadCount++;
+    }
+    return uploadCount;
+}
+
+void DrawLine(Dx11& dx, Vec3 position, Vec3 scale, float yRotation, ID3D11Buffer* cBuffer, const FpsCam& cam)
+{
+    BasicColorShaderData shaderData = { .color = { 0.0f, 0.0f, 0.0f, 1.0f } };
+    Mat4 modelMat = TranslateMat4(position) * ScaleMat4(scale) * RotateEulerYMat4(toRadians(yRotation));
+    shaderData.xformMat = cam.projMat * cam.viewMat * modelMat;
+    UploadDataToBuffer(dx, cBuffer, &shaderData, sizeof(shaderData));
+    dx.context->VSSetConstantBuffers(0, 1, &cBuffer);
+    dx.context->Draw(2, 0);
+}
+
+constexpr int LineGridSquaresHalfX = 6;
+constexpr int LineGridSquaresHalfZ = 6;
+constexpr int LineGridXLineCount = 1 + (LineGridSquaresHalfZ * 2);
+constexpr int LineGridZLineCount = 1 + (LineGridSquaresHalfX * 2);
+constexpr int LineGridLineCount = LineGridXLineCount + LineGridZLineCount;
+
+struct LineGridInstances
+{
+    Mat4 lines[LineGridLineCount];
+};
+
+// the grid never changes, so the compiler builds its instance matrices
+constexpr LineGridInstances GetLineGridInstances()
+{
+    LineGridInstances res = {};
+    int instanceWriteIndex = 0;
+    // draw lines parallel to x-axis
+    for(int i = 0; i < LineGridXLineCount; i++) {
+        Transform transform = {
+            .scale = { (float)(LineGridZLineCount - 1), 1.0f, 1.0f }
+        };
+        transform.position.z = (float)i;
+        transform.position.z -= (float)((LineGridXLineCount - 1) / 2);
+        res.lines[instanceWriteIndex++] = GetModelMatFromTransform(transform);
+    }
+
+    // draw lines parallel to z-axis
+    for(int i = 0; i < LineGridZLineCount; i++) {
+        // the line runs along x, scaled first and then turned onto the z-axis
+        Transform transform = {
+            .scale = { (float)(LineGridXLineCount - 1), 1.0f, 1.0f },
+            .rotation = QuatFromAxisAngle({ 0.0f, 1.0f, 0.0f }, toRadians(90.0f))
+        };
+        transform.position.x = (float)i;
+        transform.position.x -= (float)((LineGridZLineCount - 1) / 2);
+        res.lines[instanceWriteIndex++] = GetModelMatFromTransform(transform);
+    }
+
+    return res;
+}
+
+static constexpr LineGridInstances lineGridInstances = GetLineGridInstances();
+static_assert(lineGridInstances.lines[0].data[3][2] == -(float)LineGridSquaresHalfZ, "first x line should sit on the -z edge");
+static_assert(lineGridInstances.lines[LineGridLineCount - 1].data[3][0] == (float)LineGridSquaresHalfX, "last z line should sit on the +x edge");
+static_assert(IsNearlyEqual(lineGridInstances.lines[LineGridLineCount - 1].data[0][2], -(double)(LineGridXLineCount - 1), 1e-5),
+    "z lines should be rotated onto the z-axis and span the grid");
+
+struct LineGrid
+{
+    Dx11VertexBuffer positionVertexBuffer;
+    Dx11VertexBuffer instanceVertexBuffer;
+    UINT totalLineCount;
+};
+
+void FreeLineGrid(LineGrid* grid)
+{
+    grid->positionVertexBuffer.buffer->Release();
+    grid->instanceVertexBuffer.buffer->Release();
+    *grid = {};
+}
+
+LineGrid GenerateLineGrid(Dx11& dx)
+{
+    LineGrid grid = {};
+    grid.positionVertexBuffer = CreateDx11VertexBuffer(dx, BufferUsageType::Static, lineVertices, 
+        sizeof(lineVertices), 3 * sizeof(float), 0);
+    grid.totalLineCount = LineGridLineCount;
+    grid.instanceVertexBuffer = CreateDx11VertexBuffer(dx, BufferUsageType::Static, lineGridInstances.lines, 
+        sizeof(lineGridInstances.lines), sizeof(Mat4), 0);
+    
+    return grid;
+}
+
+void DrawLineGrid(Dx11& dx, LineGrid& grid, ID3D11InputLayout* inputLayout, Dx11Program& program,
+    void* programData, UINT programDataByteSize)
+{
+    dx.context->IASetVertexBuffers(0, 1, &grid.positionVertexBuffer.buffer, &grid.positionVertexBuffer.stride, 
+        &grid.positionVertexBuffer.byteOffset);
+    dx.context->IASetVertexBuffers(1, 1, &grid.instanceVertexBuffer.buffer, &grid.instanceVertexBuffer.stride, 
+        &grid.instanceVertexBuffer.byteOffset);
+    dx.context->IASetInputLayout(inputLayout);
+    dx.context->IASetPrimitiveTopology(D3D_PRIMITIVE_TOPOLOGY_LINELIST);
+    dx.context->VSSetShader(program.vs, nullptr, 0);
+    dx.context->PSSetShader(program.ps, nullptr, 0);
+
+    UploadDataToBuffer(dx, program.cBuffer, programData, programDataByteSize);
+    dx.context->VSSetConstantBuffers(0, 1, &program.cBuffer);
+    dx.context->DrawInstanced(2, grid.totalLineCount, 0, 0);
+}
+
+// per-frame timings in a ring written by the main thread, other threads can snapshot it without locking
+constexpr uint32_t FrameTimeHistoryLen = 4096;
+constexpr uint32_t FrameTimeHistoryMask = FrameTimeHistoryLen - 1;
+static_assert((FrameTimeHistoryLen & FrameTimeHistoryMask) == 0, "the history length has to be a power of 2");
+// the rolling stats cover about 10 seconds at 60 Hz
+constexpr uint32_t FrameTimeWindowLen = 600;
+static_assert(FrameTimeWindowLen <= FrameTimeHistoryLen);
+// 0.05 ms bins up to 100 ms, anything slower lands in the last bin
+constexpr float FrameTimeBinMs = 0.05f;
+constexpr uint32_t FrameTimeBinCount = 2000;
+
+struct FrameTimeHistory
+{
+    float frameTimesMs[FrameTimeHistoryLen];
+    // frames pushed so far, only advanced after the frame's slot is written
+    volatile LONGLONG writeCount;
+    // histogram of the last FrameTimeWindowLen frames, only touched by the thread that pushes
+    uint16_t binCounts[FrameTimeBinCount];
+};
+
+struct FrameTimeStats
+{
+    uint32_t frameCount;
+    float lastMs;
+    float p50Ms;
+    float p95Ms;
+    float p99Ms;
+    float maxMs;
+};
+
+FrameTimeHistory* CreateFrameTimeHistory()
+{
+    FrameTimeHistory* history = (FrameTimeHistory*)calloc(1, sizeof(FrameTimeHistory));
+    ASSERT(history != nullptr);
+    return history;
+}
+
+void FreeFrameTimeHistory(FrameTimeHistory* history)
+{
+    free(history);
+}
+
+uint32_t GetFrameTimeBin(float frameTimeMs)
+{
+    float bin = frameTimeMs / FrameTimeBinMs;
+    return bin < (float)(FrameTimeBinCount - 1) ? (uint32_t)fmaxf(bin, 0.0f) : FrameTimeBinCount - 1;
+}
+
+// single producer, the frame that falls out of the window leaves the histogram as the new one goes in
+void PushFrameTime(FrameTimeHistory* history, float frameTimeMs)
+{
+    uint64_t writeCount = (uint64_t)history->writeCount;
+    if(writeCount >= FrameTimeWindowLen)
+        history->binCounts[GetFrameTimeBin(history->frameTimesMs[(writeCount - FrameTimeWindowLen) & FrameTimeHistoryMask])]--;
+    history->binCounts[GetFrameTimeBin(frameTimeMs)]++;
+
+    history->frameTimesMs[writeCount & FrameTimeHistoryMask] = frameTimeMs;
+    // full barrier, readers never see the new count before the slot
+    InterlockedIncrement64(&history->writeCount);
+}
+
+uint64_t GetFrameTimeWriteCount(FrameTimeHistory* history)
+{
+    return (uint64_t)InterlockedCompareExchange64(&history->writeCount, 0, 0);
+}
+
+// copies the most recent frames oldest first from any thread and returns how many are consistent,
+// the frames the writer lapped during the copy are dropped from the front
+uint32_t CopyFrameTimeHistory(FrameTimeHistory* history, float* dest, uint32_t maxCount, uint64_t* firstFrameIndex)
+{
+    uint64_t endCount = GetFrameTimeWriteCount(history);
+    uint64_t count = endCount < FrameTimeHistoryLen ? endCount : FrameTimeHistoryLen;
+    count = count < maxCount ? count : maxCount;
+    uint64_t startIndex = endCount - count;
+    for(uint64_t i = 0; i < count; i++)
+        dest[i] = history->frameTimesMs[(startIndex + i) & FrameTimeHistoryMask];
+
+    // the writer may already be filling the slot of frame afterCount - FrameTimeHistoryLen
+    uint64_t afterCount = GetFrameTimeWriteCount(history);
+    uint64_t firstValidIndex = afterCount >= FrameTimeHistoryLen ? afterCount - FrameTimeHistoryLen + 1 : 0;
+    if(startIndex < firstValidIndex) {
+        uint64_t dropCount = firstValidIndex - startIndex < count ? firstValidIndex - startIndex : count;
+        memmove(dest, dest + dropCount, (count - dropCount) * sizeof(float));
+        count -= dropCount;
+        startIndex += dropCount;
+    }
+
+    *firstFrameIndex = startIndex;
+    return (uint32_t)count;
+}
+
+// nearest rank percentiles from the histogram, within half a bin of the exact ones, the max is exact
+FrameTimeStats GetFrameTimeStats(const FrameTimeHistory& history)
+{
+    uint64_t writeCount = (uint64_t)history.writeCount;
+    FrameTimeStats stats = {
+        .frameCount = (uint32_t)(writeCount < FrameTimeWindowLen ? writeCount : FrameTimeWindowLen)
+    };
+    if(stats.frameCount == 0)
+        return stats;
+
+    stats.lastMs = history.frameTimesMs[(writeCount - 1) & FrameTimeHistoryMask];
+    for(uint64_t i = writeCount - stats.frameCount; i < writeCount; i++)
+        stats.maxMs = fmaxf(stats.maxMs, history.frameTimesMs[i & FrameTimeHistoryMask]);
+
+    const uint32_t percentiles[3] = { 50, 95, 99 };
+    float* results[3] = { &stats.p50Ms, &stats.p95Ms, &stats.p99Ms };
+    uint32_t percentileIndex = 0;
+    uint32_t rank = ((stats.frameCount * percentiles[0]) + 99) / 100;
+    uint32_t cumulativeCount = 0;
+    for(uint32_t bin = 0; bin < FrameTimeBinCount && percentileIndex < 3; bin++) {
+        cumulativeCount += history.binCounts[bin];
+        while(percentileIndex < 3 && cumulativeCount >= rank) {
+            float binCenterMs = ((float)bin + 0.5f) * FrameTimeBinMs;
+            *results[percentileIndex] = bin == FrameTimeBinCount - 1 ? stats.maxMs : fminf(binCenterMs, stats.maxMs);
+            percentileIndex++;
+            if(percentileIndex < 3)
+                rank = ((stats.frameCount * percentiles[percentileIndex]) + 99) / 100;
+        }
+    }
+    return stats;
+}
+
+struct FrameTimeExport
+{
+    FrameTimeHistory* history;
+    const char* filename;
+    volatile LONG pendingCount;
+};
+
+// "frame,ms" lines of the whole history, runs on the task pool while the main thread keeps pushing frames
+void ExportFrameTimesTask(void* data, int threadIndex)
+{
+    FrameTimeExport* frameTimeExport = (FrameTimeExport*)data;
+    float* frameTimes = (float*)calloc(1, FrameTimeHistoryLen * sizeof(float));
+    // a 20 digit frame index, a comma, a float of at most 15 chars and a newline
+    size_t maxCsvLen = 16 + (FrameTimeHistoryLen * 40);
+    char* csv = (char*)calloc(1, maxCsvLen);
+    ASSERT(frameTimes != nullptr && csv != nullptr);
+
+    uint64_t firstFrameIndex = 0;
+    uint32_t frameCount = CopyFrameTimeHistory(frameTimeExport->history, frameTimes, FrameTimeHistoryLen, &firstFrameIndex);
+    TextBuilder builder = CreateTextBuilder(csv, maxCsvLen);
+    AppendText(&builder, STRING_VIEW("frame,ms\n"));
+    for(uint32_t i = 0; i < frameCount; i++) {
+        AppendUint(&builder, firstFrameIndex + i);
+        AppendText(&builder, STRING_VIEW(","));
+        AppendFloat(&builder, frameTimes[i]);
+        AppendText(&builder, STRING_VIEW("\n"));
+    }
+
+    if(WriteAllBytesToFile(frameTimeExport->filename, builder.data, builder.len))
+        printf("exported %u frame times to %s\n", frameCount, frameTimeExport->filename);
+    else
+        printf("failed to export frame times to %s\n", frameTimeExport->filename);
+
+    free(csv);
+    free(frameTimes);
+}
+
+// the most recent frames as vertical bars plus 60 and 30 FPS reference lines,
+// drawn with the line grid program and input layout from one instanced unit line
+constexpr uint32_t FrameTimeGraphBarCount = 240;
+constexpr uint32_t FrameTimeGraphLineCount = FrameTimeGraphBarCount + 2;
+constexpr float FrameTimeGraphMaxMs = 50.0f;
+
+struct FrameTimeGraph
+{
+    Dx11VertexBuffer positionVertexBuffer;
+    Dx11VertexBuffer instanceVertexBuffer;
+    // regular bars from the front, stutters from the back of the bar range, then the reference lines
+    Mat4 lines[FrameTimeGraphLineCount];
+    UINT regularBarCount;
+    UINT stutterBarCount;
+};
+
+void FreeFrameTimeGraph(FrameTimeGraph* graph)
+{
+    graph->positionVertexBuffer.buffer->Release();
+    graph->instanceVertexBuffer.buffer->Release();
+    *graph = {};
+}
+
+FrameTimeGraph CreateFrameTimeGraph(Dx11& dx)
+{
+    FrameTimeGraph graph = {};
+    graph.positionVertexBuffer = CreateDx11VertexBuffer(dx, BufferUsageType::Static, lineVertices, 
+        sizeof(lineVertices), 3 * sizeof(float), 0);
+    graph.instanceVertexBuffer = CreateDx11VertexBuffer(dx, BufferUsageType::Dynamic, graph.lines, 
+        sizeof(graph.lines), sizeof(Mat4), 0);
+    return graph;
+}
+
+// the unit line goes from -0.5 to 0.5 on x, so x is scaled to the length and turned onto y for the bars
+Mat4 GetFrameTimeGraphLineMat(Vec2 center, Vec2 extent)
+{
+    Mat4 mat = IdentityMat4();
+    mat.data[0][0] = extent.x;
+    mat.data[0][1] = extent.y;
+    mat.data[3][0] = center.x;
+    mat.data[3][1] = center.y;
+    return mat;
+}
+
+// bars slower than twice the median count as stutters
+void UpdateFrameTimeGraph(FrameTimeGraph* graph, const FrameTimeHistory& history, const FrameTimeStats& stats,
+    Vec2 origin, float pixelsPerMs)
+{
+    uint64_t writeCount = (uint64_t)history.writeCount;
+    uint64_t barCount = writeCount < FrameTimeGraphBarCount ? writeCount : FrameTimeGraphBarCount;
+    float stutterMs = stats.p50Ms * 2.0f;
+    graph->regularBarCount = 0;
+    graph->stutterBarCount = 0;
+    for(uint64_t i = 0; i < barCount; i++) {
+        // newest frame on the right
+        float frameTimeMs = fminf(history.frameTimesMs[(writeCount - barCount + i) & FrameTimeHistoryMask], FrameTimeGraphMaxMs);
+        float height = frameTimeMs * pixelsPerMs;
+        Vec2 center = { origin.x + (float)(FrameTimeGraphBarCount - barCount + i) + 0.5f, origin.y + (height * 0.5f) };
+        UINT lineIndex = frameTimeMs > stutterMs ? FrameTimeGraphBarCount - ++graph->stutterBarCount : graph->regularBarCount++;
+        graph->lines[lineIndex] = GetFrameTimeGraphLineMat(center, { 0.0f, height });
+    }
+
+    const float referenceMs[2] = { 1000.0f / 60.0f, 1000.0f / 30.0f };
+    for(int i = 0; i < 2; i++) {
+        Vec2 center = { origin.x + ((float)FrameTimeGraphBarCount * 0.5f), origin.y + (referenceMs[i] * pixelsPerMs) };
+        graph->lines[FrameTimeGraphBarCount + i] = GetFrameTimeGraphLineMat(center, { (float)FrameTimeGraphBarCount, 0.0f });
+    }
+}
+
+void DrawFrameTimeGraph(Dx11& dx, FrameTimeGraph& graph, ID3D11InputLayout* inputLayout, Dx11Program& program,
+    const Mat4& orthoProjMat)
+{
+    UploadDataToBuffer(dx, graph.instanceVertexBuffer.buffer, graph.lines, sizeof(graph.lines));
+    dx.context->IASetVertexBuffers(0, 1, &graph.positionVertexBuffer.buffer, &graph.positionVertexBuffer.stride, 
+        &graph.positionVertexBuffer.byteOffset);
+    dx.context->IASetVertexBuffers(1, 1, &graph.instanceVertexBuffer.buffer, &graph.instanceVertexBuffer.stride, 
+        &graph.instanceVertexBuffer.byteOffset);
+    dx.context->IASetInputLayout(inputLayout);
+    dx.context->IASetPrimitiveTopology(D3D_PRIMITIVE_TOPOLOGY_LINELIST);
+    dx.context->VSSetShader(program.vs, nullptr, 0);
+    dx.context->PSSetShader(program.ps, nullptr, 0);
+    dx.context->VSSetConstantBuffers(0, 1, &program.cBuffer);
+
+    struct FrameTimeGraphDraw
+    {
+        Vec4 color;
+        UINT firstLine;
+        UINT lineCount;
+    };
+    const FrameTimeGraphDraw draws[3] = {
+        { { 0.2f, 0.8f, 0.2f, 1.0f }, 0, graph.regularBarCount },
+        { { 0.9f, 0.2f, 0.2f, 1.0f }, FrameTimeGraphBarCount - graph.stutterBarCount, graph.stutterBarCount },
+        { { 1.0f, 1.0f, 1.0f, 1.0f }, FrameTimeGraphBarCount, 2 }
+    };
+    for(const FrameTimeGraphDraw& draw : draws) {
+        if(draw.lineCount == 0)
+            continue;
+        LineGridShaderData shaderData = {
+            .projViewMat = orthoProjMat,
+            .color = draw.color
+        };
+        UploadDataToBuffer(dx, program.cBuffer, &shaderData, sizeof(shaderData));
+        dx.context->DrawInstanced(2, draw.lineCount, 0, draw.firstLine);
+    }
+}
+
+void BindDx11ModelBuffers(Dx11& dx, Dx11ModelData& model)
+{
+    UINT byteOffset = 0;
+    dx.context->IASetVertexBuffers(0, 1, &model.vertexBuffer, &model.vertexStride, &byteOffset);
+    dx.context->IASetIndexBuffer(model.indexBuffer, model.indexFormat, 0);
+}
+
+void DrawDx11Model(Dx11& dx, Dx11ModelData& model, ID3D11InputLayout* inputLayout, const Dx11Program& program, 
+    void* programData, UINT programDataByteSize)
 {
-    ID3D11Texture2D* texture;
-    ID3D11ShaderResourceView* view;
+    BindDx11ModelBuffers(dx, model);
+    dx.context->IASetInputLayout(inputLayout);
+    dx.context->IASetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
+    dx.context->VSSetShader(program.vs, nullptr, 0);
+    dx.context->PSSetShader(program.ps, nullptr, 0);
+
+    UploadDataToBuffer(dx, program.cBuffer, programData, programDataByteSize);
+    dx.context->VSSetConstantBuffers(0, 1, &program.cBuffer);
+    for(UINT i = 0; i < model.drawRangeCount; i++)
+        dx.context->DrawIndexed(model.drawRanges[i].indexCount, model.drawRanges[i].firstIndex, 0);
+}
+
+// the instance buffer goes in slot 1, right after the interleaved model vertices
+void DrawDx11ModelInstanced(Dx11& dx, Dx11ModelData& model, Dx11VertexBuffer& instanceVertexBuffer, UINT instanceCount,
+    ID3D11InputLayout* inputLayout, const Dx11Program& program, void* programData, UINT programDataByteSize)
+{
+    BindDx11ModelBuffers(dx, model);
+    dx.context->IASetVertexBuffers(1, 1, &instanceVertexBuffer.buffer, &instanceVertexBuffer.stride,
+        &instanceVertexBuffer.byteOffset);
+    dx.context->IASetInputLayout(inputLayout);
+    dx.context->IASetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
+    dx.context->VSSetShader(program.vs, nullptr, 0);
+    dx.context->PSSetShader(program.ps, nullptr, 0);
+
+    UploadDataToBuffer(dx, program.cBuffer, programData, programDataByteSize);
+    dx.context->VSSetConstantBuffers(0, 1, &program.cBuffer);
+    for(UINT i = 0; i < model.drawRangeCount; i++)
+        dx.context->DrawIndexedInstanced(model.drawRanges[i].indexCount, instanceCount, model.drawRanges[i].firstIndex, 0, 0);
+}
+
+void DrawText(Dx11& dx, UINT textLen, Dx11VertexBuffer& instanceVertexBuffer, 
+    ID3D11InputLayout* inputLayout, const Dx11Program& program, 
+    void* programData, UINT programDataByteSize, Dx11ShaderTexture2D& shaderTex, ID3D11SamplerState* shaderTexSampler)
+{
+    UINT dummyOffset = 0;
+    dx.context->IASetVertexBuffers(0, 1, &instanceVertexBuffer.buffer, &instanceVertexBuffer.stride, &dummyOffset);
+    dx.context->IASetInputLayout(inputLayout);
+    dx.context->IASetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
+    dx.context->VSSetShader(program.vs, nullptr, 0);
+    dx.context->PSSetShader(program.ps, nullptr, 0);
+
+    UploadDataToBuffer(dx, program.cBuffer, programData, programDataByteSize);
+    dx.context->VSSetConstantBuffers(0, 1, &program.cBuffer);
+    dx.context->PSSetSamplers(0, 1, &shaderTexSampler);
+    dx.context->PSSetShaderResources(0, 1, &shaderTex.view);
+    dx.context->DrawInstanced(6, textLen, 0, 0);
+}
+
+struct Dx11DepthStencilBuffer
+{
+    ID3D11Texture2D* buffer;
+    ID3D11DepthStencilView* view;
+};
+
+Dx11DepthStencilBuffer CreateDx11DepthStencilBuffer(UINT width, UINT height, Dx11* dx)
+{
+    D3D11_TEXTURE2D_DESC dsBufferDesc = {
+        .Width = width,
+        .Height = height,
+        .MipLevels = 1,
+        .ArraySize = 1,
+        .Format = DXGI_FORMAT_D24_UNORM_S8_UINT,
+        .SampleDesc = {
+            .Count = 1,
+            .Quality = 0
+        },
+        .Usage = D3D11_USAGE_DEFAULT,
+        .BindFlags = D3D11_BIND_DEPTH_STENCIL
+    };
+
+    ID3D11Texture2D* dsBuffer = nullptr;
+    HRESULT res = dx->device->CreateTexture2D(&dsBufferDesc, nullptr, &dsBuffer);
+    ASSERT(res == S_OK);
+
+    ID3D11DepthStencilView* dsBufferView = nullptr;
+    res = dx->device->CreateDepthStencilView(dsBuffer, nullptr, &dsBufferView);
+    ASSERT(res == S_OK);
+
+    return {
+        .buffer = dsBuffer,
+        .view = dsBufferView
+    };
+}
+
+void FreeDx11DepthStencilBuffer(Dx11DepthStencilBuffer* dsBuffer)
+{
+    dsBuffer->buffer->Release();
+    dsBuffer->view->Release();
+    *dsBuffer = {};
+}
+
+void ResizeDx11DepthStencilBuffer(Dx11DepthStencilBuffer* dsBuffer, UINT newWidth, UINT newHeight, Dx11* dx)
+{
+    dx->context->OMSetRenderTargets(0, 0, 0);
+    FreeDx11DepthStencilBuffer(dsBuffer);
+    *dsBuffer = CreateDx11DepthStencilBuffer(newWidth, newHeight, dx);
+}
+
+ID3D11DepthStencilState* CreateDx11DepthStencilState(Dx11* dx)
+{
+    D3D11_DEPTH_STENCIL_DESC stateDesc = {
+        .DepthEnable = TRUE,
+        .DepthWriteMask = D3D11_DEPTH_WRITE_MASK_ALL,
+        .DepthFunc = D3D11_COMPARISON_LESS,
+        .StencilEnable = FALSE,
+        .StencilReadMask = D3D11_DEFAULT_STENCIL_READ_MASK,
+        .StencilWriteMask = D3D11_DEFAULT_STENCIL_WRITE_MASK
+    };
+
+    ID3D11DepthStencilState* dsState = nullptr;
+    HRESULT res = dx->device->CreateDepthStencilState(&stateDesc, &dsState);
+    ASSERT(res == S_OK);
+    return dsState;
+}
+
+// ORIGINAL GOAL: 
+// =============================================
+// Load a textured 3D model from an .obj file 
+// with reference grid at 0.0.0, some info stats in corner and mouse drag controls and keyboard movement
+// =============================================
+
+float GetMaxVec3x8Difference(const Vec3x8* one, const Vec3x8* other, uint32_t blockCount)
+{
+    float maxDiff = 0.0f;
+    for(uint32_t block = 0; block < blockCount; block++) {
+        for(int lane = 0; lane < 8; lane++) {
+            maxDiff = fmaxf(maxDiff, fabsf(one[block].x[lane] - other[block].x[lane]));
+            maxDiff = fmaxf(maxDiff, fabsf(one[block].y[lane] - other[block].y[lane]));
+            maxDiff = fmaxf(maxDiff, fabsf(one[block].z[lane] - other[block].z[lane]));
+        }
+    }
+    return maxDiff;
+}
+
+int GetMaxQuantizedVec3x8Difference(const QuantizedVec3x8* one, const QuantizedVec3x8* other, uint32_t blockCount)
+{
+    int maxDiff = 0;
+    for(uint32_t block = 0; block < blockCount; block++) {
+        for(int lane = 0; lane < 8; lane++) {
+            int diffs[3] = {
+                abs((int)one[block].x[lane] - (int)other[block].x[lane]),
+                abs((int)one[block].y[lane] - (int)other[block].y[lane]),
+                abs((int)one[block].z[lane] - (int)other[block].z[lane])
+            };
+            for(int axis = 0; axis < 3; axis++)
+                maxDiff = diffs[axis] > maxDiff ? diffs[axis] : maxDiff;
+        }
+    }
+    return maxDiff;
+}
+
+float GetMaxVec3Difference(const Vec3* one, const Vec3* other, uint32_t count)
+{
+    float maxDiff = 0.0f;
+    for(uint32_t i = 0; i < count; i++) {
+        Vec3 diff = one[i] - other[i];
+        maxDiff = fmaxf(maxDiff, fmaxf(fabsf(diff.x), fmaxf(fabsf(diff.y), fabsf(diff.z))));
+    }
+    return maxDiff;
+}
+
+float GetMaxAabbDifference(const Aabb& one, const Aabb& other)
+{
+    Vec3 minDiff = one.min - other.min;
+    Vec3 maxDiff = one.max - other.max;
+    return fmaxf(fmaxf(fmaxf(fabsf(minDiff.x), fabsf(minDiff.y)), fmaxf(fabsf(minDiff.z), fabsf(maxDiff.x))),
+        fmaxf(fabsf(maxDiff.y), fabsf(maxDiff.z)));
+}
+
+typedef Aabb GetVec3x8BoundsFunc(const Vec3x8* blocks, uint32_t blockCount);
+typedef void NormalizeVec3x8Func(Vec3x8* blocks, uint32_t blockCount);
+typedef void TransformVec3x8Func(const Mat4& mat, const Vec3x8* blocks, Vec3x8* dest, uint32_t blockCount);
+typedef void QuantizeVec3x8Func(const Vec3x8* blocks, const Aabb& bounds, QuantizedVec3x8* dest, uint32_t blockCount);
+typedef void BinaryVec3x8Func(const Vec3x8* one, const Vec3x8* other, Vec3x8* dest, uint32_t blockCount);
+typedef void DotVec3x8Func(const Vec3x8* one, const Vec3x8* other, float* dest, uint32_t blockCount);
+
+// the products in dot and cross reach a few hundred, so fma against separate rounding differs in the 1e-5 range
+constexpr float Vec3x8ProductTolerance = 1e-3f;
+constexpr float Vec3x8TransformTolerance = 1e-4f;
+constexpr float Vec3x8NormalizeTolerance = 1e-6f;
+
+// headless check of the Vec3x8 backends against the scalar reference and the one at a time Vec3 math plus throughput,
+// returns false on a mismatch, run with --bench-soa
+bool RunVec3x8Benchmark(uint32_t pointCount, uint32_t iterationCount)
+{
+    const CpuFeatures& cpu = GetCpuFeatures();
+    uint32_t blockCount = GetVec3x8BlockCount(pointCount);
+    Vec3* points = (Vec3*)calloc(1, pointCount * sizeof(Vec3));
+    Vec3* otherPoints = (Vec3*)calloc(1, pointCount * sizeof(Vec3));
+    Vec3* unpacked = (Vec3*)calloc(1, pointCount * sizeof(Vec3));
+    Vec3* aosResults = (Vec3*)calloc(1, pointCount * sizeof(Vec3));
+    float* aosDots = (float*)calloc(1, pointCount * sizeof(float));
+    float* dots = (float*)_aligned_malloc((size_t)blockCount * 8 * sizeof(float), alignof(Vec3x8));
+    Vec3x8* blocks = CreateVec3x8Blocks(pointCount);
+    Vec3x8* otherBlocks = CreateVec3x8Blocks(pointCount);
+    Vec3x8* reference = CreateVec3x8Blocks(pointCount);
+    Vec3x8* results = CreateVec3x8Blocks(pointCount);
+    QuantizedVec3x8* quantizedReference = (QuantizedVec3x8*)_aligned_malloc(blockCount * sizeof(QuantizedVec3x8), alignof(QuantizedVec3x8));
+    QuantizedVec3x8* quantized = (QuantizedVec3x8*)_aligned_malloc(blockCount * sizeof(QuantizedVec3x8), alignof(QuantizedVec3x8));
+    ASSERT(points != nullptr && otherPoints != nullptr && unpacked != nullptr && aosResults != nullptr && aosDots != nullptr);
+    ASSERT(dots != nullptr && quantizedReference != nullptr && quantized != nullptr);
+
+    uint32_t rngState = 0xBEEF;
+    for(uint32_t i = 0; i < pointCount; i++) {
+        points[i] = { (RandomFloat01(&rngState) * 20.0f) - 10.0f, (RandomFloat01(&rngState) * 20.0f) - 10.0f, (RandomFloat01(&rngState) * 20.0f) - 10.0f };
+        otherPoints[i] = { (RandomFloat01(&rngState) * 20.0f) - 10.0f, (RandomFloat01(&rngState) * 20.0f) - 10.0f, (RandomFloat01(&rngState) * 20.0f) - 10.0f };
+    }
+    // a zero vector so normalize has to keep it zero
+    points[0] = { 0.0f, 0.0f, 0.0f };
+    PackVec3x8Scalar(otherPoints, pointCount, otherBlocks);
+
+    // the transposes just move floats so everything has to match exactly
+    PackVec3x8Scalar(points, pointCount, reference);
+    PackVec3x8(points, pointCount, blocks);
+    UnpackVec3x8(blocks, pointCount, unpacked);
+    bool isRoundTripExact = GetMaxVec3x8Difference(blocks, reference, blockCount) == 0.0f &&
+        memcmp(points, unpacked, pointCount * sizeof(Vec3)) == 0;
+    printf("pack/unpack %u points: %s\n", pointCount, isRoundTripExact ? "exact" : "MISMATCH");
+    bool isPassing = isRoundTripExact;
+
+    double seconds = 0.0;
+    uint64_t startTicks = GetTicks();
+    for(uint32_t i = 0; i < iterationCount; i++)
+        PackVec3x8(points, pointCount, blocks);
+    seconds = TicksToSeconds(GetTicks() - startTicks);
+    printf("pack    %6.2f ms\n", (seconds * 1000.0) / iterationCount);
+    startTicks = GetTicks();
+    for(uint32_t i = 0; i < iterationCount; i++)
+        UnpackVec3x8(blocks, pointCount, unpacked);
+    seconds = TicksToSeconds(GetTicks() - startTicks);
+    printf("unpack  %6.2f ms\n", (seconds * 1000.0) / iterationCount);
+
+    // the one at a time Vec3 path the kernels replace
+    Aabb aosBounds = EmptyAabb();
+    startTicks = GetTicks();
+    for(uint32_t i = 0; i < iterationCount; i++) {
+        aosBounds = EmptyAabb();
+        for(uint32_t p = 0; p < pointCount; p++)
+            aosBounds = Grow(aosBounds, points[p]);
+    }
+    seconds = TicksToSeconds(GetTicks() - startTicks);
+    printf("bounds    vec3      %6.2f ms\n", (seconds * 1000.0) / iterationCount);
+
+    struct { const char* name; GetVec3x8BoundsFunc* func; bool isSupported; } boundsVariants[] = {
+        { "scalar", GetVec3x8BoundsScalar, true },
+        { "sse4.1", GetVec3x8BoundsSse41, cpu.hasSse41 },
+        { "avx2", GetVec3x8BoundsAvx2, cpu.hasAvx2 }
+    };
+    for(int v = 0; v < ARRAY_LEN(boundsVariants); v++) {
+        if(!boundsVariants[v].isSupported)
+            continue;
+        Aabb bounds = {};
+        startTicks = GetTicks();
+        for(uint32_t i = 0; i < iterationCount; i++)
+            bounds = boundsVariants[v].func(blocks, blockCount);
+        seconds = TicksToSeconds(GetTicks() - startTicks);
+        float maxDiff = GetMaxAabbDifference(bounds, aosBounds);
+        isPassing = isPassing && maxDiff == 0.0f;
+        printf("bounds    %-9s %6.2f ms, max diff to vec3 %g\n", boundsVariants[v].name, (seconds * 1000.0) / iterationCount, maxDiff);
+    }
+
+    startTicks = GetTicks();
+    for(uint32_t i = 0; i < iterationCount; i++) {
+        for(uint32_t p = 0; p < pointCount; p++)
+            unpacked[p] = Normalize(points[p]);
+    }
+    seconds = TicksToSeconds(GetTicks() - startTicks);
+    printf("normalize vec3      %6.2f ms\n", (seconds * 1000.0) / iterationCount);
+
+    struct { const char* name; NormalizeVec3x8Func* func; bool isSupported; } normalizeVariants[] = {
+        { "scalar", NormalizeVec3x8Scalar, true },
+        { "sse4.1", NormalizeVec3x8Sse41, cpu.hasSse41 },
+        { "avx2+fma", NormalizeVec3x8Avx2, cpu.hasAvx2 && cpu.hasFma }
+    };
+    // the vec3 results from the loop above are the reference
+    PackVec3x8Scalar(unpacked, pointCount, reference);
+    for(int v = 0; v < ARRAY_LEN(normalizeVariants); v++) {
+        if(!normalizeVariants[v].isSupported)
+            continue;
+        // normalizing in place, so every iteration starts from a fresh copy
+        seconds = 0.0;
+        for(uint32_t i = 0; i < iterationCount; i++) {
+            memcpy(results, blocks, blockCount * sizeof(Vec3x8));
+            startTicks = GetTicks();
+            normalizeVariants[v].func(results, blockCount);
+            seconds += TicksToSeconds(GetTicks() - startTicks);
+        }
+        float maxDiff = GetMaxVec3x8Difference(results, reference, blockCount);
+        isPassing = isPassing && maxDiff <= Vec3x8NormalizeTolerance;
+        printf("normalize %-9s %6.2f ms, max diff to vec3 %g\n", normalizeVariants[v].name, (seconds * 1000.0) / iterationCount, maxDiff);
+    }
+
+    Transform transform = { .position = { 1.0f, -2.0f, 3.0f }, .scale = { 0.5f, 2.0f, 1.5f }, .rotation = QuatFromEuler({ 0.3f, 1.2f, 0.0f }) };
+    Mat4 modelMat = GetModelMatFromTransform(transform);
+    startTicks = GetTicks();
+    for(uint32_t i = 0; i < iterationCount; i++) {
+        for(uint32_t p = 0; p < pointCount; p++)
+            unpacked[p] = TransformPoint(modelMat, points[p]);
+    }
+    seconds = TicksToSeconds(GetTicks() - startTicks);
+    printf("transform vec3      %6.2f ms\n", (seconds * 1000.0) / iterationCount);
+
+    struct { const char* name; TransformVec3x8Func* func; bool isSupported; } transformVariants[] = {
+        { "scalar", TransformVec3x8Scalar, true },
+        { "sse4.1", TransformVec3x8Sse41, cpu.hasSse41 },
+        { "avx2+fma", TransformVec3x8Avx2, cpu.hasAvx2 && cpu.hasFma }
+    };
+    PackVec3x8Scalar(unpacked, pointCount, reference);
+    for(int v = 0; v < ARRAY_LEN(transformVariants); v++) {
+        if(!transformVariants[v].isSupported)
+            continue;
+        startTicks = GetTicks();
+        for(uint32_t i = 0; i < iterationCount; i++)
+            transformVariants[v].func(modelMat, blocks, results, blockCount);
+        seconds = TicksToSeconds(GetTicks() - startTicks);
+        float maxDiff = GetMaxVec3x8Difference(results, reference, blockCount);
+        isPassing = isPassing && maxDiff <= Vec3x8TransformTolerance;
+        printf("transform %-9s %6.2f ms, max diff to vec3 %g\n", transformVariants[v].name, (seconds * 1000.0) / iterationCount, maxDiff);
+    }
+
+    Aabb bounds = GetVec3x8BoundsScalar(blocks, blockCount);
+    struct { const char* name; QuantizeVec3x8Func* func; bool isSupported; } quantizeVariants[] = {
+        { "scalar", QuantizeVec3x8Scalar, true },
+        { "sse4.1", QuantizeVec3x8Sse41, cpu.hasSse41 },
+        { "avx2", QuantizeVec3x8Avx2, cpu.hasAvx2 }
+    };
+    QuantizeVec3x8Scalar(blocks, bounds, quantizedReference, blockCount);
+    for(int v = 0; v < ARRAY_LEN(quantizeVariants); v++) {
+        if(!quantizeVariants[v].isSupported)
+            continue;
+        startTicks = GetTicks();
+        for(uint32_t i = 0; i < iterationCount; i++)
+            quantizeVariants[v].func(blocks, bounds, quantized, blockCount);
+        seconds = TicksToSeconds(GetTicks() - startTicks);
+        int maxDiff = GetMaxQuantizedVec3x8Difference(quantized, quantizedReference, blockCount);
+        isPassing = isPassing && maxDiff == 0;
+        printf("quantize  %-9s %6.2f ms, max diff to scalar %d\n", quantizeVariants[v].name, (seconds * 1000.0) / iterationCount, maxDiff);
+    }
+
+    // the binary ops are checked point by point against the Vec3 operators, the padding lanes aren't compared
+    struct { const char* name; const char* variant; BinaryVec3x8Func* func; bool isSupported; float tolerance; } binaryVariants[] = {
+        { "add", "scalar", AddVec3x8Scalar, true, 0.0f },
+        { "add", "sse4.1", AddVec3x8Sse41, cpu.hasSse41, 0.0f },
+        { "add", "avx2", AddVec3x8Avx2, cpu.hasAvx2, 0.0f },
+        { "cross", "scalar", CrossVec3x8Scalar, true, Vec3x8ProductTolerance },
+        { "cross", "sse4.1", CrossVec3x8Sse41, cpu.hasSse41, Vec3x8ProductTolerance },
+        { "cross", "avx2+fma", CrossVec3x8Avx2, cpu.hasAvx2 && cpu.hasFma, Vec3x8ProductTolerance }
+    };
+    for(int v = 0; v < ARRAY_LEN(binaryVariants); v++) {
+        bool isAdd = strcmp(binaryVariants[v].name, "add") == 0;
+        if(strcmp(binaryVariants[v].variant, "scalar") == 0) {
+            startTicks = GetTicks();
+            for(uint32_t i = 0; i < iterationCount; i++) {
+                for(uint32_t p = 0; p < pointCount; p++)
+                    aosResults[p] = isAdd ? points[p] + otherPoints[p] : Cross(points[p], otherPoints[p]);
+            }
+            seconds = TicksToSeconds(GetTicks() - startTicks);
+            printf("%-9s vec3      %6.2f ms\n", binaryVariants[v].name, (seconds * 1000.0) / iterationCount);
+        }
+        if(!binaryVariants[v].isSupported)
+            continue;
+
+        startTicks = GetTicks();
+        for(uint32_t i = 0; i < iterationCount; i++)
+            binaryVariants[v].func(blocks, otherBlocks, results, blockCount);
+        seconds = TicksToSeconds(GetTicks() - startTicks);
+        UnpackVec3x8(results, pointCount, unpacked);
+        float maxDiff = GetMaxVec3Difference(unpacked, aosResults, pointCount);
+        isPassing = isPassing && maxDiff <= binaryVariants[v].tolerance;
+        printf("%-9s %-9s %6.2f ms, max diff to vec3 %g\n", binaryVariants[v].name, binaryVariants[v].variant,
+            (seconds * 1000.0) / iterationCount, maxDiff);
+    }
+
+    startTicks = GetTicks();
+    for(uint32_t i = 0; i < iterationCount; i++) {
+        for(uint32_t p = 0; p < pointCount; p++)
+            aosDots[p] = Dot(points[p], otherPoints[p]);
+    }
+    seconds = TicksToSeconds(GetTicks() - startTicks);
+    printf("dot       vec3      %6.2f ms\n", (seconds * 1000.0) / iterationCount);
+
+    struct { const char* name; DotVec3x8Func* func; bool isSupported; } dotVariants[] = {
+        { "scalar", DotVec3x8Scalar, true },
+        { "sse4.1", DotVec3x8Sse41, cpu.hasSse41 },
+        { "avx2+fma", DotVec3x8Avx2, cpu.hasAvx2 && cpu.hasFma }
+    };
+    for(int v = 0; v < ARRAY_LEN(dotVariants); v++) {
+        if(!dotVariants[v].isSupported)
+            continue;
+        startTicks = GetTicks();
+        for(uint32_t i = 0; i < iterationCount; i++)
+            dotVariants[v].func(blocks, otherBlocks, dots, blockCount);
+        seconds = TicksToSeconds(GetTicks() - startTicks);
+        float maxDiff = 0.0f;
+        for(uint32_t p = 0; p < pointCount; p++)
+            maxDiff = fmaxf(maxDiff, fabsf(dots[p] - aosDots[p]));
+        isPassing = isPassing && maxDiff <= Vec3x8ProductTolerance;
+        printf("dot       %-9s %6.2f ms, max diff to vec3 %g\n", dotVariants[v].name, (seconds * 1000.0) / iterationCount, maxDiff);
+    }
+    printf("%s\n", isPassing ? "all kernels match" : "MISMATCH");
+
+    _aligned_free(quantized);
+    _aligned_free(quantizedReference);
+    FreeVec3x8Blocks(results);
+    FreeVec3x8Blocks(reference);
+    FreeVec3x8Blocks(otherBlocks);
+    FreeVec3x8Blocks(blocks);
+    _aligned_free(dots);
+    free(aosDots);
+    free(aosResults);
+    free(unpacked);
+    free(otherPoints);
+    free(points);
+    return isPassing;
+}
+
+// double precision references for the --bench-math accuracy checks, same data[column][row] layout as Mat4
+struct Mat4d
+{
+    double data[4][4];
+};
+
+Mat4d ToMat4d(const Mat4& mat)
+{
+    Mat4d res = {};
+    for(int col = 0; col < 4; col++) {
+        for(int row = 0; row < 4; row++)
+            res.data[col][row] = mat.data[col][row];
+    }
+    return res;
+}
+
+Mat4d IdentityMat4d()
+{
+    Mat4d res = {};
+    for(int i = 0; i < 4; i++)
+        res.data[i][i] = 1.0;
+    return res;
+}
+
+Mat4d MulMat4d(const Mat4d& one, const Mat4d& other)
+{
+    Mat4d res = {};
+    for(int col = 0; col < 4; col++) {
+        for(int row = 0; row < 4; row++) {
+            for(int i = 0; i < 4; i++)
+                res.data[col][row] += one.data[i][row] * other.data[col][i];
+        }
+    }
+    return res;
+}
+
+// gauss-jordan with partial pivoting, the determinant falls out of the pivots
+Mat4d InverseMat4d(const Mat4d& mat, double* determ)
+{
+    Mat4d work = mat;
+    Mat4d res = IdentityMat4d();
+    double determAcc = 1.0;
+    for(int pivotCol = 0; pivotCol < 4; pivotCol++) {
+        int pivotRow = pivotCol;
+        for(int row = pivotCol + 1; row < 4; row++) {
+            if(fabs(work.data[pivotCol][row]) > fabs(work.data[pivotCol][pivotRow]))
+                pivotRow = row;
+        }
+        if(pivotRow != pivotCol) {
+            determAcc = -determAcc;
+            for(int col = 0; col < 4; col++) {
+                double temp = work.data[col][pivotRow];
+                work.data[col][pivotRow] = work.data[col][pivotCol];
+                work.data[col][pivotCol] = temp;
+                temp = res.data[col][pivotRow];
+                res.data[col][pivotRow] = res.data[col][pivotCol];
+                res.data[col][pivotCol] = temp;
+            }
+        }
+
+        double pivot = work.data[pivotCol][pivotCol];
+        determAcc *= pivot;
+        for(int col = 0; col < 4; col++) {
+            work.data[col][pivotCol] /= pivot;
+            res.data[col][pivotCol] /= pivot;
+        }
+        for(int row = 0; row < 4; row++) {
+            if(row == pivotCol)
+                continue;
+            double factor = work.data[pivotCol][row];
+            for(int col = 0; col < 4; col++) {
+                work.data[col][row] -= factor * work.data[col][pivotCol];
+                res.data[col][row] -= factor * res.data[col][pivotCol];
+            }
+        }
+    }
+
+    if(determ != nullptr)
+        *determ = determAcc;
+    return res;
+}
+
+Mat4d TransposeMat4d(const Mat4d& mat)
+{
+    Mat4d res = {};
+    for(int col = 0; col < 4; col++) {
+        for(int row = 0; row < 4; row++)
+            res.data[row][col] = mat.data[col][row];
+    }
+    return res;
+}
+
+Mat4d RotateEulerMat4d(int axis, double angleRads)
+{
+    // the same layout as RotateEulerXMat4, RotateEulerYMat4 and RotateEulerZMat4
+    int one = (axis + 1) % 3;
+    int other = (axis + 2) % 3;
+    double cosine = cos(angleRads);
+    double sine = sin(angleRads);
+    Mat4d res = IdentityMat4d();
+    res.data[one][one] = cosine;
+    res.data[one][other] = sine;
+    res.data[other][one] = -sine;
+    res.data[other][other] = cosine;
+    return res;
+}
+
+// T * Rx * Ry * Rz * S
+Mat4d TrsMat4d(const Vec3& position, const Vec3& scale, const Vec3& eulerRads)
+{
+    Mat4d rotation = MulMat4d(MulMat4d(RotateEulerMat4d(0, eulerRads.x), RotateEulerMat4d(1, eulerRads.y)), RotateEulerMat4d(2, eulerRads.z));
+    double scales[3] = { scale.x, scale.y, scale.z };
+    for(int col = 0; col < 3; col++) {
+        for(int row = 0; row < 3; row++)
+            rotation.data[col][row] *= scales[col];
+    }
+    rotation.data[3][0] = position.x;
+    rotation.data[3][1] = position.y;
+    rotation.data[3][2] = position.z;
+    return rotation;
+}
+
+Mat4d LookatMat4d(const Vec3& eye, const Vec3& at, const Vec3& up)
+{
+    double z[3] = { (double)eye.x - at.x, (double)eye.y - at.y, (double)eye.z - at.z };
+    double zLen = sqrt((z[0] * z[0]) + (z[1] * z[1]) + (z[2] * z[2]));
+    for(int i = 0; i < 3; i++)
+        z[i] /= zLen;
+    double x[3] = { (up.y * z[2]) - (up.z * z[1]), (up.z * z[0]) - (up.x * z[2]), (up.x * z[1]) - (up.y * z[0]) };
+    double xLen = sqrt((x[0] * x[0]) + (x[1] * x[1]) + (x[2] * x[2]));
+    for(int i = 0; i < 3; i++)
+        x[i] /= xLen;
+    double y[3] = { (z[1] * x[2]) - (z[2] * x[1]), (z[2] * x[0]) - (z[0] * x[2]), (z[0] * x[1]) - (z[1] * x[0]) };
+    double e[3] = { eye.x, eye.y, eye.z };
+
+    Mat4d res = {};
+    for(int i = 0; i < 3; i++) {
+        res.data[i][0] = x[i];
+        res.data[i][1] = y[i];
+        res.data[i][2] = z[i];
+    }
+    res.data[3][0] = -((x[0] * e[0]) + (x[1] * e[1]) + (x[2] * e[2]));
+    res.data[3][1] = -((y[0] * e[0]) + (y[1] * e[1]) + (y[2] * e[2]));
+    res.data[3][2] = -((z[0] * e[0]) + (z[1] * e[1]) + (z[2] * e[2]));
+    res.data[3][3] = 1.0;
+    return res;
+}
+
+Mat4d PerspectiveProjMat4d(double fovY, double width, double height, double nearClip, double farClip)
+{
+    double yScale = 1.0 / tan(fovY / 2.0);
+    Mat4d res = {};
+    res.data[0][0] = yScale / (width / height);
+    res.data[1][1] = yScale;
+    res.data[2][2] = farClip / (nearClip - farClip);
+    res.data[2][3] = -1.0;
+    res.data[3][2] = nearClip * farClip / (nearClip - farClip);
+    return res;
+}
+
+Mat4d OrthoProjMat4d(double left, double right, double bot, double top, double nearClip, double farClip)
+{
+    Mat4d res = IdentityMat4d();
+    res.data[0][0] = 2.0 / (right - left);
+    res.data[1][1] = 2.0 / (top - bot);
+    res.data[2][2] = 1.0 / (nearClip - farClip);
+    res.data[3][0] = (left + right) / (left - right);
+    res.data[3][1] = (top + bot) / (bot - top);
+    res.data[3][2] = nearClip / (nearClip - farClip);
+    return res;
+}
+
+// error in units in the last place of the largest reference element, so entries that cancel to
+// almost zero, like the cosine of a right angle, don't blow the count up
+double GetMat4UlpError(const Mat4& res, const Mat4d& reference)
+{
+    double maxAbs = 0.0;
+    double maxError = 0.0;
+    for(int col = 0; col < 4; col++) {
+        for(int row = 0; row < 4; row++) {
+            maxAbs = fmax(maxAbs, fabs(reference.data[col][row]));
+            maxError = fmax(maxError, fabs((double)res.data[col][row] - reference.data[col][row]));
+        }
+    }
+    float largest = (float)maxAbs;
+    double ulp = (double)nextafterf(largest, FLT_MAX) - (double)largest;
+    return maxError / ulp;
+}
+
+constexpr uint32_t MathBenchInputCount = 256;
+
+struct MathBenchInputs
+{
+    // diagonally dominant so the general inverses are well conditioned
+    Mat4 mats[MathBenchInputCount];
+    // non-uniform scale so the affine paths are exercised
+    Mat4 modelMats[MathBenchInputCount];
+    Mat4 rigidMats[MathBenchInputCount];
+    Vec4 vecs[MathBenchInputCount];
+    // uniform scale and no z rotation, where T * S * Rx * Ry and T * R * S agree
+    Transform transforms[MathBenchInputCount];
+    Vec3 eulers[MathBenchInputCount];
+    Vec3 eyes[MathBenchInputCount];
+    Vec3 targets[MathBenchInputCount];
+    float angles[MathBenchInputCount];
 };
 
-void FreeDx11ShaderTexture2D(Dx11ShaderTexture2D* shaderTex)
+// every function under test is wrapped to take an input index and hand back a Mat4, scalar results
+// go into data[0][0] and vectors into data[0]
+typedef Mat4 MathBenchFunc(const MathBenchInputs& inputs, uint32_t index);
+typedef Mat4d MathBenchReferenceFunc(const MathBenchInputs& inputs, uint32_t index);
+typedef void TransformPointsFunc(const Mat4& mat, const Vec3* points, Vec4* dest, uint32_t count);
+
+uint32_t GetNextMathBenchIndex(uint32_t index)
+{
+    return (index + 1) % MathBenchInputCount;
+}
+
+Mat4 MathBenchMulMat4Scalar(const MathBenchInputs& in, uint32_t i) { return MulMat4Scalar(in.mats[i], in.mats[GetNextMathBenchIndex(i)]); }
+Mat4 MathBenchMulMat4Sse(const MathBenchInputs& in, uint32_t i) { return MulMat4Sse(in.mats[i], in.mats[GetNextMathBenchIndex(i)]); }
+Mat4 MathBenchMulMat4Avx2(const MathBenchInputs& in, uint32_t i) { return MulMat4Avx2(in.mats[i], in.mats[GetNextMathBenchIndex(i)]); }
+Mat4d MathBenchMulMat4Reference(const MathBenchInputs& in, uint32_t i)
+{
+    return MulMat4d(ToMat4d(in.mats[i]), ToMat4d(in.mats[GetNextMathBenchIndex(i)]));
+}
+
+Mat4 GetMat4FromVec4(const Vec4& vec)
+{
+    Mat4 res = {};
+    res.data[0][0] = vec.x;
+    res.data[0][1] = vec.y;
+    res.data[0][2] = vec.z;
+    res.data[0][3] = vec.w;
+    return res;
+}
+
+Mat4 MathBenchMulMat4Vec4Scalar(const MathBenchInputs& in, uint32_t i) { return GetMat4FromVec4(MulMat4Vec4Scalar(in.mats[i], in.vecs[i])); }
+Mat4 MathBenchMulMat4Vec4Sse(const MathBenchInputs& in, uint32_t i) { return GetMat4FromVec4(MulMat4Vec4Sse(in.mats[i], in.vecs[i])); }
+Mat4 MathBenchMulMat4Vec4Fma(const MathBenchInputs& in, uint32_t i) { return GetMat4FromVec4(MulMat4Vec4Fma(in.mats[i], in.vecs[i])); }
+Mat4d MathBenchMulMat4Vec4Reference(const MathBenchInputs& in, uint32_t i)
+{
+    Mat4d vecMat = {};
+    vecMat.data[0][0] = in.vecs[i].x;
+    vecMat.data[0][1] = in.vecs[i].y;
+    vecMat.data[0][2] = in.vecs[i].z;
+    vecMat.data[0][3] = in.vecs[i].w;
+    return MulMat4d(ToMat4d(in.mats[i]), vecMat);
+}
+
+Mat4 MathBenchDeterm(const MathBenchInputs& in, uint32_t i)
+{
+    Mat4 res = {};
+    res.data[0][0] = Determ(in.mats[i]);
+    return res;
+}
+
+Mat4d MathBenchDetermReference(const MathBenchInputs& in, uint32_t i)
 {
-    shaderTex->texture->Release();   
-    shaderTex->view->Release();   
-    *shaderTex = {};
+    Mat4d res = {};
+    InverseMat4d(ToMat4d(in.mats[i]), &res.data[0][0]);
+    return res;
 }
 
-ID3D11SamplerState* CreateDx11TextureSampler(Dx11& dx)
+Mat4 MathBenchInverseCofactor(const MathBenchInputs& in, uint32_t i) { return InverseCofactor(in.mats[i]); }
+Mat4 MathBenchInverseScalar(const MathBenchInputs& in, uint32_t i) { return InverseScalar(in.mats[i]); }
+Mat4 MathBenchInverseSse(const MathBenchInputs& in, uint32_t i) { return InverseSse(in.mats[i]); }
+Mat4d MathBenchInverseReference(const MathBenchInputs& in, uint32_t i) { return InverseMat4d(ToMat4d(in.mats[i]), nullptr); }
+
+Mat4 MathBenchInverseAffine(const MathBenchInputs& in, uint32_t i) { return InverseAffine(in.modelMats[i]); }
+Mat4d MathBenchInverseAffineReference(const MathBenchInputs& in, uint32_t i) { return InverseMat4d(ToMat4d(in.modelMats[i]), nullptr); }
+Mat4 MathBenchInverseRigid(const MathBenchInputs& in, uint32_t i) { return InverseRigid(in.rigidMats[i]); }
+Mat4d MathBenchInverseRigidReference(const MathBenchInputs& in, uint32_t i) { return InverseMat4d(ToMat4d(in.rigidMats[i]), nullptr); }
+
+// only the upper 3x3 of a normal matrix is meaningful, the transposed inverse carries the translation in its last row
+Mat4 GetUpper3x3(const Mat4& mat)
 {
-    D3D11_SAMPLER_DESC samplerDesc = {
-        .Filter = D3D11_FILTER_MIN_MAG_MIP_LINEAR,
-        .AddressU = D3D11_TEXTURE_ADDRESS_CLAMP,
-        .AddressV = D3D11_TEXTURE_ADDRESS_CLAMP,
-        .AddressW = D3D11_TEXTURE_ADDRESS_CLAMP,
-        .MaxAnisotropy = 1,
-        .ComparisonFunc = D3D11_COMPARISON_ALWAYS
-    };
+    Mat4 res = {};
+    for(int col = 0; col < 3; col++) {
+        for(int row = 0; row < 3; row++)
+            res.data[col][row] = mat.data[col][row];
+    }
+    return res;
+}
 
-    ID3D11SamplerState* sampler = nullptr;
-    HRESULT res = dx.device->CreateSamplerState(&samplerDesc, &sampler);
-    ASSERT(res == S_OK);
+Mat4 MathBenchNormalCofactor(const MathBenchInputs& in, uint32_t i) { return GetUpper3x3(Transpose(InverseCofactor(in.modelMats[i]))); }
+Mat4 MathBenchNormalDirect(const MathBenchInputs& in, uint32_t i) { return GetUpper3x3(NormalMat4FromModelMat(in.modelMats[i])); }
+Mat4d MathBenchNormalReference(const MathBenchInputs& in, uint32_t i)
+{
+    Mat4d res = TransposeMat4d(InverseMat4d(ToMat4d(in.modelMats[i]), nullptr));
+    for(int i = 0; i < 4; i++) {
+        res.data[i][3] = 0.0;
+        res.data[3][i] = 0.0;
+    }
+    return res;
+}
 
-    return sampler;
+Mat4 MathBenchRotateX(const MathBenchInputs& in, uint32_t i) { return RotateEulerXMat4(in.angles[i]); }
+Mat4 MathBenchRotateY(const MathBenchInputs& in, uint32_t i) { return RotateEulerYMat4(in.angles[i]); }
+Mat4 MathBenchRotateZ(const MathBenchInputs& in, uint32_t i) { return RotateEulerZMat4(in.angles[i]); }
+Mat4d MathBenchRotateXReference(const MathBenchInputs& in, uint32_t i) { return RotateEulerMat4d(0, in.angles[i]); }
+Mat4d MathBenchRotateYReference(const MathBenchInputs& in, uint32_t i) { return RotateEulerMat4d(1, in.angles[i]); }
+Mat4d MathBenchRotateZReference(const MathBenchInputs& in, uint32_t i) { return RotateEulerMat4d(2, in.angles[i]); }
+
+// the four matrix path GetModelMatFromTransform used before quaternions, the fused builder is timed against it
+Mat4 MathBenchModelMatEulerProduct(const MathBenchInputs& in, uint32_t i)
+{
+    const Transform& transform = in.transforms[i];
+    return TranslateMat4(transform.position) *
+        ScaleMat4(transform.scale) *
+        RotateEulerXMat4(in.eulers[i].x) *
+        RotateEulerYMat4(in.eulers[i].y);
 }
 
-Dx11ShaderTexture2D CreateDx11ShaderTextureForBakedCharMap(Dx11& dx, BakedCharMap& bakedCharMap)
+Mat4 MathBenchModelMatFused(const MathBenchInputs& in, uint32_t i) { return GetModelMatFromTransform(in.transforms[i]); }
+Mat4d MathBenchModelMatReference(const MathBenchInputs& in, uint32_t i)
 {
-    D3D11_TEXTURE2D_DESC texDesc = {
-        .Width = (UINT)bakedCharMap.fontBitmapWidth,
-        .Height = (UINT)bakedCharMap.fontBitmapHeight,
-        .MipLevels = 1,
-        .ArraySize = 1,
-        .Format = DXGI_FORMAT_R8_UNORM,
-        .SampleDesc = { .Count = 1 },
-        .Usage = D3D11_USAGE_IMMUTABLE,
-        .BindFlags = D3D11_BIND_SHADER_RESOURCE
-    };
+    return TrsMat4d(in.transforms[i].position, in.transforms[i].scale, in.eulers[i]);
+}
 
-    D3D11_SUBRESOURCE_DATA texData = {
-        .pSysMem = bakedCharMap.fontBitmap,
-        .SysMemPitch = (UINT)bakedCharMap.fontBitmapWidth
-    };
+Mat4 MathBenchLookat(const MathBenchInputs& in, uint32_t i) { return LookatMat4(in.eyes[i], in.targets[i], { 0.0f, 1.0f, 0.0f }); }
+Mat4d MathBenchLookatReference(const MathBenchInputs& in, uint32_t i) { return LookatMat4d(in.eyes[i], in.targets[i], { 0.0f, 1.0f, 0.0f }); }
 
-    ID3D11Texture2D* tex = nullptr;
-    HRESULT res = dx.device->CreateTexture2D(
-        &texDesc,
-        &texData,
-        &tex
-    );
-    ASSERT(res == S_OK);
+// angles doubles as the field of view and eyes as the clip planes
+Mat4 MathBenchPerspective(const MathBenchInputs& in, uint32_t i)
+{
+    return PerspectiveProjMat4(0.3f + fabsf(in.angles[i]) * 0.3f, 1280.0f, 720.0f, 0.1f, 100.0f + fabsf(in.eyes[i].x) * 10.0f);
+}
 
-    ID3D11ShaderResourceView* view = nullptr;
-    res = dx.device->CreateShaderResourceView(
-        tex,
-        nullptr,
-        &view
-    );
-    ASSERT(res == S_OK);
+Mat4d MathBenchPerspectiveReference(const MathBenchInputs& in, uint32_t i)
+{
+    float fovY = 0.3f + fabsf(in.angles[i]) * 0.3f;
+    float farClip = 100.0f + fabsf(in.eyes[i].x) * 10.0f;
+    return PerspectiveProjMat4d(fovY, 1280.0, 720.0, (double)0.1f, farClip);
+}
 
-    return {
-        .texture = tex,
-        .view = view
-    };
+Mat4 MathBenchOrtho(const MathBenchInputs& in, uint32_t i)
+{
+    const Vec3& corner = in.eyes[i];
+    return OrthoProjMat4(corner.x, corner.x + 1280.0f, corner.y, corner.y + 720.0f, 0.0f, 1.0f + fabsf(corner.z));
 }
 
-void DrawLine(Dx11& dx, Vec3 position, Vec3 scale, float yRotation, ID3D11Buffer* cBuffer, const FpsCam& cam)
+Mat4d MathBenchOrthoReference(const MathBenchInputs& in, uint32_t i)
 {
-    BasicColorShaderData shaderData = { .color = { 0.0f, 0.0f, 0.0f, 1.0f } };
-    Mat4 modelMat = TranslateMat4(position) * ScaleMat4(scale) * RotateEulerYMat4(toRadians(yRotation));
-    shaderData.xformMat = cam.projMat * cam.viewMat * modelMat;
-    UploadDataToBuffer(dx, cBuffer, &shaderData, sizeof(shaderData));
-    dx.context->VSSetConstantBuffers(0, 1, &cBuffer);
-    dx.context->Draw(2, 0);
+    const Vec3& corner = in.eyes[i];
+    return OrthoProjMat4d(corner.x, corner.x + 1280.0f, corner.y, corner.y + 720.0f, 0.0, 1.0f + fabsf(corner.z));
 }
 
-struct LineGrid
+// every SIMD variant has to be this much faster than the scalar variant of the same function
+constexpr double MathBenchMinSimdSpeedup = 1.1;
+// compilers vectorize the scalar mat4 product into the same shuffles as the sse one, it only has to keep up
+constexpr double MathBenchMinMat4SseSpeedup = 0.8;
+// timings are the fastest of a few runs so a busy machine doesn't fail the speed gate as easily
+constexpr int MathBenchTimingRunCount = 3;
+
+// one row of the --bench-math report
+struct MathBenchEntry
+{
+    const char* name;
+    const char* variant;
+    double nsPerOp;
+    double maxUlpError;
+    double ulpTolerance;
+    // 0 when the entry isn't compared against a scalar variant
+    double minSpeedup;
+    double speedup;
+    bool isPassing;
+};
+
+struct MathBenchReport
 {
-    Dx11VertexBuffer positionVertexBuffer;
-    Mat4* instanceData;
-    Dx11VertexBuffer instanceVertexBuffer;
-    UINT totalLineCount;
+    MathBenchEntry entries[48];
+    int entryCount;
+    bool isPassing;
 };
 
-void FreeLineGrid(LineGrid* grid)
+void AddMathBenchEntry(MathBenchReport* report, MathBenchEntry entry)
 {
-    grid->positionVertexBuffer.buffer->Release();
-    grid->instanceVertexBuffer.buffer->Release();
-    free(grid->instanceData);
-    *grid = {};
+    ASSERT(report->entryCount < ARRAY_LEN(report->entries));
+    bool isAccurate = entry.maxUlpError <= entry.ulpTolerance;
+    bool isFastEnough = true;
+    if(entry.minSpeedup > 0.0) {
+        for(int i = 0; i < report->entryCount; i++) {
+            const MathBenchEntry& baseline = report->entries[i];
+            if(strcmp(baseline.name, entry.name) == 0 && strcmp(baseline.variant, "scalar") == 0)
+                entry.speedup = entry.nsPerOp > 0.0 ? baseline.nsPerOp / entry.nsPerOp : 0.0;
+        }
+        isFastEnough = entry.speedup >= entry.minSpeedup;
+    }
+    entry.isPassing = isAccurate && isFastEnough;
+    report->entries[report->entryCount++] = entry;
+    report->isPassing = report->isPassing && entry.isPassing;
+
+    printf("%-16s %-9s %8.2f ns, max error %7.2f ulp (tolerance %g)", entry.name, entry.variant, entry.nsPerOp,
+        entry.maxUlpError, entry.ulpTolerance);
+    if(entry.minSpeedup > 0.0)
+        printf(", %.2fx scalar (min %.2fx)", entry.speedup, entry.minSpeedup);
+    printf("%s%s\n", isAccurate ? "" : " TOO INACCURATE", isFastEnough ? "" : " TOO SLOW");
 }
 
-LineGrid GenerateLineGrid(Dx11& dx, int xSquaresHalf, int zSquaresHalf)
-{
-    LineGrid grid = {};
-    grid.positionVertexBuffer = CreateDx11VertexBuffer(dx, BufferUsageType::Static, lineVertices, 
-        sizeof(lineVertices), 3 * sizeof(float), 0);
-    
-    int nrOfXLines = 1 + (zSquaresHalf * 2);
-    int nrOfZLines = 1 + (xSquaresHalf * 2);
-    grid.totalLineCount = nrOfXLines + nrOfZLines;
-    
-    grid.instanceData = (Mat4*)calloc(1, grid.totalLineCount * sizeof(Mat4));
-    ASSERT(grid.instanceData != nullptr);
+bool WriteMathBenchJson(const char* filename, const MathBenchReport& report)
+{
+    char json[8192] = {};
+    int len = snprintf(json, sizeof(json), "{\n    \"pass\": %s,\n    \"entries\": [\n", report.isPassing ? "true" : "false");
+    for(int i = 0; i < report.entryCount && len > 0 && len < (int)sizeof(json); i++) {
+        const MathBenchEntry& entry = report.entries[i];
+        len += snprintf(json + len, sizeof(json) - len,
+            "        { \"name\": \"%s\", \"variant\": \"%s\", \"nsPerOp\": %.3f, \"maxUlpError\": %.3f, \"ulpTolerance\": %.1f, "
+            "\"speedup\": %.3f, \"minSpeedup\": %.2f, \"pass\": %s }%s\n",
+            entry.name, entry.variant, entry.nsPerOp, entry.maxUlpError, entry.ulpTolerance, entry.speedup, entry.minSpeedup,
+            entry.isPassing ? "true" : "false", i + 1 < report.entryCount ? "," : "");
+    }
+    if(len > 0 && len < (int)sizeof(json))
+        len += snprintf(json + len, sizeof(json) - len, "    ]\n}\n");
+    return len > 0 && len < (int)sizeof(json) && WriteAllBytesToFile(filename, json, (size_t)len);
+}
 
-    int instanceWriteIndex = 0;
-    // draw lines parallel to x-axis
-    for(int i = 0; i < nrOfXLines; i++) {
-        Transform transform = {
-            .scale = { (float)(nrOfZLines - 1), 1.0f, 1.0f }
+// headless accuracy and speed suite for the hand written math, errors are against double precision references,
+// writes math_bench.json and returns false when any function is past its ulp tolerance or a SIMD variant
+// isn't faster than its scalar one, run with --bench-math
+bool RunMathBenchmark(uint32_t iterationCount)
+{
+    const CpuFeatures& cpu = GetCpuFeatures();
+    printf("cpu: sse2 %d, sse4.1 %d, avx %d, avx2 %d, fma %d\n", cpu.hasSse2, cpu.hasSse41, cpu.hasAvx, cpu.hasAvx2, cpu.hasFma);
+
+    MathBenchInputs* inputs = (MathBenchInputs*)calloc(1, sizeof(MathBenchInputs));
+    ASSERT(inputs != nullptr);
+    uint32_t rngState = 0xC0FFEE;
+    for(uint32_t i = 0; i < MathBenchInputCount; i++) {
+        for(int col = 0; col < 4; col++) {
+            for(int row = 0; row < 4; row++)
+                inputs->mats[i].data[col][row] = ((RandomFloat01(&rngState) * 2.0f) - 1.0f) + (col == row ? 4.0f : 0.0f);
+        }
+        inputs->vecs[i] = { RandomFloat01(&rngState), RandomFloat01(&rngState), RandomFloat01(&rngState), 1.0f };
+        inputs->eulers[i] = { RandomFloat01(&rngState) * 6.28f, RandomFloat01(&rngState) * 6.28f, 0.0f };
+        inputs->angles[i] = (RandomFloat01(&rngState) * 12.56f) - 6.28f;
+        inputs->eyes[i] = { (RandomFloat01(&rngState) * 20.0f) - 10.0f, (RandomFloat01(&rngState) * 20.0f) - 10.0f, (RandomFloat01(&rngState) * 20.0f) - 10.0f };
+        inputs->targets[i] = { RandomFloat01(&rngState) - 0.5f, RandomFloat01(&rngState) - 0.5f, RandomFloat01(&rngState) - 0.5f };
+
+        Vec3 position = { (RandomFloat01(&rngState) * 20.0f) - 10.0f, (RandomFloat01(&rngState) * 20.0f) - 10.0f, (RandomFloat01(&rngState) * 20.0f) - 10.0f };
+        float uniformScale = 0.5f + RandomFloat01(&rngState);
+        inputs->transforms[i] = {
+            .position = position,
+            .scale = { uniformScale, uniformScale, uniformScale },
+            .rotation = QuatFromEuler(inputs->eulers[i])
         };
-        transform.position.z = (float)i;
-        transform.position.z -= (float)((nrOfXLines - 1) / 2);
-        grid.instanceData[instanceWriteIndex++] = GetModelMatFromTransform(transform);
+        Transform modelTransform = {
+            .position = position,
+            .scale = { 0.5f + RandomFloat01(&rngState), 0.5f + RandomFloat01(&rngState), 0.5f + RandomFloat01(&rngState) },
+            .rotation = inputs->transforms[i].rotation
+        };
+        inputs->modelMats[i] = GetModelMatFromTransform(modelTransform);
+        modelTransform.scale = { 1.0f, 1.0f, 1.0f };
+        inputs->rigidMats[i] = GetModelMatFromTransform(modelTransform);
     }
 
-    // draw lines parallel to z-axis
-    for(int i = 0; i < nrOfZLines; i++) {
-        Transform transform = {
-            .scale = { 1.0f, 1.0f, (float)(nrOfXLines - 1) }
-        };
-        transform.position.x = (float)i;
-        transform.position.x -= (float)((nrOfZLines - 1) / 2);
-        transform.rotation.y = toRadians(90.0f);
-        grid.instanceData[instanceWriteIndex++] = GetModelMatFromTransform(transform);
+    // the tolerances leave headroom over what the kernels do today, they're there to catch regressions
+    struct { const char* name; const char* variant; MathBenchFunc* func; MathBenchReferenceFunc* reference; double ulpTolerance; bool isSupported; double minSpeedup; } cases[] = {
+        { "mat4 * mat4", "scalar", MathBenchMulMat4Scalar, MathBenchMulMat4Reference, 8.0, true },
+        { "mat4 * mat4", "sse", MathBenchMulMat4Sse, MathBenchMulMat4Reference, 8.0, cpu.hasSse2, MathBenchMinMat4SseSpeedup },
+        { "mat4 * mat4", "avx2+fma", MathBenchMulMat4Avx2, MathBenchMulMat4Reference, 8.0, cpu.hasAvx2 && cpu.hasFma, MathBenchMinSimdSpeedup },
+        { "mat4 * vec4", "scalar", MathBenchMulMat4Vec4Scalar, MathBenchMulMat4Vec4Reference, 8.0, true },
+        { "mat4 * vec4", "sse", MathBenchMulMat4Vec4Sse, MathBenchMulMat4Vec4Reference, 8.0, cpu.hasSse2, MathBenchMinSimdSpeedup },
+        { "mat4 * vec4", "fma", MathBenchMulMat4Vec4Fma, MathBenchMulMat4Vec4Reference, 8.0, cpu.hasFma, MathBenchMinSimdSpeedup },
+        { "determ", "cofactor", MathBenchDeterm, MathBenchDetermReference, 64.0, true },
+        { "inverse", "cofactor", MathBenchInverseCofactor, MathBenchInverseReference, 64.0, true },
+        { "inverse", "scalar", MathBenchInverseScalar, MathBenchInverseReference, 64.0, true },
+        { "inverse", "sse", MathBenchInverseSse, MathBenchInverseReference, 64.0, cpu.hasSse2, MathBenchMinSimdSpeedup },
+        { "inverse affine", "scalar", MathBenchInverseAffine, MathBenchInverseAffineReference, 32.0, true },
+        { "inverse rigid", "scalar", MathBenchInverseRigid, MathBenchInverseRigidReference, 32.0, true },
+        { "normal mat", "cofactor", MathBenchNormalCofactor, MathBenchNormalReference, 32.0, true },
+        { "normal mat", "direct", MathBenchNormalDirect, MathBenchNormalReference, 32.0, true },
+        { "rotate x", "scalar", MathBenchRotateX, MathBenchRotateXReference, 4.0, true },
+        { "rotate y", "scalar", MathBenchRotateY, MathBenchRotateYReference, 4.0, true },
+        { "rotate z", "scalar", MathBenchRotateZ, MathBenchRotateZReference, 4.0, true },
+        { "model mat", "euler", MathBenchModelMatEulerProduct, MathBenchModelMatReference, 32.0, true },
+        { "model mat", "fused", MathBenchModelMatFused, MathBenchModelMatReference, 32.0, true },
+        { "lookat", "scalar", MathBenchLookat, MathBenchLookatReference, 16.0, true },
+        { "perspective", "scalar", MathBenchPerspective, MathBenchPerspectiveReference, 8.0, true },
+        { "ortho", "scalar", MathBenchOrtho, MathBenchOrthoReference, 8.0, true }
+    };
+
+    MathBenchReport report = { .isPassing = true };
+    float sink = 0.0f;
+    for(int c = 0; c < ARRAY_LEN(cases); c++) {
+        if(!cases[c].isSupported)
+            continue;
+        double maxUlpError = 0.0;
+        for(uint32_t i = 0; i < MathBenchInputCount; i++)
+            maxUlpError = fmax(maxUlpError, GetMat4UlpError(cases[c].func(*inputs, i), cases[c].reference(*inputs, i)));
+
+        double seconds = DBL_MAX;
+        for(int run = 0; run < MathBenchTimingRunCount; run++) {
+            uint64_t startTicks = GetTicks();
+            for(uint32_t i = 0; i < iterationCount; i++)
+                sink += cases[c].func(*inputs, i % MathBenchInputCount).data[0][0];
+            seconds = fmin(seconds, TicksToSeconds(GetTicks() - startTicks));
+        }
+
+        AddMathBenchEntry(&report, {
+            .name = cases[c].name,
+            .variant = cases[c].variant,
+            .nsPerOp = (seconds * 1e9) / iterationCount,
+            .maxUlpError = maxUlpError,
+            .ulpTolerance = cases[c].ulpTolerance,
+            .minSpeedup = cases[c].minSpeedup
+        });
     }
 
-    grid.instanceVertexBuffer = CreateDx11VertexBuffer(dx, BufferUsageType::Static, grid.instanceData, 
-        grid.totalLineCount * sizeof(Mat4), sizeof(Mat4), 0);
-    
-    return grid;
-}
+    // batched, so it's timed per point over whole arrays rather than through the per index wrappers
+    Vec3 points[MathBenchInputCount];
+    Vec4 transformed[MathBenchInputCount];
+    for(uint32_t i = 0; i < MathBenchInputCount; i++)
+        points[i] = { inputs->vecs[i].x, inputs->vecs[i].y, inputs->vecs[i].z };
+    struct { const char* variant; TransformPointsFunc* func; bool isSupported; double minSpeedup; } pointVariants[] = {
+        { "scalar", TransformPointsScalar, true },
+        { "sse", TransformPointsSse, cpu.hasSse2, MathBenchMinSimdSpeedup },
+        { "avx2+fma", TransformPointsAvx2, cpu.hasAvx2 && cpu.hasFma, MathBenchMinSimdSpeedup }
+    };
+    for(int v = 0; v < ARRAY_LEN(pointVariants); v++) {
+        if(!pointVariants[v].isSupported)
+            continue;
+        pointVariants[v].func(inputs->mats[0], points, transformed, MathBenchInputCount);
+        Mat4d mat = ToMat4d(inputs->mats[0]);
+        double maxUlpError = 0.0;
+        for(uint32_t i = 0; i < MathBenchInputCount; i++) {
+            Mat4d point = {};
+            point.data[0][0] = points[i].x;
+            point.data[0][1] = points[i].y;
+            point.data[0][2] = points[i].z;
+            point.data[0][3] = 1.0;
+            maxUlpError = fmax(maxUlpError, GetMat4UlpError(GetMat4FromVec4(transformed[i]), MulMat4d(mat, point)));
+        }
 
-void DrawLineGrid(Dx11& dx, LineGrid& grid, ID3D11InputLayout* inputLayout, Dx11Program& program,
-    void* programData, UINT programDataByteSize)
-{
-    dx.context->IASetVertexBuffers(0, 1, &grid.positionVertexBuffer.buffer, &grid.positionVertexBuffer.stride, 
-        &grid.positionVertexBuffer.byteOffset);
-    dx.context->IASetVertexBuffers(1, 1, &grid.instanceVertexBuffer.buffer, &grid.instanceVertexBuffer.stride, 
-        &grid.instanceVertexBuffer.byteOffset);
-    dx.context->IASetInputLayout(inputLayout);
-    dx.context->IASetPrimitiveTopology(D3D_PRIMITIVE_TOPOLOGY_LINELIST);
-    dx.context->VSSetShader(program.vs, nullptr, 0);
-    dx.context->PSSetShader(program.ps, nullptr, 0);
+        uint32_t batchCount = iterationCount / MathBenchInputCount;
+        double seconds = DBL_MAX;
+        for(int run = 0; run < MathBenchTimingRunCount; run++) {
+            uint64_t startTicks = GetTicks();
+            for(uint32_t i = 0; i < batchCount; i++)
+                pointVariants[v].func(inputs->mats[i % MathBenchInputCount], points, transformed, MathBenchInputCount);
+            seconds = fmin(seconds, TicksToSeconds(GetTicks() - startTicks));
+        }
+        sink += transformed[0].x;
+
+        AddMathBenchEntry(&report, {
+            .name = "mat4 * vec3[]",
+            .variant = pointVariants[v].variant,
+            .nsPerOp = (seconds * 1e9) / ((double)batchCount * MathBenchInputCount),
+            .maxUlpError = maxUlpError,
+            .ulpTolerance = 8.0,
+            .minSpeedup = pointVariants[v].minSpeedup
+        });
+    }
 
-    UploadDataToBuffer(dx, program.cBuffer, programData, programDataByteSize);
-    dx.context->VSSetConstantBuffers(0, 1, &program.cBuffer);
-    dx.context->DrawInstanced(2, grid.totalLineCount, 0, 0);
+    printf("checksum %g\n", sink);
+    const char* jsonFilename = "math_bench.json";
+    if(!WriteMathBenchJson(jsonFilename, report))
+        printf("failed to write %s\n", jsonFilename);
+    printf("%s, report written to %s\n", report.isPassing ? "all within tolerance" : "ACCURACY OR SPEED REGRESSION", jsonFilename);
+
+    free(inputs);
+    return report.isPassing;
 }
 
-void DrawDx11Model(Dx11& dx, Dx11ModelData& model, ID3D11InputLayout* inputLayout, const Dx11Program& program, 
-    void* programData, UINT programDataByteSize)
-{
-    dx.context->IASetVertexBuffers(0, model.vertexBufferCount, model.vertexBuffers, model.vertexBufferStrides, model.vertexBufferOffsets);
-    dx.context->IASetInputLayout(inputLayout);
-    dx.context->IASetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
-    dx.context->VSSetShader(program.vs, nullptr, 0);
-    dx.context->PSSetShader(program.ps, nullptr, 0);
+// the HUD lines formatted with snprintf + StringViewFromCString and with TextBuilder
+uint32_t FormatHudLinesWithSnprintf(char (*lines)[MaxTextRunLen], const Vec3& boxMin, const Vec3& boxMax, float radius,
+    uint32_t visibleCount, float deltaTime)
+{
+    uint32_t totalLen = 0;
+    snprintf(lines[0], MaxTextRunLen, "mesh: %u degenerate, %u zero area, %u bad indices, %u non-manifold, %u holes, %u duplicates",
+        0u, 0u, 0u, 0u, 0u, 0u);
+    snprintf(lines[1], MaxTextRunLen, "bounds: (%.2f %.2f %.2f)-(%.2f %.2f %.2f) r %.2f", 
+        boxMin.x, boxMin.y, boxMin.z, boxMax.x, boxMax.y, boxMax.z, radius);
+    snprintf(lines[2], MaxTextRunLen, "model vertices: %d, visible objects: %u/%u (%u occluded), instances: %u", 
+        2904, visibleCount, 8u, 8u - visibleCount, 0u);
+    snprintf(lines[3], MaxTextRunLen, "frame time: %f (%d FPS)", deltaTime, (int)(1.0f / deltaTime));
+    for(int i = 0; i < 4; i++)
+        totalLen += (uint32_t)StringViewFromCString(lines[i]).len;
+    return totalLen;
+}
 
-    UploadDataToBuffer(dx, program.cBuffer, programData, programDataByteSize);
-    dx.context->VSSetConstantBuffers(0, 1, &program.cBuffer);
-    dx.context->Draw(model.vertexCount, 0);
+uint32_t FormatHudLinesWithTextBuilder(char (*lines)[MaxTextRunLen], const Vec3& boxMin, const Vec3& boxMax, float radius,
+    uint32_t visibleCount, float deltaTime)
+{
+    uint32_t totalLen = 0;
+    TextBuilder line = CreateTextBuilder(lines[0], MaxTextRunLen);
+    AppendText(&line, STRING_VIEW("mesh: "));
+    AppendUint(&line, 0);
+    AppendText(&line, STRING_VIEW(" degenerate, "));
+    AppendUint(&line, 0);
+    AppendText(&line, STRING_VIEW(" zero area, "));
+    AppendUint(&line, 0);
+    AppendText(&line, STRING_VIEW(" bad indices, "));
+    AppendUint(&line, 0);
+    AppendText(&line, STRING_VIEW(" non-manifold, "));
+    AppendUint(&line, 0);
+    AppendText(&line, STRING_VIEW(" holes, "));
+    AppendUint(&line, 0);
+    AppendText(&line, STRING_VIEW(" duplicates"));
+    totalLen += (uint32_t)line.len;
+
+    line = CreateTextBuilder(lines[1], MaxTextRunLen);
+    AppendText(&line, STRING_VIEW("bounds: "));
+    AppendVec3Fixed(&line, boxMin, 2);
+    AppendText(&line, STRING_VIEW("-"));
+    AppendVec3Fixed(&line, boxMax, 2);
+    AppendText(&line, STRING_VIEW(" r "));
+    AppendFloatFixed(&line, radius, 2);
+    totalLen += (uint32_t)line.len;
+
+    line = CreateTextBuilder(lines[2], MaxTextRunLen);
+    AppendText(&line, STRING_VIEW("model vertices: "));
+    AppendInt(&line, 2904);
+    AppendText(&line, STRING_VIEW(", visible objects: "));
+    AppendUint(&line, visibleCount);
+    AppendText(&line, STRING_VIEW("/"));
+    AppendUint(&line, 8);
+    AppendText(&line, STRING_VIEW(" ("));
+    AppendUint(&line, 8 - visibleCount);
+    AppendText(&line, STRING_VIEW(" occluded), instances: "));
+    AppendUint(&line, 0);
+    totalLen += (uint32_t)line.len;
+
+    line = CreateTextBuilder(lines[3], MaxTextRunLen);
+    AppendText(&line, STRING_VIEW("frame time: "));
+    AppendFloatFixed(&line, deltaTime, 6);
+    AppendText(&line, STRING_VIEW(" ("));
+    AppendInt(&line, (int)(1.0f / deltaTime));
+    AppendText(&line, STRING_VIEW(" FPS)"));
+    totalLen += (uint32_t)line.len;
+    return totalLen;
 }
 
-void DrawText(Dx11& dx, UINT textLen, Dx11VertexBuffer& positionVertexBuffer, Dx11VertexBuffer& instanceVertexBuffer, 
-    ID3D11InputLayout* inputLayout, const Dx11Program& program, 
-    void* programData, UINT programDataByteSize, Dx11ShaderTexture2D& shaderTex, ID3D11SamplerState* shaderTexSampler)
-{
-    UINT dummyOffset = 0;
-    dx.context->IASetVertexBuffers(0, 1, &positionVertexBuffer.buffer, &positionVertexBuffer.stride, &dummyOffset);
-    dx.context->IASetVertexBuffers(1, 1, &instanceVertexBuffer.buffer, &instanceVertexBuffer.stride, &dummyOffset);
-    dx.context->IASetInputLayout(inputLayout);
-    dx.context->IASetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
-    dx.context->VSSetShader(program.vs, nullptr, 0);
-    dx.context->PSSetShader(program.ps, nullptr, 0);
+// headless check of the formatters against printf and strtof plus a HUD line timing, run with --bench-format
+bool RunFormatBenchmark(uint32_t sampleCount, int frameCount)
+{
+    uint32_t rngState = 0xF0A7;
+    char text[64] = {};
+    char reference[64] = {};
+
+    uint32_t intMismatchCount = 0;
+    const int64_t edgeInts[] = { 0, 1, -1, 9, 10, 99, 100, -100, 123456789, INT32_MIN, INT32_MAX, INT64_MIN, INT64_MAX };
+    for(uint32_t i = 0; i < sampleCount + ARRAY_LEN(edgeInts); i++) {
+        int64_t value = i < ARRAY_LEN(edgeInts) ? edgeInts[i] : 
+            (int64_t)(((uint64_t)XorShift32(&rngState) << 32) | XorShift32(&rngState)) >> (XorShift32(&rngState) % 64);
+        size_t len = FormatInt(text, sizeof(text), value);
+        int refLen = snprintf(reference, sizeof(reference), "%lld", (long long)value);
+        intMismatchCount += len != (size_t)refLen || memcmp(text, reference, len) != 0;
+
+        len = FormatUint(text, sizeof(text), (uint64_t)value);
+        refLen = snprintf(reference, sizeof(reference), "%llu", (unsigned long long)value);
+        intMismatchCount += len != (size_t)refLen || memcmp(text, reference, len) != 0;
+    }
 
-    UploadDataToBuffer(dx, program.cBuffer, programData, programDataByteSize);
-    dx.context->VSSetConstantBuffers(0, 1, &program.cBuffer);
-    dx.context->PSSetSamplers(0, 1, &shaderTexSampler);
-    dx.context->PSSetShaderResources(0, 1, &shaderTex.view);
-    dx.context->DrawInstanced(6, textLen, 0, 0);
+    // fixed precision has to match printf exactly, ties included
+    uint32_t fixedMismatchCount = 0;
+    const float edgeFloats[] = { 0.0f, -0.0f, 0.125f, 0.375f, 2.5f, -2.5f, 0.0166666f, 1.0f / 3.0f, 999.995f, 1e-7f, 123456.0f };
+    for(uint32_t i = 0; i < sampleCount + ARRAY_LEN(edgeFloats); i++) {
+        float value = i < ARRAY_LEN(edgeFloats) ? edgeFloats[i] :
+            (RandomFloat01(&rngState) - 0.5f) * GetFormatPow10((int)(XorShift32(&rngState) % 14) - 4);
+        int precision = (int)(i % (MaxFormatFixedPrecision + 1));
+        size_t len = FormatFloatFixed(text, sizeof(text), value, precision);
+        int refLen = snprintf(reference, sizeof(reference), "%.*f", precision, value);
+        fixedMismatchCount += len != (size_t)refLen || memcmp(text, reference, len) != 0;
+    }
+
+    // any finite bit pattern has to parse back to itself with no more digits than the shortest %.*e that does
+    uint32_t roundTripFailCount = 0;
+    uint32_t longerCount = 0;
+    const float edgeShortestFloats[] = { FLT_MAX, -FLT_MAX, FLT_MIN, FLT_TRUE_MIN, 16777216.0f, 0.1f, 1e-5f, 1e9f };
+    for(uint32_t i = 0; i < sampleCount + ARRAY_LEN(edgeShortestFloats); i++) {
+        uint32_t bits = XorShift32(&rngState);
+        float value = 0.0f;
+        memcpy(&value, &bits, sizeof(value));
+        if(i < ARRAY_LEN(edgeShortestFloats))
+            value = edgeShortestFloats[i];
+        if(!isfinite(value))
+            continue;
+        size_t len = FormatFloat(text, sizeof(text) - 1, value);
+        text[len] = '\0';
+        if(strtof(text, nullptr) != value)
+            roundTripFailCount++;
+
+        int shortestDigitCount = 1;
+        while(shortestDigitCount < 9) {
+            snprintf(reference, sizeof(reference), "%.*e", shortestDigitCount - 1, value);
+            if(strtof(reference, nullptr) == value)
+                break;
+            shortestDigitCount++;
+        }
+        int digitCount = 0;
+        bool isExponent = false;
+        bool isLeadingZero = true;
+        for(size_t c = 0; c < len && !isExponent; c++) {
+            isExponent = text[c] == 'e';
+            if(text[c] >= '1' && text[c] <= '9')
+                isLeadingZero = false;
+            if(!isExponent && !isLeadingZero && text[c] >= '0' && text[c] <= '9')
+                digitCount++;
+        }
+        // trailing zeros of plain integers like 1200 don't count as significant
+        for(size_t c = len; c > 0 && !isExponent && text[c - 1] == '0' && memchr(text, '.', len) == nullptr; c--)
+            digitCount--;
+        longerCount += digitCount > shortestDigitCount;
+    }
+
+    char lines[4][MaxTextRunLen] = {};
+    Vec3 boxMin = { -1.367188f, -0.984375f, -0.851562f };
+    Vec3 boxMax = { 1.367188f, 0.984375f, 0.851562f };
+    double snprintfSeconds = 0.0;
+    double builderSeconds = 0.0;
+    uint32_t lineMismatchCount = 0;
+    uint32_t totalLen = 0;
+    for(int frame = 0; frame < frameCount; frame++) {
+        float deltaTime = 0.0166f + (RandomFloat01(&rngState) * 0.002f);
+        uint32_t visibleCount = XorShift32(&rngState) % 9;
+
+        uint64_t startTicks = GetTicks();
+        uint32_t snprintfLen = FormatHudLinesWithSnprintf(lines, boxMin, boxMax, 1.71f, visibleCount, deltaTime);
+        snprintfSeconds += TicksToSeconds(GetTicks() - startTicks);
+        char referenceLines[4][MaxTextRunLen] = {};
+        memcpy(referenceLines, lines, sizeof(lines));
+
+        memset(lines, 0, sizeof(lines));
+        startTicks = GetTicks();
+        totalLen = FormatHudLinesWithTextBuilder(lines, boxMin, boxMax, 1.71f, visibleCount, deltaTime);
+        builderSeconds += TicksToSeconds(GetTicks() - startTicks);
+        lineMismatchCount += totalLen != snprintfLen || memcmp(lines, referenceLines, sizeof(lines)) != 0;
+    }
+
+    printf("format %u samples: %u int mismatches, %u fixed mismatches, %u round trip failures, %u longer than shortest\n",
+        sampleCount, intMismatchCount, fixedMismatchCount, roundTripFailCount, longerCount);
+    printf("4 HUD lines (%u chars): snprintf %.3f us, TextBuilder %.3f us (%.1fx), %u mismatching frames\n", totalLen,
+        (snprintfSeconds * 1000000.0) / frameCount, (builderSeconds * 1000000.0) / frameCount, snprintfSeconds / builderSeconds,
+        lineMismatchCount);
+    return intMismatchCount == 0 && fixedMismatchCount == 0 && roundTripFailCount == 0 && longerCount == 0 && lineMismatchCount == 0;
 }
 
-struct Dx11DepthStencilBuffer
+struct FrameTimeSnapshotCheck
 {
-    ID3D11Texture2D* buffer;
-    ID3D11DepthStencilView* view;
+    FrameTimeHistory* history;
+    volatile LONG isDone;
+    uint32_t snapshotCount;
+    uint32_t tornCount;
 };
 
-Dx11DepthStencilBuffer CreateDx11DepthStencilBuffer(UINT width, UINT height, Dx11* dx)
-{
-    D3D11_TEXTURE2D_DESC dsBufferDesc = {
-        .Width = width,
-        .Height = height,
-        .MipLevels = 1,
-        .ArraySize = 1,
-        .Format = DXGI_FORMAT_D24_UNORM_S8_UINT,
-        .SampleDesc = {
-            .Count = 1,
-            .Quality = 0
-        },
-        .Usage = D3D11_USAGE_DEFAULT,
-        .BindFlags = D3D11_BIND_DEPTH_STENCIL
-    };
+// the benchmark pushes the frame index as the frame time, so every copied entry can be checked against its slot
+void CheckFrameTimeSnapshotsTask(void* data, int threadIndex)
+{
+    FrameTimeSnapshotCheck* check = (FrameTimeSnapshotCheck*)data;
+    float* frameTimes = (float*)calloc(1, FrameTimeHistoryLen * sizeof(float));
+    ASSERT(frameTimes != nullptr);
+    while(!check->isDone) {
+        uint64_t firstFrameIndex = 0;
+        uint32_t count = CopyFrameTimeHistory(check->history, frameTimes, FrameTimeHistoryLen, &firstFrameIndex);
+        for(uint32_t i = 0; i < count; i++)
+            check->tornCount += frameTimes[i] != (float)((firstFrameIndex + i) & 0xFFFFF);
+        check->snapshotCount++;
+    }
+    free(frameTimes);
+}
 
-    ID3D11Texture2D* dsBuffer = nullptr;
-    HRESULT res = dx->device->CreateTexture2D(&dsBufferDesc, nullptr, &dsBuffer);
-    ASSERT(res == S_OK);
+// headless check of the rolling percentiles against sorting the window and of snapshots taken while frames
+// are pushed from another thread, run with --bench-frame-stats
+bool RunFrameTimeStatsBenchmark(TaskPool* pool, uint32_t frameCount, uint32_t checkInterval)
+{
+    FrameTimeHistory* history = CreateFrameTimeHistory();
+    float* window = (float*)calloc(1, FrameTimeWindowLen * sizeof(float));
+    uint64_t* keys = (uint64_t*)calloc(1, FrameTimeWindowLen * sizeof(uint64_t));
+    uint32_t* values = (uint32_t*)calloc(1, FrameTimeWindowLen * sizeof(uint32_t));
+    uint64_t* tempKeys = (uint64_t*)calloc(1, FrameTimeWindowLen * sizeof(uint64_t));
+    uint32_t* tempValues = (uint32_t*)calloc(1, FrameTimeWindowLen * sizeof(uint32_t));
+    ASSERT(window != nullptr && keys != nullptr && values != nullptr && tempKeys != nullptr && tempValues != nullptr);
+
+    // mostly 60 Hz with jitter, 2% stutters and the odd hitch past the last bin
+    uint32_t rngState = 0xF7A3;
+    double pushSeconds = 0.0;
+    double statsSeconds = 0.0;
+    uint32_t checkCount = 0;
+    uint32_t mismatchCount = 0;
+    FrameTimeStats stats = {};
+    for(uint32_t frame = 0; frame < frameCount; frame++) {
+        float roll = RandomFloat01(&rngState);
+        float frameTimeMs = 16.0f + (RandomFloat01(&rngState) * 1.5f);
+        if(roll < 0.001f)
+            frameTimeMs = 120.0f + (RandomFloat01(&rngState) * 200.0f);
+        else if(roll < 0.02f)
+            frameTimeMs = 25.0f + (RandomFloat01(&rngState) * 40.0f);
+
+        uint64_t startTicks = GetTicks();
+        PushFrameTime(history, frameTimeMs);
+        pushSeconds += TicksToSeconds(GetTicks() - startTicks);
+        if(frame % checkInterval != 0)
+            continue;
 
-    ID3D11DepthStencilView* dsBufferView = nullptr;
-    res = dx->device->CreateDepthStencilView(dsBuffer, nullptr, &dsBufferView);
-    ASSERT(res == S_OK);
+        startTicks = GetTicks();
+        stats = GetFrameTimeStats(*history);
+        statsSeconds += TicksToSeconds(GetTicks() - startTicks);
+
+        // positive floats sort like their bits
+        uint64_t firstFrameIndex = 0;
+        uint32_t windowCount = CopyFrameTimeHistory(history, window, FrameTimeWindowLen, &firstFrameIndex);
+        for(uint32_t i = 0; i < windowCount; i++) {
+            uint32_t bits = 0;
+            memcpy(&bits, &window[i], sizeof(bits));
+            keys[i] = bits;
+            values[i] = i;
+        }
+        RadixSortKeyValues(nullptr, keys, values, tempKeys, tempValues, windowCount, 32);
+
+        const uint32_t percentiles[3] = { 50, 95, 99 };
+        const float results[3] = { stats.p50Ms, stats.p95Ms, stats.p99Ms };
+        for(int i = 0; i < 3; i++) {
+            float exactMs = window[values[(((windowCount * percentiles[i]) + 99) / 100) - 1]];
+            float lastBinMs = (float)(FrameTimeBinCount - 1) * FrameTimeBinMs;
+            bool isClose = exactMs >= lastBinMs ? results[i] >= lastBinMs : fabsf(results[i] - exactMs) <= (FrameTimeBinMs * 0.5f) + 1e-4f;
+            mismatchCount += !isClose;
+        }
+        mismatchCount += stats.frameCount != windowCount || stats.maxMs != window[values[windowCount - 1]] ||
+            stats.lastMs != frameTimeMs;
+        checkCount++;
+    }
 
-    return {
-        .buffer = dsBuffer,
-        .view = dsBufferView
-    };
+    // snapshots need a second thread, the single core fallback pool only runs tasks inline
+    TaskPool* snapshotPool = GetTaskPoolTotalThreadCount(pool) > 1 ? pool : CreateTaskPool(1);
+    FrameTimeHistory* concurrentHistory = CreateFrameTimeHistory();
+    FrameTimeSnapshotCheck snapshotCheck = { .history = concurrentHistory };
+    volatile LONG snapshotCounter = 0;
+    PushTask(snapshotPool, CheckFrameTimeSnapshotsTask, &snapshotCheck, &snapshotCounter);
+    for(uint32_t frame = 0; frame < frameCount * 10; frame++)
+        PushFrameTime(concurrentHistory, (float)(frame & 0xFFFFF));
+    InterlockedExchange(&snapshotCheck.isDone, 1);
+    WaitForTasks(snapshotPool, &snapshotCounter);
+    if(snapshotPool != pool)
+        FreeTaskPool(snapshotPool);
+
+    printf("frame stats %u frames: push %.1f ns, stats %.2f us, p50 %.2f p95 %.2f p99 %.2f max %.2f ms, %u/%u checks off\n",
+        frameCount, (pushSeconds * 1000000000.0) / frameCount, (statsSeconds * 1000000.0) / checkCount,
+        stats.p50Ms, stats.p95Ms, stats.p99Ms, stats.maxMs, mismatchCount, checkCount);
+    printf("%u snapshots while pushing %u frames from another thread, %u torn entries\n", snapshotCheck.snapshotCount,
+        frameCount * 10, snapshotCheck.tornCount);
+
+    FreeFrameTimeHistory(concurrentHistory);
+    free(tempValues);
+    free(tempKeys);
+    free(values);
+    free(keys);
+    free(window);
+    FreeFrameTimeHistory(history);
+    return mismatchCount == 0 && snapshotCheck.tornCount == 0;
 }
 
-void FreeDx11DepthStencilBuffer(Dx11DepthStencilBuffer* dsBuffer)
-{
-    dsBuffer->buffer->Release();
-    dsBuffer->view->Release();
-    *dsBuffer = {};
+// every corner has to come back bit-identical through its index, the draw ranges have to tile the index buffer
+uint32_t CheckPackedModel(const PackedModel& packed, const Vec3* positions, const Vec3* normals, const Vec4* tangents,
+    uint32_t cornerCount, const uint32_t* submeshEnds, uint32_t submeshCount)
+{
+    uint32_t errorCount = 0;
+    errorCount += packed.indexCount != cornerCount || packed.drawRangeCount != submeshCount;
+    errorCount += packed.indexStride != (packed.vertexCount <= 0xFFFF ? sizeof(uint16_t) : sizeof(uint32_t));
+    for(uint32_t corner = 0; corner < cornerCount && packed.indexCount == cornerCount; corner++) {
+        uint32_t index = packed.indexStride == sizeof(uint16_t) ? ((const uint16_t*)packed.indices)[corner] : 
+            ((const uint32_t*)packed.indices)[corner];
+        ModelVertex vertex = GetModelVertexForCorner(positions, normals, tangents, corner);
+        errorCount += index >= packed.vertexCount || memcmp(&packed.vertices[index], &vertex, sizeof(vertex)) != 0;
+    }
+    uint32_t firstIndex = 0;
+    for(uint32_t i = 0; i < submeshCount && packed.drawRangeCount == submeshCount; i++) {
+        errorCount += packed.drawRanges[i].firstIndex != firstIndex || 
+            packed.drawRanges[i].firstIndex + packed.drawRanges[i].indexCount != submeshEnds[i];
+        firstIndex = submeshEnds[i];
+    }
+    return errorCount;
 }
 
-void ResizeDx11DepthStencilBuffer(Dx11DepthStencilBuffer* dsBuffer, UINT newWidth, UINT newHeight, Dx11* dx)
+// headless check and timing of the CPU packing stage behind Dx11ModelData, run with --bench-model-pack
+bool RunModelPackBenchmark(TaskPool* pool, int iterationCount)
 {
-    dx->context->OMSetRenderTargets(0, 0, 0);
-    FreeDx11DepthStencilBuffer(dsBuffer);
-    *dsBuffer = CreateDx11DepthStencilBuffer(newWidth, newHeight, dx);
-}
+    ObjModel model = LoadObjModel("res/monkey.obj", pool, 1e-5f);
+    uint32_t errorCount = 0;
 
-ID3D11DepthStencilState* CreateDx11DepthStencilState(Dx11* dx)
-{
-    D3D11_DEPTH_STENCIL_DESC stateDesc = {
-        .DepthEnable = TRUE,
-        .DepthWriteMask = D3D11_DEPTH_WRITE_MASK_ALL,
-        .DepthFunc = D3D11_COMPARISON_LESS,
-        .StencilEnable = FALSE,
-        .StencilReadMask = D3D11_DEFAULT_STENCIL_READ_MASK,
-        .StencilWriteMask = D3D11_DEFAULT_STENCIL_WRITE_MASK
+    // the whole model, then the same corners split into 3 submeshes on triangle boundaries
+    uint32_t wholeEnd = model.vertexCount;
+    uint32_t triangleCount = model.vertexCount / 3;
+    uint32_t splitEnds[3] = { (triangleCount / 3) * 3, ((triangleCount * 2) / 3) * 3, model.vertexCount };
+    struct ModelPackBenchConfig
+    {
+        const char* name;
+        const uint32_t* submeshEnds;
+        uint32_t submeshCount;
     };
+    const ModelPackBenchConfig configs[] = {
+        { "monkey", &wholeEnd, 1 },
+        { "monkey split", splitEnds, 3 }
+    };
+    for(const ModelPackBenchConfig& config : configs) {
+        double totalSeconds = 0.0;
+        PackedModel packed = {};
+        for(int iteration = 0; iteration < iterationCount; iteration++) {
+            FreePackedModel(&packed);
+            uint64_t startTicks = GetTicks();
+            packed = PackModelVertices(model.positions, model.normals, model.tangents, model.vertexCount,
+                config.submeshEnds, config.submeshCount);
+            totalSeconds += TicksToSeconds(GetTicks() - startTicks);
+        }
+        uint32_t packErrorCount = CheckPackedModel(packed, model.positions, model.normals, model.tangents, model.vertexCount,
+            config.submeshEnds, config.submeshCount);
+        errorCount += packErrorCount;
+
+        // the old layout was 3 separate streams of 40 bytes per corner in total
+        size_t streamBytes = model.vertexCount * (sizeof(Vec3) + sizeof(Vec3) + sizeof(Vec4));
+        size_t packedBytes = (packed.vertexCount * sizeof(ModelVertex)) + (packed.indexCount * packed.indexStride);
+        printf("%s: %u corners -> %u vertices, %u-bit indices, %u draw ranges, %zu -> %zu GPU bytes (%.1f%%), "
+            "%.3f ms to pack, %u errors\n", config.name, model.vertexCount, packed.vertexCount, packed.indexStride * 8, 
+            packed.drawRangeCount, streamBytes, packedBytes, (100.0 * (double)packedBytes) / (double)streamBytes,
+            (totalSeconds * 1000.0) / iterationCount, packErrorCount);
+        FreePackedModel(&packed);
+    }
 
-    ID3D11DepthStencilState* dsState = nullptr;
-    HRESULT res = dx->device->CreateDepthStencilState(&stateDesc, &dsState);
-    ASSERT(res == S_OK);
-    return dsState;
+    // position only, missing attributes are zero
+    uint32_t cubeEnd = ARRAY_LEN(cubeVertices);
+    PackedModel cube = PackModelVertices(cubeVertices, nullptr, nullptr, cubeEnd, &cubeEnd, 1);
+    uint32_t cubeErrorCount = CheckPackedModel(cube, cubeVertices, nullptr, nullptr, cubeEnd, &cubeEnd, 1);
+    cubeErrorCount += cube.vertexCount != 8;
+    printf("cube: %u corners -> %u vertices, %u errors\n", cubeEnd, cube.vertexCount, cubeErrorCount);
+    errorCount += cubeErrorCount;
+    FreePackedModel(&cube);
+
+    FreeObjModel(&model);
+    return errorCount == 0;
 }
 
-// ORIGINAL GOAL: 
-// =============================================
-// Load a textured 3D model from an .obj file 
-// with reference grid at 0.0.0, some info stats in corner and mouse drag controls and keyboard movement
-// =============================================
+int main(int argc, char** argv)
+{
+    if(argc > 1 && strncmp(argv[1], "--bench-", 8) == 0) {
+        TaskPool* benchTaskPool = CreateTaskPool(0);
+        bool isBenchPassing = true;
+        if(strcmp(argv[1], "--bench-occlusion") == 0)
+            RunOcclusionBenchmark(benchTaskPool, 1000000, 10);
+        else if(strcmp(argv[1], "--bench-adjacency") == 0)
+            RunCornerTableBenchmark(benchTaskPool, 1024, 5);
+        else if(strcmp(argv[1], "--bench-instances") == 0)
+            RunModelInstancesBenchmark(benchTaskPool, 100000, 20);
+        else if(strcmp(argv[1], "--bench-math") == 0)
+            isBenchPassing = RunMathBenchmark(1000000);
+        else if(strcmp(argv[1], "--bench-soa") == 0)
+            isBenchPassing = RunVec3x8Benchmark(1000003, 20);
+        else if(strcmp(argv[1], "--bench-scene") == 0)
+            isBenchPassing = RunSceneGraphBenchmark(100000, 0.01f, 50);
+        else if(strcmp(argv[1], "--bench-text") == 0)
+            RunTextBenchmark(10000, 200);
+        else if(strcmp(argv[1], "--bench-text-cache") == 0)
+            isBenchPassing = RunTextLayoutCacheBenchmark(512, 1000);
+        else if(strcmp(argv[1], "--bench-atlas") == 0)
+            isBenchPassing = RunGlyphAtlasBenchmark(384, 150, 200);
+        else if(strcmp(argv[1], "--bench-font-cache") == 0)
+            isBenchPassing = RunGlyphAtlasCacheBenchmark(5);
+        else if(strcmp(argv[1], "--bench-sdf") == 0)
+            isBenchPassing = RunSdfAtlasBenchmark(benchTaskPool, 2000, 48.0f, 3);
+        else if(strcmp(argv[1], "--bench-format") == 0)
+            isBenchPassing = RunFormatBenchmark(1000000, 100000);
+        else if(strcmp(argv[1], "--bench-frame-stats") == 0)
+            isBenchPassing = RunFrameTimeStatsBenchmark(benchTaskPool, 200000, 97);
+        else if(strcmp(argv[1], "--bench-model-pack") == 0)
+            isBenchPassing = RunModelPackBenchmark(benchTaskPool, 20);
+        else if(strcmp(argv[1], "--bench-pick") == 0)
+            isBenchPassing = RunPickBenchmark(benchTaskPool, "res/monkey.obj", 256);
+        else if(strcmp(argv[1], "--bench-bvh") == 0)
+            isBenchPassing = RunBvhBenchmark(benchTaskPool, "res/monkey.obj", 20, 100000, 2000);
+        else if(strcmp(argv[1], "--bench-cull") == 0)
+            isBenchPassing = RunCullBenchmark(1000003, 20);
+        else {
+            printf("unknown benchmark %s\n", argv[1]);
+            isBenchPassing = false;
+        }
+        FreeTaskPool(benchTaskPool);
+        return isBenchPassing ? 0 : 1;
+    }
 
-int main()
-{
     int windowWidth = 1280;
     int windowHeight = 720;
     HWND window = InitWindow(windowWidth, windowHeight, "objviewer");
@@ -2453,6 +11097,8 @@ int main()
 
     Dx11Program textProgram = CreateDx11ProgramFromFiles("res/textvs.hlsl", "res/textps.hlsl", sizeof(TextShaderData), &dx);
     ID3D11InputLayout* textInputLayout = CreateTextDx11InputLayout(&dx, textProgram.vsByteCode);
+    // same vertex shader and instance layout, only the pixel shader turns the distance into coverage
+    Dx11Program sdfTextProgram = CreateDx11ProgramFromFiles("res/textvs.hlsl", "res/textsdfps.hlsl", sizeof(TextShaderData), &dx);
 
     Dx11Program lineGridProgram = CreateDx11ProgramFromFiles("res/linegridvs.hlsl", "res/linegridps.hlsl", sizeof(LineGridShaderData), &dx);
     ID3D11InputLayout* lineGridInputLayout = CreateLineGridDx11InputLayout(&dx, lineGridProgram.vsByteCode);
@@ -2462,47 +11108,118 @@ int main()
         .scale = { 0.4f, 0.4f, 0.4f }
     };
     Dx11ModelData cubeDx11Model = CreateDx11ModelDataForCube(dx, cubeVertices, ARRAY_LEN(cubeVertices));
+    Aabb cubeBounds = { .min = { -0.5f, -0.5f, -0.5f }, .max = { 0.5f, 0.5f, 0.5f } };
+
+    TaskPool* taskPool = CreateTaskPool(0);
 
-    ObjModel monkeyObjModel = LoadModelFromObjFile("res/monkey.obj");
+    const char* modelFileName = "res/monkey.obj";
+    const float modelWeldEpsilon = 1e-5f;
+    ObjModel monkeyObjModel = LoadObjModel(modelFileName, taskPool, modelWeldEpsilon);
     Transform monkeyTransform = {
         .position = { 0.0f, 0.0f, 0.0f },
         .scale = { 1.0f, 1.0f, 1.0f },
-        .rotation = { toRadians(-90.0f), 0.0f, 0.0f }
+        .rotation = QuatFromAxisAngle({ 1.0f, 0.0f, 0.0f }, toRadians(-90.0f))
     };
     Dx11ModelData monkeyDx11Model = CreateDx11ModelDataFromObjModel(dx, monkeyObjModel);
 
-    LineGrid lineGrid = GenerateLineGrid(dx, 6, 6);
-
-    Dx11VertexBuffer textPositionVertexBuffer = CreateDx11VertexBuffer(dx, BufferUsageType::Static, quadVertices, 
-        sizeof(quadVertices), 3 * sizeof(float), 0);
-
-    FpsCam cam = CreateFpsCam({ 0.0f, 0.0f, 2.0f }, 5.0f, 6.0f, PerspectiveProjMat4(toRadians(45.0f), viewport.Width, viewport.Height, 0.1f, 100.0f));
+    Dx11Program phongInstancedProgram = CreateDx11ProgramFromFiles("res/phonginstancedvs.hlsl", "res/phongps.hlsl", 
+        sizeof(PhongInstancedShaderData), &dx);
+    ID3D11InputLayout* phongInstancedInputLayout = CreatePhongInstancedDx11InputLayout(&dx, phongInstancedProgram.vsByteCode);
+
+    // a field of small copies behind the main model
+    const int monkeyFieldSize = 32;
+    ModelInstances monkeyInstances = CreateModelInstances(monkeyFieldSize * monkeyFieldSize);
+    for(int z = 0; z < monkeyFieldSize; z++) {
+        for(int x = 0; x < monkeyFieldSize; x++) {
+            Transform transform = {
+                .position = { (x - (monkeyFieldSize / 2)) * 1.5f, 0.5f, -10.0f - (z * 1.5f) },
+                .scale = { 0.5f, 0.5f, 0.5f },
+                .rotation = QuatFromEuler({ toRadians(-90.0f), (x + z) * 0.3f, 0.0f })
+            };
+            AddModelInstance(&monkeyInstances, transform);
+        }
+    }
+    Dx11VertexBuffer monkeyInstanceVertexBuffer = CreateDx11VertexBuffer(dx, BufferUsageType::Dynamic, nullptr, 
+        monkeyInstances.capacity * sizeof(ModelInstanceData), sizeof(ModelInstanceData), 0);
+    bool showMonkeyInstances = true;
+
+    LineGrid lineGrid = GenerateLineGrid(dx);
+    FrameTimeGraph frameTimeGraph = CreateFrameTimeGraph(dx);
+
+    const uint32_t maxSceneObjects = 64;
+    // matrices are only recomputed for nodes whose transform changed
+    SceneGraph sceneGraph = CreateSceneGraph(maxSceneObjects);
+    uint32_t monkeyNode = AddSceneNode(&sceneGraph, InvalidSceneNode, monkeyTransform);
+    uint32_t cubeNode = AddSceneNode(&sceneGraph, InvalidSceneNode, cubeTransform);
+    CullBoxes sceneCullBoxes = CreateCullBoxes(maxSceneObjects);
+    uint32_t visibleIndices[maxSceneObjects] = {};
+    OcclusionBuffer occlusionBuffer = CreateOcclusionBuffer();
+
+    BoundingSphere monkeyWorldSphere = TransformBoundingSphere(monkeyObjModel.bounds.sphere, GetModelMatFromTransform(monkeyTransform));
+    FpsCam cam = CreateFpsCamFramingSphere(monkeyWorldSphere, toRadians(45.0f), viewport.Width, viewport.Height, 5.0f, 6.0f);
     ToggleCamControl(&cam, true);
 
     SetupRawMouseInput();
 
     Input input = {
-        .moveForward  = { .key = Vkey::Z },
-        .moveBackward = { .key = Vkey::S },
-        .moveLeft     = { .key = Vkey::Q },
-        .moveRight    = { .key = Vkey::D },
-        .moveDown     = { .key = Vkey::A },
-        .moveUp       = { .key = Vkey::Space },
-        .devToggle    = { .key = Vkey::F1 },
-        .dragModel    = { .key = Vkey::LeftMouse }
+        .moveForward      = { .key = Vkey::Z },
+        .moveBackward     = { .key = Vkey::S },
+        .moveLeft         = { .key = Vkey::Q },
+        .moveRight        = { .key = Vkey::D },
+        .moveDown         = { .key = Vkey::A },
+        .moveUp           = { .key = Vkey::Space },
+        .devToggle        = { .key = Vkey::F1 },
+        .toggleInstances  = { .key = Vkey::F2 },
+        .exportFrameTimes = { .key = Vkey::F3 },
+        .dragModel        = { .key = Vkey::LeftMouse }
     };
 
     Mat4 orthoProjMat = OrthoProjMat4(0.0f, viewport.Width, 0.0f, viewport.Height, 0.1f, 100.0f);
-    BakedCharMap bakedCharMap = BakeCharMapForFont("res/CourierPrime-Regular.ttf", 32.0f);
-    Dx11ShaderTexture2D bakedCharMapShaderTex = CreateDx11ShaderTextureForBakedCharMap(dx, bakedCharMap);
+    const char* hudFontName = "res/CourierPrime-Regular.ttf";
+    const float hudFontHeight = 32.0f;
+    // printable ASCII and Latin-1, enough for most file and material names
+    const uint32_t hudFirstCodepoint = 0x20;
+    const uint32_t hudCodepointCount = 0xE0;
+    char glyphAtlasCacheFilename[MAX_PATH] = {};
+    GetGlyphAtlasCacheFilename(hudFontName, hudFontHeight, hudFirstCodepoint, hudCodepointCount, 
+        glyphAtlasCacheFilename, sizeof(glyphAtlasCacheFilename));
+
+    uint64_t glyphAtlasStartTicks = GetTicks();
+    GlyphAtlas glyphAtlas = CreateGlyphAtlas(hudFontName, hudFontHeight, 1024, 1024, 4096);
+    bool isGlyphAtlasCached = PrewarmGlyphAtlas(&glyphAtlas, hudFirstCodepoint, hudCodepointCount, glyphAtlasCacheFilename);
+    printf("%s glyph atlas %s in %.2f ms\n", isGlyphAtlasCached ? "loaded" : "rasterized", glyphAtlasCacheFilename,
+        TicksToSeconds(GetTicks() - glyphAtlasStartTicks) * 1000.0);
+    Dx11ShaderTexture2D glyphAtlasShaderTex = CreateDx11ShaderTextureForGlyphAtlas(dx, glyphAtlas);
     ID3D11SamplerState* texSampler = CreateDx11TextureSampler(dx);
 
-    const size_t maxTextLen = 128;
-    char textBuffer[maxTextLen];
-    CharQuadInstanceData* textInstanceData = (CharQuadInstanceData*)calloc(1, maxTextLen * sizeof(CharQuadInstanceData));
-    ASSERT(textInstanceData != nullptr);
-    Dx11VertexBuffer textInstanceVertexBuffer = CreateDx11VertexBuffer(dx, BufferUsageType::Dynamic, textInstanceData, 
-        maxTextLen * sizeof(CharQuadInstanceData), sizeof(CharQuadInstanceData), 0);
+    // the title is drawn much larger than the atlas height to keep the sdf path exercised
+    uint32_t titleCodepoints[0x5F] = {};
+    for(uint32_t i = 0; i < ARRAY_LEN(titleCodepoints); i++)
+        titleCodepoints[i] = 0x20 + i;
+    uint64_t sdfAtlasStartTicks = GetTicks();
+    SdfAtlas sdfAtlas = CreateSdfAtlas(taskPool, hudFontName, 48.0f, titleCodepoints, ARRAY_LEN(titleCodepoints), 512);
+    printf("built %dx%d sdf atlas on %d threads in %.2f ms\n", sdfAtlas.width, sdfAtlas.height, 
+        GetTaskPoolTotalThreadCount(taskPool), TicksToSeconds(GetTicks() - sdfAtlasStartTicks) * 1000.0);
+    Dx11ShaderTexture2D sdfAtlasShaderTex = CreateDx11ShaderTextureForSdfAtlas(dx, sdfAtlas);
+    GlyphInstance titleGlyphs[64];
+    UINT titleGlyphCount = (UINT)GenerateSdfGlyphInstancesForUtf8StringAt(sdfAtlas, StringViewFromCString(modelFileName),
+        { 30.0f, 140.0f }, 72.0f, titleGlyphs, ARRAY_LEN(titleGlyphs), 0);
+    Dx11VertexBuffer titleInstanceVertexBuffer = CreateDx11VertexBuffer(dx, BufferUsageType::Static, titleGlyphs, 
+        titleGlyphCount * sizeof(GlyphInstance), sizeof(GlyphInstance), 0);
+
+    const uint32_t maxTextLen = 512;
+    char textBuffer[MaxTextRunLen];
+    GlyphRange textUploadRanges[MaxTextRuns];
+    TextLayoutCache hudText = CreateTextLayoutCache(maxTextLen);
+    Dx11VertexBuffer textInstanceVertexBuffer = CreateDx11VertexBuffer(dx, BufferUsageType::Updatable, hudText.glyphs, 
+        maxTextLen * sizeof(GlyphInstance), sizeof(GlyphInstance), 0);
+
+    FrameTimeHistory* frameTimeHistory = CreateFrameTimeHistory();
+    FrameTimeExport frameTimeExport = {
+        .history = frameTimeHistory,
+        .filename = "frametimes.csv"
+    };
+    const float frameTimeGraphPixelsPerMs = 3.0f;
 
     Timer timer = CreateTimer();
 
@@ -2519,10 +11236,16 @@ int main()
         {
             ResizeDx11Backbuffer(&backbuffer, (UINT)viewport.Width, (UINT)viewport.Height, &dx);
             ResizeDx11DepthStencilBuffer(&dsBuffer, (UINT)viewport.Width, (UINT)viewport.Height, &dx);
+            orthoProjMat = OrthoProjMat4(0.0f, viewport.Width, 0.0f, viewport.Height, 0.1f, 100.0f);
         }
 
         if(input.devToggle.keyDownTransitionCount)
             ToggleCamControl(&cam, !cam.isControlOn);
+        if(input.toggleInstances.keyDownTransitionCount)
+            showMonkeyInstances = !showMonkeyInstances;
+        // written on the pool, a second press while it runs is ignored
+        if(input.exportFrameTimes.keyDownTransitionCount && frameTimeExport.pendingCount == 0)
+            PushTask(taskPool, ExportFrameTimesTask, &frameTimeExport, &frameTimeExport.pendingCount);
 
         if(cam.isControlOn)
         {
@@ -2539,70 +11262,204 @@ int main()
         dx.context->ClearRenderTargetView(backbuffer.view, clearColor);
         dx.context->ClearDepthStencilView(dsBuffer.view, D3D11_CLEAR_DEPTH, 1.0f, 0.0f);
 
-        if(input.dragModel.isKeyDown) {
-            if(input.mouseMoveX != 0)
-                monkeyTransform.rotation.y += (input.mouseMoveX * timer.deltaTime);
-            if(input.mouseMoveY != 0)
-                monkeyTransform.rotation.x += (input.mouseMoveY * timer.deltaTime);
-        }
-
-        Mat4 monkeyModelMat = GetModelMatFromTransform(monkeyTransform);
-        Mat4 monkeyNormalMat = NormalMat4FromModelMat(monkeyModelMat);
-        PhongShaderData phongShaderData = {
-            .projViewMat = cam.projMat * cam.viewMat,
-            .modelMat = monkeyModelMat,
-            .normalMat = monkeyNormalMat,
-            .color = { 0.0f, 0.9f, 0.1f, 1.0f },
-            .lightPosition = cubeTransform.position,
-            .camPosition = cam.position
-        };
-        DrawDx11Model(dx, monkeyDx11Model, phongInputLayout, phongProgram, &phongShaderData, sizeof(phongShaderData));
+        // turns around the world axes no matter how the model is already rotated
+        if(input.dragModel.isKeyDown && (input.mouseMoveX != 0 || input.mouseMoveY != 0)) {
+            Quat dragRotation = QuatFromAxisAngle({ 0.0f, 1.0f, 0.0f }, (float)(input.mouseMoveX * timer.deltaTime)) *
+                QuatFromAxisAngle({ 1.0f, 0.0f, 0.0f }, (float)(input.mouseMoveY * timer.deltaTime));
+            SetSceneNodeRotation(&sceneGraph, monkeyNode, Normalize(dragRotation * sceneGraph.localRotations[monkeyNode]));
+        }
+        UpdateSceneGraph(&sceneGraph);
+
+        // both are roots, so their world matrices come straight from their local transforms
+        Mat4 monkeyModelMat = sceneGraph.worldMats[monkeyNode];
+        Mat4 monkeyInvModelMat = GetInverseModelMatFromTransform(GetSceneNodeLocalTransform(sceneGraph, monkeyNode), monkeyModelMat);
+
+        // the cursor is trapped in the center while the camera is controlled, so that's a crosshair pick
+        Ray pickRay = GetWorldRayFromScreenPosition((float)input.mousePosX, (float)input.mousePosY, viewport.Width, viewport.Height,
+            cam.projMat, cam.viewMat);
+        PickHit pickHit = {};
+        bool isModelPicked = PickObjModelTriangle(monkeyObjModel, monkeyInvModelMat, pickRay, &pickHit);
+
+        Mat4 cubeModelMat = sceneGraph.worldMats[cubeNode];
+        Mat4 projViewMat = cam.projMat * cam.viewMat;
+
+        ResetCullBoxes(&sceneCullBoxes);
+        uint32_t monkeyCullIndex = AddCullBox(&sceneCullBoxes, TransformAabb(monkeyObjModel.bounds.box, monkeyModelMat));
+        uint32_t cubeCullIndex = AddCullBox(&sceneCullBoxes, TransformAabb(cubeBounds, cubeModelMat));
+        uint32_t frustumVisibleCount = CullBoxesAgainstFrustum(sceneCullBoxes, ExtractFrustumPlanes(projViewMat), visibleIndices);
+
+        BeginOcclusionFrame(&occlusionBuffer, projViewMat);
+        AddOccluder(&occlusionBuffer, monkeyObjModel.positions, monkeyObjModel.vertexCount, monkeyModelMat);
+        AddOccluder(&occlusionBuffer, cubeVertices, ARRAY_LEN(cubeVertices), cubeModelMat);
+        RasterizeOccluders(taskPool, &occlusionBuffer);
+        uint32_t visibleCount = CullOccludedBoxes(taskPool, occlusionBuffer, sceneCullBoxes, visibleIndices, frustumVisibleCount);
+
+        for(uint32_t i = 0; i < visibleCount; i++) {
+            if(visibleIndices[i] == monkeyCullIndex) {
+                Mat4 monkeyNormalMat = sceneGraph.normalMats[monkeyNode];
+                PhongShaderData phongShaderData = {
+                    .projViewMat = projViewMat,
+                    .modelMat = monkeyModelMat,
+                    .normalMat = monkeyNormalMat,
+                    .color = { 0.0f, 0.9f, 0.1f, 1.0f },
+                    .lightPosition = sceneGraph.localPositions[cubeNode],
+                    .camPosition = cam.position
+                };
+                DrawDx11Model(dx, monkeyDx11Model, phongInputLayout, phongProgram, &phongShaderData, sizeof(phongShaderData));
+            }
+            else if(visibleIndices[i] == cubeCullIndex) {
+                BasicColorShaderData basicColorShaderData = {
+                    .xformMat = projViewMat * cubeModelMat,
+                    .color = { 1.0f, 1.0f, 1.0f, 1.0f } 
+                };
+                DrawDx11Model(dx, cubeDx11Model, basicColorInputLayout, basicColorProgram, &basicColorShaderData, sizeof(basicColorShaderData));
+            }
+        }
 
-        Mat4 cubeModelMat = GetModelMatFromTransform(cubeTransform);
-        BasicColorShaderData basicColorShaderData = {
-            .xformMat = cam.projMat * cam.viewMat * cubeModelMat,
-            .color = { 1.0f, 1.0f, 1.0f, 1.0f } 
-        };
-        DrawDx11Model(dx, cubeDx11Model, basicColorInputLayout, basicColorProgram, &basicColorShaderData, sizeof(basicColorShaderData));
+        if(showMonkeyInstances) {
+            RotateModelInstances(&monkeyInstances, QuatFromAxisAngle({ 0.0f, 1.0f, 0.0f }, (float)timer.deltaTime));
+            PackModelInstances(taskPool, &monkeyInstances);
+            UploadDataToBuffer(dx, monkeyInstanceVertexBuffer.buffer, monkeyInstances.instanceData,
+                monkeyInstances.count * sizeof(ModelInstanceData));
+
+            PhongInstancedShaderData phongInstancedShaderData = {
+                .projViewMat = projViewMat,
+                .color = { 0.9f, 0.6f, 0.1f, 1.0f },
+                .lightPosition = sceneGraph.localPositions[cubeNode],
+                .camPosition = cam.position
+            };
+            DrawDx11ModelInstanced(dx, monkeyDx11Model, monkeyInstanceVertexBuffer, monkeyInstances.count, phongInstancedInputLayout,
+                phongInstancedProgram, &phongInstancedShaderData, sizeof(phongInstancedShaderData));
+        }
 
         LineGridShaderData lineGridShaderData = {
-            .projViewMat = cam.projMat * cam.viewMat,
+            .projViewMat = projViewMat,
             .color = { 0.0f, 0.0f, 0.0f, 1.0f }
         };
         DrawLineGrid(dx, lineGrid, lineGridInputLayout, lineGridProgram, &lineGridShaderData, sizeof(lineGridShaderData));
 
         TextShaderData textShaderData = {
+            .orthoProjMat = orthoProjMat,
             .color = { 1.0f, 1.0f, 1.0f, 1.0f }
         };
 
-        size_t totalTextLen = 0;
-        memset(textBuffer, 0, maxTextLen);
-
-        sprintf(textBuffer, "frame time: %f (%d FPS)", timer.deltaTime, (int)(1.0f / timer.deltaTime));     
-        totalTextLen += GenerateQuadInstanceDataForStringAt(bakedCharMap,  StringViewFromCString(textBuffer), { 30.0f, 60.0f }, 
-            orthoProjMat, textInstanceData, maxTextLen, 0);
-
-        sprintf(textBuffer + totalTextLen + 1, "model vertices: %d", monkeyObjModel.vertexCount);     
-        totalTextLen += GenerateQuadInstanceDataForStringAt(bakedCharMap,  StringViewFromCString(textBuffer + totalTextLen + 1), { 30.0f, 35.0f }, 
-            orthoProjMat, textInstanceData, maxTextLen, totalTextLen);
+        // the runs are ordered from least to most often changing
+        BeginGlyphAtlasFrame(&glyphAtlas);
+        const MeshValidationReport& validation = monkeyObjModel.validation;
+        TextBuilder line = CreateTextBuilder(textBuffer, MaxTextRunLen);
+        AppendText(&line, STRING_VIEW("mesh: "));
+        AppendUint(&line, validation.degenerateTriangles);
+        AppendText(&line, STRING_VIEW(" degenerate, "));
+        AppendUint(&line, validation.zeroAreaTriangles);
+        AppendText(&line, STRING_VIEW(" zero area, "));
+        AppendUint(&line, validation.outOfRangeIndices);
+        AppendText(&line, STRING_VIEW(" bad indices, "));
+        AppendUint(&line, validation.nonManifoldEdges);
+        AppendText(&line, STRING_VIEW(" non-manifold, "));
+        AppendUint(&line, validation.boundaryLoops);
+        AppendText(&line, STRING_VIEW(" holes, "));
+        AppendUint(&line, validation.duplicateFaces);
+        AppendText(&line, STRING_VIEW(" duplicates"));
+        SetTextRun(&hudText, &glyphAtlas, 0, GetTextBuilderString(line), { 30.0f, 110.0f });
+
+        const ModelBounds& monkeyBounds = monkeyObjModel.bounds;
+        line = CreateTextBuilder(textBuffer, MaxTextRunLen);
+        AppendText(&line, STRING_VIEW("bounds: "));
+        AppendVec3Fixed(&line, monkeyBounds.box.min, 2);
+        AppendText(&line, STRING_VIEW("-"));
+        AppendVec3Fixed(&line, monkeyBounds.box.max, 2);
+        AppendText(&line, STRING_VIEW(" r "));
+        AppendFloatFixed(&line, monkeyBounds.sphere.radius, 2);
+        SetTextRun(&hudText, &glyphAtlas, 1, GetTextBuilderString(line), { 30.0f, 35.0f });
+
+        line = CreateTextBuilder(textBuffer, MaxTextRunLen);
+        if(isModelPicked) {
+            AppendText(&line, STRING_VIEW("pick: tri "));
+            AppendUint(&line, pickHit.triIndex);
+            AppendText(&line, STRING_VIEW(" bary "));
+            AppendVec3Fixed(&line, pickHit.barycentrics, 2);
+            AppendText(&line, STRING_VIEW(" at "));
+            AppendVec3Fixed(&line, pickHit.worldPosition, 2);
+        }
+        else {
+            AppendText(&line, STRING_VIEW("pick: none"));
+        }
+        SetTextRun(&hudText, &glyphAtlas, 2, GetTextBuilderString(line), { 30.0f, 10.0f });
+
+        line = CreateTextBuilder(textBuffer, MaxTextRunLen);
+        AppendText(&line, STRING_VIEW("model vertices: "));
+        AppendInt(&line, monkeyObjModel.vertexCount);
+        AppendText(&line, STRING_VIEW(", visible objects: "));
+        AppendUint(&line, visibleCount);
+        AppendText(&line, STRING_VIEW("/"));
+        AppendUint(&line, sceneCullBoxes.count);
+        AppendText(&line, STRING_VIEW(" ("));
+        AppendUint(&line, frustumVisibleCount - visibleCount);
+        AppendText(&line, STRING_VIEW(" occluded), instances: "));
+        AppendUint(&line, showMonkeyInstances ? monkeyInstances.count : 0);
+        SetTextRun(&hudText, &glyphAtlas, 3, GetTextBuilderString(line), { 30.0f, 60.0f });
+
+        FrameTimeStats frameTimeStats = GetFrameTimeStats(*frameTimeHistory);
+        line = CreateTextBuilder(textBuffer, MaxTextRunLen);
+        AppendText(&line, STRING_VIEW("frame "));
+        AppendFloatFixed(&line, frameTimeStats.lastMs, 2);
+        AppendText(&line, STRING_VIEW(" ms, p50 "));
+        AppendFloatFixed(&line, frameTimeStats.p50Ms, 2);
+        AppendText(&line, STRING_VIEW(" p95 "));
+        AppendFloatFixed(&line, frameTimeStats.p95Ms, 2);
+        AppendText(&line, STRING_VIEW(" p99 "));
+        AppendFloatFixed(&line, frameTimeStats.p99Ms, 2);
+        AppendText(&line, STRING_VIEW(" max "));
+        AppendFloatFixed(&line, frameTimeStats.maxMs, 2);
+        AppendText(&line, STRING_VIEW(" ("));
+        AppendInt(&line, (int)(1.0f / timer.deltaTime));
+        AppendText(&line, STRING_VIEW(" FPS)"));
+        SetTextRun(&hudText, &glyphAtlas, 4, GetTextBuilderString(line), { 30.0f, 85.0f });
+
+        uint32_t textUploadRangeCount = TakeTextLayoutDirtyRanges(&hudText, &glyphAtlas, textUploadRanges);
+        UploadGlyphAtlasDirtyRects(dx, &glyphAtlas, glyphAtlasShaderTex);
+        for(uint32_t i = 0; i < textUploadRangeCount; i++) {
+            const GlyphRange& range = textUploadRanges[i];
+            UploadDataToBufferRange(dx, textInstanceVertexBuffer.buffer, hudText.glyphs + range.first, 
+                range.first * sizeof(GlyphInstance), range.count * sizeof(GlyphInstance));
+        }
 
-        UploadDataToBuffer(dx, textInstanceVertexBuffer.buffer, textInstanceData, maxTextLen * sizeof(CharQuadInstanceData));
+        // top right corner, tall enough for FrameTimeGraphMaxMs
+        Vec2 frameTimeGraphOrigin = {
+            viewport.Width - 30.0f - (float)FrameTimeGraphBarCount,
+            viewport.Height - 30.0f - (FrameTimeGraphMaxMs * frameTimeGraphPixelsPerMs)
+        };
+        UpdateFrameTimeGraph(&frameTimeGraph, *frameTimeHistory, frameTimeStats, frameTimeGraphOrigin, frameTimeGraphPixelsPerMs);
+        DrawFrameTimeGraph(dx, frameTimeGraph, lineGridInputLayout, lineGridProgram, orthoProjMat);
 
-        DrawText(dx, totalTextLen, textPositionVertexBuffer, textInstanceVertexBuffer, textInputLayout, textProgram,
-            &textShaderData, sizeof(textShaderData), bakedCharMapShaderTex, texSampler);
+        DrawText(dx, hudText.glyphCount, textInstanceVertexBuffer, textInputLayout, textProgram,
+            &textShaderData, sizeof(textShaderData), glyphAtlasShaderTex, texSampler);
+        DrawText(dx, titleGlyphCount, titleInstanceVertexBuffer, textInputLayout, sdfTextProgram,
+            &textShaderData, sizeof(textShaderData), sdfAtlasShaderTex, texSampler);
 
         dx.swapchain->Present(1, 0);
         UpdateTimer(&timer);
+        PushFrameTime(frameTimeHistory, (float)(timer.deltaTime * 1000.0));
     }
 
-    free(textInstanceData);
+    WaitForTasks(taskPool, &frameTimeExport.pendingCount);
+    FreeFrameTimeHistory(frameTimeHistory);
+    FreeTextLayoutCache(&hudText);
     texSampler->Release();
-    FreeDx11ShaderTexture2D(&bakedCharMapShaderTex);
-    FreeBakedCharMap(&bakedCharMap);
+    FreeDx11ShaderTexture2D(&glyphAtlasShaderTex);
+    FreeGlyphAtlas(&glyphAtlas);
+    FreeDx11ShaderTexture2D(&sdfAtlasShaderTex);
+    FreeSdfAtlas(&sdfAtlas);
 
     FreeLineGrid(&lineGrid);
+    FreeFrameTimeGraph(&frameTimeGraph);
+    FreeSceneGraph(&sceneGraph);
+    FreeCullBoxes(&sceneCullBoxes);
+    FreeOcclusionBuffer(&occlusionBuffer);
 
     FreeDx11ModelData(&monkeyDx11Model);
+    FreeDx11VertexBuffer(&monkeyInstanceVertexBuffer);
+    FreeModelInstances(&monkeyInstances);
     FreeObjModel(&monkeyObjModel);
     
     FreeDx11ModelData(&cubeDx11Model);
@@ -2611,14 +11468,17 @@ int main()
     textInputLayout->Release();
     basicColorInputLayout->Release();
     phongInputLayout->Release();
+    phongInstancedInputLayout->Release();
 
     FreeDx11Program(&lineGridProgram);
     FreeDx11Program(&textProgram);
+    FreeDx11Program(&sdfTextProgram);
     FreeDx11Program(&basicColorProgram);
     FreeDx11Program(&phongProgram);
+    FreeDx11Program(&phongInstancedProgram);
 
     FreeDx11VertexBuffer(&textInstanceVertexBuffer);
-    FreeDx11VertexBuffer(&textPositionVertexBuffer);
+    FreeDx11VertexBuffer(&titleInstanceVertexBuffer);
     
     blendState->Release();
     rasterizerState->Release();
@@ -2626,6 +11486,7 @@ int main()
     FreeDx11DepthStencilBuffer(&dsBuffer);
     FreeDx11Backbuffer(&backbuffer);
     FreeDx11(&dx);
+    FreeTaskPool(taskPool);
     DestroyWindow(window);
     
     return 0;
@@ -0,0 +1,41 @@
+struct VsInput
+{
+    float3 position: POSITION;
+    float3 normal: NORMAL;
+    float4 tangent: TANGENT;
+    matrix modelMat: MATRIX;
+    matrix normalMat: NORMALMATRIX;
+};
+
+cbuffer Data : register(b0)
+{
+    matrix projViewMat;
+    float4 color;
+    float3 lightPosition;
+    float3 camPosition;
+};
+
+struct VsOutput
+{
+    float4 position : SV_POSITION;
+    float4 worldPosition : POSITION;
+    float4 color: COLOR;
+    float3 normal : NORMAL;
+    float3 lightPosition : LIGHT;
+    float3 camPosition : CAM;
+    float4 tangent : TANGENT;
+};
+
+VsOutput main(VsInput input)
+{
+    VsOutput output;
+    output.worldPosition = mul(input.modelMat, float4(input.position.xyz, 1.0f));
+    output.position = mul(projViewMat, output.worldPosition);
+    output.color = color;
+    output.normal = mul(input.normalMat, float4(input.normal, 0.0f)).xyz;
+    output.lightPosition = lightPosition;
+    output.camPosition = camPosition;
+    // w is the bitangent sign, bitangent = w * cross(normal, tangent)
+    output.tangent = float4(normalize(mul(input.modelMat, float4(input.tangent.xyz, 0.0f)).xyz), input.tangent.w);
+    return output;
+}
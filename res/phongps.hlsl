@@ -6,6 +6,7 @@ struct PsInput
     float3 normal : NORMAL;
     float3 lightPosition : LIGHT;
     float3 camPosition : CAM;
+    float4 tangent : TANGENT;
 };
 
 float4 main(PsInput input) : SV_TARGET
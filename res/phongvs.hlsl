@@ -2,6 +2,7 @@ struct VsInput
 {
     float3 position: POSITION;
     float3 normal: NORMAL;
+    float4 tangent: TANGENT;
 };
 
 cbuffer Data : register(b0)
@@ -22,6 +23,7 @@ struct VsOutput
     float3 normal : NORMAL;
     float3 lightPosition : LIGHT;
     float3 camPosition : CAM;
+    float4 tangent : TANGENT;
 };
 
 VsOutput main(VsInput input)
@@ -35,5 +37,7 @@ VsOutput main(VsInput input)
     output.normal = psNormal.xyz;
     output.lightPosition = lightPosition;
     output.camPosition = camPosition;
+    // w is the bitangent sign, bitangent = w * cross(normal, tangent)
+    output.tangent = float4(normalize(mul(modelMat, float4(input.tangent.xyz, 0.0f)).xyz), input.tangent.w);
     return output;
 }
\ No newline at end of file
@@ -0,0 +1,21 @@
+struct PsInput
+{
+    float4 position : SV_POSITION;
+    float4 color: COLOR;
+    float2 texCoord: TEXCOORD;
+};
+
+Texture2D<float> sdfFontTex : register(t0);
+SamplerState fontTexSampler : register(s0);
+
+// 128 / 255, the distance value on the glyph outline
+static const float onEdgeValue = 0.502f;
+
+float4 main(PsInput input) : SV_TARGET
+{
+    float distance = sdfFontTex.Sample(fontTexSampler, input.texCoord);
+    // about one screen pixel of smoothing at any text size
+    float smoothing = max(fwidth(distance) * 0.5f, 0.001f);
+    float alpha = smoothstep(onEdgeValue - smoothing, onEdgeValue + smoothing, distance);
+    return float4(input.color.xyz, alpha);
+}
@@ -1,12 +1,14 @@
 struct VsInput
 {
-    float3 position: POSITION;
-    matrix xformMat: MATRIX;
-    float2 texCoords[6]: TEXCOORD;
+    // x0, y0, x1, y1 in pixels
+    float4 screenRect: RECT;
+    // s0, t0, s1, t1, t0 is the top of the glyph in the atlas
+    float4 uvRect: UVRECT;
 };
 
 cbuffer Data : register(b0)
 {
+    matrix orthoProjMat;
     float4 color;
 };
 
@@ -17,11 +19,24 @@ struct VsOutput
     float2 texCoord: TEXCOORD;
 };
 
+// top left, bottom left, bottom right, bottom right, top right, top left
+static const float2 quadCorners[6] = {
+    float2(0.0f, 1.0f),
+    float2(0.0f, 0.0f),
+    float2(1.0f, 0.0f),
+    float2(1.0f, 0.0f),
+    float2(1.0f, 1.0f),
+    float2(0.0f, 1.0f)
+};
+
 VsOutput main(VsInput input, unsigned int vertexId : SV_VertexID)
 {
     VsOutput output;
-    output.position = mul(input.xformMat, float4(input.position.xyz, 1.0f));
+    float2 corner = quadCorners[vertexId];
+    float2 position = lerp(input.screenRect.xy, input.screenRect.zw, corner);
+    output.position = mul(orthoProjMat, float4(position, 0.0f, 1.0f));
     output.color = color;
-    output.texCoord = input.texCoords[vertexId];
+    // the atlas v goes down while the screen y goes up
+    output.texCoord = lerp(input.uvRect.xw, input.uvRect.zy, corner);
     return output;
-}
\ No newline at end of file
+}